@@ -26,8 +26,11 @@ public:
 
 public:
 
-    BDFactory(const Integer3& matrix_sizes = default_matrix_sizes(), Real bd_dt_factor = default_bd_dt_factor())
-        : base_type(), rng_(), matrix_sizes_(matrix_sizes), bd_dt_factor_(bd_dt_factor)
+    BDFactory(const Integer3& matrix_sizes = default_matrix_sizes(), Real bd_dt_factor = default_bd_dt_factor(),
+        const Integer num_threads = default_num_threads())
+        : base_type(), rng_(), matrix_sizes_(matrix_sizes), bd_dt_factor_(bd_dt_factor),
+        num_threads_(num_threads), space_type_(default_space_type()),
+        verlet_skin_(ParticleSpaceSoAImpl::default_verlet_skin())
     {
         ; // do nothing
     }
@@ -47,6 +50,16 @@ public:
         return -1.0;
     }
 
+    static inline const Integer default_num_threads()
+    {
+        return simulator_type::default_num_threads();
+    }
+
+    static inline const std::string default_space_type()
+    {
+        return "cell_list";
+    }
+
     this_type& rng(const std::shared_ptr<RandomNumberGenerator>& rng)
     {
         rng_ = rng;
@@ -58,13 +71,70 @@ public:
         return &(this->rng(rng));  //XXX: == this
     }
 
+    /**
+     * select the implementation of ParticleSpace, one of "cell_list"
+     * (ParticleSpaceCellListImpl), "vector", "rtree" and "soa".
+     * verlet_skin is only for "soa". see ParticleSpaceSoAImpl.
+     */
+    this_type& space_type(
+        const std::string& type,
+        const Real verlet_skin = ParticleSpaceSoAImpl::default_verlet_skin())
+    {
+        if (type != "cell_list" && type != "vector" && type != "rtree" && type != "soa")
+        {
+            throw IllegalArgument("Unknown space type [" + type + "] was given.");
+        }
+        space_type_ = type;
+        verlet_skin_ = verlet_skin;
+        return (*this);
+    }
+
 protected:
 
     virtual world_type* create_world(const Real3& edge_lengths) const
     {
-        if (rng_)
+        return create_world(edge_lengths, rng_);
+    }
+
+    /**
+     * keep the type of the space. A new generator is given to each world,
+     * and then its state is loaded from the file.
+     */
+    virtual world_type* load_world(const std::string& filename) const
+    {
+        std::unique_ptr<world_type> w(create_world(
+            ones(), std::shared_ptr<RandomNumberGenerator>(new GSLRandomNumberGenerator())));
+        w->load(filename);
+        return w.release();
+    }
+
+    world_type* create_world(
+        const Real3& edge_lengths, const std::shared_ptr<RandomNumberGenerator>& rng_or_null) const
+    {
+        if (space_type_ != "cell_list")
+        {
+            std::shared_ptr<RandomNumberGenerator> rng(rng_or_null);
+            if (!rng)
+            {
+                rng = std::shared_ptr<RandomNumberGenerator>(
+                    new GSLRandomNumberGenerator());
+                (*rng).seed();
+            }
+
+            if (space_type_ == "vector")
+            {
+                return create_bd_world_vector_impl(edge_lengths, rng);
+            }
+            else if (space_type_ == "rtree")
+            {
+                return create_bd_world_rtree_impl(edge_lengths, rng);
+            }
+            return create_bd_world_soa_impl(edge_lengths, matrix_sizes_, rng, verlet_skin_);
+        }
+
+        if (rng_or_null)
         {
-            return new world_type(edge_lengths, matrix_sizes_, rng_);
+            return new world_type(edge_lengths, matrix_sizes_, rng_or_null);
         }
         else
         {
@@ -77,11 +147,12 @@ protected:
     {
         if (bd_dt_factor_ > 0)
         {
-            return new simulator_type(w, m, bd_dt_factor_);
+            return new simulator_type(w, m, bd_dt_factor_, num_threads_);
         }
         else
         {
-            return new simulator_type(w, m);
+            return new simulator_type(
+                w, m, simulator_type::default_bd_dt_factor(), num_threads_);
         }
     }
 
@@ -90,6 +161,9 @@ protected:
     std::shared_ptr<RandomNumberGenerator> rng_;
     Integer3 matrix_sizes_;
     Real bd_dt_factor_;
+    Integer num_threads_;
+    std::string space_type_;
+    Real verlet_skin_;
 };
 
 } // bd
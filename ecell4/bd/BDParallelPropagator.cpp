@@ -0,0 +1,296 @@
+#include <cmath>
+
+#include "BDParallelPropagator.hpp"
+
+
+namespace ecell4
+{
+
+namespace bd
+{
+
+BDParallelPropagator::BDParallelPropagator(
+    Model& model, BDWorld& world, RandomNumberGenerator& rng, const Real& dt,
+    std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions,
+    ThreadPool& pool, const bool batched)
+    : base_type(model, world, rng, dt, last_reactions,
+        std::vector<std::pair<ParticleID, Particle> >()),
+    pool_(pool), matrix_sizes_(world.matrix_sizes())
+{
+    batched_ = batched;
+
+    const Real3& edge_lengths(world_.edge_lengths());
+    cell_sizes_ = Real3(
+        edge_lengths[0] / matrix_sizes_.col,
+        edge_lengths[1] / matrix_sizes_.row,
+        edge_lengths[2] / matrix_sizes_.layer);
+    const std::size_t num_cells(matrix_sizes_.col * matrix_sizes_.row * matrix_sizes_.layer);
+
+    // Sort particles into cells, and cells into colours.
+    const std::vector<std::pair<ParticleID, Particle> > particles(world_.list_particles());
+    std::vector<std::vector<std::size_t> > cells(num_cells);
+    for (std::size_t i(0); i < particles.size(); ++i)
+    {
+        cells[cell_index(particles[i].second.position())].push_back(i);
+        has_first_order_reactions(particles[i].second.species());  // cached here
+    }
+
+    std::vector<std::size_t> colors(27);
+    for (std::size_t c(0); c < colors.size(); ++c)
+    {
+        colors[c] = c;
+    }
+    shuffle(rng_, colors);
+
+    queue_.reserve(particles.size());
+    offsets_.push_back(0);
+    color_offsets_.push_back(0);
+    for (std::vector<std::size_t>::const_iterator c(colors.begin()); c != colors.end(); ++c)
+    {
+        for (Integer i((*c) / 9); i < matrix_sizes_.col; i += 3)
+        {
+            for (Integer j(((*c) / 3) % 3); j < matrix_sizes_.row; j += 3)
+            {
+                for (Integer k((*c) % 3); k < matrix_sizes_.layer; k += 3)
+                {
+                    const std::size_t idx((i * matrix_sizes_.row + j) * matrix_sizes_.layer + k);
+                    if (cells[idx].empty())
+                    {
+                        continue;
+                    }
+
+                    for (std::vector<std::size_t>::const_iterator p(cells[idx].begin());
+                        p != cells[idx].end(); ++p)
+                    {
+                        queue_.push_back(particles[*p]);
+                    }
+                    offsets_.push_back(queue_.size());
+                    cell_ids_.push_back(idx);
+                }
+            }
+        }
+        color_offsets_.push_back(cell_ids_.size());
+    }
+
+    destinations_.resize(queue_.size());
+    proposals_.resize(queue_.size());
+    placed_.resize(num_cells);
+
+    seed_ = rng_.uniform_int(0, 0x7fffffff) * 0x80000000LL + rng_.uniform_int(0, 0x7fffffff);
+}
+
+std::size_t BDParallelPropagator::cell_index(const Real3& pos) const
+{
+    // The same as ParticleSpaceCellListImpl::index
+    const std::size_t i(static_cast<std::size_t>(pos[0] / cell_sizes_[0]) % matrix_sizes_.col);
+    const std::size_t j(static_cast<std::size_t>(pos[1] / cell_sizes_[1]) % matrix_sizes_.row);
+    const std::size_t k(static_cast<std::size_t>(pos[2] / cell_sizes_[2]) % matrix_sizes_.layer);
+    return (i * matrix_sizes_.row + j) * matrix_sizes_.layer + k;
+}
+
+bool BDParallelPropagator::operator()()
+{
+    for (std::size_t c(0); c + 1 < color_offsets_.size(); ++c)
+    {
+        pool_.run([this, c](const std::size_t rank) { propose_color(c, rank); });
+        commit(c);
+    }
+    return false;
+}
+
+void BDParallelPropagator::propose_color(const std::size_t color, const std::size_t rank)
+{
+    std::vector<Real> buffer;
+    for (std::size_t s(color_offsets_[color] + rank); s < color_offsets_[color + 1];
+        s += pool_.num_threads())
+    {
+        propose(s, buffer);
+    }
+}
+
+void BDParallelPropagator::propose(const std::size_t slice, std::vector<Real>& buffer)
+{
+    // This must not modify anything but the slice.
+    PhiloxRandomNumberGenerator rng(seed_, cell_ids_[slice]);
+    const std::size_t begin(offsets_[slice]), end(offsets_[slice + 1]);
+
+    for (std::size_t i(end - begin); i > 1; --i)
+    {
+        std::swap(queue_[begin + i - 1], queue_[begin + rng.uniform_int(0, i - 1)]);
+    }
+
+    if (batched_)
+    {
+        // x, y and z of each particle are stored at i, n + i and 2n + i.
+        const std::size_t n(end - begin);
+        buffer.resize(3 * n);
+        rng.fill_gaussian(&buffer[0], 3 * n, 1.0);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            const Particle& particle(queue_[begin + i].second);
+            const Real sigma(std::sqrt(2.0 * particle.D() * dt_));
+            destinations_[begin + i] = world_.apply_boundary(particle.position()
+                + Real3(buffer[i], buffer[n + i], buffer[2 * n + i]) * sigma);
+        }
+    }
+
+    for (std::size_t i(begin); i < end; ++i)
+    {
+        const ParticleID& pid(queue_[i].first);
+        const Particle& particle(queue_[i].second);
+        if (particle.D() == 0 || (*first_order_.find(particle.species())).second)
+        {
+            proposals_[i] = SERIAL;
+            continue;
+        }
+
+        if (!batched_)
+        {
+            Real displacement[3];
+            rng.fill_gaussian(displacement, 3, std::sqrt(2.0 * particle.D() * dt_));
+            destinations_[i] = world_.apply_boundary(
+                particle.position() + Real3(displacement[0], displacement[1], displacement[2]));
+        }
+        const Real3& newpos(destinations_[i]);
+        proposals_[i] = (
+            world_.has_overlap(newpos, particle.radius(), pid) ? MOVE : FREE);
+    }
+}
+
+void BDParallelPropagator::commit(const std::size_t color)
+{
+    for (std::size_t i(offsets_[color_offsets_[color]]);
+        i < offsets_[color_offsets_[color + 1]]; ++i)
+    {
+        const ParticleID& pid(queue_[i].first);
+        const Particle& particle(queue_[i].second);
+        if (!removed_.empty() && removed_.find(pid) != removed_.end())
+        {
+            continue;
+        }
+
+        if (proposals_[i] == FREE && !overlaps(destinations_[i], particle.radius()))
+        {
+            world_.update_particle_without_checking(
+                pid, Particle(particle.species(), destinations_[i],
+                    particle.radius(), particle.D()));
+            place(destinations_[i], particle.radius());
+            continue;
+        }
+
+        const std::size_t num_reactions(last_reactions_.size());
+        if (proposals_[i] == SERIAL)
+        {
+            // The same as BDPropagator::operator()
+            if (!attempt_reaction(pid, particle) && particle.D() != 0)
+            {
+                propagate(pid, particle, batched_ ? destinations_[i] : world_.apply_boundary(
+                    particle.position() + draw_displacement(particle)));
+            }
+        }
+        else
+        {
+            propagate(pid, particle, destinations_[i]);
+        }
+
+        // Remember where particles are placed for the following proposals.
+        if (last_reactions_.size() > num_reactions)
+        {
+            for (std::size_t j(num_reactions); j < last_reactions_.size(); ++j)
+            {
+                const reaction_info_type::container_type&
+                    products(last_reactions_[j].second.products());
+                for (reaction_info_type::container_type::const_iterator
+                    k(products.begin()); k != products.end(); ++k)
+                {
+                    place((*k).second.position(), (*k).second.radius());
+                }
+            }
+        }
+        else if (world_.has_particle(pid))
+        {
+            const Particle p(world_.get_particle(pid).second);
+            place(p.position(), p.radius());
+        }
+    }
+
+    for (std::vector<std::size_t>::const_iterator i(touched_.begin());
+        i != touched_.end(); ++i)
+    {
+        placed_[*i].clear();
+    }
+    touched_.clear();
+}
+
+void BDParallelPropagator::place(const Real3& pos, const Real& radius)
+{
+    const std::size_t idx(cell_index(pos));
+    if (placed_[idx].empty())
+    {
+        touched_.push_back(idx);
+    }
+    placed_[idx].push_back(std::make_pair(pos, radius));
+}
+
+bool BDParallelPropagator::overlaps(const Real3& pos, const Real& radius) const
+{
+    if (touched_.empty())
+    {
+        return false;
+    }
+
+    // Look up the same neighbouring cells as list_particles_within_radius.
+    const Integer sizes[3] = {matrix_sizes_.col, matrix_sizes_.row, matrix_sizes_.layer};
+    std::vector<Integer> candidates[3];
+    for (std::size_t dim(0); dim < 3; ++dim)
+    {
+        const Integer idx(static_cast<Integer>(pos[dim] / cell_sizes_[dim]) % sizes[dim]);
+        if (sizes[dim] < 3)
+        {
+            for (Integer i(0); i < sizes[dim]; ++i)
+            {
+                candidates[dim].push_back(i);
+            }
+        }
+        else
+        {
+            candidates[dim].push_back((idx + sizes[dim] - 1) % sizes[dim]);
+            candidates[dim].push_back(idx);
+            candidates[dim].push_back((idx + 1) % sizes[dim]);
+        }
+    }
+
+    for (std::vector<Integer>::const_iterator i(candidates[0].begin());
+        i != candidates[0].end(); ++i)
+    {
+        for (std::vector<Integer>::const_iterator j(candidates[1].begin());
+            j != candidates[1].end(); ++j)
+        {
+            for (std::vector<Integer>::const_iterator k(candidates[2].begin());
+                k != candidates[2].end(); ++k)
+            {
+                const std::vector<std::pair<Real3, Real> >&
+                    placed(placed_[((*i) * sizes[1] + (*j)) * sizes[2] + (*k)]);
+                for (std::vector<std::pair<Real3, Real> >::const_iterator
+                    p(placed.begin()); p != placed.end(); ++p)
+                {
+                    if (world_.distance(pos, (*p).first) - (*p).second < radius)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void BDParallelPropagator::remove_particle(const ParticleID& pid)
+{
+    world_.remove_particle(pid);
+    removed_.insert(pid);
+}
+
+} // bd
+
+} // ecell4
@@ -0,0 +1,105 @@
+#ifndef ECELL4_BD_BD_PARALLEL_PROPAGATOR_HPP
+#define ECELL4_BD_BD_PARALLEL_PROPAGATOR_HPP
+
+#include <unordered_set>
+
+#include <ecell4/core/ThreadPool.hpp>
+
+#include "BDPropagator.hpp"
+
+
+namespace ecell4
+{
+
+namespace bd
+{
+
+/**
+ * BDPropagator on multiple threads.
+ * Cells of the cell list are coloured by their indices modulo 3, so that
+ * cells of the same colour don't share any neighbouring cell (if the matrix
+ * sizes are multiples of 3). Colours are processed one by one in a random order.
+ * First, new positions of particles in cells of the colour are proposed
+ * concurrently without modifying the world. Each cell draws random numbers
+ * from its own stream of PhiloxRandomNumberGenerator seeded once a step.
+ * Proposals are made on the threads of the given pool, which is kept by
+ * the caller across steps. In the batched mode, displacements of all
+ * particles in a cell are drawn at once, including those going through
+ * the serial path below.
+ * Then, proposals are committed on a single thread in a fixed order.
+ * A move free from overlaps is accepted as it is, unless a particle placed
+ * before in the same colour overlaps with it. Collisions, reactions and
+ * the others go through the serial path of BDPropagator.
+ * Thus, the result is the same as that of BDPropagator processing particles
+ * in the same order, and doesn't depend on the number of threads.
+ */
+class BDParallelPropagator
+    : public BDPropagator
+{
+public:
+
+    typedef BDPropagator base_type;
+
+public:
+
+    BDParallelPropagator(
+        Model& model, BDWorld& world, RandomNumberGenerator& rng, const Real& dt,
+        std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions,
+        ThreadPool& pool, const bool batched = false);
+
+    /**
+     * propagate all particles at once.
+     * @return always false
+     */
+    bool operator()();
+
+    inline Integer num_threads() const
+    {
+        return pool_.num_threads();
+    }
+
+    void remove_particle(const ParticleID& pid);
+
+protected:
+
+    enum proposal_type
+    {
+        SERIAL = 0,  // first-order reactions or no diffusion
+        MOVE = 1,  // overlapped at the new position
+        FREE = 2
+    };
+
+    std::size_t cell_index(const Real3& pos) const;
+
+    void propose(const std::size_t slice, std::vector<Real>& buffer);
+    void propose_color(const std::size_t color, const std::size_t rank);
+    void commit(const std::size_t color);
+    bool overlaps(const Real3& pos, const Real& radius) const;
+    void place(const Real3& pos, const Real& radius);
+
+protected:
+
+    ThreadPool& pool_;
+    Integer3 matrix_sizes_;
+    Real3 cell_sizes_;
+    Integer seed_;
+
+    /**
+     * particles in the i-th cell (slice) are queue_[offsets_[i], offsets_[i + 1]),
+     * and slices of the c-th colour are [color_offsets_[c], color_offsets_[c + 1]).
+     */
+    std::vector<std::size_t> offsets_;
+    std::vector<std::size_t> cell_ids_;
+    std::vector<std::size_t> color_offsets_;
+    std::vector<char> proposals_;  // in the same order as queue_
+
+    std::unordered_set<ParticleID> removed_;
+    std::vector<std::vector<std::pair<Real3, Real> > > placed_;  // for each cell
+    std::vector<std::size_t> touched_;
+};
+
+} // bd
+
+} // ecell4
+
+#endif /* ECELL4_BD_BD_PARALLEL_PROPAGATOR_HPP */
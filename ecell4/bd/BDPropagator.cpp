@@ -1,4 +1,5 @@
 #include <iterator>
+#include <cmath>
 
 #include <ecell4/core/exceptions.hpp>
 #include <ecell4/core/Species.hpp>
@@ -19,6 +20,28 @@ bool BDPropagator::operator()()
         return false;
     }
 
+    if (batched_)
+    {
+        // Particles in the queue are never modified by the others' reactions,
+        // but removed. Thus the copy in the queue is still up to date.
+        const ParticleID pid(queue_.back().first);
+        const Particle particle(queue_.back().second);
+        const Real3 newpos(destinations_.back());
+        queue_.pop_back();
+        destinations_.pop_back();
+
+        if (has_first_order_reactions(particle.species())
+            && attempt_reaction(pid, particle))
+        {
+            return true;
+        }
+        else if (particle.D() == 0)
+        {
+            return true;
+        }
+        return propagate(pid, particle, newpos);
+    }
+
     const ParticleID pid(queue_.back().first);
     queue_.pop_back();
     Particle particle(world_.get_particle(pid).second);
@@ -37,23 +60,38 @@ bool BDPropagator::operator()()
     const Real3 newpos(
         world_.apply_boundary(
             particle.position() + draw_displacement(particle)));
+    return propagate(pid, particle, newpos);
+}
+
+bool BDPropagator::propagate(
+    const ParticleID& pid, const Particle& particle, const Real3& newpos)
+{
     Particle particle_to_update(
         particle.species(), newpos, particle.radius(), particle.D());
     // Particle particle_to_update(
     //     particle.species_serial(), newpos, particle.radius(), particle.D());
-    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
-        overlapped(world_.list_particles_within_radius(
-                       newpos, particle.radius(), pid));
+    // Count overlapping particles up to two, remembering the first one.
+    std::size_t num_overlapped(0);
+    std::pair<ParticleID, Particle> closest;
+    world_.for_each_particle_within_radius(
+        newpos, particle.radius(), pid,
+        [&num_overlapped, &closest](const ParticleView& view, const Real& dist)
+        {
+            if (++num_overlapped == 1)
+            {
+                closest.first = view.pid();
+                closest.second = view.particle();
+            }
+            return num_overlapped < 2;
+        });
 
-    switch (overlapped.size())
+    switch (num_overlapped)
     {
     case 0:
         world_.update_particle_without_checking(pid, particle_to_update);
         return true;
     case 1:
         {
-            std::pair<ParticleID, Particle> closest(
-                (*(overlapped.begin())).first);
             if (attempt_reaction(
                     pid, particle_to_update, closest.first, closest.second))
             {
@@ -66,6 +104,62 @@ bool BDPropagator::operator()()
     }
 }
 
+void BDPropagator::draw_destinations()
+{
+    const std::size_t n(queue_.size());
+    destinations_.resize(n);
+    if (n == 0)
+    {
+        return;
+    }
+
+    // x, y and z of each particle are stored at i, n + i and 2n + i.
+    std::vector<Real> positions(3 * n), displacements(3 * n), sigmas(n);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        const Particle& particle(queue_[i].second);
+        const Real3& pos(particle.position());
+        positions[i] = pos[0];
+        positions[n + i] = pos[1];
+        positions[2 * n + i] = pos[2];
+        sigmas[i] = std::sqrt(2.0 * particle.D() * dt_);
+    }
+
+    rng_.fill_gaussian(&displacements[0], 3 * n, 1.0);
+
+    const Real3& edge_lengths(world_.edge_lengths());
+    for (std::size_t dim(0); dim < 3; ++dim)
+    {
+        const Real L(edge_lengths[dim]), invL(1.0 / edge_lengths[dim]);
+        Real* x(&positions[dim * n]);
+        const Real* dx(&displacements[dim * n]);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            const Real y(x[i] + sigmas[i] * dx[i]);
+            const Real z(y - L * std::floor(y * invL));
+            x[i] = (z < L ? z : 0.0);  // the same as apply_boundary
+        }
+    }
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        destinations_[i] = Real3(positions[i], positions[n + i], positions[2 * n + i]);
+    }
+}
+
+bool BDPropagator::has_first_order_reactions(const Species& sp)
+{
+    std::unordered_map<Species, bool>::const_iterator i(first_order_.find(sp));
+    if (i != first_order_.end())
+    {
+        return (*i).second;
+    }
+
+    const bool retval(model_.query_reaction_rules(sp).size() > 0);
+    first_order_.insert(std::make_pair(sp, retval));
+    return retval;
+}
+
 bool BDPropagator::attempt_reaction(
     const ParticleID& pid, const Particle& particle)
 {
@@ -103,10 +197,7 @@ bool BDPropagator::attempt_reaction(
                     const Real radius_new(info.radius);
                     const Real D_new(info.D);
 
-                    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
-                        overlapped(world_.list_particles_within_radius(
-                                       particle.position(), radius_new, pid));
-                    if (overlapped.size() > 0)
+                    if (world_.has_overlap(particle.position(), radius_new, pid))
                     {
                         // throw NoSpace("");
                         return false;
@@ -154,15 +245,8 @@ bool BDPropagator::attempt_reaction(
                             particle.position() + ipv * (D1 / D12));
                         newpos2 = world_.apply_boundary(
                             particle.position() - ipv * (D2 / D12));
-                        std::vector<
-                            std::pair<std::pair<ParticleID, Particle>, Real> >
-                            overlapped1(world_.list_particles_within_radius(
-                                            newpos1, radius1, pid));
-                        std::vector<
-                            std::pair<std::pair<ParticleID, Particle>, Real> >
-                            overlapped2(world_.list_particles_within_radius(
-                                            newpos2, radius2, pid));
-                        if (overlapped1.size() == 0 && overlapped2.size() == 0)
+                        if (!world_.has_overlap(newpos1, radius1, pid)
+                            && !world_.has_overlap(newpos2, radius2, pid))
                         {
                             break;
                         }
@@ -255,10 +339,7 @@ bool BDPropagator::attempt_reaction(
                     const Real3 newpos(
                         world_.apply_boundary((pos1 * D2 + pos2 * D1) / D12));
 
-                    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
-                        overlapped(world_.list_particles_within_radius(
-                                       newpos, radius_new, pid1, pid2));
-                    if (overlapped.size() > 0)
+                    if (world_.has_overlap(newpos, radius_new, pid1, pid2))
                     {
                         // throw NoSpace("");
                         return false;
@@ -295,6 +376,10 @@ void BDPropagator::remove_particle(const ParticleID& pid)
         i(std::find_if(queue_.begin(), queue_.end(), cmp));
     if (i != queue_.end())
     {
+        if (batched_)
+        {
+            destinations_.erase(destinations_.begin() + (i - queue_.begin()));
+        }
         queue_.erase(i);
     }
 }
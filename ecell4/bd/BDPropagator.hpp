@@ -1,6 +1,8 @@
 #ifndef ECELL4_BD_BD_PROPAGATOR_HPP
 #define ECELL4_BD_BD_PROPAGATOR_HPP
 
+#include <unordered_map>
+
 #include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/Model.hpp>
 
@@ -73,18 +75,38 @@ public:
 
 public:
 
+    /**
+     * @param batched if true, displacements of all particles are drawn at once
+     * in the constructor. See draw_destinations.
+     */
     BDPropagator(
         Model& model, BDWorld& world, RandomNumberGenerator& rng, const Real& dt,
-        std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions)
+        std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions,
+        const bool batched = false)
         : model_(model), world_(world), rng_(rng), dt_(dt),
-        last_reactions_(last_reactions), max_retry_count_(1)
+        last_reactions_(last_reactions), max_retry_count_(1), batched_(batched)
     {
         queue_ = world_.list_particles();
         shuffle(rng_, queue_);
+
+        if (batched_)
+        {
+            draw_destinations();
+        }
+    }
+
+    virtual ~BDPropagator()
+    {
+        ;
     }
 
     bool operator()();
 
+    inline bool batched() const
+    {
+        return batched_;
+    }
+
     inline Real dt() const
     {
         return dt_;
@@ -121,7 +143,7 @@ public:
         ParticleID pid_;
     };
 
-    void remove_particle(const ParticleID& pid);
+    virtual void remove_particle(const ParticleID& pid);
 
     inline Real3 draw_displacement(const Particle& particle)
     {
@@ -133,6 +155,32 @@ public:
         return random_ipv_3d(rng(), sigma, t, D);
     }
 
+protected:
+
+    /**
+     * take the queue as it is, for subclasses ordering particles in their own way.
+     */
+    BDPropagator(
+        Model& model, BDWorld& world, RandomNumberGenerator& rng, const Real& dt,
+        std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions,
+        const std::vector<std::pair<ParticleID, Particle> >& queue)
+        : model_(model), world_(world), rng_(rng), dt_(dt),
+        last_reactions_(last_reactions), max_retry_count_(1), queue_(queue), batched_(false)
+    {
+        ;
+    }
+
+    /**
+     * draw new positions of all particles in the queue in one pass.
+     * Positions are gathered into a structure of arrays, and displacements
+     * are given by a single call of RandomNumberGenerator::fill_gaussian,
+     * so that the loop has no branch nor virtual call.
+     */
+    void draw_destinations();
+
+    bool propagate(const ParticleID& pid, const Particle& particle, const Real3& newpos);
+    bool has_first_order_reactions(const Species& sp);
+
 protected:
 
     Model& model_;
@@ -143,6 +191,10 @@ protected:
     Integer max_retry_count_;
 
     BDWorld::particle_container_type queue_;
+
+    bool batched_;
+    std::vector<Real3> destinations_;  // in the same order as queue_
+    std::unordered_map<Species, bool> first_order_;
 };
 
 } // bd
@@ -66,8 +66,18 @@ void BDSimulator::step()
         }
     }
 
+    if (pool_)
     {
-        BDPropagator propagator(*model_, *world_, *rng(), dt(), last_reactions_);
+        BDParallelPropagator propagator(
+            *model_, *world_, *rng(), dt(), last_reactions_, *pool_, batched_);
+        while (propagator())
+        {
+            ; // do nothing here
+        }
+    }
+    else
+    {
+        BDPropagator propagator(*model_, *world_, *rng(), dt(), last_reactions_, batched_);
         while (propagator())
         {
             ; // do nothing here
@@ -8,6 +8,7 @@
 
 #include "BDWorld.hpp"
 #include "BDPropagator.hpp"
+#include "BDParallelPropagator.hpp"
 
 
 namespace ecell4
@@ -28,18 +29,35 @@ public:
 
     BDSimulator(
         std::shared_ptr<BDWorld> world, std::shared_ptr<Model> model,
-        Real bd_dt_factor = 1e-5)
-        : base_type(world, model), dt_(0), bd_dt_factor_(bd_dt_factor), dt_set_by_user_(false)
+        Real bd_dt_factor = default_bd_dt_factor(),
+        const Integer num_threads = default_num_threads())
+        : base_type(world, model), dt_(0), bd_dt_factor_(bd_dt_factor), dt_set_by_user_(false),
+        batched_(false), num_threads_(num_threads),
+        pool_(num_threads > 1 ? new ThreadPool(num_threads) : NULL)
     {
         initialize();
     }
 
-    BDSimulator(std::shared_ptr<BDWorld> world, Real bd_dt_factor = 1e-5)
-        : base_type(world), dt_(0), bd_dt_factor_(bd_dt_factor), dt_set_by_user_(false)
+    BDSimulator(
+        std::shared_ptr<BDWorld> world, Real bd_dt_factor = default_bd_dt_factor(),
+        const Integer num_threads = default_num_threads())
+        : base_type(world), dt_(0), bd_dt_factor_(bd_dt_factor), dt_set_by_user_(false),
+        batched_(false), num_threads_(num_threads),
+        pool_(num_threads > 1 ? new ThreadPool(num_threads) : NULL)
     {
         initialize();
     }
 
+    static inline const Real default_bd_dt_factor()
+    {
+        return 1e-5;
+    }
+
+    static inline const Integer default_num_threads()
+    {
+        return 1;
+    }
+
     // SimulatorTraits
 
     void initialize()
@@ -127,6 +145,33 @@ public:
         dt_set_by_user_ = true;
     }
 
+    /**
+     * if true, displacements of all particles in a step are drawn at once
+     * (see BDPropagator::draw_destinations). Trajectories differ from those
+     * in the default mode with the same seed, but not in distribution.
+     * This also applies to BDParallelPropagator with multiple threads.
+     */
+    bool batched() const
+    {
+        return batched_;
+    }
+
+    void set_batched(const bool batched)
+    {
+        batched_ = batched;
+    }
+
+    /**
+     * With multiple threads, particles are propagated by BDParallelPropagator.
+     * Trajectories differ from those on a single thread, but don't depend on
+     * the number of threads as far as it's more than one.
+     * Threads are kept alive in a pool while the simulator exists.
+     */
+    Integer num_threads() const
+    {
+        return num_threads_;
+    }
+
     inline std::shared_ptr<RandomNumberGenerator> rng()
     {
         return (*world_).rng();
@@ -145,6 +190,9 @@ protected:
     Real dt_;
     const Real bd_dt_factor_;
     bool dt_set_by_user_;
+    bool batched_;
+    Integer num_threads_;
+    std::shared_ptr<ThreadPool> pool_;  // kept across steps if multithreaded
     std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions_;
 };
 
@@ -10,6 +10,8 @@
 #include <ecell4/core/SerialIDGenerator.hpp>
 #include <ecell4/core/ParticleSpace.hpp>
 #include <ecell4/core/ParticleSpaceCellListImpl.hpp>
+#include <ecell4/core/ParticleSpaceRTreeImpl.hpp>
+#include <ecell4/core/ParticleSpaceSoAImpl.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/WorldInterface.hpp>
 
@@ -55,6 +57,16 @@ public:
         ;
     }
 
+    /**
+     * create a world with the given particle space.
+     * the world takes the ownership of the space.
+     */
+    BDWorld(ParticleSpace* space, std::shared_ptr<RandomNumberGenerator> rng)
+        : ps_(space), rng_(rng)
+    {
+        ;
+    }
+
     BDWorld(const std::string& filename)
         : ps_(new particle_space_type(Real3(1, 1, 1)))
     {
@@ -77,7 +89,7 @@ public:
         // {
         //     throw AlreadyExists("particle already exists");
         // }
-        if (list_particles_within_radius(p.position(), p.radius()).size() == 0)
+        if (!has_overlap(p.position(), p.radius()))
         {
             (*ps_).update_particle(pid, p); //XXX: DONOT call this->update_particle
             return std::make_pair(std::make_pair(pid, p), true);
@@ -146,6 +158,25 @@ public:
         return (*ps_).edge_lengths();
     }
 
+    /**
+     * return the sizes of the cell list. the whole space is regarded as
+     * a single cell when the particle space has no cell list.
+     */
+    const Integer3 matrix_sizes() const
+    {
+        if (const particle_space_type* ps
+            = dynamic_cast<const particle_space_type*>(ps_.get()))
+        {
+            return ps->matrix_sizes();
+        }
+        else if (const ParticleSpaceSoAImpl* ps
+            = dynamic_cast<const ParticleSpaceSoAImpl*>(ps_.get()))
+        {
+            return ps->matrix_sizes();
+        }
+        return Integer3(1, 1, 1);
+    }
+
     Integer num_particles() const
     {
         return (*ps_).num_particles();
@@ -205,8 +236,7 @@ public:
 
     bool update_particle(const ParticleID& pid, const Particle& p)
     {
-        if (list_particles_within_radius(p.position(), p.radius(), pid).size()
-            == 0)
+        if (!has_overlap(p.position(), p.radius(), pid))
         {
             return (*ps_).update_particle(pid, p);
         }
@@ -249,6 +279,36 @@ public:
         return (*ps_).list_particles_within_radius(pos, radius, ignore1, ignore2);
     }
 
+    template <typename Tfn_>
+    bool for_each_particle_within_radius(
+        const Real3& pos, const Real& radius, Tfn_ fn) const
+    {
+        return (*ps_).for_each_particle_within_radius(pos, radius, fn);
+    }
+
+    template <typename Tfn_>
+    bool for_each_particle_within_radius(
+        const Real3& pos, const Real& radius, const ParticleID& ignore, Tfn_ fn) const
+    {
+        return (*ps_).for_each_particle_within_radius(pos, radius, ignore, fn);
+    }
+
+    template <typename Tfn_>
+    bool for_each_particle_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1, const ParticleID& ignore2, Tfn_ fn) const
+    {
+        return (*ps_).for_each_particle_within_radius(pos, radius, ignore1, ignore2, fn);
+    }
+
+    bool has_overlap(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const
+    {
+        return (*ps_).has_overlap(pos, radius, ignore1, ignore2);
+    }
+
     inline Real3 periodic_transpose(
         const Real3& pos1, const Real3& pos2) const
     {
@@ -326,11 +386,6 @@ public:
         return rng_;
     }
 
-    const particle_container_type& particles() const
-    {
-        return (*ps_).particles();
-    }
-
     void save(const std::string& filename) const
     {
 #ifdef WITH_HDF5
@@ -409,6 +464,34 @@ protected:
     std::weak_ptr<Model> model_;
 };
 
+inline BDWorld* create_bd_world_cell_list_impl(
+    const Real3& edge_lengths, const Integer3& matrix_sizes,
+    const std::shared_ptr<RandomNumberGenerator>& rng)
+{
+    return new BDWorld(new ParticleSpaceCellListImpl(edge_lengths, matrix_sizes), rng);
+}
+
+inline BDWorld* create_bd_world_vector_impl(
+    const Real3& edge_lengths, const std::shared_ptr<RandomNumberGenerator>& rng)
+{
+    return new BDWorld(new ParticleSpaceVectorImpl(edge_lengths), rng);
+}
+
+inline BDWorld* create_bd_world_rtree_impl(
+    const Real3& edge_lengths, const std::shared_ptr<RandomNumberGenerator>& rng)
+{
+    return new BDWorld(new ParticleSpaceRTreeImpl(edge_lengths), rng);
+}
+
+inline BDWorld* create_bd_world_soa_impl(
+    const Real3& edge_lengths, const Integer3& matrix_sizes,
+    const std::shared_ptr<RandomNumberGenerator>& rng,
+    const Real verlet_skin = ParticleSpaceSoAImpl::default_verlet_skin())
+{
+    return new BDWorld(
+        new ParticleSpaceSoAImpl(edge_lengths, matrix_sizes, verlet_skin), rng);
+}
+
 } // bd
 
 } // ecell4
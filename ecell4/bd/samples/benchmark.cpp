@@ -0,0 +1,68 @@
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/Species.hpp>
+#include <ecell4/core/Real3.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+
+#include <ecell4/bd/BDFactory.hpp>
+
+using namespace ecell4;
+using namespace ecell4::bd;
+
+/**
+ * run BD steps and return the elapsed time in seconds
+ */
+double run(BDFactory& factory, const Integer num_particles, const Integer num_steps)
+{
+    const Real L(1e-6);
+    const Real3 edge_lengths(L, L, L);
+
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 2.5e-9, 1e-12);
+    model->add_species_attribute(sp1);
+
+    std::shared_ptr<BDWorld> world(factory.world(edge_lengths));
+    world->bind_to(model);
+    world->add_molecules(sp1, num_particles);
+
+    std::shared_ptr<BDSimulator> sim(factory.simulator(world, model));
+    sim->set_dt(1e-7);
+
+    const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+    for (Integer i(0); i < num_steps; ++i)
+    {
+        sim->step();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * compare implementations of ParticleSpace for BDSimulator
+ */
+int main(int argc, char** argv)
+{
+    const Integer num_particles(argc > 1 ? std::atoi(argv[1]) : 10000);
+    const Integer num_steps(argc > 2 ? std::atoi(argv[2]) : 100);
+    const Integer3 matrix_sizes(30, 30, 30);  // cells of 3.3e-8
+
+    const std::string types[] = {"cell_list", "vector", "rtree", "soa", "soa"};
+    const Real skins[] = {0.0, 0.0, 0.0, 0.0, 1e-8};
+    for (std::size_t i(0); i < 5; ++i)
+    {
+        if (types[i] == "vector" && num_particles > 10000)
+        {
+            continue;  // too slow
+        }
+
+        std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+        BDFactory factory(matrix_sizes);
+        factory.rng(rng).space_type(types[i], skins[i]);
+        std::cout << std::setw(10) << types[i] << " (skin=" << skins[i] << "): "
+            << run(factory, num_particles, num_steps) << " sec" << std::endl;
+    }
+}
@@ -9,6 +9,7 @@
 
 #include <ecell4/core/NetworkModel.hpp>
 #include "../BDSimulator.hpp"
+#include "../BDFactory.hpp"
 
 using namespace ecell4;
 using namespace ecell4::bd;
@@ -59,3 +60,193 @@ BOOST_AUTO_TEST_CASE(BDSimulator_test_step2)
     BDSimulator target(world, model);
     target.step();
 }
+
+/**
+ * check the mean squared displacement of 1000 particles after a step.
+ */
+static void check_diffusion(
+    const std::shared_ptr<RandomNumberGenerator>& rng, const Integer3& matrix_sizes,
+    const Integer num_threads, const bool batched)
+{
+    const Real L(1e-6);
+    const Real3 edge_lengths(L, L, L);
+
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 1e-10, 1e-12);
+    model->add_species_attribute(sp1);
+
+    std::shared_ptr<BDWorld> world(new BDWorld(edge_lengths, matrix_sizes, rng));
+    world->add_molecules(sp1, 1000);
+    const std::vector<std::pair<ParticleID, Particle> > particles(world->list_particles());
+
+    const Real dt(1e-6);
+    BDSimulator target(world, model, BDSimulator::default_bd_dt_factor(), num_threads);
+    target.set_batched(batched);
+    target.set_dt(dt);
+    BOOST_CHECK_EQUAL(target.batched(), batched);
+    target.step();
+
+    BOOST_CHECK_EQUAL(world->num_particles(sp1), 1000);
+    Real msd(0.0);
+    for (std::vector<std::pair<ParticleID, Particle> >::const_iterator i(particles.begin());
+        i != particles.end(); ++i)
+    {
+        const Real3 pos((*i).second.position());
+        const Real3 newpos(world->get_particle((*i).first).second.position());
+        BOOST_CHECK(newpos[0] >= 0 && newpos[0] < L);
+        BOOST_CHECK(newpos[1] >= 0 && newpos[1] < L);
+        BOOST_CHECK(newpos[2] >= 0 && newpos[2] < L);
+        msd += length_sq(world->periodic_transpose(newpos, pos) - pos);
+    }
+    msd /= particles.size();
+    BOOST_CHECK_CLOSE(msd, 6.0 * 1e-12 * dt, 10.0);
+}
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_batched_diffusion)
+{
+    check_diffusion(std::shared_ptr<RandomNumberGenerator>(
+        new PhiloxRandomNumberGenerator(1)), Integer3(3, 3, 3), 1, true);
+}
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_batched_reactions)
+{
+    const Real L(1e-7);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(3, 3, 3);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 2.5e-9, 1e-12), sp2("B", 2.5e-9, 1e-12), sp3("C", 2.5e-9, 1e-12);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 1e-19));
+
+    std::shared_ptr<BDWorld> world(new BDWorld(edge_lengths, matrix_sizes, rng));
+    world->add_molecules(sp1, 50);
+    world->add_molecules(sp2, 50);
+
+    BDSimulator target(world, model);
+    target.set_batched(true);
+    target.set_dt(1e-7);
+    Integer num_reactions(0);
+    for (unsigned int i(0); i < 300; ++i)
+    {
+        target.step();
+        num_reactions += target.last_reactions().size();
+        BOOST_CHECK_EQUAL(
+            world->num_particles(sp1) + world->num_particles(sp3), 50);
+        BOOST_CHECK_EQUAL(
+            world->num_particles(sp2) + world->num_particles(sp3), 50);
+    }
+    BOOST_CHECK(num_reactions > 0);
+}
+
+static std::shared_ptr<BDWorld> run_parallel(const Integer num_threads, const bool batched)
+{
+    const Real L(1e-7);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(6, 6, 6);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 2.5e-9, 1e-12), sp2("B", 2.5e-9, 1e-12), sp3("C", 2.5e-9, 1e-12);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 1e-19));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 1e+4));
+
+    std::shared_ptr<BDWorld> world(new BDWorld(edge_lengths, matrix_sizes, rng));
+    world->add_molecules(sp1, 100);
+    world->add_molecules(sp2, 100);
+
+    BDSimulator target(world, model, BDSimulator::default_bd_dt_factor(), num_threads);
+    BOOST_CHECK_EQUAL(target.num_threads(), num_threads);
+    target.set_batched(batched);
+    target.set_dt(1e-7);
+    for (unsigned int i(0); i < 100; ++i)
+    {
+        target.step();
+        BOOST_CHECK_EQUAL(world->num_particles(sp1) + world->num_particles(sp3), 100);
+        BOOST_CHECK_EQUAL(world->num_particles(sp2) + world->num_particles(sp3), 100);
+    }
+    return world;
+}
+
+static void check_parallel(const bool batched)
+{
+    std::shared_ptr<BDWorld> world1(run_parallel(2, batched)), world2(run_parallel(3, batched));
+
+    std::vector<std::pair<ParticleID, Particle> >
+        particles1(world1->list_particles()), particles2(world2->list_particles());
+    BOOST_CHECK_EQUAL(particles1.size(), particles2.size());
+    for (std::vector<std::pair<ParticleID, Particle> >::const_iterator
+        i(particles1.begin()); i != particles1.end(); ++i)
+    {
+        BOOST_CHECK(world2->has_particle((*i).first));
+        const Particle p(world2->get_particle((*i).first).second);
+        BOOST_CHECK_EQUAL((*i).second.species().serial(), p.species().serial());
+        BOOST_CHECK_EQUAL((*i).second.position()[0], p.position()[0]);
+        BOOST_CHECK_EQUAL((*i).second.position()[1], p.position()[1]);
+        BOOST_CHECK_EQUAL((*i).second.position()[2], p.position()[2]);
+
+        // No overlap with the others
+        BOOST_CHECK_EQUAL(world1->list_particles_within_radius(
+            (*i).second.position(), (*i).second.radius(), (*i).first).size(), 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_parallel)
+{
+    check_parallel(false);
+    check_parallel(true);
+}
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_parallel_diffusion)
+{
+    check_diffusion(std::shared_ptr<RandomNumberGenerator>(
+        new GSLRandomNumberGenerator(1)), Integer3(9, 9, 9), 4, false);
+    check_diffusion(std::shared_ptr<RandomNumberGenerator>(
+        new GSLRandomNumberGenerator(1)), Integer3(9, 9, 9), 4, true);
+}
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_soa_space)
+{
+    const Real L(1e-7);
+    const Real3 edge_lengths(L, L, L);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 2.5e-9, 1e-12), sp2("B", 2.5e-9, 1e-12), sp3("C", 2.5e-9, 1e-12);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 1e-19));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 1e+4));
+
+    BDFactory factory(Integer3(6, 6, 6));
+    factory.rng(rng).space_type("soa", 5e-9);
+    BOOST_CHECK_THROW(BDFactory().space_type("unknown"), IllegalArgument);
+    std::shared_ptr<BDWorld> world(factory.world(edge_lengths));
+    BOOST_CHECK_EQUAL(world->matrix_sizes(), Integer3(6, 6, 6));
+    world->add_molecules(sp1, 100);
+    world->add_molecules(sp2, 100);
+
+    std::shared_ptr<BDSimulator> target(factory.simulator(world, model));
+    target->set_dt(1e-7);
+    for (unsigned int i(0); i < 300; ++i)
+    {
+        target->step();
+        BOOST_CHECK_EQUAL(world->num_particles(sp1) + world->num_particles(sp3), 100);
+        BOOST_CHECK_EQUAL(world->num_particles(sp2) + world->num_particles(sp3), 100);
+    }
+
+    const std::vector<std::pair<ParticleID, Particle> > particles(world->list_particles());
+    for (std::vector<std::pair<ParticleID, Particle> >::const_iterator
+        i(particles.begin()); i != particles.end(); ++i)
+    {
+        BOOST_CHECK(!world->has_overlap(
+            (*i).second.position(), (*i).second.radius(), (*i).first));
+    }
+}
@@ -0,0 +1,260 @@
+#ifndef ECELL4_COMPACT_PARTICLE_HPP
+#define ECELL4_COMPACT_PARTICLE_HPP
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <unordered_map>
+
+#include "types.hpp"
+#include "Real3.hpp"
+#include "Species.hpp"
+#include "Particle.hpp"
+#include "Identifier.hpp"
+#include "exceptions.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * A compact representation of Particle for the storage of particle spaces.
+ * Species and Location are replaced with an index of ParticleSpeciesTable,
+ * so that copying it never touches strings on the heap.
+ */
+class CompactParticle
+{
+public:
+
+    typedef std::int32_t species_index_type;
+
+public:
+
+    CompactParticle()
+    {
+        ;
+    }
+
+    CompactParticle(
+        const species_index_type& idx, const Real3& pos,
+        const Real& radius, const Real& D)
+        : position_(pos), radius_(radius), D_(D), species_index_(idx)
+    {
+        ;
+    }
+
+    const Real3& position() const
+    {
+        return position_;
+    }
+
+    const Real& radius() const
+    {
+        return radius_;
+    }
+
+    const Real& D() const
+    {
+        return D_;
+    }
+
+    const species_index_type& species_index() const
+    {
+        return species_index_;
+    }
+
+private:
+
+    Real3 position_;
+    Real radius_, D_;
+    species_index_type species_index_;
+};
+
+template<typename Tstrm_, typename Ttraits_>
+inline std::basic_ostream<Tstrm_, Ttraits_>& operator<<(
+    std::basic_ostream<Tstrm_, Ttraits_>& strm, const CompactParticle& p)
+{
+    strm << "CompactParticle(" << "{ " << p.position() << ", " << p.radius() << "}, "
+        << ", D=" << p.D() << ", " << p.species_index() << ")";
+    return strm;
+}
+
+/**
+ * A table interning pairs of Species and Location as dense indices.
+ * Species are identified by their serials as Particle::operator== does.
+ * Entries are never removed until clear() is called.
+ */
+class ParticleSpeciesTable
+{
+public:
+
+    typedef CompactParticle::species_index_type species_index_type;
+    typedef Particle::Location location_type;
+
+public:
+
+    species_index_type find(const Species& sp, const location_type& loc = "") const
+    {
+        const index_map_type::const_iterator i(index_map_.find(sp.serial()));
+        if (i == index_map_.end())
+        {
+            return -1;
+        }
+
+        for (std::vector<species_index_type>::const_iterator j((*i).second.begin());
+            j != (*i).second.end(); ++j)
+        {
+            if (locations_[*j] == loc)
+            {
+                return *j;
+            }
+        }
+        return -1;
+    }
+
+    species_index_type intern(const Species& sp, const location_type& loc = "")
+    {
+        const species_index_type idx(find(sp, loc));
+        if (idx >= 0)
+        {
+            return idx;
+        }
+
+        if (species_.size() >= static_cast<std::size_t>(
+            std::numeric_limits<species_index_type>::max()))
+        {
+            throw IllegalState("Too many species are interned.");
+        }
+
+        const species_index_type newidx(static_cast<species_index_type>(species_.size()));
+        species_.push_back(sp);
+        locations_.push_back(loc);
+        index_map_[sp.serial()].push_back(newidx);
+        return newidx;
+    }
+
+    inline const Species& species(const species_index_type& idx) const
+    {
+        return species_[idx];
+    }
+
+    inline const location_type& location(const species_index_type& idx) const
+    {
+        return locations_[idx];
+    }
+
+    inline std::size_t size() const
+    {
+        return species_.size();
+    }
+
+    void clear()
+    {
+        species_.clear();
+        locations_.clear();
+        index_map_.clear();
+    }
+
+    CompactParticle compact(const Particle& p)
+    {
+        return CompactParticle(
+            intern(p.species(), p.location()), p.position(), p.radius(), p.D());
+    }
+
+    Particle particle(const CompactParticle& p) const
+    {
+        return Particle(
+            species_[p.species_index()], p.position(), p.radius(), p.D(),
+            locations_[p.species_index()]);
+    }
+
+protected:
+
+    typedef std::unordered_map<Species::serial_type, std::vector<species_index_type> >
+        index_map_type;
+
+    std::vector<Species> species_;
+    std::vector<location_type> locations_;
+    index_map_type index_map_;
+};
+
+/**
+ * A view of a particle found by a neighbour query of a particle space.
+ * It holds the ID and the compact form of the particle, and refers to
+ * the species table (or the Particle) in the space, so that making it
+ * never touches the heap. Particle is built only when particle() is called.
+ * A view is valid only while the space is not modified.
+ */
+class ParticleView
+{
+public:
+
+    typedef CompactParticle::species_index_type species_index_type;
+
+public:
+
+    ParticleView(
+        const ParticleID& pid, const CompactParticle& p, const ParticleSpeciesTable& table)
+        : pid_(pid), compact_(p), table_(&table), particle_(NULL)
+    {
+        ;
+    }
+
+    /**
+     * a view of Particle for spaces without a species table.
+     * species_index() is -1.
+     */
+    ParticleView(const ParticleID& pid, const Particle& p)
+        : pid_(pid), compact_(-1, p.position(), p.radius(), p.D()),
+        table_(NULL), particle_(&p)
+    {
+        ;
+    }
+
+    const ParticleID& pid() const
+    {
+        return pid_;
+    }
+
+    const Real3& position() const
+    {
+        return compact_.position();
+    }
+
+    const Real& radius() const
+    {
+        return compact_.radius();
+    }
+
+    const Real& D() const
+    {
+        return compact_.D();
+    }
+
+    const species_index_type& species_index() const
+    {
+        return compact_.species_index();
+    }
+
+    const Species& species() const
+    {
+        return (table_ != NULL
+            ? table_->species(compact_.species_index()) : particle_->species());
+    }
+
+    Particle particle() const
+    {
+        return (table_ != NULL ? table_->particle(compact_) : *particle_);
+    }
+
+private:
+
+    ParticleID pid_;
+    CompactParticle compact_;
+    const ParticleSpeciesTable* table_;
+    const Particle* particle_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_COMPACT_PARTICLE_HPP */
@@ -1,6 +1,8 @@
 #include "Context.hpp"
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <set>
 
 
 namespace ecell4
@@ -594,6 +596,200 @@ Species format_species(const Species& sp)
     return newsp;
 }
 
+inline void hash_combine(std::size_t& seed, const std::size_t& value)
+{
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+compiled_species compile_species(const Species& sp)
+{
+    typedef compiled_species::name_type name_type;
+    typedef compiled_species::mask_type mask_type;
+
+    const std::hash<std::string> hasher;
+    const std::vector<UnitSpecies> units(sp.units());
+
+    compiled_species res;
+    res.names.reserve(units.size());
+    res.site_masks.reserve(units.size());
+    res.labels.reserve(units.size());
+
+    std::unordered_map<std::string, std::pair<unsigned int, name_type> > open_bonds;
+    for (unsigned int idx(0); idx < units.size(); ++idx)
+    {
+        const UnitSpecies& usp(units[idx]);
+
+        name_type name(0);
+        if (!is_wildcard(usp.name()))
+        {
+            name = hasher(usp.name());
+            if (name == 0)
+            {
+                name = 1;  // zero is reserved for wildcards
+            }
+        }
+
+        mask_type mask(0);
+        std::size_t label(hasher(usp.name()));
+        for (UnitSpecies::container_type::const_iterator i(usp.begin());
+            i != usp.end(); ++i)
+        {
+            const name_type site(hasher((*i).first));
+            mask |= (mask_type(1) << (site % 64));
+            hash_combine(label, site);
+            hash_combine(label, hasher((*i).second.first));
+
+            const std::string& bond((*i).second.second);
+            if (bond == "" || is_wildcard(bond))
+            {
+                hash_combine(label, hasher(bond));
+                continue;
+            }
+
+            hash_combine(label, 1);  // bonded
+            std::unordered_map<std::string, std::pair<unsigned int, name_type> >::iterator
+                it(open_bonds.find(bond));
+            if (it == open_bonds.end())
+            {
+                open_bonds.insert(std::make_pair(bond, std::make_pair(idx, site)));
+            }
+            else
+            {
+                const compiled_species::bond_type b = {
+                    (*it).second.first, idx, (*it).second.second, site};
+                res.bonds.push_back(b);
+                open_bonds.erase(it);
+            }
+        }
+
+        res.names.push_back(name);
+        res.site_masks.push_back(mask);
+        res.labels.push_back(label);
+    }
+
+    std::vector<name_type> names(res.names);
+    std::sort(names.begin(), names.end());
+    for (std::vector<name_type>::const_iterator i(names.begin()); i != names.end(); ++i)
+    {
+        if ((*i) == 0)
+        {
+            continue;
+        }
+        else if (res.signature.size() > 0 && res.signature.back().first == (*i))
+        {
+            ++res.signature.back().second;
+        }
+        else
+        {
+            res.signature.push_back(std::make_pair((*i), 1u));
+        }
+    }
+    return res;
+}
+
+bool may_match(const compiled_species& pttrn, const compiled_species& sp)
+{
+    typedef std::vector<std::pair<compiled_species::name_type, unsigned int> >
+        signature_type;
+
+    if (pttrn.names.size() > sp.names.size())
+    {
+        return false;
+    }
+
+    // Each named unit in the pattern needs a unit of its own.
+    signature_type::const_iterator j(sp.signature.begin());
+    for (signature_type::const_iterator i(pttrn.signature.begin());
+        i != pttrn.signature.end(); ++i)
+    {
+        while (j != sp.signature.end() && (*j).first < (*i).first)
+        {
+            ++j;
+        }
+        if (j == sp.signature.end() || (*j).first != (*i).first
+            || (*j).second < (*i).second)
+        {
+            return false;
+        }
+    }
+
+    // Each unit in the pattern needs a unit with all the sites.
+    for (std::size_t i(0); i < pttrn.names.size(); ++i)
+    {
+        bool found(false);
+        for (std::size_t k(0); k < sp.names.size() && !found; ++k)
+        {
+            found = ((pttrn.names[i] == 0 || pttrn.names[i] == sp.names[k])
+                     && (pttrn.site_masks[i] & ~sp.site_masks[k]) == 0);
+        }
+        if (!found)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t canonical_hash(const compiled_species& sp)
+{
+    const std::size_t num_units(sp.labels.size());
+
+    std::vector<std::size_t> labels(sp.labels);
+    std::vector<std::vector<std::size_t> > neighbors(num_units);
+    std::size_t num_classes(0);
+    for (std::size_t round(0); round < num_units; ++round)
+    {
+        for (std::size_t i(0); i < num_units; ++i)
+        {
+            neighbors[i].clear();
+        }
+        for (std::vector<compiled_species::bond_type>::const_iterator
+            i(sp.bonds.begin()); i != sp.bonds.end(); ++i)
+        {
+            std::size_t seed1((*i).site1);
+            hash_combine(seed1, (*i).site2);
+            hash_combine(seed1, labels[(*i).unit2]);
+            neighbors[(*i).unit1].push_back(seed1);
+
+            std::size_t seed2((*i).site2);
+            hash_combine(seed2, (*i).site1);
+            hash_combine(seed2, labels[(*i).unit1]);
+            neighbors[(*i).unit2].push_back(seed2);
+        }
+
+        std::vector<std::size_t> refined(labels);
+        for (std::size_t i(0); i < num_units; ++i)
+        {
+            std::sort(neighbors[i].begin(), neighbors[i].end());
+            for (std::vector<std::size_t>::const_iterator
+                j(neighbors[i].begin()); j != neighbors[i].end(); ++j)
+            {
+                hash_combine(refined[i], (*j));
+            }
+        }
+        labels.swap(refined);
+
+        // Stop when labels no longer split units into more classes.
+        std::vector<std::size_t> classes(labels);
+        std::sort(classes.begin(), classes.end());
+        const std::size_t num_new_classes(static_cast<std::size_t>(
+            std::distance(classes.begin(), std::unique(classes.begin(), classes.end()))));
+        if (num_new_classes == num_classes)
+        {
+            break;
+        }
+        num_classes = num_new_classes;
+    }
+
+    std::sort(labels.begin(), labels.end());
+    std::size_t seed(num_units);
+    for (std::vector<std::size_t>::const_iterator i(labels.begin()); i != labels.end(); ++i)
+    {
+        hash_combine(seed, (*i));
+    }
+    return seed;
+}
+
 boost::optional<rule_based_expression_matcher<UnitSpecies>::context_type>
     rule_based_expression_matcher<UnitSpecies>::match_unit_species(
         const UnitSpecies& pttrn,
@@ -1258,6 +1454,11 @@ std::vector<ReactionRule> generate_reaction_rules(
             1, ReactionRule(reactants, pttrn.products(), pttrn.k()));  // Zeroth-order reactions
     }
 
+    if (pttrn.reactants().size() != reactants.size())
+    {
+        return return_type();
+    }
+
     std::vector<std::vector<UnitSpecies> > candidates;
     const operation_type op = context::compile_reaction_rule(pttrn);
 
@@ -1287,4 +1488,54 @@ std::vector<ReactionRule> generate_reaction_rules(
     return reactions;
 }
 
+boost::optional<ReactionRule> generate_reaction_rule(
+    const ReactionRule& pttrn,
+    const ReactionRule::reactant_container_type& reactants,
+    const std::size_t idx)
+{
+    typedef context::_ReactionRuleExpressionMatcher::operation_type operation_type;
+    typedef context::_ReactionRuleExpressionMatcher::unit_group_type unit_group_type;
+    typedef context::rule_based_expression_matcher<std::vector<Species> >::context_type context_type;
+
+    if (pttrn.reactants().size() == 0)
+    {
+        if (idx != 0)
+        {
+            return boost::none;
+        }
+        return ReactionRule(reactants, pttrn.products(), pttrn.k());
+    }
+
+    if (pttrn.reactants().size() != reactants.size())
+    {
+        return boost::none;
+    }
+
+    // Matches on the same set of units are counted once.
+    std::set<context_type::iterator_container_type> found;
+    context::rule_based_expression_matcher<std::vector<Species> > matcher(pttrn.reactants());
+    for (boost::optional<context_type> ctx = matcher.match(reactants); ctx; ctx = matcher.next())
+    {
+        context_type::iterator_container_type iterators((*ctx).iterators);
+        std::sort(iterators.begin(), iterators.end());
+        if (!found.insert(iterators).second)
+        {
+            continue;
+        }
+        else if (found.size() <= idx)
+        {
+            continue;
+        }
+
+        const operation_type op = context::compile_reaction_rule(pttrn);
+        const unit_group_type _res
+            = context::generate_units(op, (*ctx), reactants, pttrn.policy());
+        return ReactionRule(
+            reactants,
+            context::group_units(_res.units, _res.groups, _res.num_groups),
+            pttrn.k());
+    }
+    return boost::none;
+}
+
 } // ecell4
@@ -6,6 +6,7 @@
 #include "ReactionRule.hpp"
 #include <boost/optional.hpp>
 #include <unordered_map>
+#include <cstdint>
 
 namespace ecell4
 {
@@ -45,6 +46,52 @@ inline Species::serial_type unique_serial(const Species& sp)
     return format_species(sp).serial();
 }
 
+/**
+ * A compiled form of a species or a pattern for checks without strings.
+ * Names of units and sites are replaced with their hashes, so that no table
+ * is shared between threads. Collisions of hashes never make may_match
+ * false negative, and only make canonical_hash collide.
+ */
+struct compiled_species
+{
+    typedef std::size_t name_type;
+    typedef std::uint64_t mask_type;
+
+    struct bond_type
+    {
+        unsigned int unit1, unit2;
+        name_type site1, site2;
+    };
+
+    std::vector<name_type> names;  // zero for wildcards
+    std::vector<mask_type> site_masks;  // a bit for each site name
+    std::vector<std::size_t> labels;  // names, states and bond flags of sites
+    std::vector<bond_type> bonds;
+    std::vector<std::pair<name_type, unsigned int> > signature;  // sorted counts of named units
+};
+
+compiled_species compile_species(const Species& sp);
+
+/**
+ * return false if a pattern never matches a species. This compares
+ * the numbers of units, the signatures of unit names and site masks,
+ * and is used to reject rules before the full backtracking.
+ */
+bool may_match(const compiled_species& pttrn, const compiled_species& sp);
+
+/**
+ * a hash invariant under the order of units and the names of bonds.
+ * Species with the same format_species always have the same hash.
+ * Labels of units are refined along the bond graph as in
+ * the Weisfeiler-Lehman test.
+ */
+std::size_t canonical_hash(const compiled_species& sp);
+
+inline std::size_t canonical_hash(const Species& sp)
+{
+    return canonical_hash(compile_species(sp));
+}
+
 template <typename T>
 class rule_based_expression_matcher {};
 
@@ -527,6 +574,16 @@ std::vector<ReactionRule> generate_reaction_rules(
     const ReactionRule& pttrn,
     const ReactionRule::reactant_container_type& reactants);
 
+/**
+ * apply the pattern only to the idx-th of distinct matches in reactants.
+ * Products are not generated for the other matches.
+ * Return none if there are not so many matches.
+ */
+boost::optional<ReactionRule> generate_reaction_rule(
+    const ReactionRule& pttrn,
+    const ReactionRule::reactant_container_type& reactants,
+    const std::size_t idx);
+
 } // ecell4
 
 #endif /* ECELL4_CONTEXT_HPP */
@@ -0,0 +1,54 @@
+#include "EnsembleRunner.hpp"
+
+#include <cstdlib>
+#include <stdint.h>
+
+#ifndef WIN32_MSC
+#include <unistd.h>
+#endif
+
+
+namespace ecell4
+{
+
+Integer EnsembleRunnerBase::replicate_seed(const Integer seed, const Integer i)
+{
+    uint64_t z(static_cast<uint64_t>(seed) + (static_cast<uint64_t>(i) + 1) * 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return static_cast<Integer>(z >> 1);
+}
+
+std::mutex& EnsembleRunnerBase::io_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::string EnsembleRunnerBase::temporary_filename()
+{
+#ifndef WIN32_MSC
+    const char* tmpdir(std::getenv("TMPDIR"));
+    const std::string pattern(
+        std::string(tmpdir != NULL ? tmpdir : "/tmp") + "/ecell4-ensemble-XXXXXX");
+    std::vector<char> buffer(pattern.begin(), pattern.end());
+    buffer.push_back('\0');
+    const int fd(mkstemp(&buffer[0]));
+    if (fd == -1)
+    {
+        throw IllegalState("Failed to create a temporary file.");
+    }
+    close(fd);
+    return std::string(&buffer[0]);
+#else
+    char buffer[L_tmpnam];
+    if (std::tmpnam(buffer) == NULL)
+    {
+        throw IllegalState("Failed to create a temporary file.");
+    }
+    return std::string(buffer);
+#endif
+}
+
+} // ecell4
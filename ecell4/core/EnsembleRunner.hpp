@@ -0,0 +1,222 @@
+#ifndef ECELL4_ENSEMBLE_RUNNER_HPP
+#define ECELL4_ENSEMBLE_RUNNER_HPP
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <cstdio>
+
+#include "types.hpp"
+#include "exceptions.hpp"
+#include "Species.hpp"
+#include "Model.hpp"
+#include "observers.hpp"
+#include "EnsembleStatistics.hpp"
+
+
+namespace ecell4
+{
+
+class EnsembleRunnerBase
+{
+public:
+
+    /**
+     * return the seed for the i-th replicate mixed with SplitMix64,
+     * so that neighboring replicates get uncorrelated streams.
+     */
+    static Integer replicate_seed(const Integer seed, const Integer i);
+
+protected:
+
+    /**
+     * HDF5 is not thread-safe. Worlds are cloned one by one under this lock.
+     */
+    static std::mutex& io_mutex();
+
+    static std::string temporary_filename();
+
+    /**
+     * a temporary file removed at the end of the scope,
+     * even when an exception is thrown.
+     */
+    struct temporary_file
+    {
+        temporary_file()
+            : filename(temporary_filename())
+        {
+            ;
+        }
+
+        ~temporary_file()
+        {
+            std::remove(filename.c_str());
+        }
+
+        const std::string filename;
+    };
+};
+
+/**
+ * Run independent replicates of a template world and model on threads,
+ * and aggregate the values of targets at every dt into EnsembleStatistics.
+ * Each replicate is cloned from the template world through a file by
+ * the factory, which keeps its configuration of the world, and then
+ * the random number generator of the world is seeded with
+ * replicate_seed(seed, i). Trajectories are accumulated as soon as they
+ * finish, and never kept all in memory.
+ * The statistics don't depend on the number of threads.
+ */
+template <typename Tfactory_>
+class EnsembleRunner
+    : public EnsembleRunnerBase
+{
+public:
+
+    typedef Tfactory_ factory_type;
+    typedef typename factory_type::world_type world_type;
+    typedef typename factory_type::simulator_type simulator_type;
+
+public:
+
+    EnsembleRunner(
+        const factory_type& factory, const std::shared_ptr<world_type>& world,
+        const std::shared_ptr<Model>& model, const Integer num_threads = 1)
+        : factory_(factory), world_(world), model_(model), num_threads_(num_threads)
+    {
+        if (num_threads_ <= 0)
+        {
+            throw IllegalArgument("The number of threads must be positive.");
+        }
+    }
+
+    Integer num_threads() const
+    {
+        return num_threads_;
+    }
+
+    const std::shared_ptr<Model>& model() const
+    {
+        return model_;
+    }
+
+    /**
+     * @param species names of targets. If empty, all species in the world.
+     */
+    EnsembleStatistics run(
+        const Integer num_replicates, const Real duration, const Real dt,
+        const std::vector<std::string>& species = std::vector<std::string>(),
+        const Integer seed = 0) const
+    {
+        std::vector<std::string> names(species);
+        if (names.empty())
+        {
+            const std::vector<Species> all(world_->list_species());
+            for (std::vector<Species>::const_iterator i(all.begin()); i != all.end(); ++i)
+            {
+                names.push_back((*i).serial());
+            }
+        }
+
+        std::vector<Species> targets;
+        for (std::vector<std::string>::const_iterator i(names.begin()); i != names.end(); ++i)
+        {
+            targets.push_back(Species(*i));
+        }
+
+        const temporary_file tmpfile;
+        const std::string& filename(tmpfile.filename);
+        {
+            std::lock_guard<std::mutex> lock(io_mutex());
+            world_->save(filename);
+        }
+
+        const std::size_t num_workers(
+            std::max<Integer>(1, std::min(num_threads_, num_replicates)));
+        std::atomic<Integer> next(0);
+        std::vector<EnsembleStatistics> stats(num_workers, EnsembleStatistics(targets));
+        std::vector<std::exception_ptr> errors(num_workers);
+        std::vector<std::thread> threads;
+        for (std::size_t i(1); i < num_workers; ++i)
+        {
+            threads.push_back(std::thread(
+                &EnsembleRunner::run_replicates, this, std::cref(filename), std::cref(names),
+                num_replicates, duration, dt, seed, std::ref(next),
+                std::ref(stats[i]), std::ref(errors[i])));
+        }
+        run_replicates(
+            filename, names, num_replicates, duration, dt, seed, next, stats[0], errors[0]);
+        for (std::vector<std::thread>::iterator i(threads.begin()); i != threads.end(); ++i)
+        {
+            (*i).join();
+        }
+
+        for (std::vector<std::exception_ptr>::const_iterator i(errors.begin());
+            i != errors.end(); ++i)
+        {
+            if (*i)
+            {
+                std::rethrow_exception(*i);
+            }
+        }
+
+        for (std::size_t i(1); i < num_workers; ++i)
+        {
+            stats[0].merge(stats[i]);
+        }
+        return stats[0];
+    }
+
+protected:
+
+    void run_replicates(
+        const std::string& filename, const std::vector<std::string>& names,
+        const Integer num_replicates, const Real duration, const Real dt,
+        const Integer seed, std::atomic<Integer>& next,
+        EnsembleStatistics& stats, std::exception_ptr& error) const
+    {
+        try
+        {
+            // A static model is copied for each thread.
+            const std::shared_ptr<Model> model(
+                model_->is_static() ? model_->expand(std::vector<Species>()) : model_);
+
+            for (Integer i(next++); i < num_replicates; i = next++)
+            {
+                std::shared_ptr<world_type> world;
+                {
+                    std::lock_guard<std::mutex> lock(io_mutex());
+                    world.reset(factory_.world(filename));
+                }
+                world->rng()->seed(replicate_seed(seed, i));
+
+                std::unique_ptr<simulator_type> sim(factory_.simulator(world, model));
+                std::shared_ptr<FixedIntervalNumberObserver>
+                    observer(new FixedIntervalNumberObserver(dt, names));
+                sim->run(duration, observer);
+                stats.add(observer->data());
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+            next = num_replicates;  // Stop the others as well.
+        }
+    }
+
+protected:
+
+    factory_type factory_;
+    std::shared_ptr<world_type> world_;
+    std::shared_ptr<Model> model_;
+    Integer num_threads_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_ENSEMBLE_RUNNER_HPP */
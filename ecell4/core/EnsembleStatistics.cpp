@@ -0,0 +1,152 @@
+#include "EnsembleStatistics.hpp"
+#include "exceptions.hpp"
+
+#include <cmath>
+
+
+namespace ecell4
+{
+
+void EnsembleStatistics::add(const data_container_type& data)
+{
+    if (num_samples_ == 0)
+    {
+        times_.clear();
+        for (data_container_type::const_iterator i(data.begin()); i != data.end(); ++i)
+        {
+            times_.push_back((*i)[0]);
+        }
+        histograms_.assign(times_.size() * targets_.size(), histogram_type());
+    }
+    else if (data.size() != times_.size())
+    {
+        throw IllegalArgument("The number of time points differs.");
+    }
+
+    for (std::size_t i(0); i < data.size(); ++i)
+    {
+        if (data[i].size() != targets_.size() + 1)
+        {
+            throw IllegalArgument("The number of targets differs.");
+        }
+        for (std::size_t j(0); j < targets_.size(); ++j)
+        {
+            ++histograms_[i * targets_.size() + j][data[i][j + 1]];
+        }
+    }
+    ++num_samples_;
+}
+
+void EnsembleStatistics::merge(const EnsembleStatistics& other)
+{
+    if (other.num_samples_ == 0)
+    {
+        return;
+    }
+    else if (num_samples_ == 0)
+    {
+        times_ = other.times_;
+        histograms_ = other.histograms_;
+        num_samples_ = other.num_samples_;
+        return;
+    }
+    else if (other.times_.size() != times_.size()
+        || other.targets_.size() != targets_.size())
+    {
+        throw IllegalArgument("Statistics are not compatible.");
+    }
+
+    for (std::size_t i(0); i < histograms_.size(); ++i)
+    {
+        histogram_type& histogram(histograms_[i]);
+        for (histogram_type::const_iterator j(other.histograms_[i].begin());
+            j != other.histograms_[i].end(); ++j)
+        {
+            histogram[(*j).first] += (*j).second;
+        }
+    }
+    num_samples_ += other.num_samples_;
+}
+
+EnsembleStatistics::data_container_type EnsembleStatistics::mean() const
+{
+    data_container_type ret(times_.size());
+    for (std::size_t i(0); i < times_.size(); ++i)
+    {
+        ret[i].push_back(times_[i]);
+        for (std::size_t j(0); j < targets_.size(); ++j)
+        {
+            const histogram_type& hist(histogram(i, j));
+            Real sum(0.0);
+            for (histogram_type::const_iterator k(hist.begin()); k != hist.end(); ++k)
+            {
+                sum += (*k).first * (*k).second;
+            }
+            ret[i].push_back(sum / num_samples_);
+        }
+    }
+    return ret;
+}
+
+EnsembleStatistics::data_container_type EnsembleStatistics::variance() const
+{
+    data_container_type ret(mean());
+    if (num_samples_ < 2)
+    {
+        for (std::size_t i(0); i < ret.size(); ++i)
+        {
+            std::fill(ret[i].begin() + 1, ret[i].end(), 0.0);
+        }
+        return ret;
+    }
+
+    for (std::size_t i(0); i < times_.size(); ++i)
+    {
+        for (std::size_t j(0); j < targets_.size(); ++j)
+        {
+            const Real mu(ret[i][j + 1]);
+            const histogram_type& hist(histogram(i, j));
+            Real sum(0.0);
+            for (histogram_type::const_iterator k(hist.begin()); k != hist.end(); ++k)
+            {
+                sum += ((*k).first - mu) * ((*k).first - mu) * (*k).second;
+            }
+            ret[i][j + 1] = sum / (num_samples_ - 1);
+        }
+    }
+    return ret;
+}
+
+EnsembleStatistics::data_container_type EnsembleStatistics::quantile(const Real q) const
+{
+    if (q < 0.0 || q > 1.0)
+    {
+        throw IllegalArgument("A quantile must be in [0, 1].");
+    }
+
+    // The smallest value whose cumulative count reaches q N
+    const Integer rank(std::max<Integer>(1, static_cast<Integer>(std::ceil(q * num_samples_))));
+    data_container_type ret(times_.size());
+    for (std::size_t i(0); i < times_.size(); ++i)
+    {
+        ret[i].push_back(times_[i]);
+        for (std::size_t j(0); j < targets_.size(); ++j)
+        {
+            const histogram_type& hist(histogram(i, j));
+            Integer count(0);
+            histogram_type::const_iterator k(hist.begin());
+            for (; k != hist.end(); ++k)
+            {
+                count += (*k).second;
+                if (count >= rank)
+                {
+                    break;
+                }
+            }
+            ret[i].push_back(k != hist.end() ? (*k).first : hist.rbegin()->first);
+        }
+    }
+    return ret;
+}
+
+} // ecell4
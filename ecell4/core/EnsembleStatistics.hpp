@@ -0,0 +1,87 @@
+#ifndef ECELL4_ENSEMBLE_STATISTICS_HPP
+#define ECELL4_ENSEMBLE_STATISTICS_HPP
+
+#include <vector>
+#include <map>
+
+#include "types.hpp"
+#include "Species.hpp"
+#include "observers.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * Statistics of trajectories sampled at the same time points.
+ * Each value at a time point is accumulated into an exact histogram.
+ * Numbers of molecules are integers, thus a histogram grows only with
+ * the range of values, but not with the number of trajectories.
+ * Statistics don't depend on the order of adding or merging trajectories.
+ */
+class EnsembleStatistics
+{
+public:
+
+    typedef std::map<Real, Integer> histogram_type;
+    typedef std::vector<Species> species_container_type;
+    typedef NumberLogger::data_container_type data_container_type;
+
+public:
+
+    EnsembleStatistics(const species_container_type& targets = species_container_type())
+        : targets_(targets), num_samples_(0)
+    {
+        ;
+    }
+
+    const species_container_type& targets() const
+    {
+        return targets_;
+    }
+
+    const std::vector<Real>& times() const
+    {
+        return times_;
+    }
+
+    Integer num_samples() const
+    {
+        return num_samples_;
+    }
+
+    /**
+     * add a trajectory in the format of NumberLogger::data,
+     * each row of which is the time followed by values of targets.
+     */
+    void add(const data_container_type& data);
+
+    void merge(const EnsembleStatistics& other);
+
+    /**
+     * return the histogram of the j-th target at the i-th time.
+     */
+    const histogram_type& histogram(const std::size_t i, const std::size_t j) const
+    {
+        return histograms_[i * targets_.size() + j];
+    }
+
+    /**
+     * return the mean, the unbiased variance, or the q-quantile
+     * in the format of NumberLogger::data.
+     */
+    data_container_type mean() const;
+    data_container_type variance() const;
+    data_container_type quantile(const Real q) const;
+
+protected:
+
+    species_container_type targets_;
+    std::vector<Real> times_;
+    std::vector<histogram_type> histograms_;
+    Integer num_samples_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_ENSEMBLE_STATISTICS_HPP */
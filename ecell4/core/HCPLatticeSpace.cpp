@@ -49,6 +49,29 @@ void HCPLatticeSpace::set_lattice_properties(const Real3 &edge_lengths,
     row_size_ += 2;
     layer_size_ += 2;
     col_size_ += 2;
+
+    const Integer NUM_COLROW(col_size_ * row_size_);
+    const Integer NUM_ROW(row_size_);
+    for (Integer odd_col(0); odd_col < 2; ++odd_col)
+    {
+        for (Integer odd_lay(0); odd_lay < 2; ++odd_lay)
+        {
+            const Integer diff(odd_col ^ odd_lay);
+            coordinate_type *offsets(neighbor_offsets_[(odd_col << 1) | odd_lay]);
+            offsets[0] = -1;
+            offsets[1] = +1;
+            offsets[2] = diff - NUM_ROW - 1;
+            offsets[3] = diff - NUM_ROW;
+            offsets[4] = diff + NUM_ROW - 1;
+            offsets[5] = diff + NUM_ROW;
+            offsets[6] = -(2 * odd_col - 1) * NUM_COLROW - NUM_ROW;
+            offsets[7] = -(2 * odd_col - 1) * NUM_COLROW + NUM_ROW;
+            offsets[8] = diff - NUM_COLROW - 1;
+            offsets[9] = diff - NUM_COLROW;
+            offsets[10] = diff + NUM_COLROW - 1;
+            offsets[11] = diff + NUM_COLROW;
+        }
+    }
 }
 
 } // namespace ecell4
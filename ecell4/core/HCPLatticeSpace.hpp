@@ -120,45 +120,30 @@ public:
     }
 
 protected:
-    coordinate_type get_neighbor_(const coordinate_type &coord,
-                                  const Integer &nrand) const
+    /**
+     * the offset to the nrand-th neighbor of a voxel inside.
+     * offsets depend only on the parities of the column and the layer,
+     * and are precomputed in set_lattice_properties.
+     */
+    inline coordinate_type neighbor_offset(const coordinate_type &coord,
+                                           const Integer &nrand) const
     {
         const Integer NUM_COLROW(col_size_ * row_size_);
-        const Integer NUM_ROW(row_size_);
-        const bool odd_col(((coord % NUM_COLROW) / NUM_ROW) & 1);
-        const bool odd_lay((coord / NUM_COLROW) & 1);
+        const Integer layer(coord / NUM_COLROW);
+        const Integer col((coord - layer * NUM_COLROW) / row_size_);
+        return neighbor_offsets_[((col & 1) << 1) | (layer & 1)][nrand];
+    }
 
+    coordinate_type get_neighbor_(const coordinate_type &coord,
+                                  const Integer &nrand) const
+    {
         if (!is_inside(coord))
             throw NotFound("There is no neighbor voxel.");
 
-        switch (nrand)
-        {
-        case 0:
-            return coord - 1;
-        case 1:
-            return coord + 1;
-        case 2:
-            return coord + (odd_col ^ odd_lay) - NUM_ROW - 1;
-        case 3:
-            return coord + (odd_col ^ odd_lay) - NUM_ROW;
-        case 4:
-            return coord + (odd_col ^ odd_lay) + NUM_ROW - 1;
-        case 5:
-            return coord + (odd_col ^ odd_lay) + NUM_ROW;
-        case 6:
-            return coord - (2 * odd_col - 1) * NUM_COLROW - NUM_ROW;
-        case 7:
-            return coord - (2 * odd_col - 1) * NUM_COLROW + NUM_ROW;
-        case 8:
-            return coord + (odd_col ^ odd_lay) - NUM_COLROW - 1;
-        case 9:
-            return coord + (odd_col ^ odd_lay) - NUM_COLROW;
-        case 10:
-            return coord + (odd_col ^ odd_lay) + NUM_COLROW - 1;
-        case 11:
-            return coord + (odd_col ^ odd_lay) + NUM_COLROW;
-        }
-        throw NotFound("Invalid argument: nrand");
+        if (nrand < 0 || nrand >= 12)
+            throw NotFound("Invalid argument: nrand");
+
+        return coord + neighbor_offset(coord, nrand);
     }
 
 public:
@@ -191,6 +176,11 @@ protected:
     Real3 edge_lengths_;
     Real HCP_L, HCP_X, HCP_Y;
     Integer row_size_, layer_size_, col_size_;
+
+    /**
+     * neighbor_offsets_[(odd_col << 1) | odd_layer][nrand]
+     */
+    coordinate_type neighbor_offsets_[4][12];
 };
 
 } // namespace ecell4
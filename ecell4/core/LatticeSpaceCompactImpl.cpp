@@ -0,0 +1,443 @@
+#include <limits>
+
+#include "Context.hpp"
+#include "LatticeSpaceCompactImpl.hpp"
+#include "MoleculePool.hpp"
+#include "StructureType.hpp"
+#include "VacantType.hpp"
+
+namespace ecell4
+{
+
+typedef LatticeSpaceCompactImpl::coordinate_type coordinate_type;
+typedef LatticeSpaceCompactImpl::pool_index_type pool_index_type;
+
+const pool_index_type LatticeSpaceCompactImpl::npos =
+    std::numeric_limits<pool_index_type>::max();
+
+LatticeSpaceCompactImpl::LatticeSpaceCompactImpl(const Real3 &edge_lengths,
+                                                 const Real &voxel_radius,
+                                                 const bool is_periodic)
+    : base_type(edge_lengths, voxel_radius, is_periodic),
+      is_periodic_(is_periodic)
+{
+    border_ = std::shared_ptr<VoxelPool>(
+        new MoleculePool(Species("Border", voxel_radius_, 0), vacant_));
+    periodic_ = std::shared_ptr<VoxelPool>(
+        new MoleculePool(Species("Periodic", voxel_radius, 0), vacant_));
+
+    initialize_voxels(is_periodic_);
+}
+
+LatticeSpaceCompactImpl::~LatticeSpaceCompactImpl() {}
+
+void LatticeSpaceCompactImpl::initialize_voxels(const bool is_periodic)
+{
+    const coordinate_type voxel_size(col_size_ * row_size_ * layer_size_);
+
+    voxel_pools_.clear();
+    molecule_pools_.clear();
+
+    pools_.clear();
+    locations_.clear();
+    is_vacant_.clear();
+    pool_indices_.clear();
+    const pool_index_type vacant_index(index_of(vacant_));
+    border_index_ = index_of(border_);
+    periodic_index_ = index_of(periodic_);
+
+    voxels_.clear();
+    voxels_.reserve(voxel_size);
+    for (coordinate_type coord(0); coord < voxel_size; ++coord)
+    {
+        if (!is_inside(coord))
+        {
+            if (is_periodic)
+            {
+                voxels_.push_back(periodic_index_);
+                periodic_->add_voxel(
+                    coordinate_id_pair_type(ParticleID(), coord));
+            }
+            else
+            {
+                voxels_.push_back(border_index_);
+                border_->add_voxel(
+                    coordinate_id_pair_type(ParticleID(), coord));
+            }
+        }
+        else
+        {
+            voxels_.push_back(vacant_index);
+            vacant_->add_voxel(coordinate_id_pair_type(ParticleID(), coord));
+        }
+    }
+}
+
+pool_index_type
+LatticeSpaceCompactImpl::index_of(const std::shared_ptr<VoxelPool> &vp)
+{
+    const pool_index_type found(find_index(vp.get()));
+    if (found != npos)
+    {
+        return found;
+    }
+
+    const std::shared_ptr<VoxelPool> location(vp->location());
+    const pool_index_type location_index(location ? index_of(location)
+                                                  : npos);
+
+    if (pools_.size() >= static_cast<std::size_t>(npos))
+    {
+        throw IllegalState("Too many VoxelPools are placed on the lattice.");
+    }
+
+    const pool_index_type idx(static_cast<pool_index_type>(pools_.size()));
+    pools_.push_back(vp);
+    locations_.push_back(location_index);
+    is_vacant_.push_back(vp->is_vacant() ? 1 : 0);
+    pool_indices_.insert(std::make_pair(vp.get(), idx));
+    return idx;
+}
+
+Integer LatticeSpaceCompactImpl::num_species() const
+{
+    return voxel_pools_.size() + molecule_pools_.size();
+}
+
+bool LatticeSpaceCompactImpl::update_structure(const Particle &p)
+{
+    return update_voxel(ParticleID(), p.species(),
+                        position2coordinate(p.position()));
+}
+
+void LatticeSpaceCompactImpl::push_voxels(std::vector<VoxelView> &voxels,
+                                          const pool_index_type &idx) const
+{
+    if (idx == npos)
+    {
+        return;
+    }
+
+    const Species &sp(pools_[idx]->species());
+    for (voxel_container::const_iterator i(voxels_.begin()); i != voxels_.end();
+         ++i)
+    {
+        if (*i != idx)
+        {
+            continue;
+        }
+
+        const coordinate_type coord(std::distance(voxels_.begin(), i));
+        voxels.push_back(VoxelView(ParticleID(), sp, coord));
+    }
+}
+
+std::vector<VoxelView> LatticeSpaceCompactImpl::list_voxels() const
+{
+    std::vector<VoxelView> retval;
+
+    for (const auto &pool : molecule_pools_)
+    {
+        const std::shared_ptr<MoleculePool> &vp(pool.second);
+        const Species &sp(vp->species());
+
+        for (const auto &voxel : *vp)
+        {
+            retval.push_back(VoxelView(voxel.pid, sp, voxel.coordinate));
+        }
+    }
+
+    for (const auto &pool : voxel_pools_)
+    {
+        push_voxels(retval, find_index(pool.second.get()));
+    }
+    return retval;
+}
+
+std::vector<VoxelView>
+LatticeSpaceCompactImpl::list_voxels_exact(const Species &sp) const
+{
+    std::vector<VoxelView> retval;
+
+    {
+        voxel_pool_map_type::const_iterator itr(voxel_pools_.find(sp));
+        if (itr != voxel_pools_.end())
+        {
+            push_voxels(retval, find_index((*itr).second.get()));
+            return retval;
+        }
+    }
+
+    {
+        molecule_pool_map_type::const_iterator itr(molecule_pools_.find(sp));
+        if (itr != molecule_pools_.end())
+        {
+            const std::shared_ptr<MoleculePool> &vp((*itr).second);
+            for (const auto &voxel : *vp)
+            {
+                retval.push_back(VoxelView(voxel.pid, sp, voxel.coordinate));
+            }
+            return retval;
+        }
+    }
+    return retval; // an empty vector
+}
+
+std::vector<VoxelView>
+LatticeSpaceCompactImpl::list_voxels(const Species &sp) const
+{
+    std::vector<VoxelView> retval;
+    SpeciesExpressionMatcher sexp(sp);
+
+    for (const auto &pool : voxel_pools_)
+    {
+        if (!sexp.match(pool.first))
+        {
+            continue;
+        }
+
+        push_voxels(retval, find_index(pool.second.get()));
+    }
+
+    for (const auto &pool : molecule_pools_)
+    {
+        if (!sexp.match(pool.first))
+        {
+            continue;
+        }
+
+        const std::shared_ptr<MoleculePool> &vp(pool.second);
+        const Species &sp(vp->species());
+        for (const auto &voxel : *vp)
+        {
+            retval.push_back(VoxelView(voxel.pid, sp, voxel.coordinate));
+        }
+    }
+
+    return retval;
+}
+
+/*
+ * Protected functions
+ */
+
+coordinate_type LatticeSpaceCompactImpl::get_coord(const ParticleID &pid) const
+{
+    for (const auto &pool : molecule_pools_)
+    {
+        const std::shared_ptr<MoleculePool> &vp(pool.second);
+        for (const auto &voxel : *vp)
+        {
+            if (voxel.pid == pid)
+            {
+                return voxel.coordinate;
+            }
+        }
+    }
+    return -1; // XXX: a bit dirty way
+}
+
+bool LatticeSpaceCompactImpl::remove_voxel(const ParticleID &pid)
+{
+    for (const auto &pool : molecule_pools_)
+    {
+        const std::shared_ptr<MoleculePool> &vp(pool.second);
+        MoleculePool::const_iterator j(vp->find(pid));
+        if (j != vp->end())
+        {
+            const coordinate_type coord((*j).coordinate);
+            if (!vp->remove_voxel_if_exists(coord))
+            {
+                return false;
+            }
+
+            set_voxel_pool_at(coord, vp->location());
+
+            vp->location()->add_voxel(
+                coordinate_id_pair_type(ParticleID(), coord));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LatticeSpaceCompactImpl::remove_voxel(const coordinate_type &coord)
+{
+    const pool_index_type idx(voxels_.at(coord));
+    const pool_index_type location_index(locations_[idx]);
+    if (location_index != npos)
+    {
+        if (pools_[idx]->remove_voxel_if_exists(coord))
+        {
+            voxels_[coord] = location_index;
+            pools_[location_index]->add_voxel(
+                coordinate_id_pair_type(ParticleID(), coord));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LatticeSpaceCompactImpl::move(const coordinate_type &src,
+                                   const coordinate_type &dest,
+                                   const std::size_t candidate)
+{
+    return move_(src, dest, candidate).second;
+}
+
+bool LatticeSpaceCompactImpl::can_move(const coordinate_type &src,
+                                       const coordinate_type &dest) const
+{
+    if (src == dest)
+        return false;
+
+    const pool_index_type src_idx(voxels_.at(src));
+    if (is_vacant_[src_idx])
+        return false;
+
+    pool_index_type dest_idx(voxels_.at(dest));
+
+    if (dest_idx == border_index_)
+        return false;
+
+    if (dest_idx == periodic_index_)
+        dest_idx = voxels_.at(apply_boundary_(dest));
+
+    return (dest_idx == locations_[src_idx]);
+}
+
+std::pair<coordinate_type, bool>
+LatticeSpaceCompactImpl::move_(coordinate_type from, coordinate_type to,
+                               const std::size_t candidate)
+{
+    if (from == to)
+    {
+        return std::pair<coordinate_type, bool>(from, false);
+    }
+
+    const pool_index_type from_idx(voxels_.at(from));
+    if (is_vacant_[from_idx])
+    {
+        return std::pair<coordinate_type, bool>(from, true);
+    }
+
+    pool_index_type to_idx(voxels_.at(to));
+
+    if (to_idx == border_index_)
+    {
+        return std::pair<coordinate_type, bool>(from, false);
+    }
+    else if (to_idx == periodic_index_)
+    {
+        to = apply_boundary_(to);
+        to_idx = voxels_.at(to);
+    }
+
+    if (to_idx != locations_[from_idx])
+    {
+        return std::pair<coordinate_type, bool>(to, false);
+    }
+
+    pools_[from_idx]->replace_voxel(from, to, candidate);
+    voxels_[from] = to_idx;
+
+    pools_[to_idx]->replace_voxel(to, from);
+    voxels_[to] = from_idx;
+
+    return std::pair<coordinate_type, bool>(to, true);
+}
+
+/*
+ * Change the Species and coordinate of a Voxel with ParticleID, pid, to
+ * species and coordinate respectively and return false.
+ * If no Voxel with pid is found, create a new Voxel at
+ * coordiante() and return true.
+ */
+bool LatticeSpaceCompactImpl::update_voxel(const ParticleID &pid,
+                                           const Species &species,
+                                           const coordinate_type to_coord)
+{
+    if (!is_in_range(to_coord))
+    {
+        throw NotSupported("Out of bounds");
+    }
+
+    std::shared_ptr<VoxelPool> new_vp(
+        find_voxel_pool(species)); // XXX: need MoleculeInfo
+    std::shared_ptr<VoxelPool> dest_vp(get_voxel_pool_at(to_coord));
+
+    if (dest_vp != new_vp->location())
+    {
+        throw NotSupported("Mismatch in the location. Failed to place '" +
+                           new_vp->species().serial() + "' to '" +
+                           dest_vp->species().serial() + "'.");
+    }
+
+    const coordinate_type from_coord(pid != ParticleID() ? get_coord(pid) : -1);
+    if (from_coord != -1)
+    {
+        // move
+        get_voxel_pool_at(from_coord)->remove_voxel_if_exists(from_coord);
+
+        // XXX: use location?
+        dest_vp->replace_voxel(to_coord, from_coord);
+        set_voxel_pool_at(from_coord, dest_vp);
+
+        new_vp->add_voxel(coordinate_id_pair_type(pid, to_coord));
+        set_voxel_pool_at(to_coord, new_vp);
+        return false;
+    }
+
+    // new
+    dest_vp->remove_voxel_if_exists(to_coord);
+
+    new_vp->add_voxel(coordinate_id_pair_type(pid, to_coord));
+    set_voxel_pool_at(to_coord, new_vp);
+    return true;
+}
+
+bool LatticeSpaceCompactImpl::add_voxel(const Species &sp,
+                                        const ParticleID &pid,
+                                        const coordinate_type &coordinate)
+{
+    std::shared_ptr<VoxelPool> vpool(find_voxel_pool(sp));
+    std::shared_ptr<VoxelPool> location(get_voxel_pool_at(coordinate));
+
+    if (vpool->location() != location)
+        return false;
+
+    location->remove_voxel_if_exists(coordinate);
+    vpool->add_voxel(coordinate_id_pair_type(pid, coordinate));
+    set_voxel_pool_at(coordinate, vpool);
+
+    return true;
+}
+
+bool LatticeSpaceCompactImpl::add_voxels(
+    const Species &sp,
+    std::vector<std::pair<ParticleID, coordinate_type>> voxels)
+{
+    // this function doesn't check location.
+    std::shared_ptr<VoxelPool> mtb;
+    try
+    {
+        mtb = find_voxel_pool(sp);
+    }
+    catch (NotFound &e)
+    {
+        return false;
+    }
+
+    const pool_index_type idx(index_of(mtb));
+    for (const auto &voxel : voxels)
+    {
+        const ParticleID pid(voxel.first);
+        const coordinate_type coord(voxel.second);
+        get_voxel_pool_at(coord)->remove_voxel_if_exists(coord);
+        mtb->add_voxel(coordinate_id_pair_type(pid, coord));
+        voxels_.at(coord) = idx;
+    }
+    return true;
+}
+
+} // namespace ecell4
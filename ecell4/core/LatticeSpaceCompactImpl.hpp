@@ -0,0 +1,209 @@
+#ifndef ECELL4_LATTICE_SPACE_COMPACT_IMPL_HPP
+#define ECELL4_LATTICE_SPACE_COMPACT_IMPL_HPP
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "HCPLatticeSpace.hpp"
+
+namespace ecell4
+{
+
+/**
+ * A HCP lattice storing a 16-bit index of VoxelPool for each voxel
+ * instead of std::shared_ptr<VoxelPool> as LatticeSpaceVectorImpl does.
+ * Pools are interned in a table together with the indices of their locations,
+ * so that can_move, move and get_neighbor never touch reference counts.
+ * ParticleIDs are kept in MoleculePools as usual.
+ * The number of pools, including Border and Periodic, is limited to 65535.
+ */
+class LatticeSpaceCompactImpl : public HCPLatticeSpace
+{
+public:
+    typedef HCPLatticeSpace base_type;
+    typedef std::uint16_t pool_index_type;
+    typedef std::vector<pool_index_type> voxel_container;
+
+public:
+    LatticeSpaceCompactImpl(const Real3 &edge_lengths, const Real &voxel_radius,
+                            const bool is_periodic = true);
+    ~LatticeSpaceCompactImpl();
+
+    /*
+     * Space APIs
+     *
+     * using ParticleID, Species and Posision3
+     */
+
+    Integer num_species() const;
+
+    bool remove_voxel(const ParticleID &pid);
+    bool remove_voxel(const coordinate_type &coord);
+
+    bool update_structure(const Particle &p);
+
+    /*
+     * for Simulator
+     *
+     * using Species and coordinate_type
+     */
+    std::vector<VoxelView> list_voxels() const;
+    std::vector<VoxelView> list_voxels(const Species &sp) const;
+    std::vector<VoxelView> list_voxels_exact(const Species &sp) const;
+
+    bool update_voxel(const ParticleID &pid, const Species &species,
+                      const coordinate_type coordinate);
+    bool add_voxel(const Species &species, const ParticleID &pid,
+                   const coordinate_type &coord);
+
+    bool add_voxels(const Species &species,
+                    std::vector<std::pair<ParticleID, coordinate_type>> voxels);
+
+    std::shared_ptr<VoxelPool>
+    get_voxel_pool_at(const coordinate_type &coord) const
+    {
+        return pools_[voxels_.at(coord)];
+    }
+
+    const VoxelPool *get_voxel_pool_ptr_at(const coordinate_type &coord) const
+    {
+        return pools_[voxels_.at(coord)].get();
+    }
+
+    bool move(const coordinate_type &src, const coordinate_type &dest,
+              const std::size_t candidate = 0);
+    bool can_move(const coordinate_type &src,
+                  const coordinate_type &dest) const;
+
+    coordinate_type get_neighbor(const coordinate_type &coord,
+                                 const Integer &nrand) const
+    {
+        coordinate_type const dest = get_neighbor_(coord, nrand);
+
+        if (voxels_.at(dest) != periodic_index_)
+        {
+            return dest;
+        }
+        else
+        {
+            return periodic_transpose(dest);
+        }
+    }
+
+    void get_all_neighbors(const coordinate_type &coord,
+                           std::vector<coordinate_type> &neighbors) const
+    {
+        neighbors.resize(num_neighbors(coord));
+        for (std::size_t nrand(0); nrand < neighbors.size(); ++nrand)
+        {
+            const coordinate_type dest(coord + neighbor_offset(coord, nrand));
+            neighbors[nrand] =
+                (voxels_[dest] != periodic_index_ ? dest : periodic_transpose(dest));
+        }
+    }
+
+    void get_neighbors_randomly(const std::vector<coordinate_type> &coords,
+                                RandomNumberGenerator &rng,
+                                std::vector<coordinate_type> &neighbors) const
+    {
+        neighbors.resize(coords.size());
+        for (std::size_t i(0); i < coords.size(); ++i)
+        {
+            const coordinate_type dest(
+                coords[i] + neighbor_offset(coords[i], rng.uniform_int(0, 11)));
+            neighbors[i] =
+                (voxels_[dest] != periodic_index_ ? dest : periodic_transpose(dest));
+        }
+    }
+
+    bool is_periodic() const { return is_periodic_; }
+
+    bool allows_concurrent_moves() const { return true; }
+
+    /**
+     * the number of VoxelPools interned so far.
+     */
+    std::size_t num_pools() const { return pools_.size(); }
+
+#ifdef WITH_HDF5
+    /*
+     * HDF5 Save
+     */
+    void save_hdf5(H5::Group *root) const
+    {
+        save_lattice_space(*this, root, "LatticeSpaceCompactImpl");
+    }
+
+    void load_hdf5(const H5::Group &root) { load_lattice_space(root, this); }
+#endif
+
+    void reset(const Real3 &edge_lengths, const Real &voxel_radius,
+               const bool is_periodic)
+    {
+        base_type::reset(edge_lengths, voxel_radius, is_periodic);
+
+        is_periodic_ = is_periodic;
+        initialize_voxels(is_periodic_);
+    }
+
+protected:
+    static const pool_index_type npos;
+
+    coordinate_type apply_boundary_(const coordinate_type &coord) const
+    {
+        return periodic_transpose(coord);
+    }
+
+    void initialize_voxels(const bool is_periodic);
+
+    /**
+     * return the index of a pool. a new index is given at the first time.
+     */
+    pool_index_type index_of(const std::shared_ptr<VoxelPool> &vp);
+
+    /**
+     * return the index of a pool, or npos if it has never been interned.
+     */
+    pool_index_type find_index(const VoxelPool *vp) const
+    {
+        const auto itr(pool_indices_.find(vp));
+        return (itr != pool_indices_.end() ? (*itr).second : npos);
+    }
+
+    void set_voxel_pool_at(const coordinate_type &coord,
+                           const std::shared_ptr<VoxelPool> &vp)
+    {
+        voxels_.at(coord) = index_of(vp);
+    }
+
+    std::pair<coordinate_type, bool> move_(coordinate_type from,
+                                           coordinate_type to,
+                                           const std::size_t candidate = 0);
+
+    coordinate_type get_coord(const ParticleID &pid) const;
+
+    void push_voxels(std::vector<VoxelView> &voxels,
+                     const pool_index_type &idx) const;
+
+protected:
+    bool is_periodic_;
+
+    voxel_container voxels_;
+
+    /**
+     * interned pools. locations_[i] is the index of the location of pools_[i],
+     * and is_vacant_[i] caches pools_[i]->is_vacant().
+     */
+    std::vector<std::shared_ptr<VoxelPool>> pools_;
+    std::vector<pool_index_type> locations_;
+    std::vector<char> is_vacant_;
+    std::unordered_map<const VoxelPool *, pool_index_type> pool_indices_;
+
+    std::shared_ptr<VoxelPool> border_;
+    std::shared_ptr<VoxelPool> periodic_;
+    pool_index_type border_index_, periodic_index_;
+};
+
+} // namespace ecell4
+
+#endif /* ECELL4_LATTICE_SPACE_COMPACT_IMPL_HPP */
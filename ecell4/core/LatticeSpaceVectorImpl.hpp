@@ -57,6 +57,11 @@ public:
         return voxels_.at(coord);
     }
 
+    const VoxelPool *get_voxel_pool_ptr_at(const coordinate_type &coord) const
+    {
+        return voxels_.at(coord).get();
+    }
+
     bool move(const coordinate_type &src, const coordinate_type &dest,
               const std::size_t candidate = 0);
     bool can_move(const coordinate_type &src,
@@ -77,8 +82,36 @@ public:
         }
     }
 
+    void get_all_neighbors(const coordinate_type &coord,
+                           std::vector<coordinate_type> &neighbors) const
+    {
+        neighbors.resize(num_neighbors(coord));
+        for (std::size_t nrand(0); nrand < neighbors.size(); ++nrand)
+        {
+            const coordinate_type dest(coord + neighbor_offset(coord, nrand));
+            neighbors[nrand] =
+                (voxels_[dest] != periodic_ ? dest : periodic_transpose(dest));
+        }
+    }
+
+    void get_neighbors_randomly(const std::vector<coordinate_type> &coords,
+                                RandomNumberGenerator &rng,
+                                std::vector<coordinate_type> &neighbors) const
+    {
+        neighbors.resize(coords.size());
+        for (std::size_t i(0); i < coords.size(); ++i)
+        {
+            const coordinate_type dest(
+                coords[i] + neighbor_offset(coords[i], rng.uniform_int(0, 11)));
+            neighbors[i] =
+                (voxels_[dest] != periodic_ ? dest : periodic_transpose(dest));
+        }
+    }
+
     bool is_periodic() const { return is_periodic_; }
 
+    bool allows_concurrent_moves() const { return true; }
+
 #ifdef WITH_HDF5
     /*
      * HDF5 Save
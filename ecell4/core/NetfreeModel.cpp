@@ -1,4 +1,9 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include <unordered_set>
 
 #include "exceptions.hpp"
 #include "NetfreeModel.hpp"
@@ -76,12 +81,46 @@ Integer NetfreeModel::apply(const Species& pttrn, const Species& sp) const
 
 std::vector<ReactionRule> NetfreeModel::query_reaction_rules(
     const Species& sp) const
+{
+    std::vector<ReactionRule> retval;
+    if (query_cache_.find(sp, retval))
+    {
+        return retval;
+    }
+    retval = query_reaction_rules_(sp);
+    query_cache_.insert(sp, retval);
+    return retval;
+}
+
+std::vector<ReactionRule> NetfreeModel::query_reaction_rules(
+    const Species& sp1, const Species& sp2) const
+{
+    std::vector<ReactionRule> retval;
+    if (query_cache_.find(sp1, sp2, retval))
+    {
+        return retval;
+    }
+    retval = query_reaction_rules_(sp1, sp2);
+    query_cache_.insert(sp1, sp2, retval);
+    return retval;
+}
+
+std::vector<ReactionRule> NetfreeModel::query_reaction_rules_(
+    const Species& sp) const
 {
     ReactionRule::reactant_container_type reactants(1, sp);
+    const context::compiled_species compiled(context::compile_species(sp));
     std::vector<ReactionRule> retval;
     for (reaction_rule_container_type::const_iterator i(reaction_rules_.begin());
         i != reaction_rules_.end(); ++i)
     {
+        const std::vector<context::compiled_species>& patterns(
+            compiled_reactants_[std::distance(reaction_rules_.begin(), i)]);
+        if (patterns.size() != 1 || !context::may_match(patterns[0], compiled))
+        {
+            continue;
+        }
+
         const std::vector<ReactionRule> generated = (*i).generate(reactants);
         // retval.insert(retval.end(), generated.begin(), generated.end());
         retval.reserve(retval.size() + generated.size());
@@ -148,13 +187,26 @@ std::vector<ReactionRule> generate_reaction_rules(
     return res;
 }
 
-std::vector<ReactionRule> NetfreeModel::query_reaction_rules(
+std::vector<ReactionRule> NetfreeModel::query_reaction_rules_(
     const Species& sp1, const Species& sp2) const
 {
+    const context::compiled_species compiled1(context::compile_species(sp1));
+    const context::compiled_species compiled2(context::compile_species(sp2));
     std::vector<ReactionRule> retval;
     for (reaction_rule_container_type::const_iterator i(reaction_rules_.begin());
         i != reaction_rules_.end(); ++i)
     {
+        const std::vector<context::compiled_species>& patterns(
+            compiled_reactants_[std::distance(reaction_rules_.begin(), i)]);
+        if (patterns.size() != 2
+            || !((context::may_match(patterns[0], compiled1)
+                  && context::may_match(patterns[1], compiled2))
+                 || (context::may_match(patterns[0], compiled2)
+                     && context::may_match(patterns[1], compiled1))))
+        {
+            continue;
+        }
+
         const std::vector<ReactionRule> generated = generate_reaction_rules(*i, sp1, sp2);
         // retval.insert(retval.end(), generated.begin(), generated.end());
         retval.reserve(retval.size() + generated.size());
@@ -196,9 +248,23 @@ std::vector<ReactionRule> NetfreeModel::apply(
     return rr.generate(reactants);
 }
 
+std::vector<context::compiled_species> compile_reactants(const ReactionRule& rr)
+{
+    std::vector<context::compiled_species> patterns;
+    for (ReactionRule::reactant_container_type::const_iterator
+        i(rr.reactants().begin()); i != rr.reactants().end(); ++i)
+    {
+        patterns.push_back(context::compile_species(*i));
+    }
+    return patterns;
+}
+
 void NetfreeModel::add_reaction_rule(const ReactionRule& rr)
 {
     reaction_rules_.push_back(rr);
+    compiled_reactants_.push_back(compile_reactants(rr));
+
+    clear_query_cache();
 }
 
 void NetfreeModel::remove_reaction_rule(const ReactionRule& rr)
@@ -209,6 +275,19 @@ void NetfreeModel::remove_reaction_rule(const ReactionRule& rr)
         throw NotFound("The given reaction rule was not found.");
     }
     reaction_rules_.erase(i, reaction_rules_.end());
+    compile_reaction_rules();
+    clear_query_cache();
+}
+
+void NetfreeModel::compile_reaction_rules()
+{
+    compiled_reactants_.clear();
+    compiled_reactants_.reserve(reaction_rules_.size());
+    for (reaction_rule_container_type::const_iterator i(reaction_rules_.begin());
+        i != reaction_rules_.end(); ++i)
+    {
+        compiled_reactants_.push_back(compile_reactants(*i));
+    }
 }
 
 bool NetfreeModel::has_reaction_rule(const ReactionRule& rr) const
@@ -234,6 +313,14 @@ std::shared_ptr<Model> NetfreeModel::expand(
         *this, sp, max_itr).first;
 }
 
+std::shared_ptr<Model> NetfreeModel::expand(
+    const std::vector<Species>& sp, const Integer max_itr,
+    const std::map<Species, Integer>& max_stoich, const Integer num_threads) const
+{
+    return extras::generate_network_from_netfree_model(
+        *this, sp, max_itr, max_stoich, num_threads).first;
+}
+
 std::shared_ptr<Model> NetfreeModel::expand(
     const std::vector<Species>& sp) const
 {
@@ -281,10 +368,12 @@ bool check_stoichiometry(const ReactionRule& rr,
     return true;
 }
 
+typedef std::vector<std::pair<ReactionRule, std::vector<Species> > >
+    __generated_reaction_rules_type;
+
 void __add_reaction_rules(
     const std::vector<ReactionRule>& reaction_rules,
-    std::vector<ReactionRule>& reactions, std::vector<Species>& newseeds,
-    const std::vector<Species>& seeds,
+    __generated_reaction_rules_type& generated,
     const std::map<Species, Integer>& max_stoich)
 {
     for (std::vector<ReactionRule>::const_iterator i(reaction_rules.begin());
@@ -296,90 +385,197 @@ void __add_reaction_rules(
             continue;
         }
 
-        reactions.push_back(rr);
-
+        std::vector<Species> products;
+        products.reserve(rr.products().size());
         for (ReactionRule::product_container_type::const_iterator
             j(rr.products().begin()); j != rr.products().end(); ++j)
         {
-            const Species sp(format_species(*j));
-            if (std::find(newseeds.begin(), newseeds.end(), sp)
-                == newseeds.end()
-                && std::find(seeds.begin(), seeds.end(), sp)
-                == seeds.end())
-            {
-                newseeds.push_back(sp);
-            }
+            products.push_back(format_species(*j));
+        }
+        generated.push_back(std::make_pair(rr, products));
+    }
+}
+
+/**
+ * apply a rule to the j-th seed, or to the j-th seed and each of seeds2
+ * from the j-th on. seeds2 begins with seeds1. patterns and compiled are
+ * the compiled reactants of the rule and seeds2, which reject pairs
+ * before the full matcher.
+ */
+void __generate_reaction_rules(
+    const ReactionRule& rr, const std::size_t j,
+    const std::vector<Species>& seeds1, const std::vector<Species>& seeds2,
+    const std::vector<context::compiled_species>& patterns,
+    const std::vector<context::compiled_species>& compiled,
+    const std::map<Species, Integer>& max_stoich,
+    __generated_reaction_rules_type& generated)
+{
+    if (rr.reactants().size() == 1)
+    {
+        if (!context::may_match(patterns[0], compiled[j]))
+        {
+            return;
+        }
+
+        const ReactionRule::reactant_container_type reactants(1, seeds1[j]);
+        __add_reaction_rules(rr.generate(reactants), generated, max_stoich);
+        return;
+    }
+
+    for (std::size_t k(j); k < seeds2.size(); ++k)
+    {
+        if (!((context::may_match(patterns[0], compiled[j])
+               && context::may_match(patterns[1], compiled[k]))
+              || (context::may_match(patterns[0], compiled[k])
+                  && context::may_match(patterns[1], compiled[j]))))
+        {
+            continue;
         }
+
+        __add_reaction_rules(
+            generate_reaction_rules(rr, seeds1[j], seeds2[k]), generated, max_stoich);
     }
 }
 
 void __generate_recurse(
     const NetfreeModel& nfm, std::vector<ReactionRule>& reactions,
     std::vector<Species>& seeds1, std::vector<Species>& seeds2,
-    const std::map<Species, Integer>& max_stoich)
+    std::unordered_set<Species>& known,
+    const std::map<Species, Integer>& max_stoich, const Integer num_threads,
+    network_generation_statistics& stats)
 {
-    std::vector<Species> newseeds;
     seeds2.insert(seeds2.begin(), seeds1.begin(), seeds1.end());
 
+    std::vector<context::compiled_species> compiled;
+    compiled.reserve(seeds2.size());
+    for (std::vector<Species>::const_iterator i(seeds2.begin()); i != seeds2.end(); ++i)
+    {
+        compiled.push_back(context::compile_species(*i));
+    }
+
+    // a task is a pair of a rule and a seed in seeds1
+    std::vector<std::pair<std::size_t, std::size_t> > tasks;
+    std::vector<std::vector<context::compiled_species> > patterns;
+    stats.num_trials = 0;
     for (NetfreeModel::reaction_rule_container_type::const_iterator
         i(nfm.reaction_rules().begin()); i != nfm.reaction_rules().end(); ++i)
     {
         const ReactionRule& rr(*i);
+        patterns.push_back(compile_reactants(rr));
 
         switch (rr.reactants().size())
         {
         case 0:
             continue;
         case 1:
-            for (std::vector<Species>::const_iterator j(seeds1.begin());
-                j != seeds1.end(); ++j)
-            {
-                ReactionRule::reactant_container_type reactants(1);
-                reactants[0] = *j;
-                __add_reaction_rules(
-                    rr.generate(reactants), reactions, newseeds, seeds2, max_stoich);
-            }
+            stats.num_trials += seeds1.size();
             break;
         case 2:
-            for (std::vector<Species>::const_iterator j(seeds1.begin());
-                j != seeds1.end(); ++j)
-            {
-                const std::vector<Species>::const_iterator start(
-                    seeds2.begin()
-                    + std::distance<std::vector<Species>::const_iterator>(
-                        seeds1.begin(), j));
-                for (std::vector<Species>::const_iterator
-                    k(start); k != seeds2.end(); ++k)
-                {
-                    __add_reaction_rules(
-                        generate_reaction_rules(rr, *j, *k),
-                        reactions, newseeds, seeds2, max_stoich);
-                }
-            }
+            stats.num_trials += seeds1.size() * (2 * seeds2.size() - seeds1.size() + 1) / 2;
             break;
         default:
             throw NotImplemented(
                 "No reaction rule with more than two reactants is accepted.");
         }
+
+        for (std::size_t j(0); j < seeds1.size(); ++j)
+        {
+            tasks.push_back(std::make_pair(patterns.size() - 1, j));
+        }
     }
 
+    std::vector<__generated_reaction_rules_type> generated(tasks.size());
+    std::atomic<std::size_t> next(0);
+    std::mutex mutex;
+    std::exception_ptr error;
+    const auto worker = [&]()
+    {
+        for (std::size_t i(next++); i < tasks.size(); i = next++)
+        {
+            try
+            {
+                __generate_reaction_rules(
+                    nfm.reaction_rules()[tasks[i].first], tasks[i].second, seeds1, seeds2,
+                    patterns[tasks[i].first], compiled, max_stoich, generated[i]);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                next = tasks.size();
+            }
+        }
+    };
+
+    const std::size_t nthreads(
+        std::min(static_cast<std::size_t>(num_threads), tasks.size()));
+    std::vector<std::thread> threads;
+    for (std::size_t i(1); i < nthreads; ++i)
+    {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (std::vector<std::thread>::iterator i(threads.begin()); i != threads.end(); ++i)
+    {
+        (*i).join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    // merge in the order of tasks, so that the result is deterministic
+    std::vector<Species> newseeds;
+    stats.num_reactions = 0;
+    for (std::vector<__generated_reaction_rules_type>::const_iterator
+        i(generated.begin()); i != generated.end(); ++i)
+    {
+        for (__generated_reaction_rules_type::const_iterator j((*i).begin());
+            j != (*i).end(); ++j)
+        {
+            reactions.push_back((*j).first);
+            for (std::vector<Species>::const_iterator k((*j).second.begin());
+                k != (*j).second.end(); ++k)
+            {
+                if (known.insert(*k).second)
+                {
+                    newseeds.push_back(*k);
+                }
+            }
+        }
+        stats.num_reactions += (*i).size();
+    }
+
+    stats.num_seeds = seeds1.size();
+    stats.num_new_species = newseeds.size();
+    stats.num_species = known.size();
     seeds1.swap(newseeds);
 }
 
 std::pair<std::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_model(
     const NetfreeModel& nfm, const std::vector<Species>& seeds, const Integer max_itr,
-    const std::map<Species, Integer>& max_stoich)
+    const std::map<Species, Integer>& max_stoich, const Integer num_threads,
+    const network_generation_observer_type& observer)
 {
+    if (num_threads < 1)
+    {
+        throw IllegalArgument("The number of threads must be positive.");
+    }
+
     std::vector<ReactionRule> reactions;
     std::vector<Species> seeds1;
     std::vector<Species> seeds2;
+    std::unordered_set<Species> known;  // formatted species in seeds1 and seeds2
 
     for (std::vector<Species>::const_iterator i(seeds.begin());
         i != seeds.end(); ++i)
     {
         const Species sp(format_species(*i));
-        if (std::find(seeds1.begin(), seeds1.end(), sp)
-            == seeds1.end())
+        if (known.insert(sp).second)
         {
             seeds1.push_back(sp);
         }
@@ -396,8 +592,7 @@ std::pair<std::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_mod
                 j(rr.products().begin()); j != rr.products().end(); ++j)
             {
                 const Species sp(format_species(*j));
-                if (std::find(seeds1.begin(), seeds1.end(), sp)
-                    == seeds1.end())
+                if (known.insert(sp).second)
                 {
                     seeds1.push_back(sp);
                 }
@@ -408,8 +603,21 @@ std::pair<std::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_mod
     Integer cnt(0);
     while (seeds1.size() > 0 && cnt < max_itr)
     {
-        __generate_recurse(nfm, reactions, seeds1, seeds2, max_stoich);
+        const std::chrono::steady_clock::time_point tstart(
+            std::chrono::steady_clock::now());
+
+        network_generation_statistics stats;
+        stats.iteration = cnt;
+        __generate_recurse(
+            nfm, reactions, seeds1, seeds2, known, max_stoich, num_threads, stats);
         cnt += 1;
+
+        stats.elapsed_time = std::chrono::duration<Real>(
+            std::chrono::steady_clock::now() - tstart).count();
+        if (observer)
+        {
+            observer(stats);
+        }
     }
 
     bool is_completed;
@@ -4,8 +4,11 @@
 #include <map>
 #include <set>
 #include <algorithm>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "types.hpp"
 #include "Species.hpp"
@@ -31,7 +34,8 @@ public:
 public:
 
     NetfreeModel()
-        : base_type(), species_attributes_(), species_attributes_proceed_(), reaction_rules_(), effective_(false)
+        : base_type(), species_attributes_(), species_attributes_proceed_(), reaction_rules_(), effective_(false),
+        query_cache_(default_query_cache_capacity())
     {
         ;
     }
@@ -99,9 +103,17 @@ public:
         const std::vector<Species>& sp, const Integer max_itr) const;
     std::shared_ptr<Model> expand(const std::vector<Species>& sp) const;
 
+    /**
+     * expand the network with the given number of threads.
+     */
+    std::shared_ptr<Model> expand(
+        const std::vector<Species>& sp, const Integer max_itr,
+        const std::map<Species, Integer>& max_stoich, const Integer num_threads) const;
+
     void set_effective(const bool effective)
     {
         effective_ = effective;
+        clear_query_cache();
     }
 
     const bool effective() const
@@ -109,21 +121,260 @@ public:
         return effective_;
     }
 
+    // Query cache
+
+    /**
+     * the maximum number of results cached for each of single species
+     * and pairs. the cache is cleared when it gets full.
+     */
+    static inline const Integer default_query_cache_capacity()
+    {
+        return 4096;
+    }
+
+    /**
+     * set the capacity of the cache. zero disables the cache.
+     */
+    void set_query_cache_capacity(const Integer capacity)
+    {
+        std::lock_guard<std::mutex> lock(query_cache_.mutex);
+        query_cache_.capacity = capacity;
+        query_cache_.clear();
+    }
+
+    Integer query_cache_capacity() const
+    {
+        std::lock_guard<std::mutex> lock(query_cache_.mutex);
+        return query_cache_.capacity;
+    }
+
+    Integer query_cache_hits() const
+    {
+        std::lock_guard<std::mutex> lock(query_cache_.mutex);
+        return query_cache_.hits;
+    }
+
+    Integer query_cache_misses() const
+    {
+        std::lock_guard<std::mutex> lock(query_cache_.mutex);
+        return query_cache_.misses;
+    }
+
+    /**
+     * drop all cached results. counters are kept.
+     */
+    void clear_query_cache() const
+    {
+        std::lock_guard<std::mutex> lock(query_cache_.mutex);
+        query_cache_.clear();
+    }
+
+protected:
+
+    std::vector<ReactionRule> query_reaction_rules_(const Species& sp) const;
+    std::vector<ReactionRule> query_reaction_rules_(
+        const Species& sp1, const Species& sp2) const;
+
+    void compile_reaction_rules();
+
+    /**
+     * results of query_reaction_rules keyed on the reactants.
+     * serials of reactants are interned as integer ids on insertion, so that
+     * a lookup neither copies Species nor hashes a pair of strings.
+     * the cache is shared by threads and guarded by the mutex.
+     * a copy of a model starts with an empty cache of the same capacity.
+     */
+    struct query_cache_type
+    {
+        typedef std::vector<ReactionRule> value_type;
+        typedef std::pair<Integer, Integer> pair_type;
+
+        struct pair_hash
+        {
+            std::size_t operator()(const pair_type& key) const
+            {
+                const std::hash<Integer> hasher;
+                return hasher(key.first) * 31 + hasher(key.second);
+            }
+        };
+
+        query_cache_type(const Integer capacity)
+            : capacity(capacity), hits(0), misses(0)
+        {
+            ;
+        }
+
+        query_cache_type(const query_cache_type& rhs)
+            : capacity(rhs.query_capacity()), hits(0), misses(0)
+        {
+            ;
+        }
+
+        query_cache_type& operator=(const query_cache_type& rhs)
+        {
+            const Integer new_capacity(rhs.query_capacity());
+            std::lock_guard<std::mutex> lock(mutex);
+            capacity = new_capacity;
+            hits = 0;
+            misses = 0;
+            clear();
+            return *this;
+        }
+
+        Integer query_capacity() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return capacity;
+        }
+
+        /**
+         * drop all results and ids. the mutex must be locked.
+         */
+        void clear()
+        {
+            ids.clear();
+            first_order.clear();
+            second_order.clear();
+        }
+
+        bool find(const Species& sp, value_type& retval)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const Integer id(find_id(sp));
+            return find(first_order, id, retval);
+        }
+
+        bool find(const Species& sp1, const Species& sp2, value_type& retval)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const Integer id1(find_id(sp1));
+            const Integer id2(id1 < 0 ? -1 : find_id(sp2));
+            return find(second_order, pair_type(id1, id2), retval);
+        }
+
+        void insert(const Species& sp, const value_type& value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (reserve(first_order))
+            {
+                first_order.insert(std::make_pair(intern(sp), value));
+            }
+        }
+
+        void insert(const Species& sp1, const Species& sp2, const value_type& value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (reserve(second_order))
+            {
+                const Integer id1(intern(sp1));
+                second_order.insert(std::make_pair(pair_type(id1, intern(sp2)), value));
+            }
+        }
+
+        mutable std::mutex mutex;
+        Integer capacity, hits, misses;
+        std::unordered_map<Species::serial_type, Integer> ids;
+        std::unordered_map<Integer, value_type> first_order;
+        std::unordered_map<pair_type, value_type, pair_hash> second_order;
+
+    private:
+
+        Integer find_id(const Species& sp) const
+        {
+            const std::unordered_map<Species::serial_type, Integer>::const_iterator
+                i(ids.find(sp.serial()));
+            return (i == ids.end() ? -1 : (*i).second);
+        }
+
+        Integer intern(const Species& sp)
+        {
+            return (*ids.insert(std::make_pair(sp.serial(), ids.size())).first).second;
+        }
+
+        template <typename Tmap_>
+        bool find(const Tmap_& map, const typename Tmap_::key_type& key, value_type& retval)
+        {
+            const typename Tmap_::const_iterator i(map.find(key));
+            if (i == map.end())
+            {
+                ++misses;
+                return false;
+            }
+            ++hits;
+            retval = (*i).second;
+            return true;
+        }
+
+        /**
+         * make room for a new entry in the map. false if disabled.
+         * ids are bounded together with the results.
+         */
+        template <typename Tmap_>
+        bool reserve(const Tmap_& map)
+        {
+            if (capacity <= 0)
+            {
+                return false;
+            }
+            if (map.size() >= static_cast<std::size_t>(capacity)
+                || ids.size() >= 2 * static_cast<std::size_t>(capacity))
+            {
+                clear();
+            }
+            return true;
+        }
+    };
+
 protected:
 
     species_container_type species_attributes_;
     std::vector<bool> species_attributes_proceed_;  //XXX:
     reaction_rule_container_type reaction_rules_;
+    std::vector<std::vector<context::compiled_species> > compiled_reactants_;  // for each rule
 
     bool effective_;
+
+    mutable query_cache_type query_cache_;
 };
 
 namespace extras
 {
 
+/**
+ * statistics of an iteration of generate_network_from_netfree_model.
+ */
+struct network_generation_statistics
+{
+    Integer iteration;
+    Integer num_seeds;  // species expanded in this iteration
+    Integer num_trials;  // pairs of a rule and reactants tried
+    Integer num_reactions;  // reactions generated in this iteration
+    Integer num_new_species;
+    Integer num_species;  // species found so far
+    Real elapsed_time;  // wall-clock time of this iteration in seconds
+};
+
+typedef std::function<void (const network_generation_statistics&)>
+    network_generation_observer_type;
+
+/**
+ * expand the network from seeds.
+ * combinations of a rule and seeds are distributed over num_threads threads
+ * in each iteration. the result does not depend on the number of threads.
+ * observer, if any, is called after each iteration.
+ */
 std::pair<std::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_model(
     const NetfreeModel& nfm, const std::vector<Species>& seeds, const Integer max_itr,
-    const std::map<Species, Integer>& max_stoich);
+    const std::map<Species, Integer>& max_stoich, const Integer num_threads,
+    const network_generation_observer_type& observer = network_generation_observer_type());
+
+inline std::pair<std::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_model(
+    const NetfreeModel& nfm, const std::vector<Species>& seeds, const Integer max_itr,
+    const std::map<Species, Integer>& max_stoich)
+{
+    return generate_network_from_netfree_model(
+        nfm, seeds, max_itr, max_stoich, 1);
+}
 
 inline std::pair<std::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_model(
     const NetfreeModel& nfm, const std::vector<Species>& seeds, const Integer max_itr)
@@ -0,0 +1,179 @@
+#ifndef ECELL4_PARTIAL_SUM_TREE_HPP
+#define ECELL4_PARTIAL_SUM_TREE_HPP
+
+#include <vector>
+#include <limits>
+#include <stdexcept>
+
+#include "types.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * A complete binary tree holding non-negative weights at its leaves and
+ * partial sums at its internal nodes.
+ * Updating a weight and drawing an index with the probability proportional
+ * to its weight are both O(log N).
+ * Internal nodes are recomputed from their children on every update,
+ * so that rounding errors never accumulate.
+ * Infinite weights are allowed, and take precedence over finite ones in find.
+ */
+class PartialSumTree
+{
+public:
+
+    typedef std::vector<Real> container_type;
+    typedef container_type::size_type size_type;
+
+public:
+
+    PartialSumTree(const size_type size = 0)
+    {
+        resize(size);
+    }
+
+    /**
+     * resize the tree. All weights are reset to zero.
+     */
+    void resize(const size_type size)
+    {
+        size_ = size;
+        capacity_ = 1;
+        while (capacity_ < size_)
+        {
+            capacity_ <<= 1;
+        }
+        nodes_.assign(2 * capacity_, 0.0);
+        num_infinities_.assign(2 * capacity_, 0);
+    }
+
+    void clear()
+    {
+        resize(0);
+    }
+
+    /**
+     * append a leaf with the given weight. The other weights are kept.
+     * The capacity is doubled when the tree is full.
+     */
+    void push_back(const Real value)
+    {
+        if (size_ == capacity_)
+        {
+            const container_type leaves(nodes_.begin() + capacity_, nodes_.end());
+            capacity_ <<= 1;
+            nodes_.assign(2 * capacity_, 0.0);
+            num_infinities_.assign(2 * capacity_, 0);
+            for (size_type i(0); i < size_; ++i)
+            {
+                nodes_[capacity_ + i] = leaves[i];
+                num_infinities_[capacity_ + i] =
+                    (leaves[i] == std::numeric_limits<Real>::infinity() ? 1 : 0);
+            }
+            for (size_type j(capacity_ - 1); j > 0; --j)
+            {
+                nodes_[j] = nodes_[2 * j] + nodes_[2 * j + 1];
+                num_infinities_[j] = num_infinities_[2 * j] + num_infinities_[2 * j + 1];
+            }
+        }
+
+        ++size_;
+        set(size_ - 1, value);
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    const Real get(const size_type i) const
+    {
+        return nodes_[capacity_ + i];
+    }
+
+    void set(const size_type i, const Real value)
+    {
+        if (i >= size_)
+        {
+            throw std::out_of_range("An index is out of range.");
+        }
+
+        size_type j(capacity_ + i);
+        nodes_[j] = value;
+        num_infinities_[j] = (value == std::numeric_limits<Real>::infinity() ? 1 : 0);
+
+        while (j > 1)
+        {
+            j >>= 1;
+            nodes_[j] = nodes_[2 * j] + nodes_[2 * j + 1];
+            num_infinities_[j] = num_infinities_[2 * j] + num_infinities_[2 * j + 1];
+        }
+    }
+
+    /**
+     * the sum of all weights.
+     */
+    const Real total() const
+    {
+        return nodes_[1];
+    }
+
+    /**
+     * the number of leaves having an infinite weight.
+     */
+    const size_type num_infinities() const
+    {
+        return num_infinities_[1];
+    }
+
+    /**
+     * return the smallest index i such that the sum of weights [0, i] is
+     * larger than or equal to the given value, which must be in [0, total()).
+     * If the total is infinite, the value must be in [0, num_infinities())
+     * and select the corresponding leaf with an infinite weight instead.
+     */
+    size_type find(Real value) const
+    {
+        size_type j(1);
+
+        if (num_infinities_[1] > 0)
+        {
+            while (j < capacity_)
+            {
+                j <<= 1;
+                if (value >= num_infinities_[j])
+                {
+                    value -= num_infinities_[j];
+                    ++j;
+                }
+            }
+            return j - capacity_;
+        }
+
+        while (j < capacity_)
+        {
+            j <<= 1;
+            const Real left(nodes_[j]), right(nodes_[j + 1]);
+            // never descend into a subtree without weights,
+            // even when rounding errors let the value run over.
+            if (left <= 0.0 || (value > left && right > 0.0))
+            {
+                value -= left;
+                ++j;
+            }
+        }
+        return j - capacity_;
+    }
+
+protected:
+
+    size_type size_, capacity_;
+    container_type nodes_;
+    std::vector<size_type> num_infinities_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_PARTIAL_SUM_TREE_HPP */
@@ -213,6 +213,25 @@ ParticleSpaceVectorImpl::list_particles_within_radius(
     return retval;
 }
 
+bool ParticleSpaceVectorImpl::visit_particles_within_radius(
+    const Real3& pos, const Real& radius, particle_visitor& visitor,
+    const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    for (particle_container_type::const_iterator i(particles_.begin());
+         i != particles_.end(); ++i)
+    {
+        const Real dist(distance((*i).second.position(), pos) - (*i).second.radius());
+        if (dist <= radius && (*i).first != ignore1 && (*i).first != ignore2)
+        {
+            if (!visitor(ParticleView((*i).first, (*i).second), dist))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void ParticleSpaceVectorImpl::reset(const Real3& edge_lengths)
 {
     base_type::t_ = 0.0;
@@ -9,6 +9,7 @@
 #include "exceptions.hpp"
 #include "Real3.hpp"
 #include "Particle.hpp"
+#include "CompactParticle.hpp"
 #include "Species.hpp"
 // #include "Space.hpp"
 
@@ -146,7 +147,7 @@ public:
 
     virtual std::vector<Species> list_species() const
     {
-        const particle_container_type& pcont(particles());
+        const particle_container_type pcont(list_particles());
         std::vector<Species> retval;
         for (particle_container_type::const_iterator i(pcont.begin());
             i != pcont.end(); ++i)
@@ -232,6 +233,108 @@ public:
         const Real3& pos, const Real& radius,
         const ParticleID& ignore1, const ParticleID& ignore2) const = 0;
 
+    /**
+     * a callback for visit_particles_within_radius.
+     * it is called with a view of each particle found and the distance
+     * from the surface of the particle to the center of the sphere.
+     * call ParticleView::particle() only when the Particle is needed.
+     * return false to stop visiting particles.
+     */
+    struct particle_visitor
+    {
+        virtual ~particle_visitor()
+        {
+            ;
+        }
+
+        virtual bool operator()(const ParticleView& view, const Real& dist) = 0;
+    };
+
+    /**
+     * visit particles within a spherical region except for ignore(s)
+     * without building a list. particles are not sorted by the distance.
+     * a null ParticleID() as an ignore means nothing to be ignored.
+     * the default implementation falls back to list_particles_within_radius.
+     * @param pos a center position of the sphere
+     * @param radius a radius of the sphere
+     * @param visitor a callback for each particle
+     * @param ignore1 an ignored ID
+     * @param ignore2 an ignored ID
+     * @return false if the visitor stopped visiting, otherwise true
+     */
+    virtual bool visit_particles_within_radius(
+        const Real3& pos, const Real& radius, particle_visitor& visitor,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const
+    {
+        const std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+            particles(ignore1 == ParticleID()
+                ? (ignore2 == ParticleID()
+                    ? list_particles_within_radius(pos, radius)
+                    : list_particles_within_radius(pos, radius, ignore2))
+                : (ignore2 == ParticleID()
+                    ? list_particles_within_radius(pos, radius, ignore1)
+                    : list_particles_within_radius(pos, radius, ignore1, ignore2)));
+        for (std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >::const_iterator
+            i(particles.begin()); i != particles.end(); ++i)
+        {
+            if (!visitor(ParticleView((*i).first.first, (*i).first.second), (*i).second))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * call fn(view, dist) for each particle within a spherical region.
+     * fn must return a bool, false to stop. see visit_particles_within_radius.
+     */
+    template <typename Tfn_>
+    bool for_each_particle_within_radius(
+        const Real3& pos, const Real& radius, Tfn_ fn) const
+    {
+        particle_visitor_adapter<Tfn_> visitor(fn);
+        return visit_particles_within_radius(pos, radius, visitor);
+    }
+
+    template <typename Tfn_>
+    bool for_each_particle_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore, Tfn_ fn) const
+    {
+        particle_visitor_adapter<Tfn_> visitor(fn);
+        return visit_particles_within_radius(pos, radius, visitor, ignore);
+    }
+
+    template <typename Tfn_>
+    bool for_each_particle_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1, const ParticleID& ignore2, Tfn_ fn) const
+    {
+        particle_visitor_adapter<Tfn_> visitor(fn);
+        return visit_particles_within_radius(pos, radius, visitor, ignore1, ignore2);
+    }
+
+    /**
+     * check if any particle exists within a spherical region except for ignore(s).
+     * this is equivalent to !list_particles_within_radius(...).empty(),
+     * but stops at the first particle found.
+     * @param pos a center position of the sphere
+     * @param radius a radius of the sphere
+     * @param ignore1 an ignored ID
+     * @param ignore2 an ignored ID
+     * @return true if overlapped
+     */
+    bool has_overlap(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const
+    {
+        overlap_checker checker;
+        return !visit_particles_within_radius(pos, radius, checker, ignore1, ignore2);
+    }
+
     /**
      * transpose a position based on the periodic boundary condition.
      * this function is a part of the trait of ParticleSpace.
@@ -322,8 +425,6 @@ public:
 
     // Optional members
 
-    virtual const particle_container_type& particles() const = 0;
-
     virtual Real get_value(const Species& sp) const
     {
         return static_cast<Real>(num_molecules(sp));
@@ -340,6 +441,35 @@ public:
         return size[0] * size[1] * size[2];
     }
 
+protected:
+
+    template <typename Tfn_>
+    struct particle_visitor_adapter
+        : public particle_visitor
+    {
+        particle_visitor_adapter(Tfn_& fn)
+            : fn(fn)
+        {
+            ;
+        }
+
+        bool operator()(const ParticleView& view, const Real& dist)
+        {
+            return fn(view, dist);
+        }
+
+        Tfn_& fn;
+    };
+
+    struct overlap_checker
+        : public particle_visitor
+    {
+        bool operator()(const ParticleView& view, const Real& dist)
+        {
+            return false;
+        }
+    };
+
 protected:
 
     Real t_;
@@ -399,6 +529,10 @@ public:
     list_particles_within_radius(
         const Real3& pos, const Real& radius,
         const ParticleID& ignore1, const ParticleID& ignore2) const;
+    bool visit_particles_within_radius(
+        const Real3& pos, const Real& radius, particle_visitor& visitor,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const;
 
     // CompartmentSpaceTraits
 
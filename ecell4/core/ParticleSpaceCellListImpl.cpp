@@ -12,6 +12,7 @@ void ParticleSpaceCellListImpl::reset(const Real3& edge_lengths)
     particles_.clear();
     rmap_.clear();
     particle_pool_.clear();
+    species_table_.clear();
 
     for (matrix_type::size_type i(0); i < matrix_.shape()[0]; ++i)
     {
@@ -39,19 +40,21 @@ void ParticleSpaceCellListImpl::reset(const Real3& edge_lengths)
 bool ParticleSpaceCellListImpl::update_particle(
     const ParticleID& pid, const Particle& p)
 {
-    particle_container_type::iterator i(find(pid));
+    const CompactParticle v(species_table_.compact(p));
+    compact_container_type::iterator i(find(pid));
     if (i != particles_.end())
     {
-        if ((*i).second.species() != p.species())
+        if ((*i).second.species_index() != v.species_index())
         {
-            particle_pool_[(*i).second.species_serial()].erase((*i).first);
+            particle_pool_[species_table_.species(
+                (*i).second.species_index()).serial()].erase((*i).first);
             particle_pool_[p.species_serial()].insert(pid);
         }
-        this->update(i, std::make_pair(pid, p));
+        this->update(i, std::make_pair(pid, v));
         return false;
     }
 
-    this->update(std::make_pair(pid, p));
+    this->update(std::make_pair(pid, v));
     // const bool succeeded(this->update(std::make_pair(pid, p)).second);
     // BOOST_ASSERT(succeeded);
 
@@ -62,12 +65,12 @@ bool ParticleSpaceCellListImpl::update_particle(
 std::pair<ParticleID, Particle> ParticleSpaceCellListImpl::get_particle(
     const ParticleID& pid) const
 {
-    particle_container_type::const_iterator i(this->find(pid));
+    compact_container_type::const_iterator i(this->find(pid));
     if (i == particles_.end())
     {
         throw NotFound("No such particle.");
     }
-    return (*i);
+    return to_particle(*i);
 }
 
 bool ParticleSpaceCellListImpl::has_particle(const ParticleID& pid) const
@@ -80,8 +83,12 @@ void ParticleSpaceCellListImpl::remove_particle(const ParticleID& pid)
     //XXX: In contrast to the original ParticleContainer in epdp,
     //XXX: this remove_particle throws an error when no corresponding
     //XXX: particle is found.
-    std::pair<ParticleID, Particle> pp(get_particle(pid)); //XXX: may raise an error.
-    particle_pool_[pp.second.species_serial()].erase(pid);
+    compact_container_type::const_iterator i(this->find(pid));
+    if (i == particles_.end())
+    {
+        throw NotFound("No such particle.");
+    }
+    particle_pool_[species_table_.species((*i).second.species_index()).serial()].erase(pid);
     this->erase(pid);
 }
 
@@ -137,7 +144,14 @@ Integer ParticleSpaceCellListImpl::num_molecules_exact(const Species& sp) const
 std::vector<std::pair<ParticleID, Particle> >
     ParticleSpaceCellListImpl::list_particles() const
 {
-    return particles_;
+    std::vector<std::pair<ParticleID, Particle> > retval;
+    retval.reserve(particles_.size());
+    for (compact_container_type::const_iterator i(particles_.begin());
+         i != particles_.end(); ++i)
+    {
+        retval.push_back(to_particle(*i));
+    }
+    return retval;
 }
 
 std::vector<std::pair<ParticleID, Particle> >
@@ -146,12 +160,19 @@ std::vector<std::pair<ParticleID, Particle> >
     std::vector<std::pair<ParticleID, Particle> > retval;
     SpeciesExpressionMatcher sexp(sp);
 
-    for (particle_container_type::const_iterator i(particles_.begin());
+    // Match each interned species only once.
+    std::vector<char> matched(species_table_.size());
+    for (std::size_t idx(0); idx < species_table_.size(); ++idx)
+    {
+        matched[idx] = sexp.match(species_table_.species(idx));
+    }
+
+    for (compact_container_type::const_iterator i(particles_.begin());
          i != particles_.end(); ++i)
     {
-        if (sexp.match((*i).second.species()))
+        if (matched[(*i).second.species_index()])
         {
-            retval.push_back(*i);
+            retval.push_back(to_particle(*i));
         }
     }
     return retval;
@@ -172,12 +193,18 @@ std::vector<std::pair<ParticleID, Particle> >
     // }
     // retval.reserve((*i).second.size());
 
-    for (particle_container_type::const_iterator i(particles_.begin());
+    std::vector<char> matched(species_table_.size());
+    for (std::size_t idx(0); idx < species_table_.size(); ++idx)
+    {
+        matched[idx] = (species_table_.species(idx) == sp);
+    }
+
+    for (compact_container_type::const_iterator i(particles_.begin());
          i != particles_.end(); ++i)
     {
-        if ((*i).second.species() == sp)
+        if (matched[(*i).second.species_index()])
         {
-            retval.push_back(*i);
+            retval.push_back(to_particle(*i));
         }
     }
     return retval;
@@ -211,9 +238,9 @@ std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
                 for (cell_type::const_iterator i(c.begin()); i != c.end(); ++i)
                 {
                     // neighbor_filter::operator()
-                    particle_container_type::const_iterator
+                    compact_container_type::const_iterator
                         itr(particles_.begin() + (*i));
-                    // particle_container_type::const_iterator itr = particles_.begin();
+                    // compact_container_type::const_iterator itr = particles_.begin();
                     // std::advance(itr, *i);
 
                     const Real dist(
@@ -223,7 +250,7 @@ std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
                     {
                         // overlap_checker::operator()
                         retval.push_back(
-                            std::make_pair(*itr, dist));
+                            std::make_pair(to_particle(*itr), dist));
                     }
                 }
             }
@@ -264,7 +291,7 @@ std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
                 for (cell_type::const_iterator i(c.begin()); i != c.end(); ++i)
                 {
                     // neighbor_filter::operator()
-                    particle_container_type::const_iterator
+                    compact_container_type::const_iterator
                         itr(particles_.begin() + (*i));
 
                     const Real dist(
@@ -276,7 +303,7 @@ std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
                         if ((*itr).first != ignore)
                         {
                             retval.push_back(
-                                std::make_pair(*itr, dist));
+                                std::make_pair(to_particle(*itr), dist));
                         }
                     }
                 }
@@ -318,7 +345,7 @@ std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
                 for (cell_type::const_iterator i(c.begin()); i != c.end(); ++i)
                 {
                     // neighbor_filter::operator()
-                    particle_container_type::const_iterator
+                    compact_container_type::const_iterator
                         itr(particles_.begin() + (*i));
 
                     const Real dist(
@@ -330,7 +357,7 @@ std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
                         if ((*itr).first != ignore1 && (*itr).first != ignore2)
                         {
                             retval.push_back(
-                                std::make_pair(*itr, dist));
+                                std::make_pair(to_particle(*itr), dist));
                         }
                     }
                 }
@@ -343,4 +370,51 @@ std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
     return retval;
 }
 
+bool ParticleSpaceCellListImpl::visit_particles_within_radius(
+    const Real3& pos, const Real& radius, particle_visitor& visitor,
+    const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    // The same as list_particles_within_radius, but without building a list.
+    // Visitors are given views of the compact form.
+    if (particles_.size() == 0)
+    {
+        return true;
+    }
+
+    cell_index_type idx(this->index(pos));
+
+    cell_offset_type off;
+    for (off[2] = -1; off[2] <= 1; ++off[2])
+    {
+        for (off[1] = -1; off[1] <= 1; ++off[1])
+        {
+            for (off[0] = -1; off[0] <= 1; ++off[0])
+            {
+                cell_index_type newidx(idx);
+                const Real3 stride(this->offset_index_cyclic(newidx, off));
+                const cell_type& c(this->cell(newidx));
+                for (cell_type::const_iterator i(c.begin()); i != c.end(); ++i)
+                {
+                    compact_container_type::const_iterator
+                        itr(particles_.begin() + (*i));
+
+                    const Real dist(
+                        length((*itr).second.position() + stride - pos)
+                        - (*itr).second.radius());
+                    if (dist < radius
+                        && (*itr).first != ignore1 && (*itr).first != ignore2)
+                    {
+                        if (!visitor(ParticleView(
+                                (*itr).first, (*itr).second, species_table_), dist))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
 };
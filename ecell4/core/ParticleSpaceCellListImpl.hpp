@@ -6,6 +6,7 @@
 #include <array>
 
 #include "ParticleSpace.hpp"
+#include "CompactParticle.hpp"
 
 #ifdef WITH_HDF5
 #include "ParticleSpaceHDF5Writer.hpp"
@@ -25,13 +26,20 @@ public:
     typedef ParticleSpace base_type;
     typedef ParticleSpace::particle_container_type particle_container_type;
 
-    typedef std::unordered_map<ParticleID, particle_container_type::size_type>
+    /**
+     * particles are stored in the compact form internally,
+     * and converted to Particle only when they go out.
+     */
+    typedef std::vector<std::pair<ParticleID, CompactParticle> >
+        compact_container_type;
+
+    typedef std::unordered_map<ParticleID, compact_container_type::size_type>
         key_to_value_map_type;
 
     typedef std::set<ParticleID> particle_id_set;
     typedef std::map<Species::serial_type, particle_id_set> per_species_particle_id_set;
 
-    typedef std::vector<particle_container_type::size_type> cell_type; // sorted
+    typedef std::vector<compact_container_type::size_type> cell_type; // sorted
     typedef boost::multi_array<cell_type, 3> matrix_type;
     typedef std::array<matrix_type::size_type, 3> cell_index_type;
     typedef std::array<matrix_type::difference_type, 3> cell_offset_type;
@@ -39,7 +47,8 @@ public:
 public:
 
     ParticleSpaceCellListImpl(const Real3& edge_lengths)
-        : base_type(), edge_lengths_(edge_lengths), matrix_(boost::extents[3][3][3])
+        : base_type(), edge_lengths_(edge_lengths),
+        matrix_(boost::extents[3][3][3])
     {
         cell_sizes_[0] = edge_lengths_[0] / matrix_.shape()[0];
         cell_sizes_[1] = edge_lengths_[1] / matrix_.shape()[1];
@@ -120,9 +129,9 @@ public:
 
     bool update_particle(const ParticleID& pid, const Particle& p);
 
-    const particle_container_type& particles() const
+    const ParticleSpeciesTable& species_table() const
     {
-        return particles_;
+        return species_table_;
     }
 
     std::pair<ParticleID, Particle> get_particle(const ParticleID& pid) const;
@@ -171,6 +180,10 @@ public:
         list_particles_within_radius(
             const Real3& pos, const Real& radius,
             const ParticleID& ignore1, const ParticleID& ignore2) const;
+    bool visit_particles_within_radius(
+        const Real3& pos, const Real& radius, particle_visitor& visitor,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const;
 
 protected:
 
@@ -265,6 +278,12 @@ protected:
         return retval;
     }
 
+    inline std::pair<ParticleID, Particle> to_particle(
+        const std::pair<ParticleID, CompactParticle>& v) const
+    {
+        return std::make_pair(v.first, species_table_.particle(v.second));
+    }
+
     inline const cell_type& cell(const cell_index_type& i) const
     {
         return matrix_[i[0]][i[1]][i[2]];
@@ -275,7 +294,7 @@ protected:
         return matrix_[i[0]][i[1]][i[2]];
     }
 
-    inline particle_container_type::iterator find(const ParticleID& k)
+    inline compact_container_type::iterator find(const ParticleID& k)
     {
         key_to_value_map_type::const_iterator p(rmap_.find(k));
         if (rmap_.end() == p)
@@ -285,7 +304,7 @@ protected:
         return particles_.begin() + (*p).second;
     }
 
-    inline particle_container_type::const_iterator find(const ParticleID& k) const
+    inline compact_container_type::const_iterator find(const ParticleID& k) const
     {
         key_to_value_map_type::const_iterator p(rmap_.find(k));
         if (rmap_.end() == p)
@@ -295,9 +314,9 @@ protected:
         return particles_.begin() + (*p).second;
     }
 
-    inline particle_container_type::iterator update(
-        particle_container_type::iterator const& old_value,
-        const std::pair<ParticleID, Particle>& v)
+    inline compact_container_type::iterator update(
+        compact_container_type::iterator const& old_value,
+        const std::pair<ParticleID, CompactParticle>& v)
     {
         cell_type* new_cell(&cell(index(v.second.position())));
         cell_type* old_cell(0);
@@ -315,7 +334,7 @@ protected:
         }
         else
         {
-            particle_container_type::size_type idx(0);
+            compact_container_type::size_type idx(0);
 
             if (old_cell)
             {
@@ -339,11 +358,11 @@ protected:
         }
     }
 
-    inline std::pair<particle_container_type::iterator, bool> update(
-        const std::pair<ParticleID, Particle>& v)
+    inline std::pair<compact_container_type::iterator, bool> update(
+        const std::pair<ParticleID, CompactParticle>& v)
     {
         cell_type* new_cell(&cell(index(v.second.position())));
-        particle_container_type::iterator old_value(particles_.end());
+        compact_container_type::iterator old_value(particles_.end());
         cell_type* old_cell(0);
 
         {
@@ -359,12 +378,12 @@ protected:
         {
             // reinterpret_cast<nonconst_value_type&>(*old_value) = v;
             *old_value = v;
-            // return std::pair<particle_container_type::iterator, bool>(old_value, false);
+            // return std::pair<compact_container_type::iterator, bool>(old_value, false);
             return std::make_pair(old_value, false);
         }
         else
         {
-            particle_container_type::size_type idx(0);
+            compact_container_type::size_type idx(0);
 
             if (old_cell)
             {
@@ -376,7 +395,7 @@ protected:
                 idx = *i;
                 erase_from_cell(old_cell, i);
                 push_into_cell(new_cell, idx);
-                return std::pair<particle_container_type::iterator, bool>(
+                return std::pair<compact_container_type::iterator, bool>(
                     particles_.begin() + idx, false);
             }
             else
@@ -385,20 +404,20 @@ protected:
                 particles_.push_back(v);
                 push_into_cell(new_cell, idx);
                 rmap_[v.first] = idx;
-                return std::pair<particle_container_type::iterator, bool>(
+                return std::pair<compact_container_type::iterator, bool>(
                     particles_.begin() + idx, true);
             }
         }
     }
 
-    inline bool erase(particle_container_type::iterator const& i)
+    inline bool erase(compact_container_type::iterator const& i)
     {
         if (particles_.end() == i)
         {
             return false;
         }
 
-        particle_container_type::size_type old_idx(i - particles_.begin());
+        compact_container_type::size_type old_idx(i - particles_.begin());
         cell_type& old_cell(cell(index((*i).second.position())));
         const bool succeeded(erase_from_cell(&old_cell, old_idx));
         if (!succeeded)
@@ -408,11 +427,11 @@ protected:
         // BOOST_ASSERT(succeeded);
         rmap_.erase((*i).first);
 
-        particle_container_type::size_type const last_idx(particles_.size() - 1);
+        compact_container_type::size_type const last_idx(particles_.size() - 1);
 
         if (old_idx < last_idx)
         {
-            const std::pair<ParticleID, Particle>& last(particles_[last_idx]);
+            const std::pair<ParticleID, CompactParticle>& last(particles_[last_idx]);
             cell_type& last_cell(cell(index(last.second.position())));
             const bool tmp(erase_from_cell(&last_cell, last_idx));
             if (!tmp)
@@ -445,7 +464,7 @@ protected:
     }
 
     inline cell_type::size_type erase_from_cell(
-        cell_type* c, const particle_container_type::size_type& v)
+        cell_type* c, const compact_container_type::size_type& v)
     {
         cell_type::iterator e(c->end());
         std::pair<cell_type::iterator, cell_type::iterator>
@@ -456,14 +475,14 @@ protected:
     }
 
     inline void push_into_cell(
-        cell_type* c, const particle_container_type::size_type& v)
+        cell_type* c, const compact_container_type::size_type& v)
     {
         cell_type::iterator i(std::upper_bound(c->begin(), c->end(), v));
         c->insert(i, v);
     }
 
     inline cell_type::iterator find_in_cell(
-        cell_type* c, const particle_container_type::size_type& v)
+        cell_type* c, const compact_container_type::size_type& v)
     {
         cell_type::iterator i(std::lower_bound(c->begin(), c->end(), v));
         if (i != c->end() && *i == v)
@@ -477,7 +496,7 @@ protected:
     }
 
     inline cell_type::const_iterator find_in_cell(
-        cell_type* c, const particle_container_type::size_type& v) const
+        cell_type* c, const compact_container_type::size_type& v) const
     {
         cell_type::iterator i(std::lower_bound(c->begin(), c->end(), v));
         if (i != c->end() && *i == v)
@@ -494,9 +513,10 @@ protected:
 
     Real3 edge_lengths_;
 
-    particle_container_type particles_;
+    compact_container_type particles_;
     key_to_value_map_type rmap_;
     per_species_particle_id_set particle_pool_;
+    ParticleSpeciesTable species_table_;
 
     matrix_type matrix_;
     Real3 cell_sizes_;
@@ -8,6 +8,7 @@ void ParticleSpaceRTreeImpl::reset(const Real3& edge_lengths)
 {
     this->t_ = 0.0;
     this->particle_pool_.clear();
+    this->species_table_.clear();
     this->rtree_.clear();
     this->rtree_.reset_boundary(edge_lengths);
     return ;
@@ -18,7 +19,7 @@ std::vector<Species> ParticleSpaceRTreeImpl::list_species() const
     std::vector<Species> retval;
     for (const auto& pidp : rtree_.list_objects())
     {
-        const Species& sp(pidp.second.species());
+        const Species& sp(species_table_.species(pidp.second.species_index()));
         if(std::find(retval.begin(), retval.end(), sp) == retval.end())
         {
             retval.push_back(sp);
@@ -71,11 +72,18 @@ ParticleSpaceRTreeImpl::list_particles(const Species& sp) const
     std::vector<std::pair<ParticleID, Particle>> retval;
     SpeciesExpressionMatcher sexp(sp);
 
+    // match each interned species only once.
+    std::vector<char> matched(species_table_.size());
+    for(std::size_t idx=0; idx<species_table_.size(); ++idx)
+    {
+        matched[idx] = sexp.match(species_table_.species(idx));
+    }
+
     for(const auto& pidp : rtree_.list_objects())
     {
-        if(sexp.match(pidp.second.species()))
+        if(matched[pidp.second.species_index()])
         {
-            retval.push_back(pidp);
+            retval.push_back(this->to_particle(pidp));
         }
     }
     return retval;
@@ -85,46 +93,63 @@ ParticleSpaceRTreeImpl::list_particles_exact(const Species& sp) const
 {
     std::vector<std::pair<ParticleID, Particle>> retval;
 
+    std::vector<char> matched(species_table_.size());
+    for(std::size_t idx=0; idx<species_table_.size(); ++idx)
+    {
+        matched[idx] = (species_table_.species(idx) == sp);
+    }
+
     for(const auto& pidp : rtree_.list_objects())
     {
-        if (pidp.second.species() == sp)
+        if(matched[pidp.second.species_index()])
         {
-            retval.push_back(pidp);
+            retval.push_back(this->to_particle(pidp));
         }
     }
     return retval;
 }
 
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real>>
+ParticleSpaceRTreeImpl::to_sorted_particles(
+        const std::vector<std::pair<value_type, Real>>& found) const
+{
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real>> list;
+    list.reserve(found.size());
+    for(const auto& item : found)
+    {
+        list.push_back(std::make_pair(this->to_particle(item.first), item.second));
+    }
+
+    std::sort(list.begin(), list.end(), utils::pair_second_element_comparator<
+              std::pair<ParticleID, Particle>, Real>());
+    return list;
+}
+
 std::vector<std::pair<std::pair<ParticleID, Particle>, Real>>
 ParticleSpaceRTreeImpl::list_particles_within_radius(
         const Real3& pos, const Real& radius) const
 {
-    std::vector<std::pair<std::pair<ParticleID, Particle>, Real>> list;
+    std::vector<std::pair<value_type, Real>> found;
     this->query_impl(make_intersection_query(pos, radius,
         [](const value_type&) noexcept -> bool {
             return false;
-        }), std::back_inserter(list));
+        }), std::back_inserter(found));
 
-    std::sort(list.begin(), list.end(), utils::pair_second_element_comparator<
-              std::pair<ParticleID, Particle>, Real>());
-    return list;
+    return this->to_sorted_particles(found);
 }
 
 std::vector<std::pair<std::pair<ParticleID, Particle>, Real>>
 ParticleSpaceRTreeImpl::list_particles_within_radius(
     const Real3& pos, const Real& radius, const ParticleID& ignore) const
 {
-    std::vector<std::pair<std::pair<ParticleID, Particle>, Real>> list;
+    std::vector<std::pair<value_type, Real>> found;
 
     this->query_impl(make_intersection_query(pos, radius,
         [&ignore](const value_type& pidp) noexcept -> bool {
             return pidp.first == ignore;
-        }), std::back_inserter(list));
-
-    std::sort(list.begin(), list.end(), utils::pair_second_element_comparator<
-              std::pair<ParticleID, Particle>, Real>());
+        }), std::back_inserter(found));
 
-    return list;
+    return this->to_sorted_particles(found);
 }
 
 std::vector<std::pair<std::pair<ParticleID, Particle>, Real>>
@@ -132,17 +157,25 @@ ParticleSpaceRTreeImpl::list_particles_within_radius(
     const Real3& pos, const Real& radius, const ParticleID& ignore1,
     const ParticleID& ignore2) const
 {
-    std::vector<std::pair<std::pair<ParticleID, Particle>, Real>> list;
+    std::vector<std::pair<value_type, Real>> found;
 
     this->query_impl(make_intersection_query(pos, radius,
         [&ignore1, &ignore2](const value_type& pidp) noexcept -> bool {
             return pidp.first == ignore1 || pidp.first == ignore2;
-        }), std::back_inserter(list));
+        }), std::back_inserter(found));
 
-    std::sort(list.begin(), list.end(), utils::pair_second_element_comparator<
-              std::pair<ParticleID, Particle>, Real>());
+    return this->to_sorted_particles(found);
+}
 
-    return list;
+bool ParticleSpaceRTreeImpl::visit_particles_within_radius(
+    const Real3& pos, const Real& radius, particle_visitor& visitor,
+    const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    bool stopped = false;
+    this->query_impl(VisitorQuery(pos, radius, IgnoreFilter{ignore1, ignore2},
+                                  &species_table_, &visitor, &stopped),
+                     null_output_iterator());
+    return !stopped;
 }
 
 } // ecell4
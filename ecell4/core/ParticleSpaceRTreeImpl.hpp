@@ -2,6 +2,7 @@
 #define ECELL4_PARTICLE_SPACE_RTREE_IMPL_HPP
 
 #include <ecell4/core/ParticleSpace.hpp>
+#include <ecell4/core/CompactParticle.hpp>
 #include <ecell4/core/AABB.hpp>
 #include <ecell4/core/Context.hpp>
 #include <ecell4/core/Real3.hpp>
@@ -24,7 +25,7 @@ class ParticleSpaceRTreeImpl
 public:
     struct ParticleAABBGetter
     {
-        AABB operator()(const Particle& p, const Real margin) const noexcept
+        AABB operator()(const CompactParticle& p, const Real margin) const noexcept
         {
             const Real3 radius(p.radius() + p.D() * margin,
                                p.radius() + p.D() * margin,
@@ -34,18 +35,19 @@ public:
     };
 
     using base_type  = ParticleSpace;
-    using rtree_type = PeriodicRTree<ParticleID, Particle, ParticleAABBGetter>;
+    // particles are stored in the compact form, and converted to Particle
+    // only when they go out.
+    using rtree_type = PeriodicRTree<ParticleID, CompactParticle, ParticleAABBGetter>;
     using box_type                = typename rtree_type::box_type;
     using value_type              = typename rtree_type::value_type;
     using key_to_value_map_type   = typename rtree_type::key_to_value_map_type;
-    using particle_container_type = typename rtree_type::container_type;
+    using compact_container_type  = typename rtree_type::container_type;
+    using particle_container_type = ParticleSpace::particle_container_type;
     using iterator                = typename rtree_type::iterator;
     using const_iterator          = typename rtree_type::const_iterator;
 
     static_assert(std::is_same<value_type,
-            std::pair<ParticleID, Particle>>::value, "");
-    static_assert(std::is_same<particle_container_type,
-            ParticleSpace::particle_container_type>::value, "");
+            std::pair<ParticleID, CompactParticle>>::value, "");
 
     // species support
     using particle_id_set             = std::set<ParticleID>;
@@ -81,14 +83,14 @@ public:
         return rtree_.edge_lengths();
     }
 
-    const particle_container_type& particles() const override
+    const ParticleSpeciesTable& species_table() const noexcept
     {
-        return rtree_.list_objects();
+        return species_table_;
     }
 
     // ParticleSpace has the default list_species implementation.
-    // But it uses particles() member method that cannot be implemented with
-    // PeriodicRTree. So it overwrites the default implementation.
+    // But it builds the list of all particles. So it overwrites the default
+    // implementation with particle_pool_.
     std::vector<Species> list_species() const override;
 
     std::pair<ParticleID, Particle> get_particle(const ParticleID& pid) const override
@@ -98,26 +100,27 @@ public:
             throw_exception<NotFound>("ParticleSpaceRTreeImpl::get_particle: "
                     "No such particle (", pid, ").");
         }
-        return rtree_.get(pid);
+        return this->to_particle(rtree_.get(pid));
     }
 
     // returns true if it adds a new particle
-    bool update_particle(const ParticleID& pid, const Particle& newp) override
+    bool update_particle(const ParticleID& pid, const Particle& p) override
     {
+        const auto newp = species_table_.compact(p);
         if(rtree_.has(pid))
         {
             const auto& oldp = rtree_.get(pid).second;
-            if(oldp.species() != newp.species())
+            if(oldp.species_index() != newp.species_index())
             {
-                particle_pool_[oldp.species_serial()].erase (pid);
-                particle_pool_[newp.species_serial()].insert(pid);
+                particle_pool_[species_table_.species(oldp.species_index()).serial()].erase(pid);
+                particle_pool_[p.species_serial()].insert(pid);
             }
             // if species does not change, then we don't need to do anything.
         }
         else
         {
             // if `newp` is completely new, we need to insert it to the pool.
-            particle_pool_[newp.species_serial()].insert(pid);
+            particle_pool_[p.species_serial()].insert(pid);
         }
         const auto retval = rtree_.update(pid, newp);
         assert(rtree_.diagnosis());
@@ -136,7 +139,7 @@ public:
                     " No such particle (", pid, ").");
         }
         const auto& p = rtree_.get(pid).second;
-        particle_pool_[p.species_serial()].erase(pid);
+        particle_pool_[species_table_.species(p.species_index()).serial()].erase(pid);
         rtree_.erase(pid, p);
         return;
     }
@@ -153,7 +156,13 @@ public:
     std::vector<std::pair<ParticleID, Particle> >
     list_particles() const override
     {
-        return rtree_.list_objects();
+        std::vector<std::pair<ParticleID, Particle>> retval;
+        retval.reserve(rtree_.size());
+        for(const auto& pidp : rtree_.list_objects())
+        {
+            retval.push_back(this->to_particle(pidp));
+        }
+        return retval;
     }
     std::vector<std::pair<ParticleID, Particle> >
     list_particles(const Species& sp) const override;
@@ -189,6 +198,11 @@ public:
     list_particles_within_radius(const Real3& pos, const Real& radius,
             const ParticleID& ignore1, const ParticleID& ignore2) const override;
 
+    bool visit_particles_within_radius(const Real3& pos, const Real& radius,
+            particle_visitor& visitor,
+            const ParticleID& ignore1 = ParticleID(),
+            const ParticleID& ignore2 = ParticleID()) const override;
+
     bool diagnosis() const
     {
         bool is_ok = true;
@@ -216,6 +230,14 @@ public:
 
 protected:
 
+    std::pair<ParticleID, Particle> to_particle(const value_type& pidp) const
+    {
+        return std::make_pair(pidp.first, species_table_.particle(pidp.second));
+    }
+
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real>>
+    to_sorted_particles(const std::vector<std::pair<value_type, Real>>& found) const;
+
     template<typename Query, typename OutputIterator>
     void query_impl(Query&& q, OutputIterator out) const
     {
@@ -289,6 +311,64 @@ protected:
         }
     };
 
+    struct IgnoreFilter
+    {
+        ParticleID ignore1, ignore2;
+
+        bool operator()(const value_type& pidp) const noexcept
+        {
+            return pidp.first == ignore1 || pidp.first == ignore2;
+        }
+    };
+
+    // Calls the visitor for each particle inside the sphere instead of
+    // returning it. It never matches anything, so no output is generated.
+    // Once the visitor returns false, the remaining nodes are skipped.
+    struct VisitorQuery : public IntersectionQuery<IgnoreFilter>
+    {
+        typedef IntersectionQuery<IgnoreFilter> base_type;
+
+        const ParticleSpeciesTable* table;
+        particle_visitor* visitor;
+        bool* stopped;
+
+        VisitorQuery(const Real3& c, const Real r, const IgnoreFilter& f,
+                     const ParticleSpeciesTable* t, particle_visitor* v,
+                     bool* s) noexcept
+            : base_type(c, r, f), table(t), visitor(v), stopped(s)
+        {}
+
+        boost::optional<bool>
+        operator()(const value_type& pidp, const PeriodicBoundary& pbc) const
+        {
+            if(*stopped || this->ignores(pidp)){return boost::none;}
+
+            const auto rhs = pbc.periodic_transpose(pidp.second.position(),
+                                                    this->center);
+            const auto dist = length(this->center - rhs) - pidp.second.radius();
+            if(dist <= this->radius && !(*visitor)(
+                    ParticleView(pidp.first, pidp.second, *table), dist))
+            {
+                *stopped = true;
+            }
+            return boost::none;
+        }
+
+        bool operator()(const AABB& box, const PeriodicBoundary& pbc) const noexcept
+        {
+            return !*stopped && base_type::operator()(box, pbc);
+        }
+    };
+
+    // An output iterator discarding everything.
+    struct null_output_iterator
+    {
+        null_output_iterator& operator*() noexcept {return *this;}
+        null_output_iterator& operator++() noexcept {return *this;}
+        template<typename T>
+        null_output_iterator& operator=(const T&) noexcept {return *this;}
+    };
+
     template<typename Filter>
     static IntersectionQuery<Filter> make_intersection_query(
             const Real3& c, const Real r, Filter&& f)
@@ -300,6 +380,7 @@ protected:
 
     rtree_type                  rtree_;
     per_species_particle_id_set particle_pool_;
+    ParticleSpeciesTable        species_table_;
 };
 
 }; // ecell4
@@ -0,0 +1,543 @@
+#include <algorithm>
+
+#include "ParticleSpaceSoAImpl.hpp"
+#include "Context.hpp"
+#include "comparators.hpp"
+
+
+namespace ecell4
+{
+
+const ParticleSpaceSoAImpl::index_type ParticleSpaceSoAImpl::npos
+    = std::numeric_limits<ParticleSpaceSoAImpl::index_type>::max();
+
+ParticleSpaceSoAImpl::ParticleSpaceSoAImpl(
+    const Real3& edge_lengths, const Integer3& matrix_sizes, const Real verlet_skin)
+    : base_type(), edge_lengths_(edge_lengths), matrix_sizes_(matrix_sizes),
+    num_moves_(0), skin_(verlet_skin), is_verlet_valid_(false),
+    max_displacement_(0.0)
+{
+    if (matrix_sizes_.col <= 0 || matrix_sizes_.row <= 0 || matrix_sizes_.layer <= 0)
+    {
+        throw IllegalArgument("The matrix sizes must be positive.");
+    }
+
+    heads_.assign(matrix_sizes_.col * matrix_sizes_.row * matrix_sizes_.layer, npos);
+
+    // Order cells along the Z-order curve by interleaving bits of the indices.
+    std::vector<std::pair<unsigned long long, index_type> > codes;
+    codes.reserve(heads_.size());
+    for (Integer i(0); i < matrix_sizes_.col; ++i)
+    {
+        for (Integer j(0); j < matrix_sizes_.row; ++j)
+        {
+            for (Integer k(0); k < matrix_sizes_.layer; ++k)
+            {
+                unsigned long long code(0);
+                for (unsigned int bit(0); bit < 21; ++bit)
+                {
+                    code |= (static_cast<unsigned long long>((i >> bit) & 1) << (3 * bit))
+                        | (static_cast<unsigned long long>((j >> bit) & 1) << (3 * bit + 1))
+                        | (static_cast<unsigned long long>((k >> bit) & 1) << (3 * bit + 2));
+                }
+                codes.push_back(std::make_pair(
+                    code, (i * matrix_sizes_.row + j) * matrix_sizes_.layer + k));
+            }
+        }
+    }
+    std::sort(codes.begin(), codes.end());
+    cell_order_.reserve(codes.size());
+    for (std::vector<std::pair<unsigned long long, index_type> >::const_iterator
+        i(codes.begin()); i != codes.end(); ++i)
+    {
+        cell_order_.push_back((*i).second);
+    }
+
+    reset(edge_lengths);
+}
+
+void ParticleSpaceSoAImpl::reset(const Real3& edge_lengths)
+{
+    base_type::t_ = 0.0;
+
+    for (Real3::size_type dim(0); dim < 3; ++dim)
+    {
+        if (edge_lengths[dim] <= 0)
+        {
+            throw std::invalid_argument("the edge length must be positive.");
+        }
+    }
+
+    edge_lengths_ = edge_lengths;
+    cell_sizes_ = Real3(
+        edge_lengths_[0] / matrix_sizes_.col,
+        edge_lengths_[1] / matrix_sizes_.row,
+        edge_lengths_[2] / matrix_sizes_.layer);
+
+    pids_.clear();
+    x_.clear();
+    y_.clear();
+    z_.clear();
+    radius_.clear();
+    D_.clear();
+    species_.clear();
+    rmap_.clear();
+    particle_pool_.clear();
+    species_table_.clear();
+    cells_.clear();
+    next_.clear();
+    prev_.clear();
+    std::fill(heads_.begin(), heads_.end(), npos);
+    num_moves_ = 0;
+
+    is_verlet_valid_ = false;
+    verlet_offsets_.clear();
+    verlet_neighbors_.clear();
+    max_displacement_ = 0.0;
+}
+
+void ParticleSpaceSoAImpl::link(const index_type& i, const index_type& c)
+{
+    cells_[i] = c;
+    prev_[i] = npos;
+    next_[i] = heads_[c];
+    if (heads_[c] != npos)
+    {
+        prev_[heads_[c]] = i;
+    }
+    heads_[c] = i;
+}
+
+void ParticleSpaceSoAImpl::unlink(const index_type& i)
+{
+    if (prev_[i] != npos)
+    {
+        next_[prev_[i]] = next_[i];
+    }
+    else
+    {
+        heads_[cells_[i]] = next_[i];
+    }
+
+    if (next_[i] != npos)
+    {
+        prev_[next_[i]] = prev_[i];
+    }
+}
+
+bool ParticleSpaceSoAImpl::update_particle(const ParticleID& pid, const Particle& p)
+{
+    const species_index_type s(species_table_.intern(p.species(), p.location()));
+    const Real3& pos(p.position());
+    const index_type c(cell_index(pos));
+
+    const key_to_value_map_type::const_iterator it(rmap_.find(pid));
+    if (it != rmap_.end())
+    {
+        const index_type i((*it).second);
+        if (species_[i] != s)
+        {
+            particle_pool_[species_table_.species(species_[i]).serial()].erase(pid);
+            particle_pool_[p.species_serial()].insert(pid);
+        }
+
+        if (radius_[i] != p.radius())
+        {
+            is_verlet_valid_ = false;
+        }
+        else if (is_verlet_valid_)
+        {
+            max_displacement_ = std::max(max_displacement_,
+                distance(pos, Real3(verlet_x_[i], verlet_y_[i], verlet_z_[i])));
+        }
+
+        x_[i] = pos[0];
+        y_[i] = pos[1];
+        z_[i] = pos[2];
+        radius_[i] = p.radius();
+        D_[i] = p.D();
+        species_[i] = s;
+        if (cells_[i] != c)
+        {
+            unlink(i);
+            link(i, c);
+        }
+
+        ++num_moves_;
+        after_move();
+        return false;
+    }
+
+    const index_type i(pids_.size());
+    pids_.push_back(pid);
+    x_.push_back(pos[0]);
+    y_.push_back(pos[1]);
+    z_.push_back(pos[2]);
+    radius_.push_back(p.radius());
+    D_.push_back(p.D());
+    species_.push_back(s);
+    cells_.push_back(c);
+    next_.push_back(npos);
+    prev_.push_back(npos);
+    link(i, c);
+    rmap_[pid] = i;
+    particle_pool_[p.species_serial()].insert(pid);
+    is_verlet_valid_ = false;
+    return true;
+}
+
+void ParticleSpaceSoAImpl::after_move()
+{
+    if (num_moves_ < pids_.size())
+    {
+        return;
+    }
+
+    if (skin_ <= 0)
+    {
+        sort_particles();
+    }
+    else if (!is_verlet_valid_ || 2 * max_displacement_ > skin_)
+    {
+        update_verlet_lists();
+    }
+}
+
+std::pair<ParticleID, Particle> ParticleSpaceSoAImpl::get_particle(
+    const ParticleID& pid) const
+{
+    const key_to_value_map_type::const_iterator it(rmap_.find(pid));
+    if (it == rmap_.end())
+    {
+        throw NotFound("No such particle.");
+    }
+    return to_particle((*it).second);
+}
+
+bool ParticleSpaceSoAImpl::has_particle(const ParticleID& pid) const
+{
+    return (rmap_.find(pid) != rmap_.end());
+}
+
+void ParticleSpaceSoAImpl::remove_particle(const ParticleID& pid)
+{
+    const key_to_value_map_type::const_iterator it(rmap_.find(pid));
+    if (it == rmap_.end())
+    {
+        throw NotFound("No such particle.");
+    }
+
+    const index_type i((*it).second);
+    particle_pool_[species_table_.species(species_[i]).serial()].erase(pid);
+    erase(i);
+}
+
+void ParticleSpaceSoAImpl::erase(const index_type& i)
+{
+    // Move the last particle into the hole.
+    const index_type last(pids_.size() - 1);
+    unlink(i);
+    rmap_.erase(pids_[i]);
+    if (i != last)
+    {
+        const index_type c(cells_[last]);
+        unlink(last);
+        pids_[i] = pids_[last];
+        x_[i] = x_[last];
+        y_[i] = y_[last];
+        z_[i] = z_[last];
+        radius_[i] = radius_[last];
+        D_[i] = D_[last];
+        species_[i] = species_[last];
+        link(i, c);
+        rmap_[pids_[i]] = i;
+    }
+
+    pids_.pop_back();
+    x_.pop_back();
+    y_.pop_back();
+    z_.pop_back();
+    radius_.pop_back();
+    D_.pop_back();
+    species_.pop_back();
+    cells_.pop_back();
+    next_.pop_back();
+    prev_.pop_back();
+
+    is_verlet_valid_ = false;
+}
+
+void ParticleSpaceSoAImpl::sort_particles()
+{
+    const std::size_t n(pids_.size());
+    std::vector<index_type> order;
+    order.reserve(n);
+    for (std::vector<index_type>::const_iterator c(cell_order_.begin());
+        c != cell_order_.end(); ++c)
+    {
+        for (index_type i(heads_[*c]); i != npos; i = next_[i])
+        {
+            order.push_back(i);
+        }
+    }
+
+    {
+        std::vector<ParticleID> pids(n);
+        for (std::size_t k(0); k < n; ++k)
+        {
+            pids[k] = pids_[order[k]];
+        }
+        pids_.swap(pids);
+    }
+
+    std::vector<Real>* arrays[5] = {&x_, &y_, &z_, &radius_, &D_};
+    std::vector<Real> tmp(n);
+    for (std::size_t a(0); a < 5; ++a)
+    {
+        std::vector<Real>& array(*arrays[a]);
+        for (std::size_t k(0); k < n; ++k)
+        {
+            tmp[k] = array[order[k]];
+        }
+        array.swap(tmp);
+    }
+
+    {
+        std::vector<species_index_type> species(n);
+        for (std::size_t k(0); k < n; ++k)
+        {
+            species[k] = species_[order[k]];
+        }
+        species_.swap(species);
+    }
+
+    std::vector<index_type> cells(n);
+    for (std::size_t k(0); k < n; ++k)
+    {
+        cells[k] = cells_[order[k]];
+    }
+
+    // Relink backwards to keep ascending order in each cell.
+    std::fill(heads_.begin(), heads_.end(), npos);
+    for (std::size_t k(n); k > 0; --k)
+    {
+        link(k - 1, cells[k - 1]);
+        rmap_[pids_[k - 1]] = k - 1;
+    }
+
+    num_moves_ = 0;
+    is_verlet_valid_ = false;
+}
+
+void ParticleSpaceSoAImpl::update_verlet_lists()
+{
+    sort_particles();
+    max_displacement_ = 0.0;
+
+    if (skin_ <= 0)
+    {
+        return;
+    }
+
+    // Every neighbour in the cutoff must be found in the neighbouring cells.
+    const Real max_radius(
+        radius_.empty() ? 0.0 : *std::max_element(radius_.begin(), radius_.end()));
+    const Real min_cell_size(
+        std::min(std::min(cell_sizes_[0], cell_sizes_[1]), cell_sizes_[2]));
+    if (2 * max_radius + skin_ > min_cell_size)
+    {
+        return;
+    }
+
+    const std::size_t n(pids_.size());
+    verlet_x_ = x_;
+    verlet_y_ = y_;
+    verlet_z_ = z_;
+    verlet_radius_ = radius_;
+    verlet_offsets_.assign(1, 0);
+    verlet_offsets_.reserve(n + 1);
+    verlet_neighbors_.clear();
+    for (index_type i(0); i < n; ++i)
+    {
+        const Real3 pos(x_[i], y_[i], z_[i]);
+        const Real cutoff(radius_[i] + skin_);
+        visit_cells(pos,
+            [this, &i, &pos, &cutoff](const index_type& j)
+            {
+                if (j != i && distance_to(pos, j) - radius_[j] < cutoff)
+                {
+                    verlet_neighbors_.push_back(j);
+                }
+                return true;
+            });
+        verlet_offsets_.push_back(verlet_neighbors_.size());
+    }
+    is_verlet_valid_ = true;
+}
+
+std::vector<Species> ParticleSpaceSoAImpl::list_species() const
+{
+    std::vector<Species> retval;
+    for (per_species_particle_id_set::const_iterator
+        i(particle_pool_.begin()); i != particle_pool_.end(); ++i)
+    {
+        retval.push_back(Species((*i).first));
+    }
+    return retval;
+}
+
+Integer ParticleSpaceSoAImpl::num_particles(const Species& sp) const
+{
+    Integer retval(0);
+    SpeciesExpressionMatcher sexp(sp);
+    for (per_species_particle_id_set::const_iterator i(particle_pool_.begin());
+        i != particle_pool_.end(); ++i)
+    {
+        const Species tgt((*i).first);
+        if (sexp.match(tgt))
+        {
+            retval += (*i).second.size();
+        }
+    }
+    return retval;
+}
+
+Integer ParticleSpaceSoAImpl::num_particles_exact(const Species& sp) const
+{
+    per_species_particle_id_set::const_iterator i(particle_pool_.find(sp.serial()));
+    if (i == particle_pool_.end())
+    {
+        return 0;
+    }
+    return (*i).second.size();
+}
+
+Integer ParticleSpaceSoAImpl::num_molecules(const Species& sp) const
+{
+    Integer retval(0);
+    SpeciesExpressionMatcher sexp(sp);
+    for (per_species_particle_id_set::const_iterator i(particle_pool_.begin());
+        i != particle_pool_.end(); ++i)
+    {
+        const Species tgt((*i).first);
+        retval += sexp.count(tgt) * (*i).second.size();
+    }
+    return retval;
+}
+
+Integer ParticleSpaceSoAImpl::num_molecules_exact(const Species& sp) const
+{
+    return num_particles_exact(sp);
+}
+
+std::vector<std::pair<ParticleID, Particle> >
+    ParticleSpaceSoAImpl::list_particles() const
+{
+    std::vector<std::pair<ParticleID, Particle> > retval;
+    retval.reserve(pids_.size());
+    for (index_type i(0); i < pids_.size(); ++i)
+    {
+        retval.push_back(to_particle(i));
+    }
+    return retval;
+}
+
+std::vector<std::pair<ParticleID, Particle> >
+    ParticleSpaceSoAImpl::list_particles(const Species& sp) const
+{
+    std::vector<std::pair<ParticleID, Particle> > retval;
+    SpeciesExpressionMatcher sexp(sp);
+
+    std::vector<char> matched(species_table_.size());
+    for (std::size_t idx(0); idx < species_table_.size(); ++idx)
+    {
+        matched[idx] = sexp.match(species_table_.species(idx));
+    }
+
+    for (index_type i(0); i < pids_.size(); ++i)
+    {
+        if (matched[species_[i]])
+        {
+            retval.push_back(to_particle(i));
+        }
+    }
+    return retval;
+}
+
+std::vector<std::pair<ParticleID, Particle> >
+    ParticleSpaceSoAImpl::list_particles_exact(const Species& sp) const
+{
+    std::vector<std::pair<ParticleID, Particle> > retval;
+
+    std::vector<char> matched(species_table_.size());
+    for (std::size_t idx(0); idx < species_table_.size(); ++idx)
+    {
+        matched[idx] = (species_table_.species(idx) == sp);
+    }
+
+    for (index_type i(0); i < pids_.size(); ++i)
+    {
+        if (matched[species_[i]])
+        {
+            retval.push_back(to_particle(i));
+        }
+    }
+    return retval;
+}
+
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    ParticleSpaceSoAImpl::list_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> > retval;
+    query(pos, radius, ignore1, ignore2,
+        [this, &retval](const index_type& i, const Real& dist)
+        {
+            retval.push_back(std::make_pair(to_particle(i), dist));
+            return true;
+        });
+
+    std::sort(retval.begin(), retval.end(),
+        utils::pair_second_element_comparator<std::pair<ParticleID, Particle>, Real>());
+    return retval;
+}
+
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    ParticleSpaceSoAImpl::list_particles_within_radius(
+        const Real3& pos, const Real& radius) const
+{
+    return list_within_radius(pos, radius, ParticleID(), ParticleID());
+}
+
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    ParticleSpaceSoAImpl::list_particles_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore) const
+{
+    return list_within_radius(pos, radius, ignore, ParticleID());
+}
+
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    ParticleSpaceSoAImpl::list_particles_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    return list_within_radius(pos, radius, ignore1, ignore2);
+}
+
+bool ParticleSpaceSoAImpl::visit_particles_within_radius(
+    const Real3& pos, const Real& radius, particle_visitor& visitor,
+    const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    // Visitors are given views of the arrays.
+    return query(pos, radius, ignore1, ignore2,
+        [this, &visitor](const index_type& i, const Real& dist)
+        {
+            return visitor(ParticleView(pids_[i], CompactParticle(
+                species_[i], Real3(x_[i], y_[i], z_[i]), radius_[i], D_[i]),
+                species_table_), dist);
+        });
+}
+
+}; // ecell4
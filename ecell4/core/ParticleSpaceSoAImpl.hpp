@@ -0,0 +1,380 @@
+#ifndef ECELL4_PARTICLE_SPACE_SOA_IMPL_HPP
+#define ECELL4_PARTICLE_SPACE_SOA_IMPL_HPP
+
+#include <set>
+#include <map>
+#include <limits>
+
+#include "ParticleSpace.hpp"
+#include "CompactParticle.hpp"
+
+#ifdef WITH_HDF5
+#include "ParticleSpaceHDF5Writer.hpp"
+#endif
+
+#include "Integer3.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * A cell list storing particles as a structure of arrays.
+ * Coordinates, radii, diffusion coefficients and species indices are kept
+ * in separate contiguous arrays. Each cell is a doubly linked list over
+ * the arrays, and the arrays are periodically re-sorted in the Morton order
+ * of cells, so that particles in the same or neighbouring cells are close
+ * in memory.
+ * Optionally, Verlet lists with a skin distance are built for all particles.
+ * A query around a particle (given as ignore1) is answered from its list
+ * as long as the particles have not moved farther than the skin allows.
+ * The lists are rebuilt once every particle has moved once on average
+ * after they got stale. Inserting or removing particles invalidates them.
+ * As in ParticleSpaceCellListImpl, a query radius plus a particle radius
+ * must not exceed the cell size.
+ */
+class ParticleSpaceSoAImpl
+    : public ParticleSpace
+{
+public:
+
+    typedef ParticleSpace base_type;
+    typedef ParticleSpace::particle_container_type particle_container_type;
+    typedef std::size_t index_type;
+    typedef CompactParticle::species_index_type species_index_type;
+
+    typedef std::unordered_map<ParticleID, index_type> key_to_value_map_type;
+    typedef std::set<ParticleID> particle_id_set;
+    typedef std::map<Species::serial_type, particle_id_set> per_species_particle_id_set;
+
+public:
+
+    ParticleSpaceSoAImpl(
+        const Real3& edge_lengths,
+        const Integer3& matrix_sizes = default_matrix_sizes(),
+        const Real verlet_skin = default_verlet_skin());
+
+    static inline const Integer3 default_matrix_sizes()
+    {
+        return Integer3(3, 3, 3);
+    }
+
+    /**
+     * Verlet lists are disabled when the skin is not positive.
+     */
+    static inline const Real default_verlet_skin()
+    {
+        return 0.0;
+    }
+
+    // Space
+
+    virtual Integer num_species() const
+    {
+        return particle_pool_.size();
+    }
+
+    virtual bool has_species(const Species& sp) const
+    {
+        return (particle_pool_.find(sp.serial()) != particle_pool_.end());
+    }
+
+    virtual std::vector<Species> list_species() const;
+
+    // ParticleSpaceTraits
+
+    const Real3& edge_lengths() const
+    {
+        return edge_lengths_;
+    }
+
+    const Real3& cell_sizes() const
+    {
+        return cell_sizes_;
+    }
+
+    const Integer3 matrix_sizes() const
+    {
+        return matrix_sizes_;
+    }
+
+    const Real verlet_skin() const
+    {
+        return skin_;
+    }
+
+    bool has_verlet_lists() const
+    {
+        return is_verlet_valid_;
+    }
+
+    void reset(const Real3& edge_lengths);
+
+    bool update_particle(const ParticleID& pid, const Particle& p);
+    std::pair<ParticleID, Particle> get_particle(const ParticleID& pid) const;
+    bool has_particle(const ParticleID& pid) const;
+    void remove_particle(const ParticleID& pid);
+
+    Integer num_particles() const
+    {
+        return pids_.size();
+    }
+
+    Integer num_particles(const Species& sp) const;
+    Integer num_particles_exact(const Species& sp) const;
+    Integer num_molecules(const Species& sp) const;
+    Integer num_molecules_exact(const Species& sp) const;
+
+    std::vector<std::pair<ParticleID, Particle> >
+        list_particles() const;
+    std::vector<std::pair<ParticleID, Particle> >
+        list_particles(const Species& sp) const;
+    std::vector<std::pair<ParticleID, Particle> >
+        list_particles_exact(const Species& sp) const;
+
+    virtual void save(const std::string& filename) const
+    {
+        throw NotSupported(
+            "save(const std::string) is not supported by this space class");
+    }
+
+#ifdef WITH_HDF5
+    void save_hdf5(H5::Group* root) const
+    {
+        save_particle_space(*this, root);
+    }
+
+    void load_hdf5(const H5::Group& root)
+    {
+        load_particle_space(root, this);
+    }
+#endif
+
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+        list_particles_within_radius(
+            const Real3& pos, const Real& radius) const;
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+        list_particles_within_radius(
+            const Real3& pos, const Real& radius,
+            const ParticleID& ignore) const;
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+        list_particles_within_radius(
+            const Real3& pos, const Real& radius,
+            const ParticleID& ignore1, const ParticleID& ignore2) const;
+    bool visit_particles_within_radius(
+        const Real3& pos, const Real& radius, particle_visitor& visitor,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const;
+
+    /**
+     * re-sort the arrays in the Morton order of cells.
+     * this invalidates Verlet lists.
+     */
+    void sort_particles();
+
+    /**
+     * re-sort particles and rebuild Verlet lists now.
+     * lists are not built if the skin is not positive or
+     * too large for the cell size.
+     */
+    void update_verlet_lists();
+
+protected:
+
+    static const index_type npos;
+
+    inline index_type cell_index(const Real3& pos) const
+    {
+        // The same as ParticleSpaceCellListImpl::index
+        const index_type i(
+            static_cast<index_type>(pos[0] / cell_sizes_[0]) % matrix_sizes_.col);
+        const index_type j(
+            static_cast<index_type>(pos[1] / cell_sizes_[1]) % matrix_sizes_.row);
+        const index_type k(
+            static_cast<index_type>(pos[2] / cell_sizes_[2]) % matrix_sizes_.layer);
+        return (i * matrix_sizes_.row + j) * matrix_sizes_.layer + k;
+    }
+
+    inline Real distance_to(const Real3& pos, const index_type& i) const
+    {
+        // minimum image
+        Real d[3] = {x_[i] - pos[0], y_[i] - pos[1], z_[i] - pos[2]};
+        for (std::size_t dim(0); dim < 3; ++dim)
+        {
+            const Real half(edge_lengths_[dim] * 0.5);
+            if (d[dim] > half)
+            {
+                d[dim] -= edge_lengths_[dim];
+            }
+            else if (d[dim] < -half)
+            {
+                d[dim] += edge_lengths_[dim];
+            }
+        }
+        return std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+
+    inline std::pair<ParticleID, Particle> to_particle(const index_type& i) const
+    {
+        const species_index_type& s(species_[i]);
+        return std::make_pair(pids_[i], Particle(
+            species_table_.species(s), Real3(x_[i], y_[i], z_[i]),
+            radius_[i], D_[i], species_table_.location(s)));
+    }
+
+    void link(const index_type& i, const index_type& c);
+    void unlink(const index_type& i);
+    void erase(const index_type& i);
+    void after_move();
+
+    /**
+     * call fn(i) for each particle in the cell of pos and its neighbours.
+     */
+    template <typename Tfn_>
+    bool visit_cells(const Real3& pos, Tfn_ fn) const
+    {
+        const Integer sizes[3] = {
+            matrix_sizes_.col, matrix_sizes_.row, matrix_sizes_.layer};
+        Integer candidates[3][3];
+        Integer num_candidates[3];
+        for (std::size_t dim(0); dim < 3; ++dim)
+        {
+            const Integer idx(
+                static_cast<Integer>(pos[dim] / cell_sizes_[dim]) % sizes[dim]);
+            if (sizes[dim] < 3)
+            {
+                num_candidates[dim] = sizes[dim];
+                for (Integer i(0); i < sizes[dim]; ++i)
+                {
+                    candidates[dim][i] = i;
+                }
+            }
+            else
+            {
+                num_candidates[dim] = 3;
+                candidates[dim][0] = (idx + sizes[dim] - 1) % sizes[dim];
+                candidates[dim][1] = idx;
+                candidates[dim][2] = (idx + 1) % sizes[dim];
+            }
+        }
+
+        for (Integer a(0); a < num_candidates[0]; ++a)
+        {
+            for (Integer b(0); b < num_candidates[1]; ++b)
+            {
+                for (Integer c(0); c < num_candidates[2]; ++c)
+                {
+                    const index_type cell(
+                        (candidates[0][a] * sizes[1] + candidates[1][b]) * sizes[2]
+                        + candidates[2][c]);
+                    for (index_type i(heads_[cell]); i != npos; i = next_[i])
+                    {
+                        if (!fn(i))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * call fn(i, dist) for each particle within the radius.
+     */
+    template <typename Tfn_>
+    bool query(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1, const ParticleID& ignore2, Tfn_ fn) const
+    {
+        if (pids_.empty())
+        {
+            return true;
+        }
+
+        if (is_verlet_valid_ && ignore1 != ParticleID())
+        {
+            const key_to_value_map_type::const_iterator it(rmap_.find(ignore1));
+            if (it != rmap_.end())
+            {
+                const index_type& i((*it).second);
+                const Real3 ref(verlet_x_[i], verlet_y_[i], verlet_z_[i]);
+                if (distance(pos, ref) + max_displacement_ + radius
+                    <= verlet_radius_[i] + skin_)
+                {
+                    for (std::size_t k(verlet_offsets_[i]); k < verlet_offsets_[i + 1]; ++k)
+                    {
+                        const index_type& j(verlet_neighbors_[k]);
+                        if (pids_[j] == ignore2)
+                        {
+                            continue;
+                        }
+
+                        const Real dist(distance_to(pos, j) - radius_[j]);
+                        if (dist < radius && !fn(j, dist))
+                        {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+            }
+        }
+
+        return visit_cells(pos,
+            [this, &pos, &radius, &ignore1, &ignore2, &fn](const index_type& j)
+            {
+                if (pids_[j] == ignore1 || pids_[j] == ignore2)
+                {
+                    return true;
+                }
+
+                const Real dist(distance_to(pos, j) - radius_[j]);
+                return (dist >= radius || fn(j, dist));
+            });
+    }
+
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+        list_within_radius(
+            const Real3& pos, const Real& radius,
+            const ParticleID& ignore1, const ParticleID& ignore2) const;
+
+protected:
+
+    Real3 edge_lengths_;
+    Integer3 matrix_sizes_;
+    Real3 cell_sizes_;
+
+    std::vector<ParticleID> pids_;
+    std::vector<Real> x_, y_, z_, radius_, D_;
+    std::vector<species_index_type> species_;
+
+    key_to_value_map_type rmap_;
+    per_species_particle_id_set particle_pool_;
+    ParticleSpeciesTable species_table_;
+
+    /**
+     * cells as doubly linked lists. heads_ and cell_order_ are for each cell.
+     */
+    std::vector<index_type> cells_, next_, prev_;
+    std::vector<index_type> heads_;
+    std::vector<index_type> cell_order_;  // cells in the Morton order
+    std::size_t num_moves_;  // since the last sort
+
+    /**
+     * Verlet lists. neighbours of the i-th particle are
+     * verlet_neighbors_[verlet_offsets_[i], verlet_offsets_[i + 1]),
+     * which were found around the reference position verlet_x_[i], ...
+     */
+    Real skin_;
+    bool is_verlet_valid_;
+    std::vector<std::size_t> verlet_offsets_;
+    std::vector<index_type> verlet_neighbors_;
+    std::vector<Real> verlet_x_, verlet_y_, verlet_z_, verlet_radius_;
+    Real max_displacement_;
+};
+
+}; // ecell4
+
+#endif /* ECELL4_PARTICLE_SPACE_SOA_IMPL_HPP */
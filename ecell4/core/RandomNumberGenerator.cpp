@@ -1,5 +1,7 @@
 #include <gsl/gsl_rng.h>
 #include <sstream>
+#include <cmath>
+#include <limits>
 
 #include "RandomNumberGenerator.hpp"
 
@@ -100,6 +102,11 @@ Integer GSLRandomNumberGenerator::binomial(Real p, Integer n)
     return gsl_ran_binomial(rng_.get(), p, n);
 }
 
+Integer GSLRandomNumberGenerator::poisson(Real mean)
+{
+    return gsl_ran_poisson(rng_.get(), mean);
+}
+
 Real3 GSLRandomNumberGenerator::direction3d(Real length)
 {
     double x, y, z;
@@ -117,4 +124,257 @@ void GSLRandomNumberGenerator::seed()
     gsl_rng_set(rng_.get(), unsigned(std::time(0)));
 }
 
+namespace
+{
+
+unsigned long philox_get(void* state)
+{
+    return static_cast<PhiloxRandomNumberGenerator*>(state)->next();
+}
+
+double philox_get_double(void* state)
+{
+    return philox_get(state) / 4294967296.0;
+}
+
+/**
+ * A gsl_rng_type drawing from a PhiloxRandomNumberGenerator given as the state.
+ */
+const gsl_rng_type philox_rng_type = {
+    "ecell4_philox4x32", 0xffffffffUL, 0, 0, NULL, &philox_get, &philox_get_double};
+
+inline void standard_normal_pair(const Real u1, const Real u2, Real& z0, Real& z1)
+{
+    // Box-Muller. u1 is in (0, 1], and u2 in [0, 1).
+    const Real r(std::sqrt(-2.0 * std::log(u1)));
+    const Real theta(2.0 * M_PI * u2);
+    z0 = r * std::cos(theta);
+    z1 = r * std::sin(theta);
+}
+
+} // anonymous
+
+#ifdef WITH_HDF5
+void PhiloxRandomNumberGenerator::save(H5::H5Location* root) const
+{
+    using namespace H5;
+
+    std::unique_ptr<DataType> optype(new DataType(H5T_OPAQUE, 1));
+    hsize_t bufsize(sizeof(state_type));
+    DataSpace dataspace(1, &bufsize);
+    optype->setTag("PhiloxRandomNumberGenerator state type");
+    std::unique_ptr<DataSet> dataset(
+        new DataSet(root->createDataSet("rng", *optype, dataspace)));
+    dataset->write((const unsigned char*)(&state_), *optype);
+}
+
+void PhiloxRandomNumberGenerator::load(const H5::H5Location& root)
+{
+    using namespace H5;
+
+    const DataSet dataset(DataSet(root.openDataSet("rng")));
+    if (dataset.getStorageSize() != sizeof(state_type))
+    {
+        throw IllegalArgument("The size of the given state is not compatible.");
+    }
+    std::unique_ptr<DataType> optype(new DataType(H5T_OPAQUE, 1));
+    optype->setTag("PhiloxRandomNumberGenerator state type");
+    dataset.read((unsigned char*)(&state_), *optype);
+}
+
+void PhiloxRandomNumberGenerator::save(const std::string& filename) const
+{
+    std::unique_ptr<H5::H5File>
+        fout(new H5::H5File(filename.c_str(), H5F_ACC_TRUNC));
+    this->save(fout.get());
+    extras::save_version_information(fout.get(), std::string("ecell4-philox_rng-") + std::string(VERSION_INFO));
+}
+
+void PhiloxRandomNumberGenerator::load(const std::string& filename)
+{
+    std::unique_ptr<H5::H5File>
+        fin(new H5::H5File(filename.c_str(), H5F_ACC_RDONLY));
+    this->load(*fin);
+}
+#endif
+
+void PhiloxRandomNumberGenerator::philox(word_type ctr[4], const word_type key[2])
+{
+    const uint64_t M0(0xD2511F53), M1(0xCD9E8D57);
+    const word_type W0(0x9E3779B9), W1(0xBB67AE85);
+
+    word_type k0(key[0]), k1(key[1]);
+    for (unsigned int round(0); round < 10; ++round)
+    {
+        const uint64_t p0(M0 * ctr[0]), p1(M1 * ctr[2]);
+        const word_type hi0(static_cast<word_type>(p0 >> 32)), lo0(static_cast<word_type>(p0));
+        const word_type hi1(static_cast<word_type>(p1 >> 32)), lo1(static_cast<word_type>(p1));
+        ctr[0] = hi1 ^ ctr[1] ^ k0;
+        ctr[1] = lo1;
+        ctr[2] = hi0 ^ ctr[3] ^ k1;
+        ctr[3] = lo0;
+        k0 += W0;
+        k1 += W1;
+    }
+}
+
+void PhiloxRandomNumberGenerator::generate()
+{
+    for (unsigned int i(0); i < 4; ++i)
+    {
+        state_.buffer[i] = state_.counter[i];
+    }
+    philox(state_.buffer, state_.key);
+    state_.index = 0;
+
+    // Increment the lower 64 bits of the counter.
+    if (++state_.counter[0] == 0)
+    {
+        ++state_.counter[1];
+    }
+}
+
+void PhiloxRandomNumberGenerator::set_stream(const Integer stream_id)
+{
+    const uint64_t val(static_cast<uint64_t>(stream_id));
+    state_.counter[0] = 0;
+    state_.counter[1] = 0;
+    state_.counter[2] = static_cast<word_type>(val);
+    state_.counter[3] = static_cast<word_type>(val >> 32);
+    state_.index = 4;
+    state_.has_spare = 0;
+    state_.spare = 0.0;
+}
+
+Real PhiloxRandomNumberGenerator::random()
+{
+    return next_real();
+}
+
+Real PhiloxRandomNumberGenerator::uniform(Real min, Real max)
+{
+    return next_real() * (max - min) + min;
+}
+
+Integer PhiloxRandomNumberGenerator::uniform_int(Integer min, Integer max)
+{
+    if (max < min)
+    {
+        throw std::invalid_argument(
+            "the max value must be larger than the min value.");
+    }
+
+    // Rejection sampling to avoid the modulo bias.
+    const uint64_t n(static_cast<uint64_t>(max) - static_cast<uint64_t>(min) + 1);
+    uint64_t x;
+    if (n != 0 && n <= 0x100000000ULL)
+    {
+        const uint64_t limit(0x100000000ULL - 0x100000000ULL % n);
+        do
+        {
+            x = next();
+        } while (x >= limit);
+    }
+    else
+    {
+        const uint64_t umax(std::numeric_limits<uint64_t>::max());
+        const uint64_t limit(n == 0 ? umax : umax - (umax % n + 1) % n);
+        do
+        {
+            x = (static_cast<uint64_t>(next()) << 32) | next();
+        } while (x > limit);
+    }
+    return static_cast<Integer>(static_cast<uint64_t>(min) + (n == 0 ? x : x % n));
+}
+
+Real PhiloxRandomNumberGenerator::gaussian(Real sigma, Real mean)
+{
+    if (state_.has_spare)
+    {
+        state_.has_spare = 0;
+        return state_.spare * sigma + mean;
+    }
+
+    Real z0, z1;
+    const Real u1(1.0 - next_real());
+    standard_normal_pair(u1, next_real(), z0, z1);
+    state_.spare = z1;
+    state_.has_spare = 1;
+    return z0 * sigma + mean;
+}
+
+Integer PhiloxRandomNumberGenerator::binomial(Real p, Integer n)
+{
+    gsl_rng rng = {&philox_rng_type, this};
+    return gsl_ran_binomial(&rng, p, n);
+}
+
+Integer PhiloxRandomNumberGenerator::poisson(Real mean)
+{
+    gsl_rng rng = {&philox_rng_type, this};
+    return gsl_ran_poisson(&rng, mean);
+}
+
+Real3 PhiloxRandomNumberGenerator::direction3d(Real length)
+{
+    // Marsaglia (1972), the same as gsl_ran_dir_3d
+    Real x, y, s;
+    do
+    {
+        x = 2.0 * next_real() - 1.0;
+        y = 2.0 * next_real() - 1.0;
+        s = x * x + y * y;
+    } while (s > 1.0);
+
+    const Real a(2.0 * std::sqrt(1.0 - s));
+    return Real3(x * a * length, y * a * length, (2.0 * s - 1.0) * length);
+}
+
+void PhiloxRandomNumberGenerator::seed(Integer val)
+{
+    const uint64_t key(static_cast<uint64_t>(val));
+    state_.key[0] = static_cast<word_type>(key);
+    state_.key[1] = static_cast<word_type>(key >> 32);
+    set_stream(0);
+}
+
+void PhiloxRandomNumberGenerator::seed()
+{
+    seed(static_cast<Integer>(std::time(0)));
+}
+
+void PhiloxRandomNumberGenerator::fill_uniform(
+    Real* first, const std::size_t n, Real min, Real max)
+{
+    const Real width(max - min);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        first[i] = next_real() * width + min;
+    }
+}
+
+void PhiloxRandomNumberGenerator::fill_gaussian(
+    Real* first, const std::size_t n, Real sigma, Real mean)
+{
+    // This gives the same sequence as calling gaussian n times.
+    std::size_t i(0);
+    if (n > 0 && state_.has_spare)
+    {
+        state_.has_spare = 0;
+        first[i++] = state_.spare * sigma + mean;
+    }
+    for (; i + 1 < n; i += 2)
+    {
+        Real z0, z1;
+        const Real u1(1.0 - next_real());
+        standard_normal_pair(u1, next_real(), z0, z1);
+        first[i] = z0 * sigma + mean;
+        first[i + 1] = z1 * sigma + mean;
+    }
+    if (i < n)
+    {
+        first[i] = gaussian(sigma, mean);
+    }
+}
+
 } // ecell4
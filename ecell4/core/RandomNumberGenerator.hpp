@@ -4,6 +4,7 @@
 #include <ctime>
 #include <vector>
 #include <memory>
+#include <stdint.h>
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 
@@ -33,11 +34,32 @@ public:
     virtual Integer uniform_int(Integer min, Integer max) = 0;
     virtual Real gaussian(Real sigma, Real mean = 0.0) = 0;
     virtual Integer binomial(Real p, Integer n) = 0;
+    virtual Integer poisson(Real mean) = 0;
     virtual Real3 direction3d(Real length = 1.0) = 0;
 
     virtual void seed(Integer val) = 0;
     virtual void seed() = 0;
 
+    /**
+     * fill an array with n uniform or gaussian random numbers in one call.
+     * Implementations may override these to avoid a virtual call per number.
+     */
+    virtual void fill_uniform(Real* first, const std::size_t n, Real min = 0.0, Real max = 1.0)
+    {
+        for (std::size_t i(0); i < n; ++i)
+        {
+            first[i] = uniform(min, max);
+        }
+    }
+
+    virtual void fill_gaussian(Real* first, const std::size_t n, Real sigma, Real mean = 0.0)
+    {
+        for (std::size_t i(0); i < n; ++i)
+        {
+            first[i] = gaussian(sigma, mean);
+        }
+    }
+
 #ifdef WITH_HDF5
     virtual void save(H5::H5Location* root) const = 0;
     virtual void load(const H5::H5Location& root) = 0;
@@ -86,6 +108,7 @@ public:
     Integer uniform_int(Integer min, Integer max);
     Real gaussian(Real sigma, Real mean = 0.0);
     Integer binomial(Real p, Integer n);
+    Integer poisson(Real mean);
     Real3 direction3d(Real length);
     void seed(Integer val);
     void seed();
@@ -132,6 +155,122 @@ protected:
     rng_handle rng_;
 };
 
+/**
+ * A counter-based generator, Philox4x32-10 (Salmon et al., SC'11).
+ * The n-th block of four 32-bit words in a stream is a bijection of
+ * the counter (n, stream) under the key (seed), and nothing else.
+ * Thus the whole state is a few words, and independent streams are
+ * derived just by giving a different stream id with split().
+ * Non-uniform distributions without a closed form (binomial and poisson)
+ * are drawn by GSL through a thin gsl_rng adaptor.
+ */
+class PhiloxRandomNumberGenerator
+    : public RandomNumberGenerator
+{
+public:
+
+    typedef uint32_t word_type;
+
+    struct state_type
+    {
+        word_type key[2];
+        word_type counter[4];  // the next block (lower 64 bits) and the stream id
+        word_type buffer[4];
+        word_type index;  // the next word in the buffer
+        word_type has_spare;
+        Real spare;  // the second gaussian of a Box-Muller pair
+    };
+
+public:
+
+    Real random();
+    Real uniform(Real min, Real max);
+    Integer uniform_int(Integer min, Integer max);
+    Real gaussian(Real sigma, Real mean = 0.0);
+    Integer binomial(Real p, Integer n);
+    Integer poisson(Real mean);
+    Real3 direction3d(Real length);
+    void seed(Integer val);
+    void seed();
+
+    void fill_uniform(Real* first, const std::size_t n, Real min = 0.0, Real max = 1.0);
+    void fill_gaussian(Real* first, const std::size_t n, Real sigma, Real mean = 0.0);
+
+#ifdef WITH_HDF5
+    void save(H5::H5Location* root) const;
+    void load(const H5::H5Location& root);
+    void save(const std::string& filename) const;
+    void load(const std::string& filename);
+#endif
+
+    PhiloxRandomNumberGenerator(const Integer myseed = 0, const Integer stream_id = 0)
+    {
+        seed(myseed);
+        set_stream(stream_id);
+    }
+
+    PhiloxRandomNumberGenerator(const std::string& filename)
+    {
+        seed(0);
+        load(filename);
+    }
+
+    /**
+     * return a generator with the same seed and the given stream id,
+     * starting from the beginning of the stream. Generators with
+     * different stream ids never overlap (up to 2^64 blocks each).
+     */
+    PhiloxRandomNumberGenerator split(const Integer stream_id) const
+    {
+        PhiloxRandomNumberGenerator ret(*this);
+        ret.set_stream(stream_id);
+        return ret;
+    }
+
+    Integer stream() const
+    {
+        return static_cast<Integer>(
+            (static_cast<uint64_t>(state_.counter[3]) << 32) | state_.counter[2]);
+    }
+
+    const state_type& state() const
+    {
+        return state_;
+    }
+
+    /**
+     * the bare Philox4x32-10 bijection.
+     */
+    static void philox(word_type ctr[4], const word_type key[2]);
+
+    inline word_type next()
+    {
+        if (state_.index == 4)
+        {
+            generate();
+        }
+        return state_.buffer[state_.index++];
+    }
+
+protected:
+
+    void set_stream(const Integer stream_id);
+    void generate();
+
+    /**
+     * return a uniform random number in [0, 1) with 53 random bits.
+     */
+    inline Real next_real()
+    {
+        const word_type a(next() >> 5), b(next() >> 6);
+        return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+    }
+
+protected:
+
+    state_type state_;
+};
+
 } // ecell4
 
 #endif /* ECELL4_RANDOM_NUMBER_GENERATOR_HPP */
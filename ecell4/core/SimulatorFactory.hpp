@@ -43,7 +43,7 @@ public:
 
     world_type* world(const std::string& filename) const
     {
-        return new world_type(filename);
+        return load_world(filename);
     }
 
     world_type* world(const std::shared_ptr<Model>& m) const
@@ -76,6 +76,15 @@ protected:
         return new world_type(edge_lengths);
     }
 
+    /**
+     * load a world from a file. Override this to keep the configuration of
+     * the factory, e.g. the type of the space, which is not saved in the file.
+     */
+    virtual world_type* load_world(const std::string& filename) const
+    {
+        return new world_type(filename);
+    }
+
     virtual simulator_type* create_simulator(
         const std::shared_ptr<world_type>& w, const std::shared_ptr<Model>& m) const
     {
@@ -53,7 +53,7 @@ Species::Species(
     set_attribute("dimension", dimension);
 }
 
-const Species::serial_type Species::serial() const
+const Species::serial_type& Species::serial() const
 {
     return serial_;
 }
@@ -48,7 +48,7 @@ public:
     Species(const serial_type& name, const Quantity<Real>& radius, const Quantity<Real>& D,
             const std::string location = "", const Integer& dimension = 0);
 
-    const serial_type serial() const;
+    const serial_type& serial() const;
 
     void add_unit(const UnitSpecies& usp);
     const std::vector<UnitSpecies> units() const;
@@ -0,0 +1,137 @@
+#include "ThreadPool.hpp"
+#include "exceptions.hpp"
+
+
+namespace ecell4
+{
+
+ThreadPool::ThreadPool(const Integer num_threads)
+    : num_threads_(num_threads), task_(NULL), generation_(0), pending_(0), stopped_(false)
+{
+    if (num_threads_ <= 0)
+    {
+        throw IllegalArgument("The number of threads must be positive.");
+    }
+
+    errors_.resize(num_threads_);
+    try
+    {
+        for (std::size_t rank(1); rank < static_cast<std::size_t>(num_threads_); ++rank)
+        {
+            threads_.push_back(std::thread(&ThreadPool::run_worker, this, rank));
+        }
+    }
+    catch (...)
+    {
+        stop();
+        throw;
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    ready_.notify_all();
+    for (std::vector<std::thread>::iterator i(threads_.begin()); i != threads_.end(); ++i)
+    {
+        (*i).join();
+    }
+}
+
+void ThreadPool::run(const task_type& task)
+{
+    if (threads_.empty())
+    {
+        task(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        pending_ = threads_.size();
+        ++generation_;
+    }
+    ready_.notify_all();
+
+    try
+    {
+        task(0);
+    }
+    catch (...)
+    {
+        errors_[0] = std::current_exception();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (pending_ > 0)
+        {
+            finished_.wait(lock);
+        }
+        task_ = NULL;
+    }
+
+    std::exception_ptr error;
+    for (std::vector<std::exception_ptr>::iterator i(errors_.begin()); i != errors_.end(); ++i)
+    {
+        if (*i && !error)
+        {
+            error = *i;
+        }
+        *i = std::exception_ptr();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::run_worker(const std::size_t rank)
+{
+    std::size_t generation(0);
+    while (true)
+    {
+        const task_type* task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stopped_ && generation_ == generation)
+            {
+                ready_.wait(lock);
+            }
+            if (stopped_)
+            {
+                return;
+            }
+            generation = generation_;
+            task = task_;
+        }
+
+        try
+        {
+            (*task)(rank);
+        }
+        catch (...)
+        {
+            errors_[rank] = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0)
+            {
+                finished_.notify_one();
+            }
+        }
+    }
+}
+
+} // ecell4
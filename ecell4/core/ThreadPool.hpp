@@ -0,0 +1,66 @@
+#ifndef ECELL4_THREAD_POOL_HPP
+#define ECELL4_THREAD_POOL_HPP
+
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+
+#include "types.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * A fixed set of worker threads kept alive between parallel regions,
+ * so that a simulator doesn't spawn threads at every step.
+ * run(f) calls f(rank) for every rank in [0, num_threads()) concurrently,
+ * where the calling thread works as the rank 0, and returns when all finish.
+ * The first exception thrown by any rank is rethrown after all finish.
+ * run must not be called concurrently, nor from inside a task.
+ */
+class ThreadPool
+{
+public:
+
+    typedef std::function<void (const std::size_t)> task_type;
+
+public:
+
+    ThreadPool(const Integer num_threads);
+    ~ThreadPool();
+
+    Integer num_threads() const
+    {
+        return num_threads_;
+    }
+
+    void run(const task_type& task);
+
+private:
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void run_worker(const std::size_t rank);
+    void stop();
+
+private:
+
+    Integer num_threads_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable ready_, finished_;
+    const task_type* task_;
+    std::size_t generation_, pending_;
+    bool stopped_;
+    std::vector<std::exception_ptr> errors_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_THREAD_POOL_HPP */
@@ -259,6 +259,16 @@ public:
     virtual std::shared_ptr<VoxelPool>
     get_voxel_pool_at(const coordinate_type &coord) const = 0;
 
+    /**
+     * the same as get_voxel_pool_at, but return a pointer owned by the space
+     * without touching the reference count. for hot loops.
+     */
+    virtual const VoxelPool *
+    get_voxel_pool_ptr_at(const coordinate_type &coord) const
+    {
+        return get_voxel_pool_at(coord).get();
+    }
+
     /*
      * Coordinate Transformation
      */
@@ -273,6 +283,43 @@ public:
     virtual coordinate_type get_neighbor(const coordinate_type &coord,
                                          const Integer &nrand) const = 0;
 
+    /**
+     * get all neighbors of a voxel.
+     * @param coord a coordinate
+     * @param neighbors a vector to store neighbors, which is overwritten
+     */
+    virtual void get_all_neighbors(const coordinate_type &coord,
+                                   std::vector<coordinate_type> &neighbors) const
+    {
+        const Integer num(num_neighbors(coord));
+        neighbors.resize(num);
+        for (Integer nrand(0); nrand < num; ++nrand)
+        {
+            neighbors[nrand] = get_neighbor(coord, nrand);
+        }
+    }
+
+    /**
+     * draw a neighbor for each voxel uniformly at random at once.
+     * this is the same as calling get_neighbor with
+     * rng.uniform_int(0, num_neighbors(coord) - 1) for each in order.
+     * @param coords coordinates of voxels inside
+     * @param rng a random number generator
+     * @param neighbors a vector to store neighbors, which is overwritten
+     */
+    virtual void
+    get_neighbors_randomly(const std::vector<coordinate_type> &coords,
+                           RandomNumberGenerator &rng,
+                           std::vector<coordinate_type> &neighbors) const
+    {
+        neighbors.resize(coords.size());
+        for (std::size_t i(0); i < coords.size(); ++i)
+        {
+            neighbors[i] = get_neighbor(
+                coords[i], rng.uniform_int(0, num_neighbors(coords[i]) - 1));
+        }
+    }
+
     /*
      * Voxel Manipulation
      */
@@ -289,6 +336,14 @@ public:
     virtual bool move(const coordinate_type &src, const coordinate_type &dest,
                       const std::size_t candidate = 0) = 0;
 
+    /**
+     * whether move can be called from multiple threads at once as long as
+     * each thread works on voxels apart from the others. this requires
+     * that move touches nothing but the two voxels and their pools, and
+     * that the exact candidate is given for a molecule.
+     */
+    virtual bool allows_concurrent_moves() const { return false; }
+
     virtual Integer size() const = 0;
     virtual Integer3 shape() const = 0;
     virtual Integer actual_size() const = 0;
@@ -0,0 +1,87 @@
+#define BOOST_TEST_MODULE "EnsembleStatistics_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/tools/floating_point_comparison.hpp>
+
+#include <ecell4/core/EnsembleStatistics.hpp>
+
+using namespace ecell4;
+
+static EnsembleStatistics::data_container_type trajectory(const Real a, const Real b)
+{
+    EnsembleStatistics::data_container_type data(2);
+    data[0].push_back(0.0);
+    data[0].push_back(10.0);
+    data[0].push_back(0.0);
+    data[1].push_back(1.0);
+    data[1].push_back(a);
+    data[1].push_back(b);
+    return data;
+}
+
+BOOST_AUTO_TEST_CASE(EnsembleStatistics_test_statistics)
+{
+    std::vector<Species> targets;
+    targets.push_back(Species("A"));
+    targets.push_back(Species("B"));
+
+    EnsembleStatistics stats(targets);
+    BOOST_CHECK_EQUAL(stats.num_samples(), 0);
+
+    const Real values[] = {3.0, 7.0, 5.0, 5.0, 10.0};
+    for (std::size_t i(0); i < 5; ++i)
+    {
+        stats.add(trajectory(values[i], 10.0 - values[i]));
+    }
+    BOOST_CHECK_EQUAL(stats.num_samples(), 5);
+    BOOST_CHECK_EQUAL(stats.times().size(), 2);
+    BOOST_CHECK_EQUAL(stats.histogram(1, 0).size(), 4);
+    BOOST_CHECK_EQUAL(stats.histogram(1, 0).at(5.0), 2);
+
+    const EnsembleStatistics::data_container_type mean(stats.mean());
+    BOOST_CHECK_EQUAL(mean[0][0], 0.0);
+    BOOST_CHECK_EQUAL(mean[0][1], 10.0);
+    BOOST_CHECK_EQUAL(mean[1][0], 1.0);
+    BOOST_CHECK_CLOSE(mean[1][1], 6.0, 1e-12);
+    BOOST_CHECK_CLOSE(mean[1][2], 4.0, 1e-12);
+
+    const EnsembleStatistics::data_container_type variance(stats.variance());
+    BOOST_CHECK_EQUAL(variance[0][1], 0.0);
+    BOOST_CHECK_CLOSE(variance[1][1], (9.0 + 1.0 + 1.0 + 1.0 + 16.0) / 4.0, 1e-12);
+    BOOST_CHECK_CLOSE(variance[1][2], variance[1][1], 1e-12);
+
+    BOOST_CHECK_EQUAL(stats.quantile(0.0)[1][1], 3.0);
+    BOOST_CHECK_EQUAL(stats.quantile(0.5)[1][1], 5.0);
+    BOOST_CHECK_EQUAL(stats.quantile(0.8)[1][1], 7.0);
+    BOOST_CHECK_EQUAL(stats.quantile(1.0)[1][1], 10.0);
+    BOOST_CHECK_EQUAL(stats.quantile(0.5)[1][2], 5.0);
+}
+
+BOOST_AUTO_TEST_CASE(EnsembleStatistics_test_merge)
+{
+    std::vector<Species> targets;
+    targets.push_back(Species("A"));
+    targets.push_back(Species("B"));
+
+    EnsembleStatistics all(targets), first(targets), second(targets);
+    for (std::size_t i(0); i < 10; ++i)
+    {
+        const Real a(static_cast<Real>((i * 7) % 5));
+        all.add(trajectory(a, i));
+        (i % 3 == 0 ? first : second).add(trajectory(a, i));
+    }
+    second.merge(first);
+
+    BOOST_CHECK_EQUAL(second.num_samples(), all.num_samples());
+    BOOST_CHECK(second.mean() == all.mean());
+    BOOST_CHECK(second.variance() == all.variance());
+    BOOST_CHECK(second.quantile(0.25) == all.quantile(0.25));
+
+    BOOST_CHECK_THROW(all.add(EnsembleStatistics::data_container_type(1)), IllegalArgument);
+}
@@ -0,0 +1,185 @@
+#define BOOST_TEST_MODULE "LatticeSpaceCompactImpl_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#include <boost/test/unit_test.hpp>
+#else
+#define BOOST_TEST_NO_LIB
+#include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <ecell4/core/LatticeSpaceCompactImpl.hpp>
+#include <ecell4/core/LatticeSpaceVectorImpl.hpp>
+#include <ecell4/core/RandomNumberGenerator.hpp>
+#include <ecell4/core/SerialIDGenerator.hpp>
+
+using namespace ecell4;
+
+struct Fixture
+{
+    const Real3 edge_lengths;
+    const Real voxel_radius;
+    LatticeSpaceCompactImpl space;
+    LatticeSpaceVectorImpl target;
+    SerialIDGenerator<ParticleID> sidgen;
+    const Species sp1, sp2, structure;
+
+    Fixture()
+        : edge_lengths(2.5e-8, 2.5e-8, 2.5e-8), voxel_radius(2.5e-9),
+          space(edge_lengths, voxel_radius, true),
+          target(edge_lengths, voxel_radius, true), sidgen(),
+          sp1("A", 2.5e-9, 1e-12), sp2("B", 2.5e-9, 1e-12, "M"),
+          structure("M", 2.5e-9, 0)
+    {
+        space.make_structure_type(structure, "");
+        space.make_molecular_type(sp1, "");
+        space.make_molecular_type(sp2, "M");
+        target.make_structure_type(structure, "");
+        target.make_molecular_type(sp1, "");
+        target.make_molecular_type(sp2, "M");
+    }
+
+    void check_equal() const
+    {
+        BOOST_CHECK_EQUAL(space.size(), target.size());
+        for (VoxelSpaceBase::coordinate_type coord(0); coord < space.size();
+             ++coord)
+        {
+            BOOST_CHECK_EQUAL(space.get_voxel_pool_at(coord)->species(),
+                              target.get_voxel_pool_at(coord)->species());
+            BOOST_CHECK_EQUAL(space.get_voxel_pool_ptr_at(coord),
+                              space.get_voxel_pool_at(coord).get());
+        }
+
+        BOOST_CHECK_EQUAL(space.num_voxels(), target.num_voxels());
+        BOOST_CHECK_EQUAL(space.num_voxels_exact(sp1),
+                          target.num_voxels_exact(sp1));
+        BOOST_CHECK_EQUAL(space.num_voxels_exact(sp2),
+                          target.num_voxels_exact(sp2));
+        BOOST_CHECK_EQUAL(space.num_voxels_exact(structure),
+                          target.num_voxels_exact(structure));
+        BOOST_CHECK_EQUAL(space.list_voxels().size(),
+                          target.list_voxels().size());
+        BOOST_CHECK_EQUAL(space.list_voxels_exact(structure).size(),
+                          target.list_voxels_exact(structure).size());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(suite, Fixture)
+
+BOOST_AUTO_TEST_CASE(LatticeSpaceCompactImpl_test_constructor)
+{
+    BOOST_CHECK_EQUAL(space.shape(), target.shape());
+    BOOST_CHECK_EQUAL(space.actual_size(), target.actual_size());
+    BOOST_CHECK_EQUAL(space.vacant()->size(), target.vacant()->size());
+    BOOST_CHECK(space.is_periodic());
+    BOOST_CHECK_EQUAL(space.num_pools(), 3); // vacant, Border and Periodic
+    check_equal();
+}
+
+BOOST_AUTO_TEST_CASE(LatticeSpaceCompactImpl_test_add_remove)
+{
+    const VoxelSpaceBase::coordinate_type coord(
+        space.global2coordinate(Integer3(3, 4, 5)));
+    const ParticleID pid(sidgen());
+    BOOST_CHECK(space.update_voxel(pid, sp1, coord));
+    BOOST_CHECK(!space.get_voxel_pool_ptr_at(coord)->is_vacant());
+    BOOST_CHECK_EQUAL(space.get_voxel_at(coord).pid, pid);
+    BOOST_CHECK_EQUAL(space.num_voxels(sp1), 1);
+
+    // sp2 can be placed only on the structure
+    BOOST_CHECK(!space.add_voxel(sp2, sidgen(), coord + 1));
+
+    BOOST_CHECK(space.remove_voxel(coord));
+    BOOST_CHECK(space.get_voxel_pool_ptr_at(coord)->is_vacant());
+    BOOST_CHECK_EQUAL(space.num_voxels(sp1), 0);
+    BOOST_CHECK(!space.remove_voxel(coord));
+
+    BOOST_CHECK(space.update_voxel(pid, sp1, coord));
+    BOOST_CHECK(space.remove_voxel(pid));
+    BOOST_CHECK(!space.has_voxel(pid));
+}
+
+BOOST_AUTO_TEST_CASE(LatticeSpaceCompactImpl_test_random_walk)
+{
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+
+    // the structure on a layer
+    const Integer l(space.layer_size() / 2);
+    for (Integer c(0); c < space.col_size(); ++c)
+    {
+        for (Integer r(0); r < space.row_size(); ++r)
+        {
+            const VoxelSpaceBase::coordinate_type coord(
+                space.global2coordinate(Integer3(c, r, l)));
+            BOOST_CHECK(space.update_voxel(ParticleID(), structure, coord));
+            BOOST_CHECK(target.update_voxel(ParticleID(), structure, coord));
+        }
+    }
+
+    for (Integer i(0); i < 100; ++i)
+    {
+        const Integer3 global(rng->uniform_int(0, space.col_size() - 1),
+                              rng->uniform_int(0, space.row_size() - 1),
+                              (i % 2 == 0 ? l : rng->uniform_int(0, l - 1)));
+        const VoxelSpaceBase::coordinate_type coord(
+            space.global2coordinate(global));
+        const Species &sp(i % 2 == 0 ? sp2 : sp1);
+        const ParticleID pid(sidgen());
+        BOOST_CHECK_EQUAL(space.add_voxel(sp, pid, coord),
+                          target.add_voxel(sp, pid, coord));
+    }
+    check_equal();
+
+    for (Integer i(0); i < 5000; ++i)
+    {
+        const VoxelSpaceBase::coordinate_type src(
+            rng->uniform_int(0, space.size() - 1));
+        if (!space.is_inside(src))
+        {
+            continue;
+        }
+
+        std::vector<VoxelSpaceBase::coordinate_type> neighbors1, neighbors2;
+        space.get_all_neighbors(src, neighbors1);
+        target.get_all_neighbors(src, neighbors2);
+        BOOST_CHECK(neighbors1 == neighbors2);
+
+        const Integer nrand(rng->uniform_int(0, 11));
+        const VoxelSpaceBase::coordinate_type dest(
+            space.get_neighbor(src, nrand));
+        BOOST_CHECK_EQUAL(dest, target.get_neighbor(src, nrand));
+        BOOST_CHECK_EQUAL(space.can_move(src, dest),
+                          target.can_move(src, dest));
+        BOOST_CHECK_EQUAL(space.move(src, dest), target.move(src, dest));
+    }
+    check_equal();
+    BOOST_CHECK_EQUAL(space.num_pools(), 6);
+}
+
+#ifdef WITH_HDF5
+BOOST_AUTO_TEST_CASE(LatticeSpaceCompactImpl_test_save_and_load)
+{
+    const VoxelSpaceBase::coordinate_type coord(
+        space.global2coordinate(Integer3(3, 4, 5)));
+    BOOST_CHECK(space.update_voxel(sidgen(), sp1, coord));
+
+    H5::H5File fout("data_compact.h5", H5F_ACC_TRUNC);
+    std::unique_ptr<H5::Group> group(
+        new H5::Group(fout.createGroup("VoxelSpaceBase")));
+    space.save_hdf5(group.get());
+    fout.close();
+
+    LatticeSpaceCompactImpl space2(Real3(3e-8, 3e-8, 3e-8), voxel_radius);
+    H5::H5File fin("data_compact.h5", H5F_ACC_RDONLY);
+    const H5::Group groupin(fin.openGroup("VoxelSpaceBase"));
+    space2.load_hdf5(groupin);
+    fin.close();
+
+    BOOST_CHECK_EQUAL(space.edge_lengths(), space2.edge_lengths());
+    BOOST_CHECK_EQUAL(space.num_voxels(), space2.num_voxels());
+    BOOST_CHECK_EQUAL(space2.num_voxels_exact(sp1), 1);
+    BOOST_CHECK_EQUAL(space2.get_voxel_pool_at(coord)->species(), sp1);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
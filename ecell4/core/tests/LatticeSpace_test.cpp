@@ -11,6 +11,7 @@
 
 #include <ecell4/core/LatticeSpaceVectorImpl.hpp>
 #include <ecell4/core/MoleculePool.hpp>
+#include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/SerialIDGenerator.hpp>
 #include <ecell4/core/VacantType.hpp>
 
@@ -477,6 +478,39 @@ BOOST_AUTO_TEST_CASE(LatticeSpace_test_periodic_layer)
         }
 }
 
+BOOST_AUTO_TEST_CASE(LatticeSpace_test_bulk_neighbors)
+{
+    std::vector<VoxelSpaceBase::coordinate_type> coords, neighbors;
+    for (VoxelSpaceBase::coordinate_type coord(0); coord < space.size();
+         ++coord)
+    {
+        if (!space.is_inside(coord))
+        {
+            continue;
+        }
+
+        coords.push_back(coord);
+        space.get_all_neighbors(coord, neighbors);
+        BOOST_CHECK_EQUAL(neighbors.size(), 12);
+        for (Integer i(0); i < 12; ++i)
+        {
+            BOOST_CHECK_EQUAL(neighbors[i], space.get_neighbor(coord, i));
+        }
+    }
+
+    GSLRandomNumberGenerator rng1, rng2;
+    rng1.seed(0);
+    rng2.seed(0);
+    space.get_neighbors_randomly(coords, rng1, neighbors);
+    BOOST_CHECK_EQUAL(neighbors.size(), coords.size());
+    for (std::size_t i(0); i < coords.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(neighbors[i],
+                          space.get_neighbor(coords[i], rng2.uniform_int(0, 11)));
+        BOOST_CHECK(space.is_inside(neighbors[i]));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(LatticeSpace_test_coordinates2)
 {
     const Integer3 g1(4, 4, 4);
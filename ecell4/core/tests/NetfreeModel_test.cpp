@@ -144,6 +144,73 @@ BOOST_AUTO_TEST_CASE(NetfreeModel_test_query_reaction_rules2)
     BOOST_CHECK_EQUAL(model.query_reaction_rules(sp2, sp1).size(), 1);
 }
 
+BOOST_AUTO_TEST_CASE(NetfreeModel_test_query_cache)
+{
+    Species sp1("A"), sp2("B"), sp3("C");
+
+    ReactionRule rr1, rr2;
+    rr1.add_reactant(sp1);
+    rr1.add_reactant(sp2);
+    rr1.add_product(sp3);
+
+    rr2.add_reactant(sp3);
+    rr2.add_product(sp1);
+    rr2.add_product(sp2);
+
+    NetfreeModel model;
+    model.add_reaction_rule(rr1);
+    BOOST_CHECK_EQUAL(model.query_cache_capacity(),
+                      NetfreeModel::default_query_cache_capacity());
+
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp3).size(), 0);
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp1, sp2).size(), 1);
+    BOOST_CHECK_EQUAL(model.query_cache_misses(), 2);
+    BOOST_CHECK_EQUAL(model.query_cache_hits(), 0);
+
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp3).size(), 0);
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp1, sp2).size(), 1);
+    BOOST_CHECK((*(model.query_reaction_rules(sp1, sp2).begin())) == rr1);
+    BOOST_CHECK_EQUAL(model.query_cache_misses(), 2);
+    BOOST_CHECK_EQUAL(model.query_cache_hits(), 3);
+
+    // the order of reactants matters
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp2, sp1).size(), 1);
+    BOOST_CHECK_EQUAL(model.query_cache_misses(), 3);
+
+    // adding a rule invalidates the cache
+    model.add_reaction_rule(rr2);
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp3).size(), 1);
+    BOOST_CHECK_EQUAL(model.query_cache_misses(), 4);
+
+    model.remove_reaction_rule(rr2);
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp3).size(), 0);
+    BOOST_CHECK_EQUAL(model.query_cache_misses(), 5);
+
+    // a copy starts with an empty cache
+    const NetfreeModel copied(model);
+    BOOST_CHECK_EQUAL(copied.query_cache_hits(), 0);
+    BOOST_CHECK_EQUAL(copied.query_reaction_rules(sp1, sp2).size(), 1);
+    BOOST_CHECK_EQUAL(copied.query_cache_misses(), 1);
+
+    model.set_query_cache_capacity(0);
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp3).size(), 0);
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp3).size(), 0);
+    BOOST_CHECK_EQUAL(model.query_cache_misses(), 7);
+
+    // keys are serials, and the cache is cleared when it gets full
+    NetfreeModel bounded;
+    bounded.add_reaction_rule(rr1);
+    bounded.set_query_cache_capacity(2);
+    bounded.query_reaction_rules(sp1, sp2);
+    BOOST_CHECK_EQUAL(bounded.query_reaction_rules(Species("A"), Species("B")).size(), 1);
+    BOOST_CHECK_EQUAL(bounded.query_cache_hits(), 1);
+    bounded.query_reaction_rules(sp2, sp1);
+    bounded.query_reaction_rules(sp2, sp3);
+    BOOST_CHECK_EQUAL(bounded.query_reaction_rules(sp1, sp2).size(), 1);
+    BOOST_CHECK_EQUAL(bounded.query_cache_misses(), 4);
+    BOOST_CHECK_EQUAL(bounded.query_cache_hits(), 1);
+}
+
 BOOST_AUTO_TEST_CASE(NetfreeModel_generation1)
 {
     NetfreeModel nfm;
@@ -328,3 +395,50 @@ BOOST_AUTO_TEST_CASE(NetfreeModel_test_proceed)
         BOOST_CHECK(model.apply_species_attributes(Species("B")).has_attribute("hoge"));
     }
 }
+
+BOOST_AUTO_TEST_CASE(NetfreeModel_generation_in_parallel)
+{
+    NetfreeModel m1;
+    m1.add_reaction_rule(
+        create_binding_reaction_rule(
+            Species("A(r)"), Species("A(l)"), Species("A(r^1).A(l^1)"), 1.0));
+    m1.add_reaction_rule(
+        create_unbinding_reaction_rule(
+            Species("A(r^1).A(l^1)"), Species("A(r)"), Species("A(l)"), 1.0));
+    m1.add_reaction_rule(
+        create_unimolecular_reaction_rule(Species("A(s=u)"), Species("A(s=p)"), 1.0));
+
+    std::vector<Species> seeds(1, Species("A(l,r,s=u)"));
+    std::map<Species, Integer> max_stoich;
+    max_stoich[Species("A")] = 3;
+
+    std::vector<extras::network_generation_statistics> stats;
+    const std::pair<std::shared_ptr<NetworkModel>, bool> retval1(
+        extras::generate_network_from_netfree_model(m1, seeds, 100, max_stoich, 1));
+    const std::pair<std::shared_ptr<NetworkModel>, bool> retval2(
+        extras::generate_network_from_netfree_model(
+            m1, seeds, 100, max_stoich, 4,
+            [&stats](const extras::network_generation_statistics& s) { stats.push_back(s); }));
+    BOOST_CHECK(retval1.second);
+    BOOST_CHECK(retval2.second);
+
+    // the same network in the same order
+    BOOST_CHECK(retval1.first->species_attributes() == retval2.first->species_attributes());
+    BOOST_CHECK(retval1.first->reaction_rules() == retval2.first->reaction_rules());
+
+    BOOST_CHECK(stats.size() > 0);
+    Integer num_species(0);
+    for (std::vector<extras::network_generation_statistics>::const_iterator
+        i(stats.begin()); i != stats.end(); ++i)
+    {
+        BOOST_CHECK_EQUAL((*i).iteration, std::distance(stats.cbegin(), i));
+        BOOST_CHECK((*i).num_trials >= (*i).num_seeds);
+        num_species = (*i).num_species;
+    }
+    BOOST_CHECK_EQUAL(stats.back().num_new_species, 0);
+    BOOST_CHECK_EQUAL(num_species, retval2.first->species_attributes().size());
+
+    BOOST_CHECK_THROW(
+        extras::generate_network_from_netfree_model(m1, seeds, 100, max_stoich, 0),
+        IllegalArgument);
+}
@@ -0,0 +1,97 @@
+#define BOOST_TEST_MODULE "PartialSumTree_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/tools/floating_point_comparison.hpp>
+
+#include <ecell4/core/PartialSumTree.hpp>
+
+using namespace ecell4;
+
+BOOST_AUTO_TEST_CASE(PartialSumTree_test_constructor)
+{
+    PartialSumTree tree(5);
+    BOOST_CHECK_EQUAL(tree.size(), 5);
+    BOOST_CHECK_EQUAL(tree.total(), 0.0);
+    BOOST_CHECK_EQUAL(tree.num_infinities(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(PartialSumTree_test_set)
+{
+    PartialSumTree tree(5);
+    tree.set(0, 1.0);
+    tree.set(2, 2.0);
+    tree.set(4, 3.0);
+    BOOST_CHECK_EQUAL(tree.get(2), 2.0);
+    BOOST_CHECK_CLOSE(tree.total(), 6.0, 1e-12);
+
+    tree.set(2, 0.5);
+    BOOST_CHECK_CLOSE(tree.total(), 4.5, 1e-12);
+
+    BOOST_CHECK_THROW(tree.set(5, 1.0), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(PartialSumTree_test_find)
+{
+    PartialSumTree tree(5);
+    tree.set(0, 1.0);
+    tree.set(2, 2.0);
+    tree.set(4, 3.0);
+
+    // the same as a linear search for the first cumulative sum >= value
+    BOOST_CHECK_EQUAL(tree.find(0.0), 0);
+    BOOST_CHECK_EQUAL(tree.find(0.5), 0);
+    BOOST_CHECK_EQUAL(tree.find(1.0), 0);
+    BOOST_CHECK_EQUAL(tree.find(1.5), 2);
+    BOOST_CHECK_EQUAL(tree.find(3.0), 2);
+    BOOST_CHECK_EQUAL(tree.find(3.5), 4);
+    BOOST_CHECK_EQUAL(tree.find(6.0), 4);
+
+    // never select a leaf without weight
+    BOOST_CHECK_EQUAL(tree.find(7.0), 4);
+    tree.set(0, 0.0);
+    BOOST_CHECK_EQUAL(tree.find(0.0), 2);
+}
+
+BOOST_AUTO_TEST_CASE(PartialSumTree_test_infinity)
+{
+    const Real inf(std::numeric_limits<Real>::infinity());
+
+    PartialSumTree tree(6);
+    tree.set(0, 1.0);
+    tree.set(1, inf);
+    tree.set(3, 2.0);
+    tree.set(4, inf);
+    BOOST_CHECK_EQUAL(tree.total(), inf);
+    BOOST_CHECK_EQUAL(tree.num_infinities(), 2);
+    BOOST_CHECK_EQUAL(tree.find(0), 1);
+    BOOST_CHECK_EQUAL(tree.find(1), 4);
+
+    tree.set(1, 3.0);
+    tree.set(4, 4.0);
+    BOOST_CHECK_EQUAL(tree.num_infinities(), 0);
+    BOOST_CHECK_CLOSE(tree.total(), 10.0, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(PartialSumTree_test_push_back)
+{
+    PartialSumTree tree;
+    for (std::size_t i(0); i < 10; ++i)
+    {
+        tree.push_back(static_cast<Real>(i));
+        BOOST_CHECK_EQUAL(tree.size(), i + 1);
+        BOOST_CHECK_CLOSE(tree.total(), 0.5 * i * (i + 1), 1e-12);
+    }
+    BOOST_CHECK_EQUAL(tree.get(7), 7.0);
+    BOOST_CHECK_EQUAL(tree.find(0.0), 1);
+    BOOST_CHECK_EQUAL(tree.find(44.5), 9);
+
+    tree.push_back(std::numeric_limits<Real>::infinity());
+    BOOST_CHECK_EQUAL(tree.num_infinities(), 1);
+    BOOST_CHECK_EQUAL(tree.find(0), 10);
+}
@@ -10,7 +10,11 @@
 #include <boost/test/tools/floating_point_comparison.hpp>
 
 #include <ecell4/core/ParticleSpaceCellListImpl.hpp>
+#include <ecell4/core/ParticleSpaceRTreeImpl.hpp>
+#include <ecell4/core/ParticleSpaceSoAImpl.hpp>
 #include <ecell4/core/SerialIDGenerator.hpp>
+#include <ecell4/core/RandomNumberGenerator.hpp>
+#include <ecell4/core/comparators.hpp>
 
 using namespace ecell4;
 
@@ -140,6 +144,247 @@ BOOST_AUTO_TEST_CASE(ParticleSpace_test_list_particles_within_radius)
     }
 }
 
+void check_visit_particles_within_radius(ParticleSpace& space)
+{
+    typedef std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+        neighbor_container_type;
+
+    SerialIDGenerator<ParticleID> pidgen;
+    PhiloxRandomNumberGenerator rng(1);
+    const Species sp("A");
+    std::vector<ParticleID> pids;
+    for (unsigned int i(0); i < 200; ++i)
+    {
+        const Real3 pos(rng.uniform(0, 1), rng.uniform(0, 1), rng.uniform(0, 1));
+        pids.push_back(pidgen());
+        space.update_particle(pids.back(), Particle(sp, pos, 0.01, 0));
+    }
+
+    for (unsigned int i(0); i < 20; ++i)
+    {
+        const Real3 pos(rng.uniform(0, 1), rng.uniform(0, 1), rng.uniform(0, 1));
+        const Real radius(0.15);
+        const ParticleID& ignore1(pids[i]);
+        const ParticleID& ignore2(pids[i + 1]);
+
+        const neighbor_container_type expected[3] = {
+            space.list_particles_within_radius(pos, radius),
+            space.list_particles_within_radius(pos, radius, ignore1),
+            space.list_particles_within_radius(pos, radius, ignore1, ignore2)};
+        neighbor_container_type found[3];
+        for (unsigned int j(0); j < 3; ++j)
+        {
+            neighbor_container_type& retval(found[j]);
+            const std::function<bool(const ParticleView&, const Real&)>
+                fn([&retval, &sp](const ParticleView& view, const Real& dist)
+                    {
+                        const Particle p(view.particle());
+                        BOOST_CHECK_EQUAL(view.species(), sp);
+                        BOOST_CHECK_EQUAL(p.species(), sp);
+                        BOOST_CHECK_EQUAL(view.position(), p.position());
+                        BOOST_CHECK_EQUAL(view.radius(), p.radius());
+                        retval.push_back(std::make_pair(std::make_pair(view.pid(), p), dist));
+                        return true;
+                    });
+            const bool completed(j == 0
+                ? space.for_each_particle_within_radius(pos, radius, fn)
+                : (j == 1
+                    ? space.for_each_particle_within_radius(pos, radius, ignore1, fn)
+                    : space.for_each_particle_within_radius(pos, radius, ignore1, ignore2, fn)));
+            BOOST_CHECK(completed);
+            std::sort(retval.begin(), retval.end(),
+                utils::pair_second_element_comparator<std::pair<ParticleID, Particle>, Real>());
+
+            BOOST_CHECK_EQUAL(retval.size(), expected[j].size());
+            for (unsigned int k(0); k < std::min(retval.size(), expected[j].size()); ++k)
+            {
+                BOOST_CHECK_EQUAL(retval[k].first.first, expected[j][k].first.first);
+                BOOST_CHECK_CLOSE(retval[k].second, expected[j][k].second, 1e-6);
+            }
+        }
+
+        BOOST_CHECK_EQUAL(space.has_overlap(pos, radius), !expected[0].empty());
+        BOOST_CHECK_EQUAL(space.has_overlap(pos, radius, ignore1), !expected[1].empty());
+        BOOST_CHECK_EQUAL(
+            space.has_overlap(pos, radius, ignore1, ignore2), !expected[2].empty());
+
+        if (expected[0].size() > 1)
+        {
+            unsigned int num_visited(0);
+            BOOST_CHECK(!space.for_each_particle_within_radius(pos, radius,
+                [&num_visited](const ParticleView&, const Real&)
+                {
+                    return ++num_visited < 2;
+                }));
+            BOOST_CHECK_EQUAL(num_visited, 2);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ParticleSpace_test_visit_particles_within_radius)
+{
+    ParticleSpaceCellListImpl space1(edge_lengths, matrix_sizes);
+    check_visit_particles_within_radius(space1);
+    ParticleSpaceVectorImpl space2(edge_lengths);
+    check_visit_particles_within_radius(space2);
+    ParticleSpaceRTreeImpl space3(edge_lengths);
+    check_visit_particles_within_radius(space3);
+    ParticleSpaceSoAImpl space4(edge_lengths, matrix_sizes);
+    check_visit_particles_within_radius(space4);
+}
+
+BOOST_AUTO_TEST_CASE(ParticleSpace_test_species_table)
+{
+    ParticleSpeciesTable table;
+    const Species sp1("A"), sp2("B");
+    BOOST_CHECK_EQUAL(table.find(sp1), -1);
+    BOOST_CHECK_EQUAL(table.intern(sp1), 0);
+    BOOST_CHECK_EQUAL(table.intern(sp2), 1);
+    BOOST_CHECK_EQUAL(table.intern(sp1, "membrane"), 2);
+    BOOST_CHECK_EQUAL(table.intern(Species("A")), 0);
+    BOOST_CHECK_EQUAL(table.find(sp1, "membrane"), 2);
+    BOOST_CHECK_EQUAL(table.size(), 3);
+
+    const Particle p(sp1, Real3(0.1, 0.2, 0.3), 0.01, 0.5, "membrane");
+    const CompactParticle cp(table.compact(p));
+    BOOST_CHECK_EQUAL(cp.species_index(), 2);
+    BOOST_CHECK_EQUAL(table.particle(cp), p);
+    BOOST_CHECK_EQUAL(table.particle(cp).location(), "membrane");
+    BOOST_CHECK_EQUAL(table.particle(cp).D(), 0.5);
+
+    const ParticleView view(ParticleID(), cp, table);
+    BOOST_CHECK_EQUAL(view.species_index(), 2);
+    BOOST_CHECK_EQUAL(view.species(), sp1);
+    BOOST_CHECK_EQUAL(view.particle(), p);
+    const ParticleView another(ParticleID(), p);
+    BOOST_CHECK_EQUAL(another.species_index(), -1);
+    BOOST_CHECK_EQUAL(another.species(), sp1);
+    BOOST_CHECK_EQUAL(another.particle(), p);
+
+    table.clear();
+    BOOST_CHECK_EQUAL(table.size(), 0);
+    BOOST_CHECK_EQUAL(table.find(sp1), -1);
+}
+
+void check_compact_storage(ParticleSpace& space)
+{
+    SerialIDGenerator<ParticleID> pidgen;
+    const Species sp1("A"), sp2("B");
+    const ParticleID pid1(pidgen()), pid2(pidgen());
+    const Particle p1(sp1, Real3(0.1, 0.2, 0.3), 0.01, 0.5, "membrane");
+    const Particle p2(sp2, Real3(0.4, 0.5, 0.6), 0.02, 0.25);
+
+    BOOST_CHECK(space.update_particle(pid1, p1));
+    BOOST_CHECK(space.update_particle(pid2, p2));
+    BOOST_CHECK_EQUAL(space.get_particle(pid1).second, p1);
+    BOOST_CHECK_EQUAL(space.get_particle(pid1).second.location(), "membrane");
+    BOOST_CHECK_EQUAL(space.get_particle(pid2).second.D(), 0.25);
+    BOOST_CHECK_EQUAL(space.list_particles().size(), 2);
+
+    // Change the species of a particle.
+    BOOST_CHECK(!space.update_particle(pid1, Particle(sp2, p1.position(), 0.01, 0.5)));
+    BOOST_CHECK_EQUAL(space.num_particles_exact(sp1), 0);
+    BOOST_CHECK_EQUAL(space.num_particles_exact(sp2), 2);
+    BOOST_CHECK_EQUAL(space.list_particles_exact(sp2).size(), 2);
+    BOOST_CHECK_EQUAL(space.list_particles(sp1).size(), 0);
+    BOOST_CHECK_EQUAL(space.list_particles().size(), 2);
+    BOOST_CHECK_EQUAL(space.list_particles()[0].second.species(), sp2);
+    BOOST_CHECK_EQUAL(space.list_particles()[1].second.species(), sp2);
+
+    space.remove_particle(pid2);
+    BOOST_CHECK_EQUAL(space.list_particles().size(), 1);
+    BOOST_CHECK_EQUAL(space.list_particles()[0].first, pid1);
+    BOOST_CHECK_EQUAL(space.num_particles_exact(sp2), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ParticleSpace_test_compact_storage)
+{
+    ParticleSpaceCellListImpl space1(edge_lengths, matrix_sizes);
+    check_compact_storage(space1);
+    ParticleSpaceRTreeImpl space2(edge_lengths);
+    check_compact_storage(space2);
+    ParticleSpaceSoAImpl space3(edge_lengths, matrix_sizes);
+    check_compact_storage(space3);
+}
+
+BOOST_AUTO_TEST_CASE(ParticleSpaceSoAImpl_test_verlet_lists)
+{
+    // Compare with the brute force while particles move and get removed.
+    ParticleSpaceSoAImpl space(edge_lengths, matrix_sizes, 0.05);
+    ParticleSpaceVectorImpl reference(edge_lengths);
+    BOOST_CHECK_EQUAL(space.verlet_skin(), 0.05);
+    BOOST_CHECK(!space.has_verlet_lists());
+
+    SerialIDGenerator<ParticleID> pidgen;
+    PhiloxRandomNumberGenerator rng(2);
+    const Species sp("A");
+    std::vector<ParticleID> pids;
+    for (unsigned int i(0); i < 300; ++i)
+    {
+        const Particle p(sp, Real3(rng.uniform(0, 1), rng.uniform(0, 1), rng.uniform(0, 1)), 0.01, 0);
+        pids.push_back(pidgen());
+        space.update_particle(pids.back(), p);
+        reference.update_particle(pids.back(), p);
+    }
+
+    // Lists are built at the end of the first step, when all particles
+    // have moved once. In the 10th step, every particle jumps farther than
+    // a half of the skin, so that queries fall back to cells.
+    for (unsigned int step(0); step < 20; ++step)
+    {
+        const bool jump(step == 10);
+        for (std::vector<ParticleID>::const_iterator i(pids.begin()); i != pids.end(); ++i)
+        {
+            const Particle p(space.get_particle(*i).second);
+            const Real3 displacement(jump
+                ? Real3(0.04, 0.0, 0.0)
+                : Real3(rng.gaussian(0.003), rng.gaussian(0.003), rng.gaussian(0.003)));
+            const Real3 newpos(space.apply_boundary(p.position() + displacement));
+
+            if (step > 0)
+            {
+                BOOST_CHECK(space.has_verlet_lists());
+            }
+
+            const std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+                expected(reference.list_particles_within_radius(newpos, p.radius(), *i));
+            std::vector<ParticleID> found;
+            space.for_each_particle_within_radius(newpos, p.radius(), *i,
+                [&found](const ParticleView& view, const Real& dist)
+                {
+                    found.push_back(view.pid());
+                    return true;
+                });
+            // Vector impl includes the boundary, but it has measure zero.
+            BOOST_CHECK_EQUAL(found.size(), expected.size());
+            BOOST_CHECK_EQUAL(space.has_overlap(newpos, p.radius(), *i), !expected.empty());
+
+            const Particle newp(sp, newpos, p.radius(), 0);
+            space.update_particle(*i, newp);
+            reference.update_particle(*i, newp);
+        }
+        BOOST_CHECK(space.has_verlet_lists());
+    }
+
+    // Removing particles invalidates the lists.
+    for (unsigned int i(0); i < 20; ++i)
+    {
+        space.remove_particle(pids.back());
+        reference.remove_particle(pids.back());
+        pids.pop_back();
+    }
+    BOOST_CHECK(!space.has_verlet_lists());
+    BOOST_CHECK_EQUAL(space.num_particles(), 280);
+    BOOST_CHECK_EQUAL(space.list_particles().size(), 280);
+    for (std::vector<ParticleID>::const_iterator i(pids.begin()); i != pids.end(); ++i)
+    {
+        const Particle p(space.get_particle(*i).second);
+        BOOST_CHECK_EQUAL(p, reference.get_particle(*i).second);
+        BOOST_CHECK_EQUAL(space.has_overlap(p.position(), p.radius(), *i),
+            !reference.list_particles_within_radius(p.position(), p.radius(), *i).empty());
+    }
+}
+
 BOOST_AUTO_TEST_CASE(ParticleSpaceCellListImpl_test_constructor)
 {
     std::unique_ptr<ParticleSpaceCellListImpl> space(new ParticleSpaceCellListImpl(edge_lengths, matrix_sizes));
@@ -0,0 +1,160 @@
+#define BOOST_TEST_MODULE "PhiloxRandomNumberGenerator_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/tools/floating_point_comparison.hpp>
+
+#include <ecell4/core/RandomNumberGenerator.hpp>
+
+using namespace ecell4;
+
+typedef PhiloxRandomNumberGenerator::word_type word_type;
+
+
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_known_answers)
+{
+    // Known answers of Philox4x32-10 from Random123
+    {
+        word_type ctr[4] = {0, 0, 0, 0};
+        const word_type key[2] = {0, 0};
+        PhiloxRandomNumberGenerator::philox(ctr, key);
+        BOOST_CHECK_EQUAL(ctr[0], 0x6627e8d5u);
+        BOOST_CHECK_EQUAL(ctr[1], 0xe169c58du);
+        BOOST_CHECK_EQUAL(ctr[2], 0xbc57ac4cu);
+        BOOST_CHECK_EQUAL(ctr[3], 0x9b00dbd8u);
+    }
+    {
+        word_type ctr[4] = {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff};
+        const word_type key[2] = {0xffffffff, 0xffffffff};
+        PhiloxRandomNumberGenerator::philox(ctr, key);
+        BOOST_CHECK_EQUAL(ctr[0], 0x408f276du);
+        BOOST_CHECK_EQUAL(ctr[1], 0x41c83b0eu);
+        BOOST_CHECK_EQUAL(ctr[2], 0xa20bc7c6u);
+        BOOST_CHECK_EQUAL(ctr[3], 0x6d5451fdu);
+    }
+    {
+        word_type ctr[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+        const word_type key[2] = {0xa4093822, 0x299f31d0};
+        PhiloxRandomNumberGenerator::philox(ctr, key);
+        BOOST_CHECK_EQUAL(ctr[0], 0xd16cfe09u);
+        BOOST_CHECK_EQUAL(ctr[1], 0x94fdccebu);
+        BOOST_CHECK_EQUAL(ctr[2], 0x5001e420u);
+        BOOST_CHECK_EQUAL(ctr[3], 0x24126ea1u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_split)
+{
+    PhiloxRandomNumberGenerator rng(12345);
+    const PhiloxRandomNumberGenerator copy(rng);
+    for (unsigned int i(0); i < 10; ++i)
+    {
+        rng.random();
+    }
+
+    // Splitting doesn't depend on how far the parent has gone.
+    PhiloxRandomNumberGenerator child1(rng.split(3)), child2(copy.split(3));
+    BOOST_CHECK_EQUAL(child1.stream(), 3);
+    for (unsigned int i(0); i < 100; ++i)
+    {
+        BOOST_CHECK_EQUAL(child1.next(), child2.next());
+    }
+
+    PhiloxRandomNumberGenerator other(rng.split(4)), reseeded(54321, 3);
+    unsigned int num_same(0);
+    for (unsigned int i(0); i < 100; ++i)
+    {
+        const word_type x(child1.next());
+        num_same += (x == other.next() ? 1 : 0);
+        num_same += (x == reseeded.next() ? 1 : 0);
+    }
+    BOOST_CHECK_EQUAL(num_same, 0);
+}
+
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_fill)
+{
+    PhiloxRandomNumberGenerator rng1(7), rng2(7);
+    std::vector<Real> values(101);
+
+    rng1.fill_uniform(&values[0], values.size(), -1.0, 3.0);
+    for (std::size_t i(0); i < values.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(values[i], rng2.uniform(-1.0, 3.0));
+        BOOST_CHECK(values[i] >= -1.0 && values[i] < 3.0);
+    }
+
+    // An odd number of gaussians leaves a spare behind.
+    rng1.fill_gaussian(&values[0], values.size(), 2.0, 1.0);
+    for (std::size_t i(0); i < values.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(values[i], rng2.gaussian(2.0, 1.0));
+    }
+    rng1.fill_gaussian(&values[0], values.size(), 2.0);
+    for (std::size_t i(0); i < values.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(values[i], rng2.gaussian(2.0));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_distributions)
+{
+    PhiloxRandomNumberGenerator rng(2024);
+    const std::size_t N(100000);
+
+    std::vector<Real> values(N);
+    rng.fill_gaussian(&values[0], N, 2.0, 1.0);
+    Real sum(0.0), sumsq(0.0);
+    for (std::size_t i(0); i < N; ++i)
+    {
+        sum += values[i];
+        sumsq += values[i] * values[i];
+    }
+    BOOST_CHECK_CLOSE(sum / N, 1.0, 2.0);
+    BOOST_CHECK_CLOSE(sumsq / N - (sum / N) * (sum / N), 4.0, 2.0);
+
+    std::vector<Integer> counts(6, 0);
+    for (std::size_t i(0); i < N; ++i)
+    {
+        const Integer k(rng.uniform_int(-2, 3));
+        BOOST_CHECK(k >= -2 && k <= 3);
+        ++counts[k + 2];
+    }
+    for (std::size_t i(0); i < counts.size(); ++i)
+    {
+        BOOST_CHECK_CLOSE(static_cast<Real>(counts[i]), N / 6.0, 3.0);
+    }
+    BOOST_CHECK_THROW(rng.uniform_int(1, 0), std::invalid_argument);
+
+    Real binomials(0.0), poissons(0.0);
+    for (std::size_t i(0); i < 10000; ++i)
+    {
+        binomials += rng.binomial(0.3, 50);
+        poissons += rng.poisson(4.0);
+    }
+    BOOST_CHECK_CLOSE(binomials / 10000, 15.0, 2.0);
+    BOOST_CHECK_CLOSE(poissons / 10000, 4.0, 2.0);
+
+    const Real3 dir(rng.direction3d(2.0));
+    BOOST_CHECK_CLOSE(length(dir), 2.0, 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_save_load)
+{
+    PhiloxRandomNumberGenerator rng1(99, 5);
+    rng1.random();
+    rng1.gaussian(1.0);  // Keep a spare.
+
+    rng1.save("PhiloxRandomNumberGenerator_test_save_load.h5");
+    PhiloxRandomNumberGenerator rng2("PhiloxRandomNumberGenerator_test_save_load.h5");
+    BOOST_CHECK_EQUAL(rng2.stream(), 5);
+    for (unsigned int i(0); i < 10; ++i)
+    {
+        BOOST_CHECK_EQUAL(rng1.gaussian(1.0), rng2.gaussian(1.0));
+        BOOST_CHECK_EQUAL(rng1.uniform_int(0, 1000), rng2.uniform_int(0, 1000));
+    }
+}
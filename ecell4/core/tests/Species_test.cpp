@@ -158,3 +158,50 @@ BOOST_AUTO_TEST_CASE(Species_test_match3)
     // BOOST_CHECK_EQUAL(
     //     SpeciesExpressionMatcher((Species("_1._2")).count(Species("A.B.C"), globals), 2);
 }
+
+BOOST_AUTO_TEST_CASE(Species_test_canonical_hash)
+{
+    const Species sp1("X(a^1).Y(a^3,b).X(a^2).Y(a^1,b^2).X(a^3)");
+    const Species sp2(format_species(sp1));
+    BOOST_CHECK(sp1 != sp2);
+    BOOST_CHECK_EQUAL(context::canonical_hash(sp1), context::canonical_hash(sp2));
+
+    const Species sp3("X(a^3,b^1).X(a^2,b).X(a,b^3).X(a^1,b^4).X(a^4,b^2)");
+    BOOST_CHECK_EQUAL(context::canonical_hash(sp3),
+                      context::canonical_hash(format_species(sp3)));
+
+    // the same units, but bonded differently
+    BOOST_CHECK(context::canonical_hash(Species("A(b^1).B(a^1,c).C(b)"))
+                != context::canonical_hash(Species("A(b).B(a,c^1).C(b^1)")));
+    // states
+    BOOST_CHECK(context::canonical_hash(Species("A(s=u)"))
+                != context::canonical_hash(Species("A(s=p)")));
+}
+
+BOOST_AUTO_TEST_CASE(Species_test_may_match)
+{
+    using context::compile_species;
+    using context::may_match;
+
+    const context::compiled_species sp(compile_species(Species("A(b^1).B(a^1,c=p)")));
+    BOOST_CHECK(may_match(compile_species(Species("A")), sp));
+    BOOST_CHECK(may_match(compile_species(Species("B(c=u)")), sp));  // states are not compared
+    BOOST_CHECK(may_match(compile_species(Species("_(a)")), sp));
+    BOOST_CHECK(may_match(compile_species(Species("A.B")), sp));
+    BOOST_CHECK(!may_match(compile_species(Species("C")), sp));
+    BOOST_CHECK(!may_match(compile_species(Species("A.A")), sp));
+    BOOST_CHECK(!may_match(compile_species(Species("A.B._")), sp));
+    BOOST_CHECK(!may_match(compile_species(Species("B(d)")), sp));
+
+    // may_match must hold whenever the full matching does
+    const Species patterns[] = {
+        Species("A"), Species("_1._2"), Species("A(b^_)"), Species("B(a,c=_1)"),
+        Species("_(a^1).A(b^1)"), Species("C")};
+    for (const Species& pttrn : patterns)
+    {
+        if (SpeciesExpressionMatcher(pttrn).match(Species("A(b^1).B(a^1,c=p)")))
+        {
+            BOOST_CHECK(may_match(compile_species(pttrn), sp));
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#define BOOST_TEST_MODULE "ThreadPool_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <atomic>
+#include <ecell4/core/ThreadPool.hpp>
+#include <ecell4/core/exceptions.hpp>
+
+using namespace ecell4;
+
+
+BOOST_AUTO_TEST_CASE(ThreadPool_test_run)
+{
+    ThreadPool pool(4);
+    BOOST_CHECK_EQUAL(pool.num_threads(), 4);
+
+    std::vector<Integer> counts(4, 0);
+    for (Integer i(0); i < 100; ++i)
+    {
+        pool.run([&counts](const std::size_t rank) { ++counts[rank]; });
+    }
+    for (std::size_t rank(0); rank < counts.size(); ++rank)
+    {
+        BOOST_CHECK_EQUAL(counts[rank], 100);
+    }
+
+    ThreadPool single(1);
+    std::atomic<Integer> total(0);
+    single.run([&total](const std::size_t rank) { total += rank + 1; });
+    BOOST_CHECK_EQUAL(total, 1);
+
+    BOOST_CHECK_THROW(ThreadPool(0), IllegalArgument);
+}
+
+BOOST_AUTO_TEST_CASE(ThreadPool_test_exception)
+{
+    ThreadPool pool(3);
+    BOOST_CHECK_THROW(
+        pool.run([](const std::size_t rank)
+            {
+                if (rank == 2)
+                {
+                    throw IllegalState("This is a test.");
+                }
+            }),
+        IllegalState);
+
+    // The pool is still available.
+    std::atomic<Integer> total(0);
+    pool.run([&total](const std::size_t rank) { total += rank; });
+    BOOST_CHECK_EQUAL(total, 3);
+}
@@ -207,14 +207,15 @@ protected:
     void _step(time_type dt)
     {
         {
+            const std::vector<particle_id_pair> particles(
+                base_type::world_->list_particles());
             BDPropagator<traits_type> propagator(
                 *base_type::world_,
                 *base_type::network_rules_,
                 base_type::rng(),
                 dt, num_retries_,
                 base_type::rrec_.get(), 0,
-                make_select_first_range(base_type::world_->
-                                        get_particles_range()),
+                make_select_first_range(particles),
                 potentials_);
             while (propagator());
         }
@@ -1128,7 +1128,7 @@ public:
         }
 
         for (particle_id_pair const& pp:
-                       (*base_type::world_).get_particles_range())
+                       (*base_type::world_).list_particles())
         {
             std::shared_ptr<single_type> single(create_single(pp));
             add_event(*single, SINGLE_EVENT_ESCAPE);
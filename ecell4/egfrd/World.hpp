@@ -248,7 +248,6 @@ public:
      * ParticleContainerBase
      */
     typedef MatrixSpace<particle_type, particle_id_type> particle_matrix_type;
-    typedef sized_iterator_range<typename particle_matrix_type::const_iterator> particle_id_pair_range;
     typedef typename particle_matrix_type::matrix_sizes_type matrix_sizes_type;
     typedef ecell4::ParticleSpaceCellListImpl particle_space_type;
     typedef typename base_type::time_type time_type;
@@ -857,12 +856,6 @@ public:
         return (*ps_).list_particles_within_radius(s.position(), s.radius(), ignore1, ignore2);
     }
 
-    particle_id_pair_range get_particles_range() const
-    {
-        const particle_space_type::particle_container_type& particles((*ps_).particles());
-        return particle_id_pair_range(particles.begin(), particles.end(), particles.size());
-    }
-
     /**
      *
      */
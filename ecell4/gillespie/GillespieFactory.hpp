@@ -27,8 +27,8 @@ public:
 
 public:
 
-    GillespieFactory()
-        : base_type(), rng_()
+    GillespieFactory(const GillespieSolverType solver_type = default_solver_type())
+        : base_type(), rng_(), solver_type_(solver_type)
     {
         ; // do nothing
     }
@@ -38,6 +38,11 @@ public:
         ; // do nothing
     }
 
+    static inline const GillespieSolverType default_solver_type()
+    {
+        return DIRECT_METHOD;
+    }
+
     this_type& rng(const std::shared_ptr<RandomNumberGenerator>& rng)
     {
         rng_ = rng;
@@ -63,9 +68,16 @@ protected:
         }
     }
 
+    virtual simulator_type* create_simulator(
+        const std::shared_ptr<world_type>& w, const std::shared_ptr<Model>& m) const
+    {
+        return new simulator_type(w, m, solver_type_);
+    }
+
 protected:
 
     std::shared_ptr<RandomNumberGenerator> rng_;
+    GillespieSolverType solver_type_;
 };
 
 } // gillespie
@@ -15,30 +15,34 @@ namespace ecell4
 namespace gillespie
 {
 
-void GillespieSimulator::increment_molecules(const Species& sp)
+void GillespieSimulator::update_dependent_events(const Species& sp, const Integer val)
 {
-    world_->add_molecules(sp, 1);
-
-    for (boost::ptr_vector<ReactionRuleEvent>::iterator i(events_.begin());
-        i != events_.end(); ++i)
+    const dependency_container_type& deps(dependencies_.get(sp, events_));
+    for (dependency_container_type::const_iterator it(deps.begin());
+        it != deps.end(); ++it)
     {
-        (*i).inc(sp);
+        events_[(*it).first].inc((*it).second, val);
+        if (solver_type_ == LOGARITHMIC_DIRECT_METHOD)
+        {
+            propensities_.set((*it).first, events_[(*it).first].propensity());
+        }
     }
 }
 
-
-void GillespieSimulator::decrement_molecules(const Species& sp)
+void GillespieSimulator::increment_molecules(const Species& sp, const Integer num)
 {
-    world_->remove_molecules(sp, 1);
+    world_->add_molecules(sp, num);
+    update_dependent_events(sp, +num);
+}
 
-    for (boost::ptr_vector<ReactionRuleEvent>::iterator i(events_.begin());
-        i != events_.end(); ++i)
-    {
-        (*i).dec(sp);
-    }
+
+void GillespieSimulator::decrement_molecules(const Species& sp, const Integer num)
+{
+    world_->remove_molecules(sp, num);
+    update_dependent_events(sp, -num);
 }
 
-bool GillespieSimulator::__draw_next_reaction(void)
+bool GillespieSimulator::__draw_event_linearly(Real& dt, std::size_t& idx)
 {
     std::vector<double> a(events_.size());
     for (unsigned int i(0); i < events_.size(); ++i)
@@ -52,13 +56,9 @@ bool GillespieSimulator::__draw_next_reaction(void)
     if (atot == 0.0)
     {
         // no reaction occurs
-        this->dt_ = std::numeric_limits<Real>::infinity();
-        return true;
+        return false;
     }
 
-    double dt = 0.0;
-    unsigned int idx = 0;
-
     if (atot == std::numeric_limits<double>::infinity())
     {
         std::vector<unsigned int> selected;
@@ -91,6 +91,57 @@ bool GillespieSimulator::__draw_next_reaction(void)
             }
         }
     }
+    return true;
+}
+
+bool GillespieSimulator::__draw_event_from_tree(Real& dt, std::size_t& idx)
+{
+    for (std::vector<std::size_t>::const_iterator i(time_dependent_events_.begin());
+        i != time_dependent_events_.end(); ++i)
+    {
+        propensities_.set(*i, events_[*i].propensity());
+    }
+
+    const double atot(propensities_.total());
+
+    if (atot == 0.0)
+    {
+        // no reaction occurs
+        return false;
+    }
+
+    if (atot == std::numeric_limits<double>::infinity())
+    {
+        const std::size_t num_selected(propensities_.num_infinities());
+
+        dt = 0.0;
+        idx = propensities_.find(num_selected == 1 ? 0 : rng()->uniform_int(0, num_selected - 1));
+    }
+    else
+    {
+        const double rnd1(rng()->uniform(0, 1));
+        const double rnd2(rng()->uniform(0, atot));
+
+        dt = gsl_sf_log(1.0 / rnd1) / double(atot);
+        idx = propensities_.find(rnd2);
+    }
+    return true;
+}
+
+bool GillespieSimulator::__draw_next_reaction(void)
+{
+    Real dt(0.0);
+    std::size_t idx(0);
+
+    const bool drawn(solver_type_ == LOGARITHMIC_DIRECT_METHOD
+        ? __draw_event_from_tree(dt, idx) : __draw_event_linearly(dt, idx));
+
+    if (!drawn)
+    {
+        // no reaction occurs
+        this->dt_ = std::numeric_limits<Real>::infinity();
+        return true;
+    }
 
     next_reaction_rule_ = events_[idx].reaction_rule();
     boost::optional<ReactionRule> r = events_[idx].draw();
@@ -140,51 +191,17 @@ void GillespieSimulator::step(void)
     // }
 
     // Reaction[u] occurs.
-    if (!next_reaction_.has_descriptor())
-    {
-        for (ReactionRule::reactant_container_type::const_iterator
-            it(next_reaction_.reactants().begin());
-            it != next_reaction_.reactants().end(); ++it)
-        {
-            decrement_molecules(*it);
-        }
-
-        for (ReactionRule::product_container_type::const_iterator
-            it(next_reaction_.products().begin());
-            it != next_reaction_.products().end(); ++it)
-        {
-            increment_molecules(*it);
-        }
-    }
-    else
+    const stoichiometry_type changes(stoichiometry(next_reaction_));
+    for (stoichiometry_type::const_iterator it(changes.begin());
+        it != changes.end(); ++it)
     {
-        const std::shared_ptr<ReactionRuleDescriptor>& desc = next_reaction_.get_descriptor();
-        assert(desc->is_available());
-
-        const ReactionRule::reactant_container_type& reactants(next_reaction_.reactants());
-        const ReactionRuleDescriptor::coefficient_container_type&
-            reactant_coefficients(desc->reactant_coefficients());
-        assert(reactants.size() == reactant_coefficients.size());
-        for (std::size_t i = 0; i < reactants.size(); ++i)
+        if ((*it).second < 0)
         {
-            assert(reactant_coefficients[i] >= 0);
-            for (std::size_t j = 0; j < (std::size_t)round(reactant_coefficients[i]); ++j)
-            {
-                decrement_molecules(reactants[i]);
-            }
+            decrement_molecules((*it).first, -(*it).second);
         }
-
-        const ReactionRule::product_container_type& products(next_reaction_.products());
-        const ReactionRuleDescriptor::coefficient_container_type&
-            product_coefficients(desc->product_coefficients());
-        assert(products.size() == product_coefficients.size());
-        for (std::size_t i = 0; i < products.size(); ++i)
+        else if ((*it).second > 0)
         {
-            assert(product_coefficients[i] >= 0);
-            for (std::size_t j = 0; j < (std::size_t)round(product_coefficients[i]); ++j)
-            {
-                increment_molecules(products[i]);
-            }
+            increment_molecules((*it).first, (*it).second);
         }
     }
 
@@ -222,64 +239,16 @@ bool GillespieSimulator::step(const Real &upto)
     }
 }
 
-void GillespieSimulator::check_model()
-{
-    // Check if the given model is supported or not.
-    const Model::reaction_rule_container_type&
-        reaction_rules(model_->reaction_rules());
-
-    for (Model::reaction_rule_container_type::const_iterator
-        i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
-    {
-        const ReactionRule& rr(*i);
-
-        if (rr.has_descriptor())
-        {
-            const std::shared_ptr<ReactionRuleDescriptor>& desc = rr.get_descriptor();
-
-            if (!desc->is_available())
-            {
-                throw NotSupported(
-                    "The given reaction rule descriptor is not available.");
-            }
-            else if ((rr.reactants().size() != desc->reactant_coefficients().size())
-                    || (rr.products().size() != desc->product_coefficients().size()))
-            {
-                throw NotSupported(
-                    "Mismatch between the number of stoichiometry coefficients and of reactants.");
-            }
-            else
-            {
-                for (ReactionRuleDescriptor::coefficient_container_type::const_iterator
-                    it(desc->reactant_coefficients().begin()); it != desc->reactant_coefficients().end();
-                    it++)
-                {
-                    if ((*it) < 0)
-                    {
-                        throw NotSupported("A stoichiometric coefficient must be non-negative.");
-                    }
-                    else if (abs((*it) - round(*it)) > 1e-10 * (*it))
-                    {
-                        throw NotSupported("A stoichiometric coefficient must be an integer.");
-                    }
-                }
-            }
-        }
-        else if (rr.reactants().size() > 2)
-        {
-            throw NotSupported("No more than 2 reactants are supported.");
-        }
-    }
-}
-
 void GillespieSimulator::initialize(void)
 {
     const Model::reaction_rule_container_type&
         reaction_rules(model_->reaction_rules());
 
-    check_model();
+    check_reaction_rules(reaction_rules);
 
     events_.clear();
+    time_dependent_events_.clear();
+    dependencies_.clear();
     for (Model::reaction_rule_container_type::const_iterator
         i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
     {
@@ -287,26 +256,37 @@ void GillespieSimulator::initialize(void)
 
         if (rr.has_descriptor())
         {
-            events_.push_back(new DescriptorReactionRuleEvent(this, rr));
-        }
-        else if (rr.reactants().size() == 0)
-        {
-            events_.push_back(new ZerothOrderReactionRuleEvent(this, rr));
-        }
-        else if (rr.reactants().size() == 1)
-        {
-            events_.push_back(new FirstOrderReactionRuleEvent(this, rr));
+            time_dependent_events_.push_back(events_.size());
         }
-        else if (rr.reactants().size() == 2)
+
+        events_.push_back(create_reaction_rule_event(this, rr));
+        events_.back().initialize();
+    }
+
+    const std::vector<Species> species(world_->list_species());
+    for (std::vector<Species>::const_iterator i(species.begin());
+        i != species.end(); ++i)
+    {
+        const Integer num(world_->num_molecules_exact(*i));
+        const dependency_container_type& deps(dependencies_.get(*i, events_));
+        for (dependency_container_type::const_iterator j(deps.begin());
+            j != deps.end(); ++j)
         {
-            events_.push_back(new SecondOrderReactionRuleEvent(this, rr));
+            events_[(*j).first].inc((*j).second, num);
         }
-        else
+    }
+
+    if (solver_type_ == LOGARITHMIC_DIRECT_METHOD)
+    {
+        propensities_.resize(events_.size());
+        for (std::size_t i(0); i < events_.size(); ++i)
         {
-            throw IllegalState("Never get here");
+            propensities_.set(i, events_[i].propensity());
         }
-
-        events_.back().initialize();
+    }
+    else
+    {
+        propensities_.clear();
     }
 
     this->draw_next_reaction();
@@ -0,0 +1,334 @@
+#include "NetfreeSimulator.hpp"
+#include <vector>
+#include <gsl/gsl_sf_log.h>
+
+#include <ecell4/core/Context.hpp>
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+std::size_t NetfreeSimulator::register_complex(const Species& sp)
+{
+    const std::unordered_map<Species, std::size_t>::const_iterator
+        it(complex_indices_.find(sp));
+    if (it != complex_indices_.end())
+    {
+        return (*it).second;
+    }
+
+    const std::size_t idx(complexes_.size());
+    complexes_.push_back(sp);
+    complex_indices_.insert(std::make_pair(sp, idx));
+    dependencies_.push_back(std::vector<std::pair<std::size_t, std::size_t> >());
+
+    for (std::size_t i(0); i < rules_.size(); ++i)
+    {
+        rule_matches_type& matches(rules_[i]);
+        const ReactionRule::reactant_container_type& reactants(matches.rr.reactants());
+
+        std::vector<Integer> coefs(reactants.size());
+        bool found(false);
+        for (std::size_t j(0); j < reactants.size(); ++j)
+        {
+            coefs[j] = model_->apply(reactants[j], sp);
+            found = (found || coefs[j] > 0);
+        }
+
+        if (!found)
+        {
+            continue;
+        }
+
+        dependencies_.back().push_back(std::make_pair(i, matches.participants.size()));
+        matches.participants.push_back(idx);
+        matches.coefficients.push_back(coefs);
+        for (std::size_t j(0); j < reactants.size(); ++j)
+        {
+            matches.weights[j].push_back(0.0);
+        }
+    }
+    return idx;
+}
+
+void NetfreeSimulator::update_complex(const std::size_t idx, const Integer val)
+{
+    const Integer num(world_->num_molecules_exact(complexes_[idx]));
+
+    const std::vector<std::pair<std::size_t, std::size_t> >& deps(dependencies_[idx]);
+    for (std::vector<std::pair<std::size_t, std::size_t> >::const_iterator
+        it(deps.begin()); it != deps.end(); ++it)
+    {
+        rule_matches_type& matches(rules_[(*it).first]);
+        const std::vector<Integer>& coefs(matches.coefficients[(*it).second]);
+        for (std::size_t j(0); j < coefs.size(); ++j)
+        {
+            matches.weights[j].set((*it).second, static_cast<Real>(coefs[j] * num));
+        }
+        if (coefs.size() == 2)
+        {
+            matches.num_self_pairs += coefs[0] * coefs[1] * val;
+        }
+
+        propensities_.set((*it).first, propensity((*it).first));
+    }
+}
+
+Real NetfreeSimulator::propensity(const std::size_t idx) const
+{
+    const rule_matches_type& matches(rules_[idx]);
+    const Real k(matches.rr.k());
+
+    switch (matches.rr.reactants().size())
+    {
+    case 0:
+        return k * world_->volume();
+    case 1:
+        {
+            const Real num(matches.weights[0].total());
+            return (num > 0 ? num * k : 0.0);
+        }
+    case 2:
+        {
+            const Real num(
+                matches.weights[0].total() * matches.weights[1].total()
+                - matches.num_self_pairs);
+            return (num > 0 ? num * k / world_->volume() : 0.0);
+        }
+    default:
+        throw IllegalState("Never get here");
+    }
+}
+
+boost::optional<ReactionRule> NetfreeSimulator::draw_reaction(const std::size_t idx)
+{
+    const rule_matches_type& matches(rules_[idx]);
+
+    ReactionRule::reactant_container_type reactants;
+    Integer num_matches(1);
+    if (matches.rr.reactants().size() == 1)
+    {
+        const std::size_t j(
+            matches.weights[0].find(rng()->uniform(0.0, matches.weights[0].total())));
+        reactants.push_back(complexes_[matches.participants[j]]);
+        num_matches = matches.coefficients[j][0];
+    }
+    else if (matches.rr.reactants().size() == 2)
+    {
+        while (true)
+        {
+            const std::size_t j1(
+                matches.weights[0].find(rng()->uniform(0.0, matches.weights[0].total())));
+            const std::size_t j2(
+                matches.weights[1].find(rng()->uniform(0.0, matches.weights[1].total())));
+            const Species& sp1(complexes_[matches.participants[j1]]);
+            const Species& sp2(complexes_[matches.participants[j2]]);
+
+            // A complex cannot react with itself, but with the other copies.
+            if (j1 == j2 && rng()->uniform_int(1, world_->num_molecules_exact(sp1)) == 1)
+            {
+                continue;
+            }
+
+            reactants.push_back(sp1);
+            reactants.push_back(sp2);
+            num_matches = matches.coefficients[j1][0] * matches.coefficients[j2][1];
+            break;
+        }
+    }
+
+    const std::size_t m(num_matches > 1 ? rng()->uniform_int(0, num_matches - 1) : 0);
+    const boost::optional<ReactionRule> r(generate_reaction_rule(matches.rr, reactants, m));
+    if (!r)
+    {
+        return boost::none;
+    }
+    return format_reaction_rule_with_nosort(r.get());
+}
+
+bool NetfreeSimulator::__draw_next_reaction(void)
+{
+    const Real atot(propensities_.total());
+
+    if (atot == 0.0)
+    {
+        // no reaction occurs
+        this->dt_ = std::numeric_limits<Real>::infinity();
+        return true;
+    }
+
+    std::size_t idx(0);
+    if (atot == std::numeric_limits<Real>::infinity())
+    {
+        const std::size_t num_selected(propensities_.num_infinities());
+        idx = propensities_.find(num_selected == 1 ? 0 : rng()->uniform_int(0, num_selected - 1));
+    }
+    else
+    {
+        const Real rnd1(rng()->uniform(0, 1));
+        const Real rnd2(rng()->uniform(0, atot));
+
+        this->dt_ += gsl_sf_log(1.0 / rnd1) / atot;
+        idx = propensities_.find(rnd2);
+    }
+
+    next_reaction_rule_ = rules_[idx].rr;
+    const boost::optional<ReactionRule> r(draw_reaction(idx));
+    if (!r)
+    {
+        return false;
+    }
+    next_reaction_ = r.get();
+    return true;
+}
+
+void NetfreeSimulator::draw_next_reaction(void)
+{
+    if (rules_.size() == 0)
+    {
+        this->dt_ = std::numeric_limits<Real>::infinity();
+        return;
+    }
+
+    this->dt_ = 0.0;
+
+    while (!__draw_next_reaction())
+    {
+        ; // pass
+    }
+}
+
+void NetfreeSimulator::step(void)
+{
+    last_reactions_.clear();
+
+    if (this->dt_ == std::numeric_limits<Real>::infinity())
+    {
+        // No reaction occurs.
+        return;
+    }
+
+    const Real t0(t()), dt0(dt());
+
+    for (ReactionRule::reactant_container_type::const_iterator
+        it(next_reaction_.reactants().begin()); it != next_reaction_.reactants().end(); ++it)
+    {
+        world_->remove_molecules(*it, 1);
+        update_complex(register_complex(*it), -1);
+    }
+
+    for (ReactionRule::product_container_type::const_iterator
+        it(next_reaction_.products().begin()); it != next_reaction_.products().end(); ++it)
+    {
+        world_->add_molecules(*it, 1);
+        update_complex(register_complex(*it), +1);
+    }
+
+    this->set_t(t0 + dt0);
+    num_steps_++;
+
+    last_reactions_.push_back(
+        std::make_pair(
+            next_reaction_rule_,
+            reaction_info_type(t(), next_reaction_.reactants(), next_reaction_.products())));
+
+    this->draw_next_reaction();
+}
+
+bool NetfreeSimulator::step(const Real &upto)
+{
+    if (upto <= t())
+    {
+        return false;
+    }
+
+    if (upto >= next_time())
+    {
+        step();
+        return true;
+    }
+    else
+    {
+        // No reaction occurs.
+        set_t(upto);
+        last_reactions_.clear();
+        draw_next_reaction();
+        return false;
+    }
+}
+
+void NetfreeSimulator::initialize(void)
+{
+    const Model::reaction_rule_container_type&
+        reaction_rules(model_->reaction_rules());
+
+    check_reaction_rules(reaction_rules);
+
+    rules_.clear();
+    for (Model::reaction_rule_container_type::const_iterator
+        i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
+    {
+        if ((*i).has_descriptor())
+        {
+            throw NotSupported(
+                "NetfreeSimulator does not support a reaction rule with a descriptor.");
+        }
+
+        rule_matches_type matches;
+        matches.rr = (*i);
+        matches.weights.resize((*i).reactants().size());
+        matches.num_self_pairs = 0;
+        rules_.push_back(matches);
+    }
+
+    complexes_.clear();
+    complex_indices_.clear();
+    dependencies_.clear();
+    propensities_.resize(rules_.size());
+
+    // Complexes are kept in the canonical form.
+    {
+        const std::vector<Species> species(world_->list_species());
+        for (std::vector<Species>::const_iterator i(species.begin());
+            i != species.end(); ++i)
+        {
+            const Species sp(format_species(*i));
+            if (sp != (*i))
+            {
+                const Integer num(world_->num_molecules_exact(*i));
+                world_->remove_molecules(*i, num);
+                world_->add_molecules(sp, num);
+            }
+        }
+    }
+
+    const std::vector<Species> species(world_->list_species());
+    for (std::vector<Species>::const_iterator i(species.begin());
+        i != species.end(); ++i)
+    {
+        const Integer num(world_->num_molecules_exact(*i));
+        if (num > 0)
+        {
+            update_complex(register_complex(*i), num);
+        }
+    }
+
+    for (std::size_t i(0); i < rules_.size(); ++i)
+    {
+        propensities_.set(i, propensity(i));
+    }
+
+    this->draw_next_reaction();
+}
+
+Real NetfreeSimulator::dt(void) const
+{
+    return this->dt_;
+}
+
+} // gillespie
+
+} // ecell4
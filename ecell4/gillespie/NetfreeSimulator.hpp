@@ -0,0 +1,145 @@
+#ifndef ECELL4_GILLESPIE_NETFREE_SIMULATOR_HPP
+#define ECELL4_GILLESPIE_NETFREE_SIMULATOR_HPP
+
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <boost/optional.hpp>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/SimulatorBase.hpp>
+#include <ecell4/core/PartialSumTree.hpp>
+
+#include "GillespieWorld.hpp"
+#include "GillespieSimulator.hpp"
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+/**
+ * A network-free stochastic simulator for rule-based models.
+ * The population is a set of complexes, each of which is a Species in
+ * the canonical form, and their numbers are kept in GillespieWorld.
+ * A complex is registered when it first appears, and then the number of
+ * matches of each reactant pattern in it is counted for each rule.
+ * The matches weighted by the number of the complex are kept in a partial
+ * sum tree for each pattern, and updated only for complexes changed by
+ * a firing. A rule is drawn by the direct method, then a match is drawn
+ * from the trees, and the rule is applied only to the match.
+ * Thus, the reaction network is never expanded.
+ * Rules with a descriptor are not supported.
+ */
+class NetfreeSimulator
+    : public SimulatorBase<GillespieWorld>
+{
+public:
+
+    typedef SimulatorBase<GillespieWorld> base_type;
+    typedef ReactionInfo reaction_info_type;
+
+protected:
+
+    /**
+     * matches of a rule. participants are complexes with any match, and
+     * coefficients[j][i] is the number of matches of the i-th reactant pattern
+     * in the j-th participant. weights[i] holds the coefficients multiplied
+     * by the number of the complex for the i-th pattern.
+     */
+    struct rule_matches_type
+    {
+        ReactionRule rr;
+        std::vector<std::size_t> participants;
+        std::vector<std::vector<Integer> > coefficients;
+        std::vector<PartialSumTree> weights;
+        Integer num_self_pairs;  // the sum of coef1 * coef2 * num for the second order
+    };
+
+public:
+
+    NetfreeSimulator(
+        std::shared_ptr<GillespieWorld> world,
+        std::shared_ptr<Model> model)
+        : base_type(world, model)
+    {
+        initialize();
+    }
+
+    NetfreeSimulator(std::shared_ptr<GillespieWorld> world)
+        : base_type(world)
+    {
+        initialize();
+    }
+
+    // SimulatorTraits
+    Real dt(void) const;
+
+    void step(void);
+    bool step(const Real& upto);
+
+    // Optional members
+
+    virtual bool check_reaction() const
+    {
+        return last_reactions_.size() > 0;
+    }
+
+    std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions() const
+    {
+        return last_reactions_;
+    }
+
+    /**
+     * format complexes in the world, count matches and draw the next time.
+     */
+    void initialize();
+
+    inline std::shared_ptr<RandomNumberGenerator> rng()
+    {
+        return (*world_).rng();
+    }
+
+    /**
+     * the number of complexes registered so far.
+     */
+    Integer num_complexes() const
+    {
+        return complexes_.size();
+    }
+
+protected:
+
+    std::size_t register_complex(const Species& sp);
+    void update_complex(const std::size_t idx, const Integer val);
+    Real propensity(const std::size_t idx) const;
+    boost::optional<ReactionRule> draw_reaction(const std::size_t idx);
+    bool __draw_next_reaction(void);
+    void draw_next_reaction(void);
+
+protected:
+
+    Real dt_;
+    ReactionRule next_reaction_rule_, next_reaction_;
+    std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions_;
+
+    std::vector<rule_matches_type> rules_;
+    PartialSumTree propensities_;
+
+    /**
+     * complexes_ and their indices. dependencies_ gives pairs of a rule and
+     * the position in its participants for each complex.
+     */
+    std::vector<Species> complexes_;
+    std::unordered_map<Species, std::size_t> complex_indices_;
+    std::vector<std::vector<std::pair<std::size_t, std::size_t> > > dependencies_;
+};
+
+} // gillespie
+
+} // ecell4
+
+#endif /* ECELL4_GILLESPIE_NETFREE_SIMULATOR_HPP */
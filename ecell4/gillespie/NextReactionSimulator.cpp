@@ -0,0 +1,255 @@
+#include "NextReactionSimulator.hpp"
+#include <vector>
+#include <algorithm>
+#include <gsl/gsl_sf_log.h>
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+Real NextReactionSimulator::draw_waiting_time(const Real a)
+{
+    if (a <= 0.0)
+    {
+        return std::numeric_limits<Real>::infinity();
+    }
+    else if (a == std::numeric_limits<Real>::infinity())
+    {
+        return 0.0;
+    }
+
+    const Real rnd(rng()->uniform(0, 1));
+    return gsl_sf_log(1.0 / rnd) / a;
+}
+
+void NextReactionSimulator::reschedule(const std::size_t idx, const bool redraw)
+{
+    const Real t0(t());
+    const Real a_old(propensities_[idx]), a_new(events_[idx].propensity());
+
+    if (!redraw && a_new == a_old)
+    {
+        return;
+    }
+
+    propensities_[idx] = a_new;
+
+    const std::shared_ptr<PutativeTimeEvent> event(scheduler_.get(ids_[idx]));
+    const Real tau_old(event->time());
+
+    if (redraw || a_new == std::numeric_limits<Real>::infinity()
+        || !(a_old > 0.0 && a_old < std::numeric_limits<Real>::infinity())
+        || !(tau_old > t0 && tau_old < std::numeric_limits<Real>::infinity()))
+    {
+        event->set_time(t0 + draw_waiting_time(a_new));
+    }
+    else if (a_new > 0.0)
+    {
+        // reuse the remaining waiting time by rescaling it.
+        event->set_time(t0 + (a_old / a_new) * (tau_old - t0));
+    }
+    else
+    {
+        event->set_time(std::numeric_limits<Real>::infinity());
+    }
+
+    scheduler_.update(std::make_pair(ids_[idx], event));
+}
+
+void NextReactionSimulator::reschedule_affected_events(
+    const boost::optional<std::size_t> fired)
+{
+    if (fired)
+    {
+        affected_events_.push_back(fired.get());
+    }
+
+    affected_events_.insert(
+        affected_events_.end(), time_dependent_events_.begin(), time_dependent_events_.end());
+    std::sort(affected_events_.begin(), affected_events_.end());
+    affected_events_.erase(
+        std::unique(affected_events_.begin(), affected_events_.end()),
+        affected_events_.end());
+
+    for (std::vector<std::size_t>::const_iterator i(affected_events_.begin());
+        i != affected_events_.end(); ++i)
+    {
+        const bool redraw(
+            (fired && (*i) == fired.get())
+            || events_[*i].reaction_rule().has_descriptor());
+        reschedule(*i, redraw);
+    }
+
+    affected_events_.clear();
+}
+
+void NextReactionSimulator::update_dependent_events(const Species& sp, const Integer val)
+{
+    const dependency_container_type& deps(dependencies_.get(sp, events_));
+    for (dependency_container_type::const_iterator it(deps.begin());
+        it != deps.end(); ++it)
+    {
+        events_[(*it).first].inc((*it).second, val);
+        affected_events_.push_back((*it).first);
+    }
+}
+
+void NextReactionSimulator::increment_molecules(const Species& sp, const Integer num)
+{
+    world_->add_molecules(sp, num);
+    update_dependent_events(sp, +num);
+}
+
+void NextReactionSimulator::decrement_molecules(const Species& sp, const Integer num)
+{
+    world_->remove_molecules(sp, num);
+    update_dependent_events(sp, -num);
+}
+
+void NextReactionSimulator::step(void)
+{
+    last_reactions_.clear();
+
+    const Real tnext(scheduler_.next_time());
+    if (tnext == std::numeric_limits<Real>::infinity())
+    {
+        // No reaction occurs.
+        return;
+    }
+
+    const std::size_t idx(scheduler_.top().second->index());
+    const ReactionRule& rr(events_[idx].reaction_rule());
+
+    // Draw exact reactants before changing the state.
+    // It may fail for rule-based models, and then nothing happens.
+    const boost::optional<ReactionRule> r(events_[idx].draw());
+
+    base_type::set_t(tnext);
+    num_steps_++;
+
+    if (r)
+    {
+        const stoichiometry_type changes(stoichiometry(r.get()));
+        for (stoichiometry_type::const_iterator it(changes.begin());
+            it != changes.end(); ++it)
+        {
+            if ((*it).second < 0)
+            {
+                decrement_molecules((*it).first, -(*it).second);
+            }
+            else if ((*it).second > 0)
+            {
+                increment_molecules((*it).first, (*it).second);
+            }
+        }
+
+        last_reactions_.push_back(
+            std::make_pair(
+                rr, reaction_info_type(t(), r.get().reactants(), r.get().products())));
+    }
+
+    reschedule_affected_events(idx);
+}
+
+bool NextReactionSimulator::step(const Real &upto)
+{
+    if (upto <= t())
+    {
+        return false;
+    }
+
+    if (upto >= next_time())
+    {
+        step();
+        return true;
+    }
+    else
+    {
+        // No reaction occurs.
+        // Putative times are kept except for time-dependent ones.
+        base_type::set_t(upto);
+        last_reactions_.clear();
+        reschedule_affected_events(boost::none);
+        return false;
+    }
+}
+
+void NextReactionSimulator::initialize(void)
+{
+    const Model::reaction_rule_container_type&
+        reaction_rules(model_->reaction_rules());
+
+    check_reaction_rules(reaction_rules);
+
+    events_.clear();
+    time_dependent_events_.clear();
+    affected_events_.clear();
+    dependencies_.clear();
+    for (Model::reaction_rule_container_type::const_iterator
+        i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
+    {
+        const ReactionRule& rr(*i);
+
+        if (rr.has_descriptor())
+        {
+            time_dependent_events_.push_back(events_.size());
+        }
+
+        events_.push_back(create_reaction_rule_event(this, rr));
+        events_.back().initialize();
+    }
+
+    const std::vector<Species> species(world_->list_species());
+    for (std::vector<Species>::const_iterator i(species.begin());
+        i != species.end(); ++i)
+    {
+        const Integer num(world_->num_molecules_exact(*i));
+        const dependency_container_type& deps(dependencies_.get(*i, events_));
+        for (dependency_container_type::const_iterator j(deps.begin());
+            j != deps.end(); ++j)
+        {
+            events_[(*j).first].inc((*j).second, num);
+        }
+    }
+
+    const Real t0(t());
+    scheduler_.clear();
+    ids_.clear();
+    propensities_.clear();
+    for (std::size_t i(0); i < events_.size(); ++i)
+    {
+        const Real a(events_[i].propensity());
+        propensities_.push_back(a);
+        ids_.push_back(scheduler_.add(std::shared_ptr<PutativeTimeEvent>(
+            new PutativeTimeEvent(t0 + draw_waiting_time(a), i))));
+    }
+}
+
+void NextReactionSimulator::set_t(const Real& t)
+{
+    // Waiting times are memoryless. Keep the remaining ones by shifting
+    // all putative times, which never changes their order.
+    const Real offset(t - this->t());
+    for (std::size_t i(0); i < ids_.size(); ++i)
+    {
+        const std::shared_ptr<PutativeTimeEvent> event(scheduler_.get(ids_[i]));
+        if (event->time() < std::numeric_limits<Real>::infinity())
+        {
+            event->set_time(event->time() + offset);
+            scheduler_.update(std::make_pair(ids_[i], event));
+        }
+    }
+    base_type::set_t(t);
+}
+
+Real NextReactionSimulator::dt(void) const
+{
+    return scheduler_.next_time() - t();
+}
+
+} // gillespie
+
+} // ecell4
@@ -0,0 +1,158 @@
+#ifndef ECELL4_GILLESPIE_NEXT_REACTION_SIMULATOR_HPP
+#define ECELL4_GILLESPIE_NEXT_REACTION_SIMULATOR_HPP
+
+#include <limits>
+#include <memory>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/SimulatorBase.hpp>
+#include <ecell4/core/EventScheduler.hpp>
+
+#include "GillespieWorld.hpp"
+#include "GillespieSimulator.hpp"
+#include "ReactionRuleEvent.hpp"
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+/**
+ * The next reaction method by Gibson and Bruck (2000).
+ * The putative time of each reaction is kept in an indexed priority queue,
+ * and only the reactions depending on the species changed by a firing
+ * are rescheduled, by rescaling their remaining waiting times.
+ */
+class NextReactionSimulator
+    : public SimulatorBase<GillespieWorld>
+{
+public:
+
+    typedef SimulatorBase<GillespieWorld> base_type;
+    typedef ReactionInfo reaction_info_type;
+
+protected:
+
+    typedef ReactionRuleEventDependencyGraph::dependency_container_type
+        dependency_container_type;
+
+    struct PutativeTimeEvent
+        : public Event
+    {
+    public:
+
+        PutativeTimeEvent(const Real& t, const std::size_t idx)
+            : Event(t), idx_(idx)
+        {
+            ;
+        }
+
+        virtual ~PutativeTimeEvent()
+        {
+            ;
+        }
+
+        void set_time(const Real& t)
+        {
+            time_ = t;
+        }
+
+        std::size_t index() const
+        {
+            return idx_;
+        }
+
+    protected:
+
+        std::size_t idx_;
+    };
+
+    typedef EventSchedulerBase<PutativeTimeEvent> scheduler_type;
+
+public:
+
+    NextReactionSimulator(
+        std::shared_ptr<GillespieWorld> world,
+        std::shared_ptr<Model> model)
+        : base_type(world, model)
+    {
+        initialize();
+    }
+
+    NextReactionSimulator(std::shared_ptr<GillespieWorld> world)
+        : base_type(world)
+    {
+        initialize();
+    }
+
+    // SimulatorTraits
+    Real dt(void) const;
+
+    void step(void);
+    bool step(const Real& upto);
+
+    /**
+     * set the current time. putative times are shifted together.
+     */
+    void set_t(const Real& t);
+
+    // Optional members
+
+    virtual bool check_reaction() const
+    {
+        return last_reactions_.size() > 0;
+    }
+
+    std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions() const
+    {
+        return last_reactions_;
+    }
+
+    /**
+     * recalculate reaction propensities and draw the putative times.
+     */
+    void initialize();
+
+    inline std::shared_ptr<RandomNumberGenerator> rng()
+    {
+        return (*world_).rng();
+    }
+
+protected:
+
+    Real draw_waiting_time(const Real a);
+    void reschedule(const std::size_t idx, const bool redraw);
+    void reschedule_affected_events(const boost::optional<std::size_t> fired);
+    void increment_molecules(const Species& sp, const Integer num = 1);
+    void decrement_molecules(const Species& sp, const Integer num = 1);
+    void update_dependent_events(const Species& sp, const Integer val);
+
+protected:
+
+    std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions_;
+
+    boost::ptr_vector<ReactionRuleEvent> events_;
+    ReactionRuleEventDependencyGraph dependencies_;
+
+    scheduler_type scheduler_;
+    std::vector<scheduler_type::identifier_type> ids_;
+    std::vector<Real> propensities_;
+
+    /**
+     * time_dependent_events_ lists events with a descriptor, which could
+     * depend on the time. They are redrawn at every step.
+     * affected_events_ collects events changed by the current step.
+     */
+    std::vector<std::size_t> time_dependent_events_;
+    std::vector<std::size_t> affected_events_;
+};
+
+} // gillespie
+
+} // ecell4
+
+#endif /* ECELL4_GILLESPIE_NEXT_REACTION_SIMULATOR_HPP */
@@ -0,0 +1,108 @@
+#include "ReactionRuleEvent.hpp"
+
+#include <cmath>
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+void check_reaction_rules(const Model::reaction_rule_container_type& reaction_rules)
+{
+    // Check if the given model is supported or not.
+    for (Model::reaction_rule_container_type::const_iterator
+        i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
+    {
+        const ReactionRule& rr(*i);
+
+        if (rr.has_descriptor())
+        {
+            const std::shared_ptr<ReactionRuleDescriptor>& desc = rr.get_descriptor();
+
+            if (!desc->is_available())
+            {
+                throw NotSupported(
+                    "The given reaction rule descriptor is not available.");
+            }
+            else if ((rr.reactants().size() != desc->reactant_coefficients().size())
+                    || (rr.products().size() != desc->product_coefficients().size()))
+            {
+                throw NotSupported(
+                    "Mismatch between the number of stoichiometry coefficients and of reactants.");
+            }
+            else
+            {
+                for (ReactionRuleDescriptor::coefficient_container_type::const_iterator
+                    it(desc->reactant_coefficients().begin()); it != desc->reactant_coefficients().end();
+                    it++)
+                {
+                    if ((*it) < 0)
+                    {
+                        throw NotSupported("A stoichiometric coefficient must be non-negative.");
+                    }
+                    else if (abs((*it) - round(*it)) > 1e-10 * (*it))
+                    {
+                        throw NotSupported("A stoichiometric coefficient must be an integer.");
+                    }
+                }
+            }
+        }
+        else if (rr.reactants().size() > 2)
+        {
+            throw NotSupported("No more than 2 reactants are supported.");
+        }
+    }
+}
+
+stoichiometry_type stoichiometry(const ReactionRule& rr)
+{
+    stoichiometry_type changes;
+
+    if (!rr.has_descriptor())
+    {
+        for (ReactionRule::reactant_container_type::const_iterator
+            it(rr.reactants().begin()); it != rr.reactants().end(); ++it)
+        {
+            changes.push_back(std::make_pair(*it, -1));
+        }
+
+        for (ReactionRule::product_container_type::const_iterator
+            it(rr.products().begin()); it != rr.products().end(); ++it)
+        {
+            changes.push_back(std::make_pair(*it, +1));
+        }
+        return changes;
+    }
+
+    const std::shared_ptr<ReactionRuleDescriptor>& desc = rr.get_descriptor();
+    assert(desc->is_available());
+
+    const ReactionRule::reactant_container_type& reactants(rr.reactants());
+    const ReactionRuleDescriptor::coefficient_container_type&
+        reactant_coefficients(desc->reactant_coefficients());
+    assert(reactants.size() == reactant_coefficients.size());
+    for (std::size_t i = 0; i < reactants.size(); ++i)
+    {
+        assert(reactant_coefficients[i] >= 0);
+        changes.push_back(
+            std::make_pair(reactants[i], -static_cast<Integer>(round(reactant_coefficients[i]))));
+    }
+
+    const ReactionRule::product_container_type& products(rr.products());
+    const ReactionRuleDescriptor::coefficient_container_type&
+        product_coefficients(desc->product_coefficients());
+    assert(products.size() == product_coefficients.size());
+    for (std::size_t i = 0; i < products.size(); ++i)
+    {
+        assert(product_coefficients[i] >= 0);
+        changes.push_back(
+            std::make_pair(products[i], static_cast<Integer>(round(product_coefficients[i]))));
+    }
+    return changes;
+}
+
+} // gillespie
+
+} // ecell4
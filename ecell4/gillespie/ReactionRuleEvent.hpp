@@ -0,0 +1,562 @@
+#ifndef ECELL4_GILLESPIE_REACTION_RULE_EVENT_HPP
+#define ECELL4_GILLESPIE_REACTION_RULE_EVENT_HPP
+
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <algorithm>
+#include <unordered_map>
+#include <boost/optional.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/ReactionRule.hpp>
+#include <ecell4/core/SimulatorBase.hpp>
+
+#include "GillespieWorld.hpp"
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+/**
+ * A reaction rule event keeps the number of reactants of a reaction rule
+ * in a GillespieWorld, and gives its propensity.
+ * It is shared by the stochastic simulators on GillespieWorld.
+ */
+class ReactionRuleEvent
+{
+public:
+
+    /**
+     * stoichiometric coefficients of a species for each reactant
+     * (and product) pattern of a reaction rule.
+     */
+    typedef std::vector<Integer> coefficient_container_type;
+    typedef std::vector<std::pair<Species, coefficient_container_type> >
+        participant_container_type;
+
+public:
+
+    ReactionRuleEvent()
+        : sim_(), rr_()
+    {
+        ;
+    }
+
+    ReactionRuleEvent(SimulatorBase<GillespieWorld>* sim, const ReactionRule& rr)
+        : sim_(sim), rr_(rr)
+    {
+        ;
+    }
+
+    virtual ~ReactionRuleEvent()
+    {
+        ;
+    }
+
+    const ReactionRule& reaction_rule() const
+    {
+        return rr_;
+    }
+
+    inline const Integer get_coef(const Species& pttrn, const Species& sp) const
+    {
+        return sim_->model()->apply(pttrn, sp);
+    }
+
+    inline const std::vector<ReactionRule> generate(
+        const ReactionRule::reactant_container_type& reactants) const
+    {
+        return sim_->model()->apply(rr_, reactants);
+    }
+
+    /**
+     * return the stoichiometric coefficients of the given species
+     * for each reactant pattern.
+     */
+    virtual coefficient_container_type coefficients(const Species& sp) const
+    {
+        const ReactionRule::reactant_container_type& reactants(rr_.reactants());
+        coefficient_container_type coefs(reactants.size());
+        for (std::size_t i = 0; i < reactants.size(); ++i)
+        {
+            coefs[i] = get_coef(reactants[i], sp);
+        }
+        return coefs;
+    }
+
+    /**
+     * register a species involved in this reaction together with
+     * its coefficients. Only registered species are drawn.
+     */
+    void add_participant(const Species& sp, const coefficient_container_type& coefs)
+    {
+        participants_.push_back(std::make_pair(sp, coefs));
+    }
+
+    /**
+     * reset the number of reactants and registered species.
+     */
+    virtual void initialize() = 0;
+    virtual void inc(const coefficient_container_type& coefs, const Integer val = +1) = 0;
+    virtual const Real propensity() const = 0;
+
+    inline void dec(const coefficient_container_type& coefs)
+    {
+        inc(coefs, -1);
+    }
+
+    boost::optional<ReactionRule> draw()
+    {
+        const std::pair<ReactionRule::reactant_container_type, Integer>
+            retval(__draw());
+        if (retval.second == 0)
+        {
+            return boost::none;
+        }
+
+        const std::vector<ReactionRule> reactions(generate(retval.first));
+
+        assert(retval.second > 0);
+        assert(retval.second >= static_cast<Integer>(reactions.size()));
+
+        if (reactions.size() == 0)
+        {
+            return boost::none;
+        }
+        else if (retval.second == 1)
+        {
+            // assert(possibles.size() == 1);
+            return reactions[0];
+        }
+        else
+        {
+            const ReactionRule::reactant_container_type::size_type rnd2(
+                static_cast<ReactionRule::reactant_container_type::size_type>(
+                    rng()->uniform_int(0, retval.second - 1)));
+            if (rnd2 >= reactions.size())
+            {
+                return boost::none;
+            }
+            return reactions[rnd2];
+        }
+    }
+
+protected:
+
+    inline const std::shared_ptr<RandomNumberGenerator>& rng() const
+    {
+        return sim_->world()->rng();
+    }
+
+    inline const GillespieWorld& world() const
+    {
+        return (*sim_->world());
+    }
+
+    virtual std::pair<ReactionRule::reactant_container_type, Integer>
+        __draw() = 0;
+
+protected:
+
+    SimulatorBase<GillespieWorld>* sim_;
+    ReactionRule rr_;
+    participant_container_type participants_;
+};
+
+class ZerothOrderReactionRuleEvent
+    : public ReactionRuleEvent
+{
+public:
+
+    typedef ReactionRuleEvent base_type;
+
+    ZerothOrderReactionRuleEvent()
+        : base_type()
+    {
+        ;
+    }
+
+    ZerothOrderReactionRuleEvent(SimulatorBase<GillespieWorld>* sim, const ReactionRule& rr)
+        : base_type(sim, rr)
+    {
+        ;
+    }
+
+    void inc(const coefficient_container_type& coefs, const Integer val = +1)
+    {
+        ; // do nothing
+    }
+
+    void initialize()
+    {
+        participants_.clear();
+    }
+
+    std::pair<ReactionRule::reactant_container_type, Integer> __draw()
+    {
+        return std::make_pair(ReactionRule::reactant_container_type(), 1);
+    }
+
+    const Real propensity() const
+    {
+        return rr_.k() * sim_->world()->volume();
+    }
+};
+
+class FirstOrderReactionRuleEvent
+    : public ReactionRuleEvent
+{
+public:
+
+    typedef ReactionRuleEvent base_type;
+
+    FirstOrderReactionRuleEvent()
+        : base_type(), num_tot1_(0)
+    {
+        ;
+    }
+
+    FirstOrderReactionRuleEvent(SimulatorBase<GillespieWorld>* sim, const ReactionRule& rr)
+        : base_type(sim, rr), num_tot1_(0)
+    {
+        ;
+    }
+
+    void inc(const coefficient_container_type& coefs, const Integer val = +1)
+    {
+        num_tot1_ += coefs[0] * val;
+    }
+
+    void initialize()
+    {
+        participants_.clear();
+        num_tot1_ = 0;
+    }
+
+    std::pair<ReactionRule::reactant_container_type, Integer> __draw()
+    {
+        const Real rnd1(rng()->uniform(0.0, num_tot1_));
+
+        Integer num_tot(0);
+        for (participant_container_type::const_iterator i(participants_.begin());
+            i != participants_.end(); ++i)
+        {
+            const Integer coef((*i).second[0]);
+            if (coef > 0)
+            {
+                num_tot += coef * world().num_molecules_exact((*i).first);
+                if (num_tot >= rnd1)
+                {
+                    return std::make_pair(
+                        ReactionRule::reactant_container_type(1, (*i).first), coef);
+                }
+            }
+        }
+
+        return std::make_pair(ReactionRule::reactant_container_type(), 0);
+    }
+
+    const Real propensity() const
+    {
+        return (num_tot1_ > 0 ? num_tot1_ * rr_.k() : 0.0);
+    }
+
+protected:
+
+    Integer num_tot1_;
+};
+
+class SecondOrderReactionRuleEvent:
+    public ReactionRuleEvent
+{
+public:
+
+    typedef ReactionRuleEvent base_type;
+
+    SecondOrderReactionRuleEvent()
+        : base_type(), num_tot1_(0), num_tot2_(0), num_tot12_(0)
+    {
+        ;
+    }
+
+    SecondOrderReactionRuleEvent(SimulatorBase<GillespieWorld>* sim, const ReactionRule& rr)
+        : base_type(sim, rr), num_tot1_(0), num_tot2_(0), num_tot12_(0)
+    {
+        ;
+    }
+
+    void inc(const coefficient_container_type& coefs, const Integer val = +1)
+    {
+        const Integer tmp(coefs[0] * val);
+        num_tot1_ += tmp;
+        num_tot2_ += coefs[1] * val;
+        num_tot12_ += coefs[1] * tmp;
+    }
+
+    void initialize()
+    {
+        participants_.clear();
+        num_tot1_ = 0;
+        num_tot2_ = 0;
+        num_tot12_ = 0;
+    }
+
+    std::pair<ReactionRule::reactant_container_type, Integer> __draw()
+    {
+        const Real rnd1(rng()->uniform(0.0, num_tot1_));
+
+        Integer num_tot(0), coef1(0);
+        participant_container_type::const_iterator itr1(participants_.begin());
+        for (; itr1 != participants_.end(); ++itr1)
+        {
+            const Integer coef((*itr1).second[0]);
+            if (coef > 0)
+            {
+                num_tot += coef * world().num_molecules_exact((*itr1).first);
+                if (num_tot >= rnd1)
+                {
+                    coef1 = coef;
+                    break;
+                }
+            }
+        }
+
+        const Real rnd2(rng()->uniform(0.0, num_tot2_ - coef1));
+
+        num_tot = 0;
+        for (participant_container_type::const_iterator i(participants_.begin());
+            i != participants_.end(); ++i)
+        {
+            const Integer coef((*i).second[1]);
+            if (coef > 0)
+            {
+                const Integer num(world().num_molecules_exact((*i).first));
+                num_tot += coef * (i == itr1 ? num - 1 : num);
+                if (num_tot >= rnd2)
+                {
+                    ReactionRule::reactant_container_type exact_reactants(2);
+                    exact_reactants[0] = (*itr1).first;
+                    exact_reactants[1] = (*i).first;
+                    return std::make_pair(exact_reactants, coef1 * coef);
+                }
+            }
+        }
+
+        return std::make_pair(ReactionRule::reactant_container_type(), 0);
+    }
+
+    const Real propensity() const
+    {
+        const Integer num = num_tot1_ * num_tot2_ - num_tot12_;
+        return (num > 0 ? num * rr_.k() / world().volume() : 0.0);
+    }
+
+protected:
+
+    Integer num_tot1_, num_tot2_, num_tot12_;
+};
+
+class DescriptorReactionRuleEvent
+    : public ReactionRuleEvent
+{
+public:
+
+    typedef ReactionRuleEvent base_type;
+    typedef ReactionRuleDescriptor::state_container_type state_container_type;
+
+    DescriptorReactionRuleEvent()
+        : base_type(), num_reactants_(), num_products_()
+    {
+        ;
+    }
+
+    DescriptorReactionRuleEvent(SimulatorBase<GillespieWorld>* sim, const ReactionRule& rr)
+        : base_type(sim, rr), num_reactants_(), num_products_()
+    {
+        ;
+    }
+
+    /**
+     * return the coefficients for each reactant pattern followed by
+     * those for each product pattern.
+     */
+    coefficient_container_type coefficients(const Species& sp) const
+    {
+        coefficient_container_type coefs(base_type::coefficients(sp));
+        const ReactionRule::product_container_type& products(rr_.products());
+        for (std::size_t i = 0; i < products.size(); ++i)
+        {
+            coefs.push_back(get_coef(products[i], sp));
+        }
+        return coefs;
+    }
+
+    void inc(const coefficient_container_type& coefs, const Integer val = +1)
+    {
+        const std::size_t num_reactants(num_reactants_.size());
+        for (std::size_t i = 0; i < num_reactants; ++i)
+        {
+            num_reactants_[i] += coefs[i] * val;
+        }
+        for (std::size_t i = 0; i < num_products_.size(); ++i)
+        {
+            num_products_[i] += coefs[num_reactants + i] * val;
+        }
+    }
+
+    void initialize()
+    {
+        participants_.clear();
+        num_reactants_.assign(rr_.reactants().size(), 0);
+        num_products_.assign(rr_.products().size(), 0);
+    }
+
+    std::pair<ReactionRule::reactant_container_type, Integer> __draw()
+    {
+        const ReactionRule::reactant_container_type& reactants(rr_.reactants());
+
+        std::pair<ReactionRule::reactant_container_type, Integer> ret;
+        ret.second = 1;
+
+        for (std::size_t i = 0; i < reactants.size(); ++i)
+        {
+            assert(num_reactants_[i] > 0);
+            const Real rnd(rng()->uniform(0.0, num_reactants_[i]));
+            Integer num_tot(0);
+            for (participant_container_type::const_iterator it(participants_.begin());
+                it != participants_.end(); ++it)
+            {
+                const Integer coef((*it).second[i]);
+                if (coef > 0)
+                {
+                    num_tot += coef * world().num_molecules_exact((*it).first);
+                    if (num_tot >= rnd)
+                    {
+                        ret.first.push_back((*it).first);
+                        ret.second *= coef;
+                        break;
+                    }
+                }
+            }
+        }
+
+        assert(ret.first.size() == reactants.size());
+        return ret;
+    }
+
+    const Real propensity() const
+    {
+        assert(rr_.has_descriptor());
+        const std::shared_ptr<ReactionRuleDescriptor>& ratelaw = rr_.get_descriptor();
+        assert(ratelaw->is_available());
+        const Real ret = ratelaw->propensity(num_reactants_, num_products_, world().volume(), world().t());
+        return ret;
+    }
+
+protected:
+
+    state_container_type num_reactants_, num_products_;
+};
+
+/**
+ * create a reaction rule event suitable for the given reaction rule.
+ */
+inline ReactionRuleEvent* create_reaction_rule_event(
+    SimulatorBase<GillespieWorld>* sim, const ReactionRule& rr)
+{
+    if (rr.has_descriptor())
+    {
+        return new DescriptorReactionRuleEvent(sim, rr);
+    }
+    else if (rr.reactants().size() == 0)
+    {
+        return new ZerothOrderReactionRuleEvent(sim, rr);
+    }
+    else if (rr.reactants().size() == 1)
+    {
+        return new FirstOrderReactionRuleEvent(sim, rr);
+    }
+    else if (rr.reactants().size() == 2)
+    {
+        return new SecondOrderReactionRuleEvent(sim, rr);
+    }
+    throw IllegalState("Never get here");
+}
+
+typedef std::vector<std::pair<Species, Integer> > stoichiometry_type;
+
+/**
+ * throw NotSupported if the given reaction rules cannot be simulated.
+ */
+void check_reaction_rules(const Model::reaction_rule_container_type& reaction_rules);
+
+/**
+ * return the changes in the number of molecules when the given reaction
+ * occurs, reactants followed by products.
+ */
+stoichiometry_type stoichiometry(const ReactionRule& rr);
+
+/**
+ * A species-to-events dependency graph. Each species is mapped to the
+ * events it is involved in, paired with its stoichiometric coefficients.
+ * An entry is built at the first time when a species is queried.
+ */
+class ReactionRuleEventDependencyGraph
+{
+public:
+
+    typedef boost::ptr_vector<ReactionRuleEvent> event_container_type;
+    typedef std::vector<std::pair<std::size_t, ReactionRuleEvent::coefficient_container_type> >
+        dependency_container_type;
+
+public:
+
+    void clear()
+    {
+        dependencies_.clear();
+    }
+
+    /**
+     * return the events depending on the given species. The species is
+     * registered to the events as a participant at the first query.
+     */
+    const dependency_container_type& get(const Species& sp, event_container_type& events)
+    {
+        std::unordered_map<Species, dependency_container_type>::const_iterator
+            it(dependencies_.find(sp));
+        if (it != dependencies_.end())
+        {
+            return (*it).second;
+        }
+
+        dependency_container_type deps;
+        for (std::size_t i(0); i < events.size(); ++i)
+        {
+            const ReactionRuleEvent::coefficient_container_type
+                coefs(events[i].coefficients(sp));
+            if (std::find_if(coefs.begin(), coefs.end(),
+                    [](const Integer coef) { return coef > 0; }) != coefs.end())
+            {
+                events[i].add_participant(sp, coefs);
+                deps.push_back(std::make_pair(i, coefs));
+            }
+        }
+        return dependencies_.insert(std::make_pair(sp, deps)).first->second;
+    }
+
+protected:
+
+    std::unordered_map<Species, dependency_container_type> dependencies_;
+};
+
+} // gillespie
+
+} // ecell4
+
+#endif /* ECELL4_GILLESPIE_REACTION_RULE_EVENT_HPP */
@@ -0,0 +1,95 @@
+#ifndef ECELL4_GILLESPIE_TAU_LEAPING_FACTORY_HPP
+#define ECELL4_GILLESPIE_TAU_LEAPING_FACTORY_HPP
+
+#include <ecell4/core/SimulatorFactory.hpp>
+#include <ecell4/core/RandomNumberGenerator.hpp>
+
+#include <ecell4/core/extras.hpp>
+#include "GillespieWorld.hpp"
+#include "TauLeapingSimulator.hpp"
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+class TauLeapingFactory:
+    public SimulatorFactory<GillespieWorld, TauLeapingSimulator>
+{
+public:
+
+    typedef SimulatorFactory<GillespieWorld, TauLeapingSimulator> base_type;
+    typedef base_type::world_type world_type;
+    typedef base_type::simulator_type simulator_type;
+    typedef TauLeapingFactory this_type;
+
+public:
+
+    TauLeapingFactory(
+        const Real epsilon = default_epsilon(),
+        const Integer critical_threshold = default_critical_threshold())
+        : base_type(), rng_(), epsilon_(epsilon), critical_threshold_(critical_threshold)
+    {
+        ; // do nothing
+    }
+
+    virtual ~TauLeapingFactory()
+    {
+        ; // do nothing
+    }
+
+    static inline const Real default_epsilon()
+    {
+        return simulator_type::default_epsilon();
+    }
+
+    static inline const Integer default_critical_threshold()
+    {
+        return simulator_type::default_critical_threshold();
+    }
+
+    this_type& rng(const std::shared_ptr<RandomNumberGenerator>& rng)
+    {
+        rng_ = rng;
+        return (*this);
+    }
+
+    inline this_type* rng_ptr(const std::shared_ptr<RandomNumberGenerator>& rng)
+    {
+        return &(this->rng(rng));  //XXX: == this
+    }
+
+protected:
+
+    virtual world_type* create_world(const Real3& edge_lengths) const
+    {
+        if (rng_)
+        {
+            return new world_type(edge_lengths, rng_);
+        }
+        else
+        {
+            return new world_type(edge_lengths);
+        }
+    }
+
+    virtual simulator_type* create_simulator(
+        const std::shared_ptr<world_type>& w, const std::shared_ptr<Model>& m) const
+    {
+        return new simulator_type(w, m, epsilon_, critical_threshold_);
+    }
+
+protected:
+
+    std::shared_ptr<RandomNumberGenerator> rng_;
+    Real epsilon_;
+    Integer critical_threshold_;
+};
+
+} // gillespie
+
+} // ecell4
+
+#endif /* ECELL4_GILLESPIE_TAU_LEAPING_FACTORY_HPP */
@@ -0,0 +1,532 @@
+#include "TauLeapingSimulator.hpp"
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <gsl/gsl_sf_log.h>
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+/**
+ * Following Cao et al., switch to the direct method for 100 steps
+ * when a leap is shorter than 10 times the mean waiting time.
+ */
+static const Real EXACT_STEP_THRESHOLD = 10.0;
+static const Integer NUM_EXACT_STEPS = 100;
+
+std::size_t TauLeapingSimulator::species_index(const Species& sp)
+{
+    std::unordered_map<Species, std::size_t>::const_iterator
+        it(species_index_.find(sp));
+    if (it != species_index_.end())
+    {
+        return (*it).second;
+    }
+
+    const std::size_t i(species_.size());
+    species_.push_back(sp);
+    num_molecules_.push_back(world_->num_molecules_exact(sp));
+    species_index_.insert(std::make_pair(sp, i));
+    return i;
+}
+
+void TauLeapingSimulator::change_molecules(const std::size_t i, const Integer val)
+{
+    if (val == 0)
+    {
+        return;
+    }
+
+    const Species& sp(species_[i]);
+    if (val > 0)
+    {
+        world_->add_molecules(sp, val);
+    }
+    else
+    {
+        world_->remove_molecules(sp, -val);
+    }
+    num_molecules_[i] += val;
+
+    const dependency_container_type& deps(dependencies_.get(sp, events_));
+    for (dependency_container_type::const_iterator it(deps.begin());
+        it != deps.end(); ++it)
+    {
+        events_[(*it).first].inc((*it).second, val);
+    }
+}
+
+Real TauLeapingSimulator::draw_leap_size() const
+{
+    const std::size_t num_species(species_.size());
+    std::vector<Real> mu(num_species, 0.0), sigma2(num_species, 0.0), g(num_species, 0.0);
+
+    for (std::size_t j(0); j < channels_.size(); ++j)
+    {
+        const ReactionChannel& channel(channels_[j]);
+
+        // the highest order of reactions, in which a species is a reactant
+        for (std::vector<std::pair<std::size_t, Integer> >::const_iterator
+            it(channel.reactants.begin()); it != channel.reactants.end(); ++it)
+        {
+            const Integer c((*it).second);
+            const Real x(num_molecules_[(*it).first]);
+            Real gi(c);
+            for (Integer k(1); k < c; ++k)
+            {
+                gi += k / std::max(x - k, 1.0);
+            }
+            gi *= static_cast<Real>(channel.order) / c;
+            g[(*it).first] = std::max(g[(*it).first], gi);
+        }
+
+        if (critical_[j] || propensities_[j] <= 0.0)
+        {
+            continue;
+        }
+
+        for (std::vector<std::pair<std::size_t, Integer> >::const_iterator
+            it(channel.changes.begin()); it != channel.changes.end(); ++it)
+        {
+            const Real v((*it).second);
+            mu[(*it).first] += v * propensities_[j];
+            sigma2[(*it).first] += v * v * propensities_[j];
+        }
+    }
+
+    Real tau(std::numeric_limits<Real>::infinity());
+    for (std::size_t i(0); i < num_species; ++i)
+    {
+        if (g[i] <= 0.0)
+        {
+            continue;
+        }
+
+        const Real bound(std::max(epsilon_ * num_molecules_[i] / g[i], 1.0));
+        if (mu[i] != 0.0)
+        {
+            tau = std::min(tau, bound / std::abs(mu[i]));
+        }
+        if (sigma2[i] > 0.0)
+        {
+            tau = std::min(tau, bound * bound / sigma2[i]);
+        }
+    }
+    return tau;
+}
+
+void TauLeapingSimulator::draw_exact_event(const Real atot)
+{
+    leaping_ = false;
+
+    if (atot == std::numeric_limits<Real>::infinity())
+    {
+        std::vector<std::size_t> selected;
+        for (std::size_t i(0); i < propensities_.size(); ++i)
+        {
+            if (propensities_[i] == std::numeric_limits<Real>::infinity())
+            {
+                selected.push_back(i);
+            }
+        }
+
+        dt_ = 0.0;
+        next_event_ = selected[(selected.size() == 1 ? 0 : rng()->uniform_int(0, selected.size() - 1))];
+        return;
+    }
+
+    const Real rnd1(rng()->uniform(0, 1));
+    const Real rnd2(rng()->uniform(0, atot));
+
+    dt_ = gsl_sf_log(1.0 / rnd1) / atot;
+
+    Real acc(0.0);
+    std::size_t idx(0);
+    for (; idx < propensities_.size() - 1; ++idx)
+    {
+        acc += propensities_[idx];
+        if (acc >= rnd2)
+        {
+            break;
+        }
+    }
+    next_event_ = idx;
+}
+
+void TauLeapingSimulator::draw_next_step(void)
+{
+    next_event_ = boost::none;
+
+    for (std::size_t j(0); j < events_.size(); ++j)
+    {
+        propensities_[j] = events_[j].propensity();
+    }
+
+    const Real atot(std::accumulate(propensities_.begin(), propensities_.end(), Real(0.0)));
+
+    if (atot == 0.0)
+    {
+        // no reaction occurs
+        dt_ = std::numeric_limits<Real>::infinity();
+        leaping_ = false;
+        return;
+    }
+    else if (num_exact_steps_ > 0 || atot == std::numeric_limits<Real>::infinity())
+    {
+        draw_exact_event(atot);
+        return;
+    }
+
+    // A reaction is critical if it could exhaust its reactants
+    // within the given number of firings.
+    Real atot_critical(0.0);
+    for (std::size_t j(0); j < channels_.size(); ++j)
+    {
+        Integer num_firings(std::numeric_limits<Integer>::max());
+        for (std::vector<std::pair<std::size_t, Integer> >::const_iterator
+            it(channels_[j].changes.begin()); it != channels_[j].changes.end(); ++it)
+        {
+            if ((*it).second < 0)
+            {
+                num_firings = std::min(
+                    num_firings, num_molecules_[(*it).first] / (-(*it).second));
+            }
+        }
+
+        critical_[j] = (propensities_[j] > 0.0 && num_firings < critical_threshold_);
+        if (critical_[j])
+        {
+            atot_critical += propensities_[j];
+        }
+    }
+
+    if (atot_critical == atot)
+    {
+        // Only critical reactions can occur. Leaping is meaningless.
+        draw_exact_event(atot);
+        return;
+    }
+
+    const Real tau1(draw_leap_size());
+
+    if (tau1 < EXACT_STEP_THRESHOLD / atot)
+    {
+        num_exact_steps_ = NUM_EXACT_STEPS;
+        draw_exact_event(atot);
+        return;
+    }
+
+    const Real tau2(atot_critical > 0.0
+        ? gsl_sf_log(1.0 / rng()->uniform(0, 1)) / atot_critical
+        : std::numeric_limits<Real>::infinity());
+
+    if (tau1 == std::numeric_limits<Real>::infinity()
+        && tau2 == std::numeric_limits<Real>::infinity())
+    {
+        // No reactant bounds the leap, e.g. only synthesis occurs.
+        draw_exact_event(atot);
+        return;
+    }
+
+    leaping_ = true;
+
+    if (tau1 < tau2)
+    {
+        dt_ = tau1;
+        return;
+    }
+
+    // One of critical reactions fires at the end of the leap.
+    dt_ = tau2;
+
+    const Real rnd(rng()->uniform(0, atot_critical));
+    Real acc(0.0);
+    for (std::size_t j(0); j < channels_.size(); ++j)
+    {
+        if (critical_[j])
+        {
+            next_event_ = j;
+            acc += propensities_[j];
+            if (acc >= rnd)
+            {
+                break;
+            }
+        }
+    }
+}
+
+void TauLeapingSimulator::fire_exact_event(void)
+{
+    const std::size_t idx(next_event_.get());
+    const boost::optional<ReactionRule> r(events_[idx].draw());
+
+    this->set_t(t() + dt_);
+
+    if (!r)
+    {
+        return;
+    }
+
+    const std::vector<std::pair<std::size_t, Integer> >& changes(channels_[idx].changes);
+    for (std::vector<std::pair<std::size_t, Integer> >::const_iterator
+        it(changes.begin()); it != changes.end(); ++it)
+    {
+        change_molecules((*it).first, (*it).second);
+    }
+
+    last_reactions_.push_back(std::make_pair(events_[idx].reaction_rule(), 1));
+}
+
+void TauLeapingSimulator::leap(const Real tnext, boost::optional<std::size_t> critical)
+{
+    const Real t0(t());
+    Real tau(tnext - t0);
+
+    std::vector<Integer> num_firings(channels_.size(), 0);
+    std::vector<Integer> delta(species_.size(), 0);
+
+    while (true)
+    {
+        std::fill(num_firings.begin(), num_firings.end(), 0);
+        std::fill(delta.begin(), delta.end(), 0);
+
+        for (std::size_t j(0); j < channels_.size(); ++j)
+        {
+            if (critical_[j] || propensities_[j] <= 0.0)
+            {
+                continue;
+            }
+            num_firings[j] = rng()->poisson(propensities_[j] * tau);
+        }
+
+        if (critical)
+        {
+            num_firings[critical.get()] = 1;
+        }
+
+        for (std::size_t j(0); j < channels_.size(); ++j)
+        {
+            if (num_firings[j] == 0)
+            {
+                continue;
+            }
+
+            for (std::vector<std::pair<std::size_t, Integer> >::const_iterator
+                it(channels_[j].changes.begin()); it != channels_[j].changes.end(); ++it)
+            {
+                delta[(*it).first] += num_firings[j] * (*it).second;
+            }
+        }
+
+        bool negative(false);
+        for (std::size_t i(0); i < species_.size(); ++i)
+        {
+            if (num_molecules_[i] + delta[i] < 0)
+            {
+                negative = true;
+                break;
+            }
+        }
+
+        if (!negative)
+        {
+            break;
+        }
+
+        // Reject the leap, and retry with the half size.
+        // Critical reactions no longer fire within it.
+        tau *= 0.5;
+        critical = boost::none;
+    }
+
+    for (std::size_t i(0); i < species_.size(); ++i)
+    {
+        if (delta[i] != 0)
+        {
+            change_molecules(i, delta[i]);
+        }
+    }
+
+    this->set_t(tau == tnext - t0 ? tnext : t0 + tau);
+
+    for (std::size_t j(0); j < channels_.size(); ++j)
+    {
+        if (num_firings[j] > 0)
+        {
+            last_reactions_.push_back(
+                std::make_pair(events_[j].reaction_rule(), num_firings[j]));
+        }
+    }
+}
+
+void TauLeapingSimulator::step(void)
+{
+    last_reactions_.clear();
+
+    if (dt_ == std::numeric_limits<Real>::infinity())
+    {
+        // No reaction occurs.
+        return;
+    }
+
+    if (leaping_)
+    {
+        leap(t() + dt_, next_event_);
+    }
+    else
+    {
+        fire_exact_event();
+        if (num_exact_steps_ > 0)
+        {
+            --num_exact_steps_;
+        }
+    }
+
+    num_steps_++;
+    draw_next_step();
+}
+
+bool TauLeapingSimulator::step(const Real &upto)
+{
+    if (upto <= t())
+    {
+        return false;
+    }
+
+    if (upto >= next_time())
+    {
+        step();
+        return true;
+    }
+
+    last_reactions_.clear();
+
+    if (!leaping_)
+    {
+        // No reaction occurs.
+        set_t(upto);
+        draw_next_step();
+        return false;
+    }
+
+    // Leap until the given time without any critical reaction.
+    leap(upto, boost::none);
+    num_steps_++;
+    draw_next_step();
+    return (t() < upto);
+}
+
+void TauLeapingSimulator::initialize(void)
+{
+    if (!model_->is_static())
+    {
+        throw NotSupported(
+            "TauLeapingSimulator only supports a static model. Expand the model first.");
+    }
+
+    const Model::reaction_rule_container_type&
+        reaction_rules(model_->reaction_rules());
+
+    check_reaction_rules(reaction_rules);
+
+    events_.clear();
+    channels_.clear();
+    dependencies_.clear();
+    species_.clear();
+    species_index_.clear();
+    num_molecules_.clear();
+
+    for (Model::reaction_rule_container_type::const_iterator
+        i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
+    {
+        const ReactionRule& rr(*i);
+
+        events_.push_back(create_reaction_rule_event(this, rr));
+        events_.back().initialize();
+
+        // Merge the stoichiometry by species.
+        ReactionChannel channel;
+        channel.order = 0;
+        const stoichiometry_type changes(stoichiometry(rr));
+        for (stoichiometry_type::const_iterator it(changes.begin());
+            it != changes.end(); ++it)
+        {
+            const std::size_t idx(species_index((*it).first));
+            std::vector<std::pair<std::size_t, Integer> >::iterator
+                it2(channel.changes.begin());
+            for (; it2 != channel.changes.end(); ++it2)
+            {
+                if ((*it2).first == idx)
+                {
+                    (*it2).second += (*it).second;
+                    break;
+                }
+            }
+            if (it2 == channel.changes.end())
+            {
+                channel.changes.push_back(std::make_pair(idx, (*it).second));
+            }
+
+            if ((*it).second >= 0)
+            {
+                continue;
+            }
+
+            // the reactants come first with negative changes.
+            channel.order += -(*it).second;
+            for (it2 = channel.reactants.begin(); it2 != channel.reactants.end(); ++it2)
+            {
+                if ((*it2).first == idx)
+                {
+                    (*it2).second += -(*it).second;
+                    break;
+                }
+            }
+            if (it2 == channel.reactants.end())
+            {
+                channel.reactants.push_back(std::make_pair(idx, -(*it).second));
+            }
+        }
+        channels_.push_back(channel);
+    }
+
+    const std::vector<Species> species(world_->list_species());
+    for (std::vector<Species>::const_iterator i(species.begin());
+        i != species.end(); ++i)
+    {
+        const Integer num(world_->num_molecules_exact(*i));
+        const dependency_container_type& deps(dependencies_.get(*i, events_));
+        for (dependency_container_type::const_iterator j(deps.begin());
+            j != deps.end(); ++j)
+        {
+            events_[(*j).first].inc((*j).second, num);
+        }
+    }
+
+    // Species not yet in the world must be registered to events as well.
+    for (std::vector<Species>::const_iterator i(species_.begin());
+        i != species_.end(); ++i)
+    {
+        dependencies_.get(*i, events_);
+    }
+
+    propensities_.assign(events_.size(), 0.0);
+    critical_.assign(events_.size(), false);
+    num_exact_steps_ = 0;
+    last_reactions_.clear();
+
+    draw_next_step();
+}
+
+Real TauLeapingSimulator::dt(void) const
+{
+    return dt_;
+}
+
+} // gillespie
+
+} // ecell4
@@ -0,0 +1,183 @@
+#ifndef ECELL4_GILLESPIE_TAU_LEAPING_SIMULATOR_HPP
+#define ECELL4_GILLESPIE_TAU_LEAPING_SIMULATOR_HPP
+
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/optional.hpp>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/SimulatorBase.hpp>
+
+#include "GillespieWorld.hpp"
+#include "ReactionRuleEvent.hpp"
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+/**
+ * The explicit tau-leaping method with the step size selection by
+ * Cao, Gillespie and Petzold (J. Chem. Phys. 124, 044109, 2006).
+ * Reactions which could exhaust their reactants within a few firings are
+ * handled as critical, and fire at most once in a leap.
+ * When a leap is not much longer than an exact step, it switches to
+ * the direct method for a while.
+ * Only a static model like NetworkModel is supported.
+ */
+class TauLeapingSimulator
+    : public SimulatorBase<GillespieWorld>
+{
+public:
+
+    typedef SimulatorBase<GillespieWorld> base_type;
+
+    /**
+     * a reaction rule paired with the number of times it fired.
+     */
+    typedef std::pair<ReactionRule, Integer> reaction_info_type;
+
+protected:
+
+    typedef ReactionRuleEventDependencyGraph::dependency_container_type
+        dependency_container_type;
+
+    /**
+     * the stoichiometry of a reaction rule event in species indices.
+     * changes: net changes in the number of molecules.
+     * reactants: coefficients of reactants.
+     * order: the sum of coefficients of reactants.
+     */
+    struct ReactionChannel
+    {
+        std::vector<std::pair<std::size_t, Integer> > changes;
+        std::vector<std::pair<std::size_t, Integer> > reactants;
+        Integer order;
+    };
+
+public:
+
+    TauLeapingSimulator(
+        std::shared_ptr<GillespieWorld> world,
+        std::shared_ptr<Model> model,
+        const Real epsilon = default_epsilon(),
+        const Integer critical_threshold = default_critical_threshold())
+        : base_type(world, model),
+          epsilon_(epsilon), critical_threshold_(critical_threshold)
+    {
+        initialize();
+    }
+
+    TauLeapingSimulator(
+        std::shared_ptr<GillespieWorld> world,
+        const Real epsilon = default_epsilon(),
+        const Integer critical_threshold = default_critical_threshold())
+        : base_type(world),
+          epsilon_(epsilon), critical_threshold_(critical_threshold)
+    {
+        initialize();
+    }
+
+    static inline const Real default_epsilon()
+    {
+        return 0.03;
+    }
+
+    static inline const Integer default_critical_threshold()
+    {
+        return 10;
+    }
+
+    // SimulatorTraits
+    Real dt(void) const;
+
+    void step(void);
+    bool step(const Real& upto);
+
+    // Optional members
+
+    virtual bool check_reaction() const
+    {
+        return last_reactions_.size() > 0;
+    }
+
+    /**
+     * return reaction rules fired in the last step,
+     * each of which is paired with the number of firings.
+     */
+    std::vector<reaction_info_type> last_reactions() const
+    {
+        return last_reactions_;
+    }
+
+    /**
+     * return true if the next step is a leap, or false if it is exact.
+     */
+    bool is_leaping() const
+    {
+        return leaping_;
+    }
+
+    Real epsilon() const
+    {
+        return epsilon_;
+    }
+
+    Integer critical_threshold() const
+    {
+        return critical_threshold_;
+    }
+
+    /**
+     * recalculate reaction propensities and draw the next step.
+     */
+    void initialize();
+
+    inline std::shared_ptr<RandomNumberGenerator> rng()
+    {
+        return (*world_).rng();
+    }
+
+protected:
+
+    std::size_t species_index(const Species& sp);
+    Real draw_leap_size() const;
+    void draw_exact_event(const Real atot);
+    void draw_next_step(void);
+    void fire_exact_event(void);
+    void leap(const Real tnext, boost::optional<std::size_t> critical);
+    void change_molecules(const std::size_t i, const Integer val);
+
+protected:
+
+    Real epsilon_;
+    Integer critical_threshold_;
+
+    Real dt_;
+    bool leaping_;
+    Integer num_exact_steps_;
+    boost::optional<std::size_t> next_event_;
+    std::vector<reaction_info_type> last_reactions_;
+
+    boost::ptr_vector<ReactionRuleEvent> events_;
+    ReactionRuleEventDependencyGraph dependencies_;
+    std::vector<ReactionChannel> channels_;
+
+    std::vector<Species> species_;
+    std::unordered_map<Species, std::size_t> species_index_;
+    std::vector<Integer> num_molecules_;
+
+    std::vector<Real> propensities_;
+    std::vector<bool> critical_;
+};
+
+} // gillespie
+
+} // ecell4
+
+#endif /* ECELL4_GILLESPIE_TAU_LEAPING_SIMULATOR_HPP */
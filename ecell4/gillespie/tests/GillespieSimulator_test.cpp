@@ -10,9 +10,18 @@
 #include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/core/EnsembleRunner.hpp>
+#include <ecell4/core/ReactionRuleDescriptor.hpp>
 
 #include <ecell4/gillespie/GillespieWorld.cpp>
 #include <ecell4/gillespie/GillespieSimulator.hpp>
+#include <ecell4/gillespie/GillespieFactory.hpp>
+
+#ifndef WIN32_MSC
+#include <cstdlib>
+#include <unistd.h>
+#include <dirent.h>
+#endif
 
 using namespace ecell4;
 using namespace ecell4::gillespie;
@@ -47,3 +56,200 @@ BOOST_AUTO_TEST_CASE(GillespieSimulator_test_step)
     BOOST_CHECK(world->num_molecules(sp1) == 9);
 
 }
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_logarithmic_direct_method)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A"), sp2("B"), sp3("C");
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 2.0));
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 1.0));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 3.0));
+    model->add_reaction_rule(create_degradation_reaction_rule(sp2, 1.0));
+    model->add_reaction_rule(create_synthesis_reaction_rule(sp1, 5.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng1(new GSLRandomNumberGenerator(0));
+    std::shared_ptr<GillespieWorld> world1(new GillespieWorld(edge_lengths, rng1));
+    std::shared_ptr<RandomNumberGenerator> rng2(new GSLRandomNumberGenerator(0));
+    std::shared_ptr<GillespieWorld> world2(new GillespieWorld(edge_lengths, rng2));
+
+    world1->add_molecules(sp1, 30);
+    world1->add_molecules(sp3, 10);
+    world2->add_molecules(sp1, 30);
+    world2->add_molecules(sp3, 10);
+
+    GillespieSimulator sim1(world1, model, DIRECT_METHOD);
+    GillespieSimulator sim2(world2, model, LOGARITHMIC_DIRECT_METHOD);
+    BOOST_CHECK_EQUAL(sim2.solver_type(), LOGARITHMIC_DIRECT_METHOD);
+
+    // with integral propensities, both select the same reaction
+    // for the same random numbers.
+    for (unsigned int i(0); i < 1000; ++i)
+    {
+        sim1.step();
+        sim2.step();
+        BOOST_CHECK_EQUAL(sim1.t(), sim2.t());
+    }
+
+    BOOST_CHECK_EQUAL(world1->num_molecules(sp1), world2->num_molecules(sp1));
+    BOOST_CHECK_EQUAL(world1->num_molecules(sp2), world2->num_molecules(sp2));
+    BOOST_CHECK_EQUAL(world1->num_molecules(sp3), world2->num_molecules(sp3));
+}
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_new_species)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A"), sp2("B"), sp3("C");
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp2, sp3, 1.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    // B and C are not in the world until the first reactions occur.
+    world->add_molecules(sp1, 10);
+
+    GillespieSimulator sim(world, model);
+    for (unsigned int i(0); i < 20; ++i)
+    {
+        sim.step();
+    }
+
+    BOOST_CHECK_EQUAL(sim.dt(), std::numeric_limits<Real>::infinity());
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp3), 10);
+}
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_ensemble)
+{
+    Species sp1("A"), sp2("B");
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+
+    const GillespieFactory factory;
+    std::shared_ptr<GillespieWorld> world(factory.world(Real3(1.0, 1.0, 1.0)));
+    world->add_molecules(sp1, 100);
+
+    std::vector<std::string> targets;
+    targets.push_back("A");
+    targets.push_back("B");
+
+    const Integer num_replicates(200);
+    const EnsembleStatistics stats1(
+        EnsembleRunner<GillespieFactory>(factory, world, model, 1).run(
+            num_replicates, 1.0, 0.5, targets, 12345));
+    const EnsembleStatistics stats2(
+        EnsembleRunner<GillespieFactory>(factory, world, model, 3).run(
+            num_replicates, 1.0, 0.5, targets, 12345));
+
+    BOOST_CHECK_EQUAL(stats1.num_samples(), num_replicates);
+    BOOST_CHECK_EQUAL(stats1.times().size(), 3);
+    BOOST_CHECK(stats1.mean() == stats2.mean());
+    BOOST_CHECK(stats1.variance() == stats2.variance());
+    BOOST_CHECK(stats1.quantile(0.9) == stats2.quantile(0.9));
+
+    // The number of A follows the binomial distribution B(100, exp(-t)).
+    const EnsembleStatistics::data_container_type mean(stats1.mean());
+    const EnsembleStatistics::data_container_type variance(stats1.variance());
+    const Real p(std::exp(-1.0));
+    BOOST_CHECK_EQUAL(mean[0][1], 100.0);
+    BOOST_CHECK_CLOSE(mean[2][1], 100.0 * p, 3.0);
+    BOOST_CHECK_CLOSE(mean[2][1] + mean[2][2], 100.0, 1e-10);
+    BOOST_CHECK_CLOSE(variance[2][1], 100.0 * p * (1.0 - p), 30.0);
+
+    // The template world is left unchanged.
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 100);
+    BOOST_CHECK_EQUAL(world->t(), 0.0);
+}
+
+static Real throwing_propensity(
+    const ReactionRuleDescriptor::state_container_type& r,
+    const ReactionRuleDescriptor::state_container_type& p,
+    Real volume, Real t, const ReactionRuleDescriptorCPPfunc& rd)
+{
+    throw IllegalState("This is a test.");
+}
+
+#ifndef WIN32_MSC
+static Integer count_files(const std::string& dirname)
+{
+    DIR* dir(opendir(dirname.c_str()));
+    Integer num(0);
+    while (const struct dirent* entry = readdir(dir))
+    {
+        const std::string name(entry->d_name);
+        if (name != "." && name != "..")
+        {
+            ++num;
+        }
+    }
+    closedir(dir);
+    return num;
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_ensemble_threads)
+{
+#ifndef WIN32_MSC
+    // Temporary files are created in TMPDIR
+    char tmpdir[] = "/tmp/ecell4-test-XXXXXX";
+    BOOST_REQUIRE(mkdtemp(tmpdir) != NULL);
+    setenv("TMPDIR", tmpdir, 1);
+#endif
+
+    Species sp1("A"), sp2("B"), sp3("C");
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 0.05));
+
+    const GillespieFactory factory;
+    std::shared_ptr<GillespieWorld> world(factory.world(Real3(1.0, 1.0, 1.0)));
+    world->add_molecules(sp1, 50);
+
+    // With a few replicates, the statistics below pin down every trajectory
+    // at each time, so the results are identical whatever the number of threads.
+    const Integer num_replicates(5);
+    const EnsembleStatistics stats1(
+        EnsembleRunner<GillespieFactory>(factory, world, model, 1).run(
+            num_replicates, 2.0, 0.25, std::vector<std::string>(), 777));
+    for (Integer num_threads(2); num_threads <= 6; num_threads += 2)
+    {
+        const EnsembleStatistics stats2(
+            EnsembleRunner<GillespieFactory>(factory, world, model, num_threads).run(
+                num_replicates, 2.0, 0.25, std::vector<std::string>(), 777));
+        BOOST_CHECK_EQUAL(stats2.num_samples(), num_replicates);
+        for (Integer i(0); i < num_replicates; ++i)
+        {
+            const Real q(static_cast<Real>(i) / (num_replicates - 1));
+            BOOST_CHECK(stats1.quantile(q) == stats2.quantile(q));
+        }
+    }
+
+    // Another seed gives other trajectories.
+    const EnsembleStatistics stats3(
+        EnsembleRunner<GillespieFactory>(factory, world, model, 2).run(
+            num_replicates, 2.0, 0.25, std::vector<std::string>(), 778));
+    BOOST_CHECK(stats1.mean() != stats3.mean());
+
+    // An exception in a replicate is rethrown.
+    ReactionRule rr;
+    rr.add_reactant(sp3);
+    rr.add_product(sp1);
+    rr.set_descriptor(std::shared_ptr<ReactionRuleDescriptor>(
+        new ReactionRuleDescriptorCPPfunc(
+            &throwing_propensity, std::vector<Real>(1, 1.0), std::vector<Real>(1, 1.0))));
+    model->add_reaction_rule(rr);
+    BOOST_CHECK_THROW(
+        EnsembleRunner<GillespieFactory>(factory, world, model, 2).run(
+            num_replicates, 2.0, 0.25, std::vector<std::string>(), 777),
+        IllegalState);
+
+#ifndef WIN32_MSC
+    // No temporary file is left.
+    BOOST_CHECK_EQUAL(count_files(tmpdir), 0);
+    unsetenv("TMPDIR");
+    rmdir(tmpdir);
+#endif
+}
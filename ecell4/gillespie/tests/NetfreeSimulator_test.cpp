@@ -0,0 +1,140 @@
+#define BOOST_TEST_MODULE "NetfreeSimulator_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/tools/floating_point_comparison.hpp>
+
+#include <ecell4/core/RandomNumberGenerator.hpp>
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/core/NetfreeModel.hpp>
+
+#include <ecell4/gillespie/NetfreeSimulator.hpp>
+
+using namespace ecell4;
+using namespace ecell4::gillespie;
+
+BOOST_AUTO_TEST_CASE(NetfreeSimulator_test_step)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A");
+    Species sp2("B");
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 5.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    world->add_molecules(sp1, 10);
+    world->add_molecules(sp2, 10);
+
+    NetfreeSimulator sim(world, model);
+
+    sim.set_t(0.0);
+    sim.step();
+
+    BOOST_CHECK(0 < sim.t());
+    BOOST_CHECK(sim.check_reaction());
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 9);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 11);
+
+    sim.run(100.0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 20);
+    BOOST_CHECK_EQUAL(sim.dt(), std::numeric_limits<Real>::infinity());
+}
+
+BOOST_AUTO_TEST_CASE(NetfreeSimulator_test_polymerization)
+{
+    // The network of this model is infinite.
+    std::shared_ptr<NetfreeModel> model(new NetfreeModel());
+    model->add_reaction_rule(
+        create_binding_reaction_rule(
+            Species("A(r)"), Species("A(l)"), Species("A(r^1).A(l^1)"), 1.0));
+    model->add_reaction_rule(
+        create_unbinding_reaction_rule(
+            Species("A(r^1).A(l^1)"), Species("A(r)"), Species("A(l)"), 1.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+    std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+    world->add_molecules(Species("A(l, r)"), 100);
+
+    NetfreeSimulator sim(world, model);
+    BOOST_CHECK_EQUAL(sim.num_complexes(), 1);
+    BOOST_CHECK(world->has_species(format_species(Species("A(l, r)"))));
+
+    for (Integer i(0); i < 200; ++i)
+    {
+        sim.step();
+        BOOST_CHECK(sim.check_reaction());
+
+        // Units are conserved.
+        BOOST_CHECK_EQUAL(world->num_molecules(Species("A")), 100);
+        // The number of free right sites equals that of free left ones.
+        BOOST_CHECK_EQUAL(
+            world->num_molecules(Species("A(r)")), world->num_molecules(Species("A(l)")));
+    }
+    BOOST_CHECK(sim.num_complexes() > 2);
+}
+
+BOOST_AUTO_TEST_CASE(NetfreeSimulator_test_mean)
+{
+    std::shared_ptr<NetfreeModel> model(new NetfreeModel());
+    model->add_reaction_rule(
+        create_unimolecular_reaction_rule(Species("A(s=u)"), Species("A(s=p)"), 1.0));
+    model->add_reaction_rule(
+        create_binding_reaction_rule(Species("B(b)"), Species("B(b)"), Species("B(b^1).B(b^1)"), 0.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+
+    // A(s=u) decays with the mean 100 * exp(-t).
+    const Integer num_trials(200);
+    Real mean(0.0);
+    for (Integer i(0); i < num_trials; ++i)
+    {
+        std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+        world->add_molecules(Species("A(s=u)"), 100);
+        world->add_molecules(Species("B(b)"), 10);
+        NetfreeSimulator sim(world, model);
+        sim.run(1.0);
+        BOOST_CHECK_EQUAL(world->num_molecules(Species("B(b)")), 10);
+        mean += world->num_molecules(Species("A(s=u)"));
+    }
+    mean /= num_trials;
+
+    BOOST_CHECK_CLOSE(mean, 100.0 * exp(-1.0), 5.0);
+}
+
+BOOST_AUTO_TEST_CASE(NetfreeSimulator_test_self_binding)
+{
+    // The dimerization of two copies of a complex: A(b) + A(b) > A(b^1).A(b^1)
+    std::shared_ptr<NetfreeModel> model(new NetfreeModel());
+    model->add_reaction_rule(
+        create_binding_reaction_rule(Species("A(b)"), Species("A(b)"), Species("A(b^1).A(b^1)"), 1.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+    world->add_molecules(Species("A(b)"), 1);
+
+    // A single copy never reacts with itself.
+    {
+        NetfreeSimulator sim(world, model);
+        BOOST_CHECK_EQUAL(sim.dt(), std::numeric_limits<Real>::infinity());
+    }
+
+    world->add_molecules(Species("A(b)"), 1);
+    NetfreeSimulator sim(world, model);
+    sim.step();
+    BOOST_CHECK(sim.check_reaction());
+    BOOST_CHECK_EQUAL(world->num_molecules_exact(Species("A(b)")), 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(Species("A.A")), 1);
+    BOOST_CHECK_EQUAL(sim.dt(), std::numeric_limits<Real>::infinity());
+}
@@ -0,0 +1,111 @@
+#define BOOST_TEST_MODULE "NextReactionSimulator_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/tools/floating_point_comparison.hpp>
+
+#include <ecell4/core/RandomNumberGenerator.hpp>
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+
+#include <ecell4/gillespie/NextReactionSimulator.hpp>
+
+using namespace ecell4;
+using namespace ecell4::gillespie;
+
+BOOST_AUTO_TEST_CASE(NextReactionSimulator_test_step)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A");
+    Species sp2("B");
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 5.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    world->add_molecules(sp1, 10);
+    world->add_molecules(sp2, 10);
+
+    NextReactionSimulator sim(world, model);
+
+    sim.set_t(0.0);
+    sim.step();
+
+    BOOST_CHECK(0 < sim.t());
+    BOOST_CHECK(sim.check_reaction());
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 9);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 11);
+
+    sim.run(100.0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 20);
+    BOOST_CHECK_EQUAL(sim.dt(), std::numeric_limits<Real>::infinity());
+}
+
+BOOST_AUTO_TEST_CASE(NextReactionSimulator_test_set_t)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A"), sp2("B");
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+    world->add_molecules(sp1, 100);
+
+    NextReactionSimulator sim(world, model);
+    const Real dt(sim.dt());
+
+    // Putative times move together with the current time
+    sim.set_t(1000.0);
+    BOOST_CHECK_EQUAL(sim.t(), 1000.0);
+    BOOST_CHECK_CLOSE(sim.dt(), dt, 1e-6);
+    BOOST_CHECK(sim.next_time() > sim.t());
+
+    Real t(sim.t());
+    for (Integer i(0); i < 10; ++i)
+    {
+        sim.step();
+        BOOST_CHECK(sim.t() > t);
+        t = sim.t();
+    }
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 90);
+
+    sim.set_t(0.0);
+    BOOST_CHECK(sim.next_time() > sim.t());
+    BOOST_CHECK(sim.next_time() < 1000.0);
+}
+
+BOOST_AUTO_TEST_CASE(NextReactionSimulator_test_mean)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A"), sp2("B"), sp3("C");
+    model->add_reaction_rule(create_degradation_reaction_rule(sp1, 1.0));
+    model->add_reaction_rule(create_binding_reaction_rule(sp2, sp2, sp3, 0.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+
+    // A decays with the mean 100 * exp(-t).
+    const Integer num_trials(200);
+    Real mean(0.0);
+    for (Integer i(0); i < num_trials; ++i)
+    {
+        std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+        world->add_molecules(sp1, 100);
+        world->add_molecules(sp2, 10);
+        NextReactionSimulator sim(world, model);
+        sim.run(1.0);
+        BOOST_CHECK_EQUAL(world->num_molecules(sp2), 10);
+        mean += world->num_molecules(sp1);
+    }
+    mean /= num_trials;
+
+    BOOST_CHECK_CLOSE(mean, 100.0 * exp(-1.0), 5.0);
+}
@@ -0,0 +1,95 @@
+#define BOOST_TEST_MODULE "TauLeapingSimulator_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/tools/floating_point_comparison.hpp>
+
+#include <ecell4/core/RandomNumberGenerator.hpp>
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/core/NetfreeModel.hpp>
+
+#include <ecell4/gillespie/TauLeapingSimulator.hpp>
+
+using namespace ecell4;
+using namespace ecell4::gillespie;
+
+BOOST_AUTO_TEST_CASE(TauLeapingSimulator_test_leap)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A"), sp2("B"), sp3("C");
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp2, sp3, 1.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+    std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    const Integer num(1000000);
+    world->add_molecules(sp1, num);
+    world->add_molecules(sp2, num);
+
+    TauLeapingSimulator sim(world, model);
+    BOOST_CHECK(sim.is_leaping());
+
+    sim.step();
+    BOOST_CHECK(sim.t() > 0);
+    BOOST_CHECK(sim.check_reaction());
+
+    // the aggregated numbers of firings
+    const std::vector<std::pair<ReactionRule, Integer> > reactions(sim.last_reactions());
+    BOOST_CHECK_EQUAL(reactions.size(), 2);
+    BOOST_CHECK(reactions[0].first == model->reaction_rules()[0]);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), num - reactions[0].second);
+
+    sim.run(1.0 - sim.t());
+    BOOST_CHECK_EQUAL(sim.t(), 1.0);
+    BOOST_CHECK(sim.num_steps() < 1000);
+    // the explicit leap has a bias of the order of epsilon.
+    BOOST_CHECK_CLOSE(static_cast<Real>(world->num_molecules(sp1)), num * exp(-1.0), 3.0);
+    BOOST_CHECK_EQUAL(
+        world->num_molecules(sp1) + world->num_molecules(sp2) + world->num_molecules(sp3),
+        2 * num);
+}
+
+BOOST_AUTO_TEST_CASE(TauLeapingSimulator_test_exact)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A"), sp2("B");
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+    std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+    world->add_molecules(sp1, 5);
+
+    // a small population never becomes negative.
+    TauLeapingSimulator sim(world, model);
+    BOOST_CHECK(!sim.is_leaping());
+
+    sim.step();
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 4);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 1);
+
+    sim.run(100.0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 5);
+    BOOST_CHECK_EQUAL(sim.dt(), std::numeric_limits<Real>::infinity());
+}
+
+BOOST_AUTO_TEST_CASE(TauLeapingSimulator_test_netfree_model)
+{
+    std::shared_ptr<NetfreeModel> model(new NetfreeModel());
+    model->add_reaction_rule(
+        create_unimolecular_reaction_rule(Species("A"), Species("B"), 1.0));
+
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    std::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths));
+
+    BOOST_CHECK_THROW(TauLeapingSimulator(world, model), NotSupported);
+}
@@ -29,8 +29,11 @@ public:
 
     MesoscopicFactory(
         const Integer3& matrix_sizes = default_matrix_sizes(),
-        const Real subvolume_length = default_subvolume_length())
-        : base_type(), rng_(), matrix_sizes_(matrix_sizes), subvolume_length_(subvolume_length)
+        const Real subvolume_length = default_subvolume_length(),
+        const Integer num_threads = default_num_threads(),
+        const Real sync_interval = default_sync_interval())
+        : base_type(), rng_(), matrix_sizes_(matrix_sizes), subvolume_length_(subvolume_length),
+          num_threads_(num_threads), sync_interval_(sync_interval)
     {
         ; // do nothing
     }
@@ -50,6 +53,16 @@ public:
         return 0.0;
     }
 
+    static inline const Integer default_num_threads()
+    {
+        return simulator_type::default_num_threads();
+    }
+
+    static inline const Real default_sync_interval()
+    {
+        return simulator_type::default_sync_interval();
+    }
+
     this_type& rng(const std::shared_ptr<RandomNumberGenerator>& rng)
     {
         rng_ = rng;
@@ -92,11 +105,19 @@ protected:
         return new world_type(edge_lengths);
     }
 
+    virtual simulator_type* create_simulator(
+        const std::shared_ptr<world_type>& w, const std::shared_ptr<Model>& m) const
+    {
+        return new simulator_type(w, m, num_threads_, sync_interval_);
+    }
+
 protected:
 
     std::shared_ptr<RandomNumberGenerator> rng_;
     Integer3 matrix_sizes_;
     Real subvolume_length_;
+    Integer num_threads_;
+    Real sync_interval_;
 };
 
 } // meso
@@ -1,5 +1,10 @@
 #include <numeric>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <exception>
+#include <limits>
 #include <gsl/gsl_sf_log.h>
 
 #include <cstring>
@@ -16,52 +21,55 @@ namespace ecell4
 namespace meso
 {
 
-void MesoscopicSimulator::increment(const std::shared_ptr<MesoscopicWorld::PoolBase>& pool, const coordinate_type& c)
+void MesoscopicSimulator::increment(const std::size_t idx, const coordinate_type& c)
 {
-    pool->add_molecules(1, c);
-
-    for (boost::ptr_vector<ReactionRuleProxyBase>::iterator i(proxies_.begin());
-        i != proxies_.end(); ++i)
-    {
-        (*i).inc(pool->species(), c);
-    }
+    DiffusionProxy& proxy(static_cast<DiffusionProxy&>(proxies_[idx]));
+    proxy.pool()->add_molecules(1, c);
+    proxy.update_dependencies(c, +1);
 }
 
-void MesoscopicSimulator::decrement(const std::shared_ptr<MesoscopicWorld::PoolBase>& pool, const coordinate_type& c)
+void MesoscopicSimulator::decrement(const std::size_t idx, const coordinate_type& c)
 {
-    pool->remove_molecules(1, c);
-
-    for (boost::ptr_vector<ReactionRuleProxyBase>::iterator i(proxies_.begin());
-        i != proxies_.end(); ++i)
-    {
-        (*i).dec(pool->species(), c);
-    }
+    DiffusionProxy& proxy(static_cast<DiffusionProxy&>(proxies_[idx]));
+    proxy.pool()->remove_molecules(1, c);
+    proxy.update_dependencies(c, -1);
 }
 
 void MesoscopicSimulator::increment_molecules(const Species& sp, const coordinate_type& c)
 {
-    if (!world_->has_species(sp))
+    std::unordered_map<Species, std::size_t>::const_iterator
+        it(diffusion_proxies_.find(sp));
+    if (it == diffusion_proxies_.end())
     {
         if (world_->has_structure(sp))
         {
             return; // do nothing
         }
+        else if (blocks_.size() > 0)
+        {
+            throw IllegalState(
+                "A new species cannot be added while running blocks in parallel.");
+        }
 
-        const std::shared_ptr<MesoscopicWorld::PoolBase> pool = world_->reserve_pool(sp);
-        proxies_.push_back(create_diffusion_proxy(sp));
-        increment(pool, c);
+        if (!world_->has_species(sp))
+        {
+            world_->reserve_pool(sp);
+        }
+        increment(add_diffusion_proxy(sp), c);
     }
     else
     {
-        increment(world_->get_pool(sp), c);
+        increment((*it).second, c);
     }
 }
 
 void MesoscopicSimulator::decrement_molecules(const Species& sp, const coordinate_type& c)
 {
-    if (world_->has_species(sp))
+    std::unordered_map<Species, std::size_t>::const_iterator
+        it(diffusion_proxies_.find(sp));
+    if (it != diffusion_proxies_.end())
     {
-        decrement(world_->get_pool(sp), c);
+        decrement((*it).second, c);
     }
     else
     {
@@ -69,17 +77,51 @@ void MesoscopicSimulator::decrement_molecules(const Species& sp, const coordinat
     }
 }
 
+Real MesoscopicSimulator::update_group(const std::size_t g, const coordinate_type& c)
+{
+    const std::size_t idx(g * num_subvolumes_ + c);
+    if (dirty_groups_[idx])
+    {
+        const std::size_t last(std::min((g + 1) * group_size_, proxies_.size()));
+        Real a(0.0);
+        for (std::size_t i(g * group_size_); i < last; ++i)
+        {
+            a += proxies_[i].propensity(c);
+        }
+        group_sums_[idx] = a;
+        dirty_groups_[idx] = false;
+    }
+    return group_sums_[idx];
+}
+
+void MesoscopicSimulator::resize_groups(void)
+{
+    const std::size_t num_groups((proxies_.size() + group_size_ - 1) / group_size_);
+    if (group_sums_.size() < num_groups * num_subvolumes_)
+    {
+        group_sums_.resize(num_groups * num_subvolumes_, 0.0);
+        dirty_groups_.resize(num_groups * num_subvolumes_, true);
+    }
+}
+
 std::pair<Real, MesoscopicSimulator::ReactionRuleProxyBase*>
 MesoscopicSimulator::draw_next_reaction(const coordinate_type& c)
 {
     constexpr Real inf = std::numeric_limits<Real>::infinity();
-    std::vector<double> a(proxies_.size());
-    for (unsigned int idx(0); idx < proxies_.size(); ++idx)
+
+    for (std::vector<std::size_t>::const_iterator i(time_dependent_proxies_.begin());
+        i != time_dependent_proxies_.end(); ++i)
+    {
+        invalidate(*i, c);
+    }
+
+    const std::size_t num_groups(group_sums_.size() / num_subvolumes_);
+    double atot(0.0);
+    for (std::size_t g(0); g < num_groups; ++g)
     {
-        a[idx] = proxies_[idx].propensity(c);
+        atot += update_group(g, c);
     }
 
-    const double atot(std::accumulate(a.begin(), a.end(), double(0.0)));
     if (atot == 0.0)
     {
         return std::make_pair(inf, (ReactionRuleProxyBase*)NULL);
@@ -88,32 +130,63 @@ MesoscopicSimulator::draw_next_reaction(const coordinate_type& c)
     if (atot == inf)
     {
         std::vector<unsigned int> selected;
-        for (unsigned int i(0); i < a.size(); ++i)
+        for (unsigned int i(0); i < proxies_.size(); ++i)
         {
-            if (a[i] == inf)
+            if (proxies_[i].propensity(c) == inf)
             {
                 selected.push_back(i);
             }
         }
 
-        const unsigned int idx = selected[(selected.size() == 1 ? 0 : rng()->uniform_int(0, selected.size() - 1))];
+        const unsigned int idx = selected[(selected.size() == 1 ? 0 : subvolume_rng(c)->uniform_int(0, selected.size() - 1))];
         return std::make_pair(0.0, &proxies_[idx]);
     }
 
-    const double rnd1(rng()->uniform(0, 1));
+    const std::shared_ptr<RandomNumberGenerator>& rng(subvolume_rng(c));
+    const double rnd1(rng->uniform(0, 1));
     const double dt(gsl_sf_log(1.0 / rnd1) / double(atot));
-    const double rnd2(rng()->uniform(0, atot));
+    const double rnd2(rng->uniform(0, atot));
 
-    int u(-1);
+    // Find a group first, and then a proxy in it.
+    // Rounding errors are absorbed by the last non-zero candidate.
+    std::size_t g(0), selected_group(num_groups);
     double acc(0.0);
-    const int len_a(a.size());
-    do
+    for (; g < num_groups; ++g)
     {
-        u++;
-        acc += a[u];
-    } while (acc < rnd2 && u < len_a - 1);
+        const Real a(group_sums_[g * num_subvolumes_ + c]);
+        if (a > 0.0)
+        {
+            selected_group = g;
+            if (acc + a >= rnd2)
+            {
+                break;
+            }
+            acc += a;
+        }
+    }
 
-    if (len_a == u)
+    if (g == num_groups)
+    {
+        acc -= group_sums_[selected_group * num_subvolumes_ + c];
+    }
+
+    const std::size_t last(std::min((selected_group + 1) * group_size_, proxies_.size()));
+    std::size_t u(last);
+    for (std::size_t i(selected_group * group_size_); i < last; ++i)
+    {
+        const Real a(proxies_[i].propensity(c));
+        if (a > 0.0)
+        {
+            u = i;
+            acc += a;
+            if (acc >= rnd2)
+            {
+                break;
+            }
+        }
+    }
+
+    if (u == last)
     {
         return std::make_pair(inf, (ReactionRuleProxyBase*)NULL);
     }
@@ -140,6 +213,13 @@ void MesoscopicSimulator::step(void)
         return;
     }
 
+    if (blocks_.size() > 0)
+    {
+        advance_blocks(next_time());
+        num_steps_++;
+        return;
+    }
+
     interrupted_ = event_ids_.size();
     EventScheduler::value_type const& top(scheduler_.top());
     const Real tnext(top.second->time());
@@ -183,6 +263,12 @@ bool MesoscopicSimulator::step(const Real &upto)
         step();
         return true;
     }
+    else if (blocks_.size() > 0)
+    {
+        advance_blocks(upto);
+        num_steps_++;
+        return false;
+    }
     else
     {
         // nothing happens
@@ -194,18 +280,178 @@ bool MesoscopicSimulator::step(const Real &upto)
     }
 }
 
-MesoscopicSimulator::DiffusionProxy*
-MesoscopicSimulator::create_diffusion_proxy(const Species& sp)
+void MesoscopicSimulator::advance_block(Block& block, const Real upto)
+{
+    const coordinate_type none(static_cast<coordinate_type>(num_subvolumes_));
+    while (block.scheduler.next_time() <= upto)
+    {
+        block.interrupted = none;
+        EventScheduler::value_type const& top(block.scheduler.top());
+        const Real tnext(top.second->time());
+        top.second->fire();
+        block.scheduler.update(top);
+
+        if (block.interrupted != none)
+        {
+            EventScheduler::identifier_type evid(event_ids_[block.interrupted]);
+            std::shared_ptr<Event> ev(block.scheduler.get(evid));
+            ev->interrupt(tnext);
+            block.scheduler.update(std::make_pair(evid, ev));
+        }
+    }
+}
+
+void MesoscopicSimulator::advance_blocks(const Real upto)
+{
+    last_reactions_.clear();
+
+    // An exception in a block is rethrown after all threads are joined.
+    std::vector<std::exception_ptr> errors(blocks_.size());
+    const auto worker = [this, upto, &errors](const std::size_t i)
+    {
+        try
+        {
+            advance_block(blocks_[i], upto);
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i(1); i < blocks_.size(); ++i)
+    {
+        threads.push_back(std::thread(worker, i));
+    }
+    worker(0);
+    for (std::vector<std::thread>::iterator i(threads.begin()); i != threads.end(); ++i)
+    {
+        (*i).join();
+    }
+
+    for (std::vector<std::exception_ptr>::const_iterator i(errors.begin());
+        i != errors.end(); ++i)
+    {
+        if (*i)
+        {
+            std::rethrow_exception(*i);
+        }
+    }
+
+    // Apply diffusion across blocks in a fixed order to be reproducible.
+    std::vector<coordinate_type> interrupted;
+    for (std::vector<Block>::iterator i(blocks_.begin()); i != blocks_.end(); ++i)
+    {
+        for (std::vector<std::pair<std::size_t, coordinate_type> >::const_iterator
+            j((*i).outbox.begin()); j != (*i).outbox.end(); ++j)
+        {
+            increment((*j).first, (*j).second);
+            interrupted.push_back((*j).second);
+        }
+        (*i).outbox.clear();
+
+        last_reactions_.insert(
+            last_reactions_.end(), (*i).last_reactions.begin(), (*i).last_reactions.end());
+        (*i).last_reactions.clear();
+    }
+
+    std::sort(interrupted.begin(), interrupted.end());
+    interrupted.erase(
+        std::unique(interrupted.begin(), interrupted.end()), interrupted.end());
+    for (std::vector<coordinate_type>::const_iterator i(interrupted.begin());
+        i != interrupted.end(); ++i)
+    {
+        EventScheduler& scheduler(blocks_[block_index(*i)].scheduler);
+        EventScheduler::identifier_type evid(event_ids_[*i]);
+        std::shared_ptr<Event> ev(scheduler.get(evid));
+        ev->interrupt(upto);
+        scheduler.update(std::make_pair(evid, ev));
+    }
+
+    set_t(upto);
+}
+
+void MesoscopicSimulator::initialize_blocks(void)
 {
-    DiffusionProxy* proxy = new DiffusionProxy(this, sp);
+    blocks_.clear();
+    sync_interval_used_ = sync_interval_;
+
+    const std::size_t num_blocks(std::min(
+        static_cast<std::size_t>(std::max(num_threads_, Integer(1))), num_subvolumes_));
+    if (num_blocks <= 1)
+    {
+        return;
+    }
+
+    if (!model_->is_static())
+    {
+        throw NotSupported(
+            "Multiple threads are only available with a static model.");
+    }
+
+    // Pools for all products must be ready before running in parallel.
+    const Model::reaction_rule_container_type&
+        reaction_rules(model_->reaction_rules());
+    for (Model::reaction_rule_container_type::const_iterator
+        i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
+    {
+        const ReactionRule::product_container_type& products((*i).products());
+        for (ReactionRule::product_container_type::const_iterator
+            j(products.begin()); j != products.end(); ++j)
+        {
+            if (diffusion_proxies_.find(*j) == diffusion_proxies_.end()
+                && !world_->has_structure(*j))
+            {
+                if (!world_->has_species(*j))
+                {
+                    world_->reserve_pool(*j);
+                }
+                add_diffusion_proxy(*j);
+            }
+        }
+    }
+
+    if (sync_interval_used_ <= 0.0)
+    {
+        Real kmax(0.0);
+        for (std::size_t i(diffusion_proxy_offset_); i < proxies_.size(); ++i)
+        {
+            kmax = std::max(kmax, static_cast<DiffusionProxy&>(proxies_[i]).rate());
+        }
+        sync_interval_used_ = (kmax > 0.0 ? 1.0 / kmax : std::numeric_limits<Real>::infinity());
+    }
+
+    // Subvolumes are split into contiguous ranges, i.e. slabs of layers.
+    blocks_.resize(num_blocks);
+    for (std::size_t i(0); i < num_blocks; ++i)
+    {
+        // Seeds are drawn from the world to be reproducible.
+        blocks_[i].rng = std::shared_ptr<RandomNumberGenerator>(
+            new GSLRandomNumberGenerator(rng()->uniform_int(1, std::numeric_limits<int>::max())));
+    }
+}
+
+std::size_t MesoscopicSimulator::add_diffusion_proxy(const Species& sp)
+{
+    const std::size_t idx(proxies_.size());
+    DiffusionProxy* proxy = new DiffusionProxy(this, sp, idx);
     proxy->initialize();
     for (boost::ptr_vector<ReactionRuleProxyBase>::size_type i = 0;
          i < diffusion_proxy_offset_; ++i)
     {
         proxy->set_dependency(
-            dynamic_cast<ReactionRuleProxy*>(&proxies_[i]));
+            i, dynamic_cast<ReactionRuleProxy*>(&proxies_[i]));
+    }
+    proxies_.push_back(proxy);
+    diffusion_proxies_[sp] = idx;
+
+    resize_groups();
+    for (coordinate_type c(0); c < static_cast<coordinate_type>(num_subvolumes_); ++c)
+    {
+        invalidate(idx, c);
     }
-    return proxy;
+    return idx;
 }
 
 void MesoscopicSimulator::check_model(void)
@@ -265,6 +511,8 @@ void MesoscopicSimulator::initialize(void)
     check_model();
 
     proxies_.clear();
+    diffusion_proxies_.clear();
+    time_dependent_proxies_.clear();
     for (Model::reaction_rule_container_type::const_iterator
         i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
     {
@@ -272,6 +520,7 @@ void MesoscopicSimulator::initialize(void)
 
         if (rr.has_descriptor())
         {
+            time_dependent_proxies_.push_back(proxies_.size());
             proxies_.push_back(new DescriptorReactionRuleProxy(this, rr));
         }
         else if (rr.reactants().size() == 0)
@@ -307,7 +556,17 @@ void MesoscopicSimulator::initialize(void)
     diffusion_proxy_offset_ = proxies_.size();
 
     // const std::vector<Species>& species(model_->species_attributes());
-    const std::vector<Species>& species(world_->species());
+    const std::vector<Species> species(world_->species());
+
+    // Groups of about sqrt(N) proxies make both searches O(sqrt(N)).
+    num_subvolumes_ = static_cast<std::size_t>(world_->num_subvolumes());
+    group_size_ = std::max(static_cast<std::size_t>(
+        std::ceil(std::sqrt(static_cast<Real>(proxies_.size() + species.size())))),
+        static_cast<std::size_t>(1));
+    group_sums_.clear();
+    dirty_groups_.clear();
+    resize_groups();
+
     for (std::vector<Species>::const_iterator i(species.begin());
         i != species.end(); ++i)
     {
@@ -316,15 +575,20 @@ void MesoscopicSimulator::initialize(void)
             world_->reserve_pool(*i); //XXX: This must be deprecated.
         }
 
-        proxies_.push_back(create_diffusion_proxy(*i));
+        add_diffusion_proxy(*i);
     }
 
+    initialize_blocks();
+
     scheduler_.clear();
+    last_reactions_.clear();
     event_ids_.resize(world_->num_subvolumes());
     for (Integer i(0); i < world_->num_subvolumes(); ++i)
     {
+        EventScheduler& scheduler(
+            blocks_.size() == 0 ? scheduler_ : blocks_[block_index(i)].scheduler);
         event_ids_[i] =
-            scheduler_.add(std::shared_ptr<Event>(
+            scheduler.add(std::shared_ptr<Event>(
                 new SubvolumeEvent(this, i, t())));
     }
 }
@@ -336,7 +600,24 @@ Real MesoscopicSimulator::dt(void) const
 
 Real MesoscopicSimulator::next_time(void) const
 {
-    return scheduler_.next_time();
+    if (blocks_.size() == 0)
+    {
+        return scheduler_.next_time();
+    }
+
+    Real tnext(std::numeric_limits<Real>::infinity());
+    for (std::vector<Block>::const_iterator i(blocks_.begin()); i != blocks_.end(); ++i)
+    {
+        tnext = std::min(tnext, (*i).scheduler.next_time());
+    }
+
+    if (tnext == std::numeric_limits<Real>::infinity())
+    {
+        return tnext;
+    }
+    // Without diffusion, blocks never need synchronization.
+    return (sync_interval_used_ == std::numeric_limits<Real>::infinity()
+            ? tnext : t() + sync_interval_used_);
 }
 
 } // meso
@@ -2,6 +2,7 @@
 #define ECELL4_MESO_MESOSCOPIC_SIMULATOR_HPP
 
 #include <memory>
+#include <unordered_map>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <ecell4/core/types.hpp>
 #include <ecell4/core/Model.hpp>
@@ -128,9 +129,9 @@ protected:
 
     protected:
 
-        inline const std::shared_ptr<RandomNumberGenerator>& rng() const
+        inline const std::shared_ptr<RandomNumberGenerator>& rng(const coordinate_type& c) const
         {
-            return sim_->world()->rng();
+            return sim_->subvolume_rng(c);
         }
 
         inline const MesoscopicWorld& world() const
@@ -150,6 +151,14 @@ protected:
 
         typedef ReactionRuleProxyBase base_type;
 
+        /**
+         * a pool of molecules matching some of reactants, paired with
+         * the coefficients given by check_dependency.
+         */
+        typedef std::pair<std::shared_ptr<MesoscopicWorld::PoolBase>, std::vector<Integer> >
+            candidate_type;
+        typedef std::vector<candidate_type> candidate_container_type;
+
         ReactionRuleProxy()
             : base_type()
         {
@@ -186,6 +195,13 @@ protected:
         virtual void inc_with_coefs(const std::vector<Integer>& coefs,
                          const coordinate_type& c, const Integer val = +1) = 0;
 
+        void add_candidate(
+            const std::shared_ptr<MesoscopicWorld::PoolBase>& pool,
+            const std::vector<Integer>& coefs)
+        {
+            candidates_.push_back(std::make_pair(pool, coefs));
+        }
+
         inline const std::vector<ReactionRule> generate(
             const ReactionRule::reactant_container_type& reactants) const
         {
@@ -213,7 +229,7 @@ protected:
             {
                 const std::vector<ReactionRule>::size_type
                     rnd2(static_cast<std::vector<ReactionRule>::size_type>(
-                        rng()->uniform_int(0, retval.second - 1)));
+                        rng(c)->uniform_int(0, retval.second - 1)));
                 if (rnd2 >= reactions.size())
                 {
                     return std::make_pair(ReactionRule(), c);
@@ -270,6 +286,7 @@ protected:
     protected:
 
         ReactionRule rr_;
+        candidate_container_type candidates_;
     };
 
     class ZerothOrderReactionRuleProxy
@@ -375,23 +392,20 @@ protected:
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-
-            const Real rnd1(rng()->uniform(0.0, num_tot1_[c]));
+            const Real rnd1(rng(c)->uniform(0.0, num_tot1_[c]));
 
             Integer num_tot(0);
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[0], *i));
+                const Integer coef((*i).second[0]);
                 if (coef > 0)
                 {
-                    num_tot += coef * world().num_molecules_exact(*i, c);
+                    num_tot += coef * (*i).first->num_molecules(c);
                     if (num_tot >= rnd1)
                     {
                         return std::make_pair(
-                            ReactionRule::reactant_container_type(1, *i), coef);
+                            ReactionRule::reactant_container_type(1, (*i).first->species()), coef);
                     }
                 }
             }
@@ -482,19 +496,16 @@ protected:
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-
-            const Real rnd1(rng()->uniform(0.0, num_tot1_[c]));
+            const Real rnd1(rng(c)->uniform(0.0, num_tot1_[c]));
 
             Integer num_tot(0), coef1(0);
-            std::vector<Species>::const_iterator itr1(species.begin());
-            for (; itr1 != species.end(); ++itr1)
+            candidate_container_type::const_iterator itr1(candidates_.begin());
+            for (; itr1 != candidates_.end(); ++itr1)
             {
-                const Integer coef(get_coef(reactants[0], *itr1));
+                const Integer coef((*itr1).second[0]);
                 if (coef > 0)
                 {
-                    num_tot += coef * world().num_molecules_exact(*itr1, c);
+                    num_tot += coef * (*itr1).first->num_molecules(c);
                     if (num_tot >= rnd1)
                     {
                         coef1 = coef;
@@ -504,22 +515,22 @@ protected:
             }
 
             const Real rnd2(
-                rng()->uniform(0.0, num_tot2_[c] - get_coef(reactants[0], *itr1)));
+                rng(c)->uniform(0.0, num_tot2_[c] - coef1));
 
             num_tot = 0;
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[1], *i));
+                const Integer coef((*i).second[1]);
                 if (coef > 0)
                 {
-                    const Integer num(world().num_molecules_exact(*i, c));
+                    const Integer num((*i).first->num_molecules(c));
                     num_tot += coef * (i == itr1 ? num - 1 : num);
                     if (num_tot >= rnd2)
                     {
                         ReactionRule::reactant_container_type exact_reactants(2);
-                        exact_reactants[0] = *itr1;
-                        exact_reactants[1] = *i;
+                        exact_reactants[0] = (*itr1).first->species();
+                        exact_reactants[1] = (*i).first->species();
                         return std::make_pair(exact_reactants, coef1 * coef);
                     }
                 }
@@ -611,23 +622,22 @@ protected:
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
-            const Real rnd1(rng()->uniform(0.0, num_tot_[c]));
+            const Real rnd1(rng(c)->uniform(0.0, num_tot_[c]));
 
             Integer tot(0);
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[spidx_], *i));
+                const Integer coef((*i).second[spidx_]);
                 if (coef > 0)
                 {
-                    tot += coef * world().num_molecules_exact(*i, c);
+                    tot += coef * (*i).first->num_molecules(c);
                     if (tot >= rnd1)
                     {
                         ReactionRule::reactant_container_type retval(2);
-                        retval[spidx_] = *i;
+                        retval[spidx_] = (*i).first->species();
                         retval[stidx_] = reactants[stidx_];
                         return std::make_pair(retval, coef);
                     }
@@ -778,7 +788,6 @@ protected:
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
             std::pair<ReactionRule::reactant_container_type, Integer> ret;
@@ -787,19 +796,18 @@ protected:
             for (std::size_t i = 0; i < reactants.size(); ++i)
             {
                 assert(num_reactants_[c][i] > 0);
-                const Real rnd(rng()->uniform(0.0, num_reactants_[c][i]));
+                const Real rnd(rng(c)->uniform(0.0, num_reactants_[c][i]));
                 Integer num_tot(0);
-                for (std::vector<Species>::const_iterator it(species.begin());
-                    it != species.end(); ++it)
+                for (candidate_container_type::const_iterator it(candidates_.begin());
+                    it != candidates_.end(); ++it)
                 {
-                    const Species& sp(*it);
-                    const Integer coef(get_coef(reactants[i], sp));
+                    const Integer coef((*it).second[i]);
                     if (coef > 0)
                     {
-                        num_tot += coef * world().num_molecules_exact(sp, c);
+                        num_tot += coef * (*it).first->num_molecules(c);
                         if (num_tot >= rnd)
                         {
-                            ret.first.push_back(sp);
+                            ret.first.push_back((*it).first->species());
                             ret.second *= coef;
                             break;
                         }
@@ -889,20 +897,24 @@ protected:
 
     protected:
 
-        typedef std::pair<ReactionRuleProxy*, std::vector<Integer> >
+        /**
+         * the index of a reaction rule proxy depending on the species,
+         * paired with the coefficients given by check_dependency.
+         */
+        typedef std::pair<std::size_t, std::vector<Integer> >
             dependency_type;
         typedef std::vector<dependency_type> dependency_container_type;
 
     public:
 
         DiffusionProxy()
-            : base_type(), pool_(), dependencies_()
+            : base_type(), pool_(), index_(0), dependencies_()
         {
             ;
         }
 
-        DiffusionProxy(MesoscopicSimulator* sim, const Species& sp)
-            : base_type(sim), pool_(sim->world()->get_pool(sp)), dependencies_()
+        DiffusionProxy(MesoscopicSimulator* sim, const Species& sp, const std::size_t idx)
+            : base_type(sim), pool_(sim->world()->get_pool(sp)), index_(idx), dependencies_()
         {
             ;
         }
@@ -919,7 +931,7 @@ protected:
                 py(1.0 / (lengths[1] * lengths[1])),
                 pz(1.0 / (lengths[2] * lengths[2]));
 
-            const Real rnd1(sim_->world()->rng()->uniform(0.0, px + py + pz));
+            const Real rnd1(rng(c)->uniform(0.0, px + py + pz));
 
             if (rnd1 < px * 0.5)
             {
@@ -959,6 +971,14 @@ protected:
             return k_ * pool_->num_molecules(c);
         }
 
+        /**
+         * the rate of hopping per molecule.
+         */
+        Real rate() const
+        {
+            return k_;
+        }
+
         void inc(const Species& sp, const coordinate_type& c, const Integer val = +1)
         {
             ; // do nothing
@@ -980,6 +1000,15 @@ protected:
                 return;
             }
 
+            if (!sim_->is_local(src, dst))
+            {
+                // The molecule arrives at the next synchronization.
+                pool_->remove_molecules(1, src);
+                update_dependencies(src, -1);
+                sim_->send(index_, src, dst);
+                return;
+            }
+
             {
                 // sim_->decrement(pool_, src);
                 // sim_->increment(pool_, dst);
@@ -987,30 +1016,49 @@ protected:
                 pool_->remove_molecules(1, src);
                 pool_->add_molecules(1, dst);
 
-                for (dependency_container_type::const_iterator i(dependencies_.begin());
-                     i != dependencies_.end(); ++i)
-                {
-                    (*i).first->inc_with_coefs((*i).second, src, -1);
-                    (*i).first->inc_with_coefs((*i).second, dst, +1);
-                }
+                update_dependencies(src, -1);
+                update_dependencies(dst, +1);
             }
 
             sim_->interrupt(dst);
         }
 
-        void set_dependency(ReactionRuleProxy* proxy)
+        /**
+         * update the counts of reaction rule proxies depending on the species
+         * in the given subvolume, and invalidate the cached propensities.
+         */
+        void update_dependencies(const coordinate_type& c, const Integer val)
+        {
+            for (dependency_container_type::const_iterator i(dependencies_.begin());
+                 i != dependencies_.end(); ++i)
+            {
+                static_cast<ReactionRuleProxy&>(
+                    sim_->proxies_[(*i).first]).inc_with_coefs((*i).second, c, val);
+                sim_->invalidate((*i).first, c);
+            }
+            sim_->invalidate(index_, c);
+        }
+
+        void set_dependency(const std::size_t idx, ReactionRuleProxy* proxy)
         {
             const std::vector<Integer> coefs = proxy->check_dependency(pool_->species());
             if (std::count(coefs.begin(), coefs.end(), 0) < std::distance(coefs.begin(), coefs.end()))
             {
-                dependencies_.push_back(std::make_pair(proxy, coefs));
+                dependencies_.push_back(std::make_pair(idx, coefs));
+                proxy->add_candidate(pool_, coefs);
             }
         }
 
+        const std::shared_ptr<MesoscopicWorld::PoolBase>& pool() const
+        {
+            return pool_;
+        }
+
     protected:
 
         const std::shared_ptr<MesoscopicWorld::PoolBase> pool_;
         Real k_;
+        std::size_t index_;
 
         dependency_container_type dependencies_;
     };
@@ -1065,18 +1113,38 @@ public:
 
     MesoscopicSimulator(
         std::shared_ptr<MesoscopicWorld> world,
-        std::shared_ptr<Model> model)
-        : base_type(world, model)
+        std::shared_ptr<Model> model,
+        const Integer num_threads = default_num_threads(),
+        const Real sync_interval = default_sync_interval())
+        : base_type(world, model),
+          num_threads_(num_threads), sync_interval_(sync_interval)
     {
         initialize();
     }
 
-    MesoscopicSimulator(std::shared_ptr<MesoscopicWorld> world)
-        : base_type(world)
+    MesoscopicSimulator(
+        std::shared_ptr<MesoscopicWorld> world,
+        const Integer num_threads = default_num_threads(),
+        const Real sync_interval = default_sync_interval())
+        : base_type(world),
+          num_threads_(num_threads), sync_interval_(sync_interval)
     {
         initialize();
     }
 
+    static inline const Integer default_num_threads()
+    {
+        return 1;
+    }
+
+    /**
+     * zero means the mean waiting time of the fastest diffusion.
+     */
+    static inline const Real default_sync_interval()
+    {
+        return 0.0;
+    }
+
     // SimulatorTraits
     Real dt(void) const;
     Real next_time(void) const;
@@ -1097,12 +1165,37 @@ public:
 
     void add_last_reaction(const ReactionRule& rr, const reaction_info_type& ri)
     {
-        last_reactions_.push_back(std::make_pair(rr, ri));
+        if (blocks_.size() == 0)
+        {
+            last_reactions_.push_back(std::make_pair(rr, ri));
+        }
+        else
+        {
+            blocks_[block_index(ri.coordinate())].last_reactions.push_back(
+                std::make_pair(rr, ri));
+        }
     }
 
     void reset_last_reactions()
     {
-        last_reactions_.clear();
+        if (blocks_.size() == 0)
+        {
+            last_reactions_.clear();
+        }
+    }
+
+    Integer num_threads() const
+    {
+        return num_threads_;
+    }
+
+    /**
+     * return the interval of synchronizations between blocks actually used.
+     * This is meaningful only with multiple threads.
+     */
+    Real sync_interval() const
+    {
+        return sync_interval_used_;
     }
 
     /**
@@ -1117,21 +1210,75 @@ public:
 
     void interrupt(const coordinate_type& coord)
     {
-        interrupted_ = coord;
+        if (blocks_.size() == 0)
+        {
+            interrupted_ = coord;
+        }
+        else
+        {
+            blocks_[block_index(coord)].interrupted = coord;
+        }
     }
 
 protected:
 
-    DiffusionProxy* create_diffusion_proxy(const Species& sp);
+    /**
+     * a contiguous range of subvolumes advanced by a thread.
+     * Each block has its own scheduler and random number generator.
+     * Molecules diffusing out of the block are kept in outbox until
+     * the next synchronization.
+     */
+    struct Block
+    {
+        EventScheduler scheduler;
+        std::shared_ptr<RandomNumberGenerator> rng;
+        coordinate_type interrupted;
+        std::vector<std::pair<std::size_t, coordinate_type> > outbox;
+        std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions;
+    };
+
+    inline std::size_t block_index(const coordinate_type& c) const
+    {
+        return static_cast<std::size_t>(c) * blocks_.size() / num_subvolumes_;
+    }
+
+    inline bool is_local(const coordinate_type& src, const coordinate_type& dst) const
+    {
+        return (blocks_.size() == 0 || block_index(src) == block_index(dst));
+    }
+
+    inline const std::shared_ptr<RandomNumberGenerator>& subvolume_rng(const coordinate_type& c) const
+    {
+        return (blocks_.size() == 0 ? world_->rng() : blocks_[block_index(c)].rng);
+    }
+
+    void send(const std::size_t idx, const coordinate_type& src, const coordinate_type& dst)
+    {
+        blocks_[block_index(src)].outbox.push_back(std::make_pair(idx, dst));
+    }
+
+    void initialize_blocks(void);
+    void advance_block(Block& block, const Real upto);
+    void advance_blocks(const Real upto);
+
+    std::size_t add_diffusion_proxy(const Species& sp);
 
     void interrupt_all(const Real& t);
     std::pair<Real, ReactionRuleProxyBase*>
         draw_next_reaction(const coordinate_type& c);
 
+    void invalidate(const std::size_t idx, const coordinate_type& c)
+    {
+        dirty_groups_[(idx / group_size_) * num_subvolumes_ + c] = 1;
+    }
+
+    Real update_group(const std::size_t g, const coordinate_type& c);
+    void resize_groups(void);
+
     void increment_molecules(const Species& sp, const coordinate_type& c);
     void decrement_molecules(const Species& sp, const coordinate_type& c);
-    void increment(const std::shared_ptr<MesoscopicWorld::PoolBase>& pool, const coordinate_type& c);
-    void decrement(const std::shared_ptr<MesoscopicWorld::PoolBase>& pool, const coordinate_type& c);
+    void increment(const std::size_t idx, const coordinate_type& c);
+    void decrement(const std::size_t idx, const coordinate_type& c);
     void check_model(void);
 
 protected:
@@ -1140,10 +1287,35 @@ protected:
 
     boost::ptr_vector<ReactionRuleProxyBase> proxies_;
     boost::ptr_vector<ReactionRuleProxyBase>::size_type diffusion_proxy_offset_;
+    std::unordered_map<Species, std::size_t> diffusion_proxies_;
+
+    /**
+     * Proxies are grouped by index, and the sum of propensities in each group
+     * is cached for each subvolume at group_sums_[g * num_subvolumes_ + c].
+     * A sum invalidated by a change is recalculated at the next draw.
+     * Proxies with a descriptor could depend on the time, and are
+     * invalidated at every draw.
+     */
+    std::size_t group_size_;
+    std::size_t num_subvolumes_;
+    std::vector<Real> group_sums_;
+    std::vector<char> dirty_groups_;
+    std::vector<std::size_t> time_dependent_proxies_;
 
     EventScheduler scheduler_;
     std::vector<EventScheduler::identifier_type> event_ids_;
     coordinate_type interrupted_;
+
+    /**
+     * With multiple threads, the subvolumes are split into blocks, and
+     * scheduler_ is left empty. event_ids_ then points to the events in
+     * the scheduler of each block. Diffusion across blocks is applied at
+     * every sync_interval_used_ (operator splitting).
+     */
+    Integer num_threads_;
+    Real sync_interval_;
+    Real sync_interval_used_;
+    std::vector<Block> blocks_;
 };
 
 } // meso
@@ -7,6 +7,8 @@
 #   include <boost/test/included/unit_test.hpp>
 #endif
 
+#include <sstream>
+
 #include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/NetworkModel.hpp>
@@ -49,3 +51,112 @@ BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_step)
     BOOST_CHECK(world->num_molecules(sp1, 0) == 9);
     BOOST_CHECK(world->num_molecules(sp2, 0) == 1);
 }
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_many_reaction_rules)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    const Integer num_species(30);
+    const Integer num(100);
+
+    const Species sp2("B");
+    model->add_species_attribute(sp2);
+
+    std::vector<Species> species;
+    for (Integer i(0); i < num_species; ++i)
+    {
+        std::ostringstream oss;
+        oss << "A" << i;
+        Species sp(oss.str());
+        sp.set_attribute("D", 1.0);
+        model->add_species_attribute(sp);
+        model->add_reaction_rule(create_unimolecular_reaction_rule(sp, sp2, 1.0));
+        species.push_back(sp);
+    }
+
+    // C is not in the world at the beginning.
+    model->add_reaction_rule(
+        create_binding_reaction_rule(sp2, sp2, Species("C"), 1e-3));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+    std::shared_ptr<MesoscopicWorld> world(
+        new MesoscopicWorld(edge_lengths, Integer3(3, 3, 3), rng));
+
+    for (std::vector<Species>::const_iterator i(species.begin());
+        i != species.end(); ++i)
+    {
+        world->add_molecules(*i, num);
+    }
+
+    MesoscopicSimulator sim(world, model);
+    sim.run(1.0);
+
+    Integer num_remaining(0);
+    for (std::vector<Species>::const_iterator i(species.begin());
+        i != species.end(); ++i)
+    {
+        num_remaining += world->num_molecules_exact(*i);
+    }
+
+    const Species sp3("C");
+    BOOST_CHECK_EQUAL(
+        num_remaining + world->num_molecules_exact(sp2) + 2 * world->num_molecules_exact(sp3),
+        num_species * num);
+    BOOST_CHECK(world->num_molecules_exact(sp3) > 0);
+    BOOST_CHECK_CLOSE(
+        static_cast<Real>(num_remaining), num_species * num * exp(-1.0), 10.0);
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_multiple_threads)
+{
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A"), sp2("B"), sp3("C");
+    sp1.set_attribute("D", 1.0);
+    sp2.set_attribute("D", 1.0);
+    sp3.set_attribute("D", 1.0);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 0.1));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 1.0));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(4, 4, 4);
+    const Integer num(1000);
+
+    std::vector<Integer> results;
+    for (Integer num_threads(1); num_threads <= 3; ++num_threads)
+    {
+        for (unsigned int trial(0); trial < 2; ++trial)
+        {
+            std::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+            std::shared_ptr<MesoscopicWorld> world(
+                new MesoscopicWorld(edge_lengths, matrix_sizes, rng));
+            world->add_molecules(sp1, num);
+            world->add_molecules(sp2, num);
+
+            MesoscopicSimulator sim(world, model, num_threads);
+            BOOST_CHECK_EQUAL(sim.num_threads(), num_threads);
+            if (num_threads > 1)
+            {
+                BOOST_CHECK_CLOSE(sim.sync_interval(), 1.0 / (6.0 * 16.0), 1e-6);
+            }
+
+            sim.run(0.5);
+            BOOST_CHECK_EQUAL(sim.t(), 0.5);
+            BOOST_CHECK_EQUAL(
+                world->num_molecules_exact(sp1) + world->num_molecules_exact(sp3), num);
+            BOOST_CHECK_EQUAL(
+                world->num_molecules_exact(sp2) + world->num_molecules_exact(sp3), num);
+            BOOST_CHECK(world->num_molecules_exact(sp3) > 0);
+            results.push_back(world->num_molecules_exact(sp3));
+        }
+    }
+
+    // The result only depends on the seed and the number of threads.
+    BOOST_CHECK_EQUAL(results[0], results[1]);
+    BOOST_CHECK_EQUAL(results[2], results[3]);
+    BOOST_CHECK_EQUAL(results[4], results[5]);
+}
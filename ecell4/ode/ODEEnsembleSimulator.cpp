@@ -0,0 +1,516 @@
+#include "ODEEnsembleSimulator.hpp"
+#include "SparseRosenbrock4.hpp"
+
+#include <boost/numeric/odeint.hpp>
+#include <boost/ref.hpp>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <cmath>
+
+namespace odeint = boost::numeric::odeint;
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+namespace
+{
+
+typedef ODEEnsembleSimulator::state_type state_type;
+typedef ODEEnsembleSimulator::compiled_reaction_container_type compiled_reaction_container_type;
+
+/**
+ * the derivatives of m members at once. Both the state and the rate
+ * constants are stored member by member for each species or reaction,
+ * x[species * m + member] and k[reaction * m + member].
+ */
+class ensemble_deriv_func
+{
+public:
+
+    ensemble_deriv_func(
+        const compiled_reaction_container_type& reactions, const std::vector<Real>& k,
+        const std::size_t num_members, const Real& volume)
+        : reactions_(reactions), k_(k), num_members_(num_members), volume_(volume),
+          flux_(num_members)
+    {
+        for (std::size_t i(0); i < reactions_.ratelaws.size(); ++i)
+        {
+            reactants_states_.push_back(
+                ReactionRuleDescriptor::state_container_type(
+                    reactions_.ratelaws[i]->reactant_coefficients().size()));
+            products_states_.push_back(
+                ReactionRuleDescriptor::state_container_type(
+                    reactions_.ratelaw_products[i].size()));
+        }
+    }
+
+    void operator()(const state_type& x, state_type& dxdt, const double& t)
+    {
+        const std::size_t m(num_members_);
+        std::fill(dxdt.begin(), dxdt.end(), 0.0);
+        for (std::size_t i(0); i < reactions_.size(); ++i)
+        {
+            const std::size_t begin(reactions_.reactant_offsets[i]),
+                end(reactions_.reactant_offsets[i + 1]);
+            const std::size_t idx(reactions_.ratelaw_indices[i]);
+
+            if (idx == compiled_reaction_container_type::npos)
+            {
+                std::copy(k_.begin() + i * m, k_.begin() + (i + 1) * m, flux_.begin());
+                for (std::size_t j(begin); j < end; ++j)
+                {
+                    const Real* const xj(&x[reactions_.reactant_indices[j] * m]);
+                    const int p(reactions_.reactant_powers[j]);
+                    const Real c(reactions_.reactant_coefficients[j]);
+                    if (p == 1)
+                    {
+                        for (std::size_t l(0); l < m; ++l)
+                        {
+                            flux_[l] *= xj[l];
+                        }
+                    }
+                    else
+                    {
+                        for (std::size_t l(0); l < m; ++l)
+                        {
+                            flux_[l] *= compiled_reaction_container_type::power(xj[l], p, c);
+                        }
+                    }
+                }
+            }
+            else
+            {
+                ReactionRuleDescriptor::state_container_type&
+                    reactants_states(reactants_states_[idx]);
+                ReactionRuleDescriptor::state_container_type&
+                    products_states(products_states_[idx]);
+                const index_container_type& products(reactions_.ratelaw_products[idx]);
+                const std::shared_ptr<ReactionRuleDescriptor>& ratelaw(reactions_.ratelaws[idx]);
+                for (std::size_t l(0); l < m; ++l)
+                {
+                    for (std::size_t j(begin); j < end; ++j)
+                    {
+                        reactants_states[j - begin] = x[reactions_.reactant_indices[j] * m + l];
+                    }
+                    for (std::size_t j(0); j < products.size(); ++j)
+                    {
+                        products_states[j] = x[products[j] * m + l];
+                    }
+                    flux_[l] = ratelaw->propensity(reactants_states, products_states, volume_, t);
+                }
+            }
+
+            for (std::size_t j(reactions_.stoichiometry_offsets[i]);
+                j < reactions_.stoichiometry_offsets[i + 1]; ++j)
+            {
+                Real* const dxj(&dxdt[reactions_.stoichiometry_indices[j] * m]);
+                const Real coef(reactions_.stoichiometry[j]);
+                for (std::size_t l(0); l < m; ++l)
+                {
+                    dxj[l] += coef * flux_[l];
+                }
+            }
+        }
+    }
+
+protected:
+
+    typedef ODESimulator::index_container_type index_container_type;
+
+    const compiled_reaction_container_type& reactions_;
+    const std::vector<Real> k_;
+    const std::size_t num_members_;
+    const Real volume_;
+    std::vector<Real> flux_;
+    std::vector<ReactionRuleDescriptor::state_container_type>
+        reactants_states_, products_states_;
+};
+
+/**
+ * the block diagonal Jacobian of m members in the layout of
+ * ensemble_deriv_func. Each block is evaluated by ODESimulator::jacobi_func.
+ */
+class ensemble_jacobi_func
+{
+public:
+
+    ensemble_jacobi_func(
+        const compiled_reaction_container_type& reactions, const std::vector<Real>& k,
+        const std::size_t num_members, const std::size_t num_species,
+        const Real& volume, const Real& abs_tol, const Real& rel_tol)
+        : num_members_(num_members), xl_(num_species), dfdtl_(num_species)
+    {
+        const std::size_t m(num_members);
+        compiled_reaction_container_type member(reactions);
+        for (std::size_t l(0); l < m; ++l)
+        {
+            for (std::size_t i(0); i < member.size(); ++i)
+            {
+                member.k[i] = k[i * m + l];
+            }
+            jacobi_.push_back(
+                ODESimulator::jacobi_func(member, num_species, volume, abs_tol, rel_tol));
+        }
+
+        const SparseMatrix& pattern(jacobi_.front().matrix());
+        const SparseMatrix::index_container_type& offsets(pattern.row_offsets());
+        const SparseMatrix::index_container_type& columns(pattern.columns());
+        std::vector<SparseMatrix::entry_type> entries;
+        for (std::size_t l(0); l < m; ++l)
+        {
+            for (std::size_t i(0); i < num_species; ++i)
+            {
+                for (std::size_t p(offsets[i]); p < offsets[i + 1]; ++p)
+                {
+                    entries.push_back(SparseMatrix::entry_type(i * m + l, columns[p] * m + l));
+                }
+            }
+        }
+        jacobian_ = SparseMatrix(num_species * m, entries);
+
+        positions_.resize(m * pattern.num_nonzeros());
+        for (std::size_t l(0); l < m; ++l)
+        {
+            for (std::size_t i(0); i < num_species; ++i)
+            {
+                for (std::size_t p(offsets[i]); p < offsets[i + 1]; ++p)
+                {
+                    positions_[l * pattern.num_nonzeros() + p]
+                        = jacobian_.find(i * m + l, columns[p] * m + l);
+                }
+            }
+        }
+    }
+
+    const SparseMatrix& evaluate(const state_type& x, const double& t, state_type& dfdt)
+    {
+        const std::size_t m(num_members_);
+        const std::size_t n(xl_.size());
+        SparseMatrix::value_container_type& values(jacobian_.values());
+        for (std::size_t l(0); l < m; ++l)
+        {
+            for (std::size_t i(0); i < n; ++i)
+            {
+                xl_[i] = x[i * m + l];
+            }
+
+            const SparseMatrix& block(jacobi_[l].evaluate(xl_, t, dfdtl_));
+            const std::size_t* const positions(&positions_[l * block.num_nonzeros()]);
+            for (std::size_t p(0); p < block.num_nonzeros(); ++p)
+            {
+                values[positions[p]] = block.values()[p];
+            }
+
+            for (std::size_t i(0); i < n; ++i)
+            {
+                dfdt[i * m + l] = dfdtl_[i];
+            }
+        }
+        return jacobian_;
+    }
+
+    SparseLU& linear_solver()
+    {
+        if (!lu_)
+        {
+            lu_.reset(new SparseLU(jacobian_));
+        }
+        return *lu_;
+    }
+
+protected:
+
+    const std::size_t num_members_;
+    std::vector<ODESimulator::jacobi_func> jacobi_;
+    SparseMatrix jacobian_;
+    std::vector<std::size_t> positions_;
+    state_type xl_, dfdtl_;
+    std::shared_ptr<SparseLU> lu_;
+};
+
+/**
+ * write the state of members [begin, begin + m) into a result.
+ * The first observations are skipped when the start time is not requested.
+ */
+struct ensemble_observer
+{
+    ensemble_observer(
+        ODEEnsembleResult& result, const std::size_t begin, const std::size_t m,
+        const std::size_t skip)
+        : result(result), begin(begin), m(m), skip(skip), count(0)
+    {
+        ;
+    }
+
+    void operator()(const state_type& x, const double t)
+    {
+        if (count < skip)
+        {
+            ++count;
+            return;
+        }
+
+        const std::size_t n(result.species().size());
+        const std::size_t M(result.num_members());
+        ODEEnsembleResult::data_container_type::iterator
+            it(result.data().begin() + (count - skip) * n * M + begin);
+        for (std::size_t i(0); i < n; ++i, it += M)
+        {
+            std::copy(&x[i * m], &x[i * m] + m, it);
+        }
+        ++count;
+    }
+
+    ODEEnsembleResult& result;
+    const std::size_t begin, m, skip;
+    std::size_t count;
+};
+
+} // anonymous
+
+ODEEnsembleSimulator::ODEEnsembleSimulator(
+    const std::shared_ptr<ODEWorld>& world,
+    const std::shared_ptr<Model>& model,
+    const std::vector<std::vector<Real> >& values,
+    const std::vector<std::vector<Real> >& k,
+    const ODESolverType solver_type,
+    const Integer num_threads)
+    : world_(world), model_(model), num_members_(std::max(values.size(), k.size())),
+      initialized_(false), initial_values_(values), initial_k_(k),
+      solver_type_(solver_type), num_threads_(num_threads),
+      dt_(std::numeric_limits<Real>::infinity()),
+      abs_tol_(1e-6), rel_tol_(1e-6), max_dt_(0.0)
+{
+    if (!model_->is_static())
+    {
+        throw NotSupported("Only a NetworkModel is accepted. Use expand");
+    }
+    else if (num_members_ == 0)
+    {
+        throw IllegalArgument("No member is given.");
+    }
+    else if (!values.empty() && !k.empty() && values.size() != k.size())
+    {
+        throw IllegalArgument("The numbers of members in values and k differ.");
+    }
+    else if (num_threads_ <= 0)
+    {
+        throw IllegalArgument("The number of threads must be positive.");
+    }
+}
+
+void ODEEnsembleSimulator::initialize()
+{
+    const std::vector<Species> species(model_->list_species());
+    for (std::vector<Species>::const_iterator it(species.begin());
+        it != species.end(); ++it)
+    {
+        if (!world_->has_species(*it))
+        {
+            world_->reserve_species(*it);
+        }
+    }
+    species_ = world_->list_species();
+
+    const Real volume(world_->volume());
+    compiled_ = ODESimulator::compile_reactions(
+        ODESimulator::convert_reactions(species_, model_->reaction_rules()), volume);
+
+    const std::vector<std::vector<Real> >& values(initial_values_);
+    const std::vector<std::vector<Real> >& k(initial_k_);
+    const std::size_t n(species_.size());
+    const std::size_t M(num_members_);
+    values_.resize(n * M);
+    for (std::size_t j(0); j < M; ++j)
+    {
+        if (!values.empty() && values[j].size() != n)
+        {
+            throw IllegalArgument(
+                "The number of values must be equal to the number of species.");
+        }
+        for (std::size_t i(0); i < n; ++i)
+        {
+            values_[i * M + j] = (
+                values.empty() ? world_->get_value_exact(species_[i]) : values[j][i]);
+        }
+    }
+
+    const std::size_t r(compiled_.size());
+    k_.resize(r * M);
+    for (std::size_t i(0); i < r; ++i)
+    {
+        Real order(0.0);
+        for (std::size_t p(compiled_.reactant_offsets[i]);
+            p < compiled_.reactant_offsets[i + 1]; ++p)
+        {
+            order += compiled_.reactant_coefficients[p];
+        }
+        const bool mass_action(
+            compiled_.ratelaw_indices[i] == compiled_reaction_container_type::npos);
+
+        for (std::size_t j(0); j < M; ++j)
+        {
+            if (!k.empty() && k[j].size() != r)
+            {
+                throw IllegalArgument(
+                    "The number of rate constants must be equal to the number of reaction rules.");
+            }
+            k_[i * M + j] = (
+                k.empty() || !mass_action ? compiled_.k[i]
+                    : k[j][i] * std::pow(volume, 1.0 - order));
+        }
+    }
+
+    initialized_ = true;
+}
+
+ODEEnsembleResult ODEEnsembleSimulator::run(const std::vector<Real>& times)
+{
+    if (!initialized_)
+    {
+        initialize();
+    }
+
+    ODEEnsembleResult result(times, species_, num_members_);
+    if (times.empty())
+    {
+        return result;
+    }
+    else if (times.front() < world_->t())
+    {
+        throw IllegalArgument("Time points must not be before the world's time.");
+    }
+    for (std::size_t i(1); i < times.size(); ++i)
+    {
+        if (times[i] <= times[i - 1])
+        {
+            throw IllegalArgument("Time points must be in ascending order.");
+        }
+    }
+
+    const std::size_t num_blocks(
+        std::min(static_cast<std::size_t>(num_threads()), num_members_));
+    std::vector<std::exception_ptr> errors(num_blocks);
+    std::vector<std::thread> threads;
+    for (std::size_t i(1); i < num_blocks; ++i)
+    {
+        threads.push_back(std::thread(
+            &ODEEnsembleSimulator::integrate_block, this,
+            i * num_members_ / num_blocks, (i + 1) * num_members_ / num_blocks,
+            std::cref(times), std::ref(result), std::ref(errors[i])));
+    }
+    integrate_block(0, num_members_ / num_blocks, times, result, errors[0]);
+    for (std::vector<std::thread>::iterator i(threads.begin()); i != threads.end(); ++i)
+    {
+        (*i).join();
+    }
+
+    for (std::vector<std::exception_ptr>::const_iterator i(errors.begin());
+        i != errors.end(); ++i)
+    {
+        if (*i)
+        {
+            std::rethrow_exception(*i);
+        }
+    }
+    return result;
+}
+
+void ODEEnsembleSimulator::integrate_block(
+    const std::size_t begin, const std::size_t end,
+    const std::vector<Real>& times, ODEEnsembleResult& result,
+    std::exception_ptr& error) const
+{
+    try
+    {
+        integrate(begin, end, times, result);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+}
+
+void ODEEnsembleSimulator::integrate(
+    const std::size_t begin, const std::size_t end,
+    const std::vector<Real>& times, ODEEnsembleResult& result) const
+{
+    const std::size_t m(end - begin);
+    const std::size_t n(species_.size());
+    const std::size_t M(num_members_);
+
+    std::vector<Real> k(compiled_.size() * m);
+    for (std::size_t i(0); i < compiled_.size(); ++i)
+    {
+        std::copy(k_.begin() + i * M + begin, k_.begin() + i * M + end, k.begin() + i * m);
+    }
+    state_type x(n * m);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        std::copy(values_.begin() + i * M + begin, values_.begin() + i * M + end,
+                  x.begin() + i * m);
+    }
+
+    std::vector<Real> grid;
+    if (times.front() > world_->t())
+    {
+        grid.push_back(world_->t());
+    }
+    grid.insert(grid.end(), times.begin(), times.end());
+    ensemble_observer observer(result, begin, m, grid.size() - times.size());
+    if (grid.size() == 1)
+    {
+        observer(x, grid.front());
+        return;
+    }
+    const Real dt(std::min(dt_, grid[1] - grid[0]));
+
+    ensemble_deriv_func deriv(compiled_, k, m, world_->volume());
+    switch (solver_type_)
+    {
+    case RUNGE_KUTTA_CASH_KARP54:
+        {
+            typedef odeint::runge_kutta_cash_karp54<state_type> error_stepper_type;
+            odeint::integrate_times(
+                odeint::make_controlled<error_stepper_type>(abs_tol_, rel_tol_, max_dt_),
+                boost::ref(deriv), x, grid.begin(), grid.end(), dt, boost::ref(observer));
+        }
+        break;
+    case ROSENBROCK4_CONTROLLER:
+    case SPARSE_ROSENBROCK4_CONTROLLER:
+        {
+            // The Jacobian is block diagonal, thus always solved as sparse.
+            typedef odeint::rosenbrock4_controller<sparse_rosenbrock4> controlled_stepper_type;
+            std::pair<ensemble_deriv_func, ensemble_jacobi_func> system(
+                deriv,
+                ensemble_jacobi_func(
+                    compiled_, k, m, n, world_->volume(), abs_tol_, rel_tol_));
+            odeint::integrate_times(
+                controlled_stepper_type(abs_tol_, rel_tol_, max_dt_),
+                boost::ref(system), x, grid.begin(), grid.end(), dt, boost::ref(observer));
+        }
+        break;
+    case EULER:
+        {
+            if (dt_ == std::numeric_limits<Real>::infinity())
+            {
+                throw IllegalState("A step interval must be given for EULER.");
+            }
+            typedef odeint::euler<state_type> stepper_type;
+            odeint::integrate_times(
+                stepper_type(), boost::ref(deriv), x, grid.begin(), grid.end(), dt_,
+                boost::ref(observer));
+        }
+        break;
+    default:
+        throw IllegalState("Solver is not specified\n");
+    }
+}
+
+} // ode
+
+} // ecell4
@@ -0,0 +1,280 @@
+#ifndef ECELL4_ODE_ODE_ENSEMBLE_SIMULATOR_HPP
+#define ECELL4_ODE_ODE_ENSEMBLE_SIMULATOR_HPP
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <exception>
+
+#include <ecell4/core/exceptions.hpp>
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/Species.hpp>
+#include <ecell4/core/Model.hpp>
+
+#include "ODEWorld.hpp"
+#include "ODESimulator.hpp"
+
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+/**
+ * Values of an ensemble at time points.
+ * They are stored in the order of time, species and member.
+ */
+class ODEEnsembleResult
+{
+public:
+
+    typedef std::vector<Real> data_container_type;
+
+public:
+
+    ODEEnsembleResult(
+        const std::vector<Real>& times, const std::vector<Species>& species,
+        const std::size_t num_members)
+        : times_(times), species_(species), num_members_(num_members),
+          data_(times.size() * species.size() * num_members, 0.0)
+    {
+        ;
+    }
+
+    const std::vector<Real>& times() const
+    {
+        return times_;
+    }
+
+    const std::vector<Species>& species() const
+    {
+        return species_;
+    }
+
+    std::size_t num_members() const
+    {
+        return num_members_;
+    }
+
+    /**
+     * return the value of the j-th species of the k-th member at the i-th time.
+     */
+    Real value(const std::size_t i, const std::size_t j, const std::size_t k) const
+    {
+        return data_[(i * species_.size() + j) * num_members_ + k];
+    }
+
+    /**
+     * return the values of the k-th member at the i-th time.
+     */
+    std::vector<Real> values(const std::size_t i, const std::size_t k) const
+    {
+        std::vector<Real> ret(species_.size());
+        for (std::size_t j(0); j < species_.size(); ++j)
+        {
+            ret[j] = value(i, j, k);
+        }
+        return ret;
+    }
+
+    const data_container_type& data() const
+    {
+        return data_;
+    }
+
+    data_container_type& data()
+    {
+        return data_;
+    }
+
+protected:
+
+    std::vector<Real> times_;
+    std::vector<Species> species_;
+    std::size_t num_members_;
+    data_container_type data_;
+};
+
+/**
+ * An ensemble of ODE systems of one model, whose members differ only in
+ * initial values and rate constants. All members are integrated together.
+ * Their state is stored as structure-of-arrays, x[species * M + member],
+ * and the reactions are compiled once and shared.
+ * Members are divided into contiguous blocks, which run on threads in
+ * parallel. Members in a block share the step size.
+ * The volume, the start time and the order of species follow the ODEWorld.
+ * The world and the model are read at initialize(), which is called at
+ * the first run() unless called explicitly.
+ */
+class ODEEnsembleSimulator
+{
+public:
+
+    typedef ODESimulator::state_type state_type;
+    typedef ODESimulator::reaction_container_type reaction_container_type;
+    typedef ODESimulator::compiled_reaction_container_type compiled_reaction_container_type;
+
+public:
+
+    /**
+     * @param values initial values of each member in the order of
+     *  world->list_species(). If empty, all members start from the world.
+     * @param k rate constants of each member in the order of
+     *  model->reaction_rules(). If empty, those in the model are used.
+     *  They are ignored for reactions with a user-defined rate law.
+     */
+    ODEEnsembleSimulator(
+        const std::shared_ptr<ODEWorld>& world,
+        const std::shared_ptr<Model>& model,
+        const std::vector<std::vector<Real> >& values,
+        const std::vector<std::vector<Real> >& k = std::vector<std::vector<Real> >(),
+        const ODESolverType solver_type = ROSENBROCK4_CONTROLLER,
+        const Integer num_threads = 1);
+
+    /**
+     * reserve species of the model in the world, and compile the reactions
+     * with the values and rate constants of members.
+     * Call this again after modifying the model.
+     */
+    void initialize();
+
+    bool initialized() const
+    {
+        return initialized_;
+    }
+
+    std::size_t num_members() const
+    {
+        return num_members_;
+    }
+
+    /**
+     * the order of species in values. valid after initialize().
+     */
+    const std::vector<Species>& species() const
+    {
+        return species_;
+    }
+
+    /**
+     * return true if any reaction has a user-defined rate law. valid after initialize().
+     * Members are integrated on a single thread in that case, because
+     * a rate law is not always thread-safe.
+     */
+    bool has_ratelaws() const
+    {
+        return !compiled_.ratelaws.empty();
+    }
+
+    Integer num_threads() const
+    {
+        return (has_ratelaws() ? 1 : num_threads_);
+    }
+
+    Real dt() const
+    {
+        return dt_;
+    }
+
+    void set_dt(const Real& dt)
+    {
+        if (dt <= 0)
+        {
+            throw IllegalArgument("The step size must be positive.");
+        }
+        dt_ = dt;
+    }
+
+    Real absolute_tolerance() const
+    {
+        return abs_tol_;
+    }
+
+    void set_absolute_tolerance(const Real abs_tol)
+    {
+        if (abs_tol < 0)
+        {
+            throw IllegalArgument("A tolerance must be positive or zero.");
+        }
+        abs_tol_ = abs_tol;
+    }
+
+    Real relative_tolerance() const
+    {
+        return rel_tol_;
+    }
+
+    void set_relative_tolerance(const Real rel_tol)
+    {
+        if (rel_tol < 0)
+        {
+            throw IllegalArgument("A tolerance must be positive or zero.");
+        }
+        rel_tol_ = rel_tol;
+    }
+
+    Real maximum_step_interval() const
+    {
+        return max_dt_;
+    }
+
+    void set_maximum_step_interval(const Real max_dt)
+    {
+        if (max_dt < 0)
+        {
+            throw IllegalArgument("A maximum step interval must be positive or zero.");
+        }
+        max_dt_ = max_dt;
+    }
+
+    /**
+     * integrate all members from the time of the world,
+     * and return their values at the given time points in ascending order.
+     * The world is left unchanged.
+     */
+    ODEEnsembleResult run(const std::vector<Real>& times);
+
+protected:
+
+    void integrate(
+        const std::size_t begin, const std::size_t end,
+        const std::vector<Real>& times, ODEEnsembleResult& result) const;
+    void integrate_block(
+        const std::size_t begin, const std::size_t end,
+        const std::vector<Real>& times, ODEEnsembleResult& result,
+        std::exception_ptr& error) const;
+
+protected:
+
+    std::shared_ptr<ODEWorld> world_;
+    std::shared_ptr<Model> model_;
+
+    std::vector<Species> species_;
+    std::size_t num_members_;
+    bool initialized_;
+    compiled_reaction_container_type compiled_;
+
+    /**
+     * values and rate constants given at the construction.
+     */
+    std::vector<std::vector<Real> > initial_values_;
+    std::vector<std::vector<Real> > initial_k_;
+
+    /**
+     * rate constants and initial values of members,
+     * k_[reaction * M + member] and values_[species * M + member].
+     */
+    std::vector<Real> k_;
+    std::vector<Real> values_;
+
+    ODESolverType solver_type_;
+    Integer num_threads_;
+    Real dt_, abs_tol_, rel_tol_, max_dt_;
+};
+
+} // ode
+
+} // ecell4
+
+#endif /* ECELL4_ODE_ODE_ENSEMBLE_SIMULATOR_HPP */
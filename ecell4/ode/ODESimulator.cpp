@@ -1,6 +1,8 @@
 #include "ODESimulator.hpp"
+#include "SparseRosenbrock4.hpp"
 
 #include <boost/numeric/odeint.hpp>
+#include <boost/ref.hpp>
 #include <algorithm>
 
 namespace odeint = boost::numeric::odeint;
@@ -13,8 +15,13 @@ namespace ode
 
 ODESimulator::reaction_container_type ODESimulator::convert_reactions() const
 {
-    const std::vector<Species> species(world_->list_species());
-    const Model::reaction_rule_container_type& reaction_rules = model_->reaction_rules();
+    return convert_reactions(world_->list_species(), model_->reaction_rules());
+}
+
+ODESimulator::reaction_container_type ODESimulator::convert_reactions(
+    const std::vector<Species>& species,
+    const Model::reaction_rule_container_type& reaction_rules)
+{
     typedef std::unordered_map<
         Species, state_type::size_type> species_map_type;
 
@@ -78,13 +85,348 @@ ODESimulator::reaction_container_type ODESimulator::convert_reactions() const
     return reactions;
 }
 
+const std::size_t ODESimulator::compiled_reaction_container_type::npos;
+
+ODESimulator::compiled_reaction_container_type ODESimulator::compile_reactions(
+    const reaction_container_type& reactions, const Real& volume)
+{
+    compiled_reaction_container_type compiled;
+    compiled.reactant_offsets.push_back(0);
+    compiled.stoichiometry_offsets.push_back(0);
+
+    for (reaction_container_type::const_iterator i(reactions.begin());
+        i != reactions.end(); ++i)
+    {
+        const reaction_type& r(*i);
+
+        Real k(r.k);
+        bool mass_action(true);
+        if (!r.ratelaw.expired())
+        {
+            const std::shared_ptr<ReactionRuleDescriptor> ratelaw(r.ratelaw.lock());
+            const ReactionRuleDescriptorMassAction* const massaction(
+                dynamic_cast<const ReactionRuleDescriptorMassAction*>(ratelaw.get()));
+            if (massaction != NULL)
+            {
+                k = massaction->k();
+            }
+            else
+            {
+                mass_action = false;
+                compiled.ratelaw_indices.push_back(compiled.ratelaws.size());
+                compiled.ratelaws.push_back(ratelaw);
+                compiled.ratelaw_products.push_back(r.products);
+            }
+        }
+
+        Real order(0.0);
+        for (std::size_t j(0); j < r.reactants.size(); ++j)
+        {
+            const Real coef(r.reactant_coefficients[j]);
+            compiled.reactant_indices.push_back(r.reactants[j]);
+            compiled.reactant_coefficients.push_back(coef);
+            compiled.reactant_powers.push_back(
+                (coef >= 0 && coef <= 4 && coef == std::floor(coef)) ? static_cast<int>(coef) : -1);
+            order += coef;
+        }
+        compiled.reactant_offsets.push_back(compiled.reactant_indices.size());
+
+        if (mass_action)
+        {
+            compiled.ratelaw_indices.push_back(compiled_reaction_container_type::npos);
+            compiled.k.push_back(k * std::pow(volume, 1.0 - order));
+        }
+        else
+        {
+            compiled.k.push_back(0.0);
+        }
+
+        // Merge the stoichiometry of the same species.
+        const std::size_t offset(compiled.stoichiometry_indices.size());
+        for (std::size_t j(0); j < r.reactants.size() + r.products.size(); ++j)
+        {
+            const bool is_reactant(j < r.reactants.size());
+            const state_type::size_type idx(
+                is_reactant ? r.reactants[j] : r.products[j - r.reactants.size()]);
+            const Real coef(
+                is_reactant ? -r.reactant_coefficients[j]
+                    : r.product_coefficients[j - r.reactants.size()]);
+
+            index_container_type::iterator it(
+                std::find(compiled.stoichiometry_indices.begin() + offset,
+                          compiled.stoichiometry_indices.end(), idx));
+            if (it == compiled.stoichiometry_indices.end())
+            {
+                compiled.stoichiometry_indices.push_back(idx);
+                compiled.stoichiometry.push_back(coef);
+            }
+            else
+            {
+                compiled.stoichiometry[it - compiled.stoichiometry_indices.begin()] += coef;
+            }
+        }
+
+        // Drop species unchanged by the reaction, e.g. an enzyme.
+        std::size_t last(offset);
+        for (std::size_t j(offset); j < compiled.stoichiometry.size(); ++j)
+        {
+            if (compiled.stoichiometry[j] != 0.0)
+            {
+                compiled.stoichiometry_indices[last] = compiled.stoichiometry_indices[j];
+                compiled.stoichiometry[last] = compiled.stoichiometry[j];
+                ++last;
+            }
+        }
+        compiled.stoichiometry_indices.resize(last);
+        compiled.stoichiometry.resize(last);
+        compiled.stoichiometry_offsets.push_back(last);
+    }
+    return compiled;
+}
+
+ODESimulator::jacobi_func::jacobi_func(
+    const compiled_reaction_container_type& reactions, const std::size_t num_species,
+    const Real& volume, const Real& abs_tol, const Real& rel_tol)
+    : reactions_(reactions), volume_(volume), abs_tol_(abs_tol), rel_tol_(rel_tol)
+{
+    std::vector<SparseMatrix::entry_type> entries;
+    for (std::size_t i(0); i < reactions_.size(); ++i)
+    {
+        const index_container_type columns(list_columns(i));
+        for (index_container_type::const_iterator j(columns.begin());
+            j != columns.end(); ++j)
+        {
+            for (std::size_t s(reactions_.stoichiometry_offsets[i]);
+                s < reactions_.stoichiometry_offsets[i + 1]; ++s)
+            {
+                entries.push_back(
+                    SparseMatrix::entry_type(reactions_.stoichiometry_indices[s], *j));
+            }
+        }
+    }
+    jacobian_ = SparseMatrix(num_species, entries);
+
+    position_offsets_.push_back(0);
+    for (std::size_t i(0); i < reactions_.size(); ++i)
+    {
+        const index_container_type columns(list_columns(i));
+        for (index_container_type::const_iterator j(columns.begin());
+            j != columns.end(); ++j)
+        {
+            for (std::size_t s(reactions_.stoichiometry_offsets[i]);
+                s < reactions_.stoichiometry_offsets[i + 1]; ++s)
+            {
+                positions_.push_back(jacobian_.find(reactions_.stoichiometry_indices[s], *j));
+            }
+        }
+        position_offsets_.push_back(positions_.size());
+    }
+
+    for (std::size_t i(0); i < reactions_.ratelaws.size(); ++i)
+    {
+        reactants_states_.push_back(
+            ReactionRuleDescriptor::state_container_type(
+                reactions_.ratelaws[i]->reactant_coefficients().size()));
+        products_states_.push_back(
+            ReactionRuleDescriptor::state_container_type(
+                reactions_.ratelaw_products[i].size()));
+    }
+}
+
+ODESimulator::index_container_type
+ODESimulator::jacobi_func::list_columns(const std::size_t i) const
+{
+    // A rate law may depend on products as well as reactants.
+    index_container_type columns(
+        reactions_.reactant_indices.begin() + reactions_.reactant_offsets[i],
+        reactions_.reactant_indices.begin() + reactions_.reactant_offsets[i + 1]);
+    const std::size_t idx(reactions_.ratelaw_indices[i]);
+    if (idx != compiled_reaction_container_type::npos)
+    {
+        const index_container_type& products(reactions_.ratelaw_products[idx]);
+        columns.insert(columns.end(), products.begin(), products.end());
+    }
+    return columns;
+}
+
+const SparseMatrix& ODESimulator::jacobi_func::evaluate(
+    const state_type& x, const double& t, state_type& dfdt)
+{
+    const Real SQRTETA(1.4901161193847656e-08);
+    const Real r0(1.0);
+    const Real ht(1.0e-10);
+
+    jacobian_.clear();
+    std::fill(dfdt.begin(), dfdt.end(), 0.0);
+    SparseMatrix::value_container_type& values(jacobian_.values());
+
+    for (std::size_t i(0); i < reactions_.size(); ++i)
+    {
+        const std::size_t begin(reactions_.reactant_offsets[i]),
+            end(reactions_.reactant_offsets[i + 1]);
+        const std::size_t sbegin(reactions_.stoichiometry_offsets[i]),
+            send(reactions_.stoichiometry_offsets[i + 1]);
+        const std::size_t offset(position_offsets_[i]);
+        const std::size_t idx(reactions_.ratelaw_indices[i]);
+
+        if (sbegin == send)
+        {
+            continue;  // No species is changed by this reaction.
+        }
+        else if (idx == compiled_reaction_container_type::npos)
+        {
+            // d/dx_j k prod_l x_l^c_l = k c_j x_j^(c_j-1) prod_{l!=j} x_l^c_l
+            for (std::size_t j(begin); j < end; ++j)
+            {
+                Real deriv(reactions_.k[i] * compiled_reaction_container_type::power_derivative(
+                    x[reactions_.reactant_indices[j]],
+                    reactions_.reactant_powers[j], reactions_.reactant_coefficients[j]));
+                for (std::size_t l(begin); l < end; ++l)
+                {
+                    if (l != j)
+                    {
+                        deriv *= compiled_reaction_container_type::power(
+                            x[reactions_.reactant_indices[l]],
+                            reactions_.reactant_powers[l], reactions_.reactant_coefficients[l]);
+                    }
+                }
+
+                if (deriv == 0.0)
+                {
+                    continue;
+                }
+                const std::size_t* const positions(
+                    &positions_[offset + (j - begin) * (send - sbegin)]);
+                for (std::size_t s(sbegin); s < send; ++s)
+                {
+                    values[positions[s - sbegin]] += deriv * reactions_.stoichiometry[s];
+                }
+            }
+            continue;
+        }
+
+        ReactionRuleDescriptor::state_container_type& reactants_states(reactants_states_[idx]);
+        ReactionRuleDescriptor::state_container_type& products_states(products_states_[idx]);
+        for (std::size_t j(begin); j < end; ++j)
+        {
+            reactants_states[j - begin] = x[reactions_.reactant_indices[j]];
+        }
+        const index_container_type& products(reactions_.ratelaw_products[idx]);
+        for (std::size_t j(0); j < products.size(); ++j)
+        {
+            products_states[j] = x[products[j]];
+        }
+
+        const std::shared_ptr<ReactionRuleDescriptor>& ratelaw(reactions_.ratelaws[idx]);
+        assert(ratelaw->is_available());
+        const Real flux_0 = ratelaw->propensity(reactants_states, products_states, volume_, t);
+
+        // Differentiate by time
+        {
+            const Real flux = ratelaw->propensity(reactants_states, products_states, volume_, t + ht);
+            const Real flux_deriv = (flux - flux_0) / ht;
+            if (flux_deriv != 0.0)
+            {
+                for (std::size_t s(sbegin); s < send; ++s)
+                {
+                    dfdt[reactions_.stoichiometry_indices[s]] += flux_deriv * reactions_.stoichiometry[s];
+                }
+            }
+        }
+
+        // Differentiate by each reactant and product
+        for (std::size_t c(0); c < reactants_states.size() + products_states.size(); ++c)
+        {
+            const bool is_reactant(c < reactants_states.size());
+            Real& xc(is_reactant ? reactants_states[c] : products_states[c - reactants_states.size()]);
+            const Real x0(xc);
+            const Real ewt = abs_tol_ + rel_tol_ * std::abs(x0);
+            const Real h = std::max(SQRTETA * std::abs(x0), r0 * ewt);
+            xc = x0 + h;
+            const Real flux = ratelaw->propensity(reactants_states, products_states, volume_, t);
+            xc = x0;
+
+            const Real flux_deriv = (flux - flux_0) / h;
+            const std::size_t* const positions(&positions_[offset + c * (send - sbegin)]);
+            for (std::size_t s(sbegin); s < send; ++s)
+            {
+                values[positions[s - sbegin]] += flux_deriv * reactions_.stoichiometry[s];
+            }
+        }
+    }
+    return jacobian_;
+}
+
 std::pair<ODESimulator::deriv_func, ODESimulator::jacobi_func>
 ODESimulator::generate_system() const
 {
-    const reaction_container_type reactions(convert_reactions());
+    const compiled_reaction_container_type reactions(
+        compile_reactions(convert_reactions(), world_->volume()));
     return std::make_pair(
             deriv_func(reactions, world_->volume()),
-            jacobi_func(reactions, world_->volume(), abs_tol_, rel_tol_));
+            jacobi_func(
+                reactions, world_->list_species().size(), world_->volume(),
+                abs_tol_, rel_tol_));
+}
+
+std::vector<Real> ODESimulator::descriptor_parameters(const ReactionRule& rr)
+{
+    std::vector<Real> params;
+    if (!rr.has_descriptor() || !rr.get_descriptor()->has_coefficients())
+    {
+        return params;  // the descriptor is ignored by convert_reactions
+    }
+
+    const std::shared_ptr<ReactionRuleDescriptor>& rrd(rr.get_descriptor());
+    const ReactionRuleDescriptorMassAction* const massaction(
+        dynamic_cast<const ReactionRuleDescriptorMassAction*>(rrd.get()));
+    if (massaction != NULL)
+    {
+        params.push_back(massaction->k());
+    }
+
+    const ReactionRuleDescriptor::coefficient_container_type&
+        reactants_coeff(rrd->reactant_coefficients());
+    const ReactionRuleDescriptor::coefficient_container_type&
+        products_coeff(rrd->product_coefficients());
+    params.insert(params.end(), reactants_coeff.begin(), reactants_coeff.end());
+    params.insert(params.end(), products_coeff.begin(), products_coeff.end());
+    return params;
+}
+
+void ODESimulator::update_system(const std::vector<Species>& species)
+{
+    const Model::reaction_rule_container_type& reaction_rules(model_->reaction_rules());
+
+    bool updated(!system_ || species != species_ || world_->volume() != volume_
+        || reaction_rules.size() != reaction_rules_.size());
+    for (Model::reaction_rule_container_type::size_type i(0);
+        !updated && i < reaction_rules.size(); ++i)
+    {
+        const ReactionRule& rr1(reaction_rules[i]);
+        const ReactionRule& rr2(reaction_rules_[i]);
+        updated = (rr1 != rr2 || rr1.k() != rr2.k()
+            || rr1.get_descriptor() != descriptors_[i]
+            || descriptor_parameters(rr1) != descriptor_parameters_[i]);
+    }
+
+    if (!updated)
+    {
+        return;
+    }
+
+    species_ = species;
+    volume_ = world_->volume();
+    reaction_rules_ = reaction_rules;
+    descriptors_.clear();
+    descriptor_parameters_.clear();
+    for (Model::reaction_rule_container_type::const_iterator i(reaction_rules.begin());
+        i != reaction_rules.end(); ++i)
+    {
+        descriptors_.push_back((*i).get_descriptor());
+        descriptor_parameters_.push_back(descriptor_parameters(*i));
+    }
+    system_.reset(new std::pair<deriv_func, jacobi_func>(generate_system()));
 }
 
 bool ODESimulator::step(const Real &upto)
@@ -108,7 +450,8 @@ bool ODESimulator::step(const Real &upto)
         x[i] = static_cast<double>(world_->get_value_exact(*it));
         i++;
     }
-    std::pair<deriv_func, jacobi_func> system(generate_system());
+    update_system(species);
+    std::pair<deriv_func, jacobi_func>& system(*system_);
     StateAndTimeBackInserter::state_container_type x_vec;
     StateAndTimeBackInserter::time_container_type times;
 
@@ -121,7 +464,7 @@ bool ODESimulator::step(const Real &upto)
                 steps = (
                     odeint::integrate_adaptive(
                         odeint::make_controlled<error_stepper_type>(abs_tol_, rel_tol_, max_dt_),
-                        system.first, x, t(), ntime, dt,
+                        boost::ref(system.first), x, t(), ntime, dt,
                         StateAndTimeBackInserter(x_vec, times)));
             }
             break;
@@ -131,7 +474,17 @@ bool ODESimulator::step(const Real &upto)
                 steps = (
                     odeint::integrate_adaptive(
                         odeint::make_controlled<error_stepper_type>(abs_tol_, rel_tol_, max_dt_),
-                        system, x, t(), ntime, dt,
+                        boost::ref(system), x, t(), ntime, dt,
+                        StateAndTimeBackInserter(x_vec, times)));
+            }
+            break;
+        case ecell4::ode::SPARSE_ROSENBROCK4_CONTROLLER:
+            {
+                typedef odeint::rosenbrock4_controller<sparse_rosenbrock4> controlled_stepper_type;
+                steps = (
+                    odeint::integrate_adaptive(
+                        controlled_stepper_type(abs_tol_, rel_tol_, max_dt_),
+                        boost::ref(system), x, t(), ntime, dt,
                         StateAndTimeBackInserter(x_vec, times)));
             }
             break;
@@ -140,7 +493,7 @@ bool ODESimulator::step(const Real &upto)
                 typedef odeint::euler<state_type> stepper_type;
                 steps = (
                     odeint::integrate_const(
-                        stepper_type(), system.first, x, t(), ntime, dt,
+                        stepper_type(), boost::ref(system.first), x, t(), ntime, dt,
                         StateAndTimeBackInserter(x_vec, times)));
             }
             break;
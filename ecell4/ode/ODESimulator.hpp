@@ -6,6 +6,7 @@
 #include <numeric>
 #include <map>
 #include <memory>
+#include <cmath>
 
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
@@ -17,6 +18,7 @@
 #include <ecell4/core/SimulatorBase.hpp>
 
 #include "ODEWorld.hpp"
+#include "SparseMatrix.hpp"
 
 namespace ecell4
 {
@@ -27,6 +29,7 @@ enum ODESolverType {
     RUNGE_KUTTA_CASH_KARP54 = 0,
     ROSENBROCK4_CONTROLLER = 1,
     EULER = 2,
+    SPARSE_ROSENBROCK4_CONTROLLER = 3,
 };
 
 class ODESimulator
@@ -56,283 +59,233 @@ public:
     };
     typedef std::vector<reaction_type> reaction_container_type;
 
+    /**
+     * reactions compiled into flat arrays in the CSR format.
+     * The reactants and the net stoichiometry of the i-th reaction are
+     * stored in [reactant_offsets[i], reactant_offsets[i + 1]) and
+     * [stoichiometry_offsets[i], stoichiometry_offsets[i + 1]) respectively.
+     * A mass action flux is evaluated inline as k V^(1-n) prod x_j^c_j,
+     * where n is the sum of coefficients c_j. k is already multiplied by
+     * the volume factor. Only a user-defined rate law is given as a
+     * descriptor, whose index is in ratelaw_indices.
+     */
+    struct compiled_reaction_container_type
+    {
+        coefficient_container_type k;
+        std::vector<std::size_t> ratelaw_indices;
+
+        std::vector<std::size_t> reactant_offsets;
+        index_container_type reactant_indices;
+        coefficient_container_type reactant_coefficients;
+        std::vector<int> reactant_powers;
+
+        std::vector<std::size_t> stoichiometry_offsets;
+        index_container_type stoichiometry_indices;
+        coefficient_container_type stoichiometry;
+
+        std::vector<std::shared_ptr<ReactionRuleDescriptor> > ratelaws;
+        std::vector<index_container_type> ratelaw_products;
+
+        static const std::size_t npos = static_cast<std::size_t>(-1);
+
+        std::size_t size() const
+        {
+            return k.size();
+        }
+
+        /**
+         * x^c, where p is c if c is a small non-negative integer, or -1.
+         */
+        static inline double power(const double x, const int p, const double c)
+        {
+            if (p == 1)
+            {
+                return x;
+            }
+            else if (p < 0)
+            {
+                return std::pow(x, c);
+            }
+
+            double ret(1.0);
+            for (int n(0); n < p; ++n)
+            {
+                ret *= x;
+            }
+            return ret;
+        }
+
+        /**
+         * c x^(c-1), the derivative of power(x, p, c).
+         */
+        static inline double power_derivative(const double x, const int p, const double c)
+        {
+            if (p < 0)
+            {
+                return c * std::pow(x, c - 1.0);
+            }
+            else if (p == 0)
+            {
+                return 0.0;
+            }
+            return p * power(x, p - 1, c - 1.0);
+        }
+    };
+
+    static reaction_container_type convert_reactions(
+        const std::vector<Species>& species,
+        const Model::reaction_rule_container_type& reaction_rules);
+    static compiled_reaction_container_type compile_reactions(
+        const reaction_container_type& reactions, const Real& volume);
+
     class deriv_func
     {
     public:
-        deriv_func(const reaction_container_type &reactions, const Real &volume)
+        deriv_func(const compiled_reaction_container_type &reactions, const Real &volume)
             : reactions_(reactions), volume_(volume), vinv_(1.0 / volume)
         {
-            ;
+            // Buffers for rate laws are allocated only once.
+            for (std::size_t i(0); i < reactions_.ratelaws.size(); ++i)
+            {
+                reactants_states_.push_back(
+                    ReactionRuleDescriptor::state_container_type(
+                        reactions_.ratelaws[i]->reactant_coefficients().size()));
+                products_states_.push_back(
+                    ReactionRuleDescriptor::state_container_type(
+                        reactions_.ratelaw_products[i].size()));
+            }
         }
 
         void operator()(const state_type &x, state_type &dxdt, const double &t)
         {
             std::fill(dxdt.begin(), dxdt.end(), 0.0);
-            for(reaction_container_type::const_iterator i(reactions_.begin());
-                i != reactions_.end(); i++)
+            for (std::size_t i(0); i < reactions_.size(); ++i)
             {
-                ReactionRuleDescriptor::state_container_type reactants_states(i->reactants.size());
-                ReactionRuleDescriptor::state_container_type products_states(i->products.size());
-                ReactionRuleDescriptor::state_container_type::size_type cnt(0);
+                const std::size_t begin(reactions_.reactant_offsets[i]),
+                    end(reactions_.reactant_offsets[i + 1]);
+                const std::size_t idx(reactions_.ratelaw_indices[i]);
 
-                for(index_container_type::const_iterator j(i->reactants.begin());
-                    j != i->reactants.end(); j++, cnt++)
-                {
-                    reactants_states[cnt] = x[*j];
-                }
-                cnt = 0;
-                for(index_container_type::const_iterator j(i->products.begin());
-                    j != i->products.end(); j++, cnt++)
-                {
-                    products_states[cnt] = x[*j];
-                }
                 double flux;
-                // Calculation! XXX
-                if (i->ratelaw.expired())
+                if (idx == compiled_reaction_container_type::npos)
                 {
-                    std::unique_ptr<ReactionRuleDescriptor> temporary_ratelaw_obj(new ReactionRuleDescriptorMassAction(i->k, i->reactant_coefficients, i->product_coefficients));
-                    flux = temporary_ratelaw_obj->propensity(reactants_states, products_states, volume_, t);
+                    flux = reactions_.k[i];
+                    for (std::size_t j(begin); j < end; ++j)
+                    {
+                        flux *= compiled_reaction_container_type::power(
+                            x[reactions_.reactant_indices[j]],
+                            reactions_.reactant_powers[j], reactions_.reactant_coefficients[j]);
+                    }
                 }
                 else
                 {
-                    std::shared_ptr<ReactionRuleDescriptor> ratelaw = i->ratelaw.lock();
+                    ReactionRuleDescriptor::state_container_type&
+                        reactants_states(reactants_states_[idx]);
+                    ReactionRuleDescriptor::state_container_type&
+                        products_states(products_states_[idx]);
+                    for (std::size_t j(begin); j < end; ++j)
+                    {
+                        reactants_states[j - begin] = x[reactions_.reactant_indices[j]];
+                    }
+                    const index_container_type& products(reactions_.ratelaw_products[idx]);
+                    for (std::size_t j(0); j < products.size(); ++j)
+                    {
+                        products_states[j] = x[products[j]];
+                    }
+
+                    const std::shared_ptr<ReactionRuleDescriptor>& ratelaw(reactions_.ratelaws[idx]);
                     assert(ratelaw->is_available());
                     flux = ratelaw->propensity(reactants_states, products_states, volume_, t);
                 }
+
                 // Merge each reaction's flux into whole dxdt
-                std::size_t nth = 0;
-                for(index_container_type::const_iterator j(i->reactants.begin());
-                    j != i->reactants.end(); j++)
-                {
-                    dxdt[*j] -= (flux * (double)i->reactant_coefficients[nth]);
-                    nth++;
-                }
-                nth = 0;
-                for(index_container_type::const_iterator j(i->products.begin()); 
-                    j != i->products.end(); j++)
+                for (std::size_t j(reactions_.stoichiometry_offsets[i]);
+                    j < reactions_.stoichiometry_offsets[i + 1]; ++j)
                 {
-                    dxdt[*j] += (flux * (double)i->product_coefficients[nth]);
-                    nth++;
+                    dxdt[reactions_.stoichiometry_indices[j]] += flux * reactions_.stoichiometry[j];
                 }
             }
             return;
         }
     protected:
-        const reaction_container_type reactions_;
+        const compiled_reaction_container_type reactions_;
         const Real volume_;
         const Real vinv_;
+        std::vector<ReactionRuleDescriptor::state_container_type>
+            reactants_states_, products_states_;
     };
 
+    /**
+     * The Jacobian in the sparse form, whose pattern is derived from
+     * the reactants and the stoichiometry of each reaction.
+     * Mass action reactions are differentiated analytically.
+     * Only user-defined rate laws are differentiated numerically
+     * with respect to their reactants, products and time.
+     */
     class jacobi_func
     {
     public:
+
         jacobi_func(
-            const reaction_container_type &reactions, const Real& volume,
-            const Real& abs_tol, const Real& rel_tol)
-            : reactions_(reactions), volume_(volume), vinv_(1.0 / volume), abs_tol_(abs_tol), rel_tol_(rel_tol)
-        {
-            ;
-        }
+            const compiled_reaction_container_type& reactions, const std::size_t num_species,
+            const Real& volume, const Real& abs_tol, const Real& rel_tol);
+
+        /**
+         * evaluate the Jacobian at (x, t) together with the derivatives by time.
+         */
+        const SparseMatrix& evaluate(const state_type& x, const double& t, state_type& dfdt);
+
         void operator()(
-                const state_type& x, matrix_type& jacobi, const double &t, state_type &dfdt) const
+                const state_type& x, matrix_type& jacobi, const double &t, state_type &dfdt)
         {
-            //fill 0 into jacobi and dfdt
-            std::fill(dfdt.begin(), dfdt.end(), 0.0);
+            const SparseMatrix& sparse(evaluate(x, t, dfdt));
             std::fill(jacobi.data().begin(), jacobi.data().end(), 0.0);
+            sparse.copy_to(jacobi);
+        }
 
-            // const Real ETA(2.2204460492503131e-16);
-            const Real SQRTETA(1.4901161193847656e-08);
-            const Real r0(1.0);
-            // Real fac(0.0);
-            // for (std::size_t k(0); k < dfdt.size(); ++k)
-            // {
-            //     const Real ewtk(atol + rtol * x[k]);
-            //     fac = std::max(fac, dfdt[k] * ewtk);
-            // }
-            // const Real r0(1000.0 * h * ETA * dfdt.size() * fac);  //XXX: h means the step interval
-            // {
-            //     const Real ewtj(atol + rtol * x[j]);
-            //     const Real dyj(std::max(SQRTETA * abs(x[j]), r0 * ewtj));
-            // }
-
-            // const Real h(1.0e-8);
-            // const Real ht(1.0e-10);
-            const Real ht(1.0e-10);
+        /**
+         * the Jacobian last evaluated.
+         */
+        const SparseMatrix& matrix() const
+        {
+            return jacobian_;
+        }
 
-            // calculate jacobian for each reaction and merge it.
-            for(reaction_container_type::const_iterator i(reactions_.begin());
-                i != reactions_.end(); i++)
+        /**
+         * return the LU solver for the pattern of the Jacobian.
+         * The symbolic analysis is done at the first call.
+         */
+        SparseLU& linear_solver()
+        {
+            if (!lu_)
             {
-                // Calculate one reactions's jabobian
-                //  Prepare the state_array to pass ReactionRuleDescriptor.
-                index_container_type::size_type reactants_size(i->reactants.size());
-                index_container_type::size_type products_size(i->products.size());
-                ReactionRuleDescriptor::state_container_type reactants_states(reactants_size);
-                ReactionRuleDescriptor::state_container_type products_states(products_size);
-                ReactionRuleDescriptor::state_container_type::size_type cnt(0);
-                for(index_container_type::const_iterator j(i->reactants.begin());
-                    j != i->reactants.end(); j++, cnt++)
-                {
-                    reactants_states[cnt] = x[*j];
-                }
-                cnt = 0;
-                for(index_container_type::const_iterator j(i->products.begin());
-                    j != i->products.end(); j++, cnt++)
-                {
-                    products_states[cnt] = x[*j];
-                }
-                // Call the ReactionRuleDescriptor object
-
-                if (i->ratelaw.expired())
-                {
-                    std::unique_ptr<ReactionRuleDescriptor> temporary_ratelaw_obj(new ReactionRuleDescriptorMassAction(i->k, i->reactant_coefficients, i->product_coefficients));
-                    Real flux_0 = temporary_ratelaw_obj->propensity(reactants_states, products_states, volume_, t);
-                    // Differentiate by time
-                    {
-                        Real flux = temporary_ratelaw_obj->propensity(reactants_states, products_states, volume_, t + ht);
-                        Real flux_deriv = (flux - flux_0) / ht;
-                        if (flux_deriv != 0.0)
-                        {
-                            for(std::size_t k(0); k < i->reactants.size(); k++)
-                            {
-                                matrix_type::size_type row = i->reactants[k];
-                                Real coeff = i->reactant_coefficients[k];
-                                dfdt[row] -= coeff * flux_deriv;
-                            }
-                            for(std::size_t k(0); k < i->products.size(); k++)
-                            {
-                                matrix_type::size_type row = i->products[k];
-                                Real coeff = i->product_coefficients[k];
-                                dfdt[row] += coeff * flux_deriv;
-                            }
-                        }
-                    }
-                    // Differentiate by each Reactants
-                    for(std::size_t j(0); j < reactants_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(reactants_states[j]);
-                        const Real h = std::max(SQRTETA * abs(reactants_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(reactants_states);
-                        h_shift[j] += h;
-                        Real flux = temporary_ratelaw_obj->propensity(h_shift, products_states, volume_, t);
-                        Real flux_deriv = (flux - flux_0) / h;
-                        matrix_type::size_type col = i->reactants[j];
-                        for(std::size_t k(0); k < i->reactants.size(); k++)
-                        {
-                            matrix_type::size_type row = i->reactants[k];
-                            Real coeff = i->reactant_coefficients[k];
-                            jacobi(row, col) -= coeff * flux_deriv;
-                        }
-                        for(std::size_t k(0); k < i->products.size(); k++)
-                        {
-                            matrix_type::size_type row = i->products[k];
-                            Real coeff = i->product_coefficients[k];
-                            jacobi(row, col) += coeff * flux_deriv;
-                        }
-                    }
-                    // Differentiate by Products
-                    for(std::size_t j(0); j < products_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(products_states[j]);
-                        const Real h = std::max(SQRTETA * abs(products_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(products_states);
-                        h_shift[j] += h;
-                        Real flux = temporary_ratelaw_obj->propensity(reactants_states, h_shift, volume_, t);
-                        Real flux_deriv = (flux - flux_0) / h;
-                        matrix_type::size_type col = i->products[j];
-                        for(std::size_t k(0); k < i->reactants.size(); k++)
-                        {
-                            matrix_type::size_type row = i->reactants[k];
-                            Real coeff = i->reactant_coefficients[k];
-                            jacobi(row, col) -= coeff * flux_deriv;
-                        }
-                        for(std::size_t k(0); k < i->products.size(); k++)
-                        {
-                            matrix_type::size_type row = i->products[k];
-                            Real coeff = i->product_coefficients[k];
-                            jacobi(row, col) += coeff * flux_deriv;
-                        }
-                    }
-                }
-                else
-                {
-                    std::shared_ptr<ReactionRuleDescriptor> ratelaw = i->ratelaw.lock();
-                    assert(ratelaw->is_available());
-                    Real flux_0 = ratelaw->propensity(reactants_states, products_states, volume_, t);
-                    // Differentiate by time
-                    {
-                        Real flux = ratelaw->propensity(reactants_states, products_states, volume_, t + ht);
-                        Real flux_deriv = (flux - flux_0) / ht;
-                        if (flux_deriv != 0.0)
-                        {
-                            for(std::size_t k(0); k < i->reactants.size(); k++)
-                            {
-                                matrix_type::size_type row = i->reactants[k];
-                                Real coeff = i->reactant_coefficients[k];
-                                dfdt[row] -= coeff * flux_deriv;
-                            }
-                            for(std::size_t k(0); k < i->products.size(); k++)
-                            {
-                                matrix_type::size_type row = i->products[k];
-                                Real coeff = i->product_coefficients[k];
-                                dfdt[row] += coeff * flux_deriv;
-                            }
-                        }
-                    }
-                    // Differentiate by each Reactants
-                    for(std::size_t j(0); j < reactants_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(reactants_states[j]);
-                        const Real h = std::max(SQRTETA * abs(reactants_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(reactants_states);
-                        h_shift[j] += h;
-                        Real flux = ratelaw->propensity(h_shift, products_states, volume_, t);
-                        Real flux_deriv = (flux - flux_0) / h;
-                        matrix_type::size_type col = i->reactants[j];
-                        for(std::size_t k(0); k < i->reactants.size(); k++)
-                        {
-                            matrix_type::size_type row = i->reactants[k];
-                            Real coeff = i->reactant_coefficients[k];
-                            jacobi(row, col) -= coeff * flux_deriv;
-                        }
-                        for(std::size_t k(0); k < i->products.size(); k++)
-                        {
-                            matrix_type::size_type row = i->products[k];
-                            Real coeff = i->product_coefficients[k];
-                            jacobi(row, col) += coeff * flux_deriv;
-                        }
-                    }
-                    // Differentiate by Products
-                    for(std::size_t j(0); j < products_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(products_states[j]);
-                        const Real h = std::max(SQRTETA * abs(products_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(products_states);
-                        h_shift[j] += h;
-                        Real flux = ratelaw->propensity(reactants_states, h_shift, volume_, t);
-                        Real flux_deriv = (flux - flux_0) / h;
-                        matrix_type::size_type col = i->products[j];
-                        for(std::size_t k(0); k < i->reactants.size(); k++)
-                        {
-                            matrix_type::size_type row = i->reactants[k];
-                            Real coeff = i->reactant_coefficients[k];
-                            jacobi(row, col) -= coeff * flux_deriv;
-                        }
-                        for(std::size_t k(0); k < i->products.size(); k++)
-                        {
-                            matrix_type::size_type row = i->products[k];
-                            Real coeff = i->product_coefficients[k];
-                            jacobi(row, col) += coeff * flux_deriv;
-                        }
-                    }
-                }
+                lu_.reset(new SparseLU(jacobian_));
             }
+            return *lu_;
         }
+
     protected:
-        const reaction_container_type reactions_;
-        const Real volume_;
-        const Real vinv_;
-        const Real abs_tol_, rel_tol_;
+
+        index_container_type list_columns(const std::size_t i) const;
+
+    protected:
+
+        compiled_reaction_container_type reactions_;
+        Real volume_;
+        Real abs_tol_, rel_tol_;
+
+        SparseMatrix jacobian_;
+
+        /**
+         * positions in the values of jacobian_ to which the derivative of
+         * the i-th reaction by its c-th column contributes through its s-th
+         * stoichiometry, [position_offsets_[i] + c * (# of stoichiometry) + s].
+         */
+        std::vector<std::size_t> position_offsets_;
+        std::vector<std::size_t> positions_;
+
+        std::vector<ReactionRuleDescriptor::state_container_type>
+            reactants_states_, products_states_;
+        std::shared_ptr<SparseLU> lu_;
     };
 
     class elasticity_func
@@ -495,7 +448,7 @@ public:
         const std::shared_ptr<Model>& model,
         const ODESolverType solver_type = ROSENBROCK4_CONTROLLER)
         : base_type(world, model), dt_(std::numeric_limits<Real>::infinity()),
-          abs_tol_(1e-6), rel_tol_(1e-6), max_dt_(0.0), solver_type_(solver_type)
+          abs_tol_(1e-6), rel_tol_(1e-6), max_dt_(0.0), solver_type_(solver_type), volume_(0.0)
     {
         initialize();
     }
@@ -504,7 +457,7 @@ public:
         const std::shared_ptr<ODEWorld>& world,
         const ODESolverType solver_type = ROSENBROCK4_CONTROLLER)
         : base_type(world), dt_(std::numeric_limits<Real>::infinity()),
-          abs_tol_(1e-6), rel_tol_(1e-6), max_dt_(0.0), solver_type_(solver_type)
+          abs_tol_(1e-6), rel_tol_(1e-6), max_dt_(0.0), solver_type_(solver_type), volume_(0.0)
     {
         initialize();
     }
@@ -526,6 +479,9 @@ public:
         }
 
         // ode_reaction_rules_ = convert_ode_reaction_rules(model_);
+
+        // Call this again after modifying the model.
+        update_system(world_->list_species());
     }
 
     void step(void)
@@ -724,6 +680,19 @@ protected:
     reaction_container_type convert_reactions() const;
     std::pair<deriv_func, jacobi_func> generate_system() const;
 
+    /**
+     * regenerate system_ if the species or the volume of the world,
+     * or the reaction rules of the model differ from those compiled.
+     */
+    void update_system(const std::vector<Species>& species);
+
+    /**
+     * return the parameters of the descriptor baked into the compiled system,
+     * i.e. the coefficients and the rate constant of the mass action.
+     * The descriptors of the model can be modified in place.
+     */
+    static std::vector<Real> descriptor_parameters(const ReactionRule& rr);
+
 protected:
 
     // std::shared_ptr<ODENetworkModel> model_;
@@ -734,6 +703,19 @@ protected:
     ODESolverType solver_type_;
 
     // ODENetworkModel::ode_reaction_rule_container_type ode_reaction_rules_;
+
+    /**
+     * the system compiled for the order of species_, volume_ and reaction_rules_.
+     * It is regenerated only when any of them is changed.
+     * Copying a ReactionRule clones its descriptor, so the descriptors of
+     * the model and their parameters are kept separately.
+     */
+    std::vector<Species> species_;
+    Real volume_;
+    Model::reaction_rule_container_type reaction_rules_;
+    std::vector<std::shared_ptr<ReactionRuleDescriptor> > descriptors_;
+    std::vector<std::vector<Real> > descriptor_parameters_;
+    std::unique_ptr<std::pair<deriv_func, jacobi_func> > system_;
 };
 
 } // ode
@@ -0,0 +1,236 @@
+#include "SparseMatrix.hpp"
+
+#include <set>
+#include <iterator>
+#include <queue>
+#include <functional>
+#include <stdexcept>
+#include <cmath>
+
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+const std::size_t SparseMatrix::npos;
+
+SparseMatrix::SparseMatrix(const std::size_t size, std::vector<entry_type> entries)
+    : size_(size)
+{
+    for (std::vector<entry_type>::const_iterator it(entries.begin());
+        it != entries.end(); ++it)
+    {
+        if ((*it).first >= size_ || (*it).second >= size_)
+        {
+            throw std::out_of_range("An entry is out of the matrix.");
+        }
+    }
+
+    for (std::size_t i(0); i < size_; ++i)
+    {
+        entries.push_back(entry_type(i, i));
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    row_offsets_.assign(size_ + 1, 0);
+    columns_.reserve(entries.size());
+    for (std::vector<entry_type>::const_iterator it(entries.begin());
+        it != entries.end(); ++it)
+    {
+        ++row_offsets_[(*it).first + 1];
+        columns_.push_back((*it).second);
+    }
+    for (std::size_t i(0); i < size_; ++i)
+    {
+        row_offsets_[i + 1] += row_offsets_[i];
+    }
+    values_.assign(columns_.size(), 0.0);
+}
+
+void SparseLU::analyze(const SparseMatrix& A)
+{
+    size_ = A.size();
+    const SparseMatrix::index_container_type& offsets(A.row_offsets());
+    const SparseMatrix::index_container_type& columns(A.columns());
+
+    // The minimum degree ordering on the symmetrized pattern
+    std::vector<index_container_type> adjacency(size_);
+    for (std::size_t i(0); i < size_; ++i)
+    {
+        for (std::size_t p(offsets[i]); p < offsets[i + 1]; ++p)
+        {
+            if (columns[p] != i)
+            {
+                adjacency[i].push_back(columns[p]);
+                adjacency[columns[p]].push_back(i);
+            }
+        }
+    }
+
+    typedef std::pair<std::size_t, std::size_t> degree_type;
+    std::priority_queue<
+        degree_type, std::vector<degree_type>, std::greater<degree_type> > queue;
+    for (std::size_t i(0); i < size_; ++i)
+    {
+        index_container_type& neighbors(adjacency[i]);
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        queue.push(degree_type(neighbors.size(), i));
+    }
+
+    permutation_.clear();
+    permutation_.reserve(size_);
+    std::vector<char> eliminated(size_, 0);
+    index_container_type merged;
+    while (!queue.empty())
+    {
+        const degree_type top(queue.top());
+        queue.pop();
+        const std::size_t v(top.second);
+        if (eliminated[v] || top.first != adjacency[v].size())
+        {
+            continue;  // a stale entry
+        }
+
+        eliminated[v] = 1;
+        permutation_.push_back(v);
+
+        // Eliminating v makes its neighbors a clique.
+        const index_container_type& neighbors(adjacency[v]);
+        for (index_container_type::const_iterator it(neighbors.begin());
+            it != neighbors.end(); ++it)
+        {
+            const std::size_t u(*it);
+            index_container_type& adj(adjacency[u]);
+            merged.clear();
+            std::set_union(adj.begin(), adj.end(), neighbors.begin(), neighbors.end(),
+                           std::back_inserter(merged));
+            adj.clear();
+            for (index_container_type::const_iterator j(merged.begin());
+                j != merged.end(); ++j)
+            {
+                if (*j != u && *j != v)
+                {
+                    adj.push_back(*j);
+                }
+            }
+            queue.push(degree_type(adj.size(), u));
+        }
+        index_container_type().swap(adjacency[v]);
+    }
+
+    index_container_type inverse(size_);
+    for (std::size_t i(0); i < size_; ++i)
+    {
+        inverse[permutation_[i]] = i;
+    }
+
+    // The symbolic factorization row by row
+    row_offsets_.assign(1, 0);
+    columns_.clear();
+    diagonal_.resize(size_);
+    std::set<std::size_t> row;
+    for (std::size_t i(0); i < size_; ++i)
+    {
+        row.clear();
+        row.insert(i);
+        const std::size_t original(permutation_[i]);
+        for (std::size_t p(offsets[original]); p < offsets[original + 1]; ++p)
+        {
+            row.insert(inverse[columns[p]]);
+        }
+
+        // The row i gets fill-in from U of each row k < i in its pattern.
+        for (std::set<std::size_t>::const_iterator it(row.begin()); *it < i; ++it)
+        {
+            const std::size_t k(*it);
+            for (std::size_t q(diagonal_[k] + 1); q < row_offsets_[k + 1]; ++q)
+            {
+                row.insert(columns_[q]);
+            }
+        }
+
+        for (std::set<std::size_t>::const_iterator it(row.begin()); it != row.end(); ++it)
+        {
+            if (*it == i)
+            {
+                diagonal_[i] = columns_.size();
+            }
+            columns_.push_back(*it);
+        }
+        row_offsets_.push_back(columns_.size());
+    }
+
+    positions_.resize(A.num_nonzeros());
+    for (std::size_t i(0); i < size_; ++i)
+    {
+        const std::size_t k(inverse[i]);
+        for (std::size_t p(offsets[i]); p < offsets[i + 1]; ++p)
+        {
+            const index_container_type::const_iterator it(
+                std::lower_bound(
+                    columns_.begin() + row_offsets_[k], columns_.begin() + row_offsets_[k + 1],
+                    inverse[columns[p]]));
+            positions_[p] = it - columns_.begin();
+        }
+    }
+
+    values_.assign(columns_.size(), 0.0);
+    scatter_.assign(size_, 0);
+    work_.assign(size_, 0.0);
+}
+
+bool SparseLU::factorize(const SparseMatrix& A, const Real alpha, const Real beta)
+{
+    if (A.size() != size_ || A.num_nonzeros() != positions_.size())
+    {
+        throw std::invalid_argument("The pattern differs from the analyzed one.");
+    }
+
+    std::fill(values_.begin(), values_.end(), 0.0);
+    const SparseMatrix::value_container_type& a(A.values());
+    for (std::size_t p(0); p < positions_.size(); ++p)
+    {
+        values_[positions_[p]] += beta * a[p];
+    }
+    for (std::size_t i(0); i < size_; ++i)
+    {
+        values_[diagonal_[i]] += alpha;
+    }
+
+    for (std::size_t i(0); i < size_; ++i)
+    {
+        for (std::size_t p(row_offsets_[i]); p < row_offsets_[i + 1]; ++p)
+        {
+            scatter_[columns_[p]] = p;
+        }
+
+        for (std::size_t p(row_offsets_[i]); p < diagonal_[i]; ++p)
+        {
+            const std::size_t k(columns_[p]);
+            const Real lik(values_[p] /= values_[diagonal_[k]]);
+            if (lik == 0.0)
+            {
+                continue;
+            }
+            for (std::size_t q(diagonal_[k] + 1); q < row_offsets_[k + 1]; ++q)
+            {
+                values_[scatter_[columns_[q]]] -= lik * values_[q];
+            }
+        }
+
+        const Real pivot(values_[diagonal_[i]]);
+        if (pivot == 0.0 || !std::isfinite(pivot))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // ode
+
+} // ecell4
@@ -0,0 +1,229 @@
+#ifndef ECELL4_ODE_SPARSE_MATRIX_HPP
+#define ECELL4_ODE_SPARSE_MATRIX_HPP
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <ecell4/core/types.hpp>
+
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+/**
+ * A square sparse matrix in the CSR format.
+ * The pattern is fixed at construction and always includes the diagonal.
+ * Columns in each row are sorted.
+ */
+class SparseMatrix
+{
+public:
+
+    typedef std::vector<std::size_t> index_container_type;
+    typedef std::vector<Real> value_container_type;
+    typedef std::pair<std::size_t, std::size_t> entry_type;
+
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+public:
+
+    SparseMatrix()
+        : size_(0), row_offsets_(1, 0)
+    {
+        ;
+    }
+
+    /**
+     * @param size the number of rows and columns
+     * @param entries a list of nonzero positions (row, column).
+     *  Duplicates are allowed.
+     */
+    SparseMatrix(const std::size_t size, std::vector<entry_type> entries);
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    std::size_t num_nonzeros() const
+    {
+        return columns_.size();
+    }
+
+    const index_container_type& row_offsets() const
+    {
+        return row_offsets_;
+    }
+
+    const index_container_type& columns() const
+    {
+        return columns_;
+    }
+
+    const value_container_type& values() const
+    {
+        return values_;
+    }
+
+    value_container_type& values()
+    {
+        return values_;
+    }
+
+    /**
+     * return the position of (i, j) in values(), or npos if not in the pattern.
+     */
+    std::size_t find(const std::size_t i, const std::size_t j) const
+    {
+        const index_container_type::const_iterator
+            first(columns_.begin() + row_offsets_[i]),
+            last(columns_.begin() + row_offsets_[i + 1]);
+        const index_container_type::const_iterator it(std::lower_bound(first, last, j));
+        return (it != last && *it == j ? it - columns_.begin() : npos);
+    }
+
+    void clear()
+    {
+        std::fill(values_.begin(), values_.end(), 0.0);
+    }
+
+    /**
+     * copy nonzeros into a dense matrix, which must be zero-filled.
+     */
+    template <typename Tmatrix_>
+    void copy_to(Tmatrix_& m) const
+    {
+        for (std::size_t i(0); i < size_; ++i)
+        {
+            for (std::size_t p(row_offsets_[i]); p < row_offsets_[i + 1]; ++p)
+            {
+                m(i, columns_[p]) = values_[p];
+            }
+        }
+    }
+
+protected:
+
+    std::size_t size_;
+    index_container_type row_offsets_;
+    index_container_type columns_;
+    value_container_type values_;
+};
+
+/**
+ * The LU factorization of (alpha I + beta A) for a SparseMatrix A.
+ * analyze() permutes rows and columns symmetrically by the minimum degree
+ * ordering, and computes the pattern of L and U including fill-in.
+ * It is done only once for a pattern. Then, factorize() and solve() can be
+ * called repeatedly for matrices with the same pattern without allocation,
+ * which is the case with an implicit ODE solver.
+ * No pivoting is done. factorize() returns false when a zero pivot occurs.
+ */
+class SparseLU
+{
+public:
+
+    typedef std::vector<std::size_t> index_container_type;
+    typedef std::vector<Real> value_container_type;
+
+public:
+
+    SparseLU()
+        : size_(0)
+    {
+        ;
+    }
+
+    SparseLU(const SparseMatrix& A)
+    {
+        analyze(A);
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    /**
+     * the number of nonzeros in L and U including fill-in.
+     */
+    std::size_t num_nonzeros() const
+    {
+        return columns_.size();
+    }
+
+    void analyze(const SparseMatrix& A);
+    bool factorize(const SparseMatrix& A, const Real alpha = 0.0, const Real beta = 1.0);
+
+    /**
+     * solve (alpha I + beta A) x = b in place.
+     */
+    template <typename Tvector_>
+    void solve(Tvector_& b)
+    {
+        for (std::size_t i(0); i < size_; ++i)
+        {
+            Real yi(b[permutation_[i]]);
+            for (std::size_t p(row_offsets_[i]); p < diagonal_[i]; ++p)
+            {
+                yi -= values_[p] * work_[columns_[p]];
+            }
+            work_[i] = yi;
+        }
+
+        for (std::size_t i(size_); i > 0; --i)
+        {
+            const std::size_t k(i - 1);
+            Real yk(work_[k]);
+            for (std::size_t p(diagonal_[k] + 1); p < row_offsets_[k + 1]; ++p)
+            {
+                yk -= values_[p] * work_[columns_[p]];
+            }
+            work_[k] = yk / values_[diagonal_[k]];
+        }
+
+        for (std::size_t i(0); i < size_; ++i)
+        {
+            b[permutation_[i]] = work_[i];
+        }
+    }
+
+protected:
+
+    std::size_t size_;
+
+    /**
+     * The i-th row and column of the factorized matrix are
+     * the permutation_[i]-th ones of the original.
+     */
+    index_container_type permutation_;
+
+    /**
+     * L (unit lower, without the diagonal) and U in a single CSR.
+     */
+    index_container_type row_offsets_;
+    index_container_type columns_;
+    index_container_type diagonal_;
+    value_container_type values_;
+
+    /**
+     * the position in values_ of each nonzero of A.
+     */
+    index_container_type positions_;
+
+    /**
+     * buffers for factorize() and solve().
+     */
+    index_container_type scatter_;
+    value_container_type work_;
+};
+
+} // ode
+
+} // ecell4
+
+#endif /* ECELL4_ODE_SPARSE_MATRIX_HPP */
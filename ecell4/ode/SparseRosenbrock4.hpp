@@ -0,0 +1,182 @@
+#ifndef ECELL4_ODE_SPARSE_ROSENBROCK4_HPP
+#define ECELL4_ODE_SPARSE_ROSENBROCK4_HPP
+
+#include <limits>
+#include <algorithm>
+
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/odeint/stepper/rosenbrock4.hpp>
+
+#include "SparseMatrix.hpp"
+
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+/**
+ * The Rosenbrock method same as boost::numeric::odeint::rosenbrock4,
+ * but with SparseLU instead of the dense LU factorization.
+ * A system is a pair of a derivative function and a Jacobian function.
+ * The Jacobian function must provide evaluate(x, t, dfdt) returning
+ * a SparseMatrix, and linear_solver() returning a SparseLU analyzed for it.
+ * This is used with boost::numeric::odeint::rosenbrock4_controller.
+ */
+class sparse_rosenbrock4
+{
+public:
+
+    typedef double value_type;
+    typedef boost::numeric::ublas::vector<value_type> state_type;
+    typedef state_type deriv_type;
+    typedef value_type time_type;
+    typedef boost::numeric::odeint::state_wrapper<state_type> wrapped_state_type;
+    typedef boost::numeric::odeint::state_wrapper<deriv_type> wrapped_deriv_type;
+    typedef boost::numeric::odeint::initially_resizer resizer_type;
+    typedef boost::numeric::odeint::default_rosenbrock_coefficients<value_type>
+        rosenbrock_coefficients;
+    typedef boost::numeric::odeint::stepper_tag stepper_category;
+    typedef unsigned short order_type;
+
+public:
+
+    order_type order() const
+    {
+        return 4;
+    }
+
+    template <typename Tsystem_>
+    void do_step(
+        Tsystem_ system, const state_type& x, time_type t, state_type& xout,
+        time_type dt, state_type& xerr)
+    {
+        typedef typename boost::numeric::odeint::unwrap_reference<Tsystem_>::type
+            system_type;
+        typedef typename boost::numeric::odeint::unwrap_reference<
+            typename system_type::first_type>::type deriv_func_type;
+        typedef typename boost::numeric::odeint::unwrap_reference<
+            typename system_type::second_type>::type jacobi_func_type;
+        system_type& sys = system;
+        deriv_func_type& deriv_func = sys.first;
+        jacobi_func_type& jacobi_func = sys.second;
+
+        const std::size_t n(x.size());
+        resize(n);
+
+        deriv_func(x, dxdt_, t);
+        const SparseMatrix& jacobi(jacobi_func.evaluate(x, t, dfdt_));
+        SparseLU& lu(jacobi_func.linear_solver());
+        if (!lu.factorize(jacobi, 1.0 / (coef_.gamma * dt), -1.0))
+        {
+            // The controller rejects this step and retries with a smaller dt.
+            std::copy(x.begin(), x.end(), xout.begin());
+            std::fill(xerr.begin(), xerr.end(), std::numeric_limits<value_type>::infinity());
+            return;
+        }
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g1_[i] = dxdt_[i] + dt * coef_.d1 * dfdt_[i];
+        }
+        lu.solve(g1_);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp_[i] = x[i] + coef_.a21 * g1_[i];
+        }
+        deriv_func(xtmp_, dxdtnew_, t + coef_.c2 * dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g2_[i] = dxdtnew_[i] + dt * coef_.d2 * dfdt_[i] + coef_.c21 * g1_[i] / dt;
+        }
+        lu.solve(g2_);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp_[i] = x[i] + coef_.a31 * g1_[i] + coef_.a32 * g2_[i];
+        }
+        deriv_func(xtmp_, dxdtnew_, t + coef_.c3 * dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g3_[i] = dxdtnew_[i] + dt * coef_.d3 * dfdt_[i]
+                + (coef_.c31 * g1_[i] + coef_.c32 * g2_[i]) / dt;
+        }
+        lu.solve(g3_);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp_[i] = x[i] + coef_.a41 * g1_[i] + coef_.a42 * g2_[i] + coef_.a43 * g3_[i];
+        }
+        deriv_func(xtmp_, dxdtnew_, t + coef_.c4 * dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g4_[i] = dxdtnew_[i] + dt * coef_.d4 * dfdt_[i]
+                + (coef_.c41 * g1_[i] + coef_.c42 * g2_[i] + coef_.c43 * g3_[i]) / dt;
+        }
+        lu.solve(g4_);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp_[i] = x[i] + coef_.a51 * g1_[i] + coef_.a52 * g2_[i]
+                + coef_.a53 * g3_[i] + coef_.a54 * g4_[i];
+        }
+        deriv_func(xtmp_, dxdtnew_, t + dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g5_[i] = dxdtnew_[i] + (coef_.c51 * g1_[i] + coef_.c52 * g2_[i]
+                + coef_.c53 * g3_[i] + coef_.c54 * g4_[i]) / dt;
+        }
+        lu.solve(g5_);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp_[i] += g5_[i];
+        }
+        deriv_func(xtmp_, dxdtnew_, t + dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xerr[i] = dxdtnew_[i] + (coef_.c61 * g1_[i] + coef_.c62 * g2_[i]
+                + coef_.c63 * g3_[i] + coef_.c64 * g4_[i] + coef_.c65 * g5_[i]) / dt;
+        }
+        lu.solve(xerr);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xout[i] = xtmp_[i] + xerr[i];
+        }
+    }
+
+protected:
+
+    void resize(const std::size_t n)
+    {
+        if (dxdt_.size() == n)
+        {
+            return;
+        }
+
+        dxdt_.resize(n, false);
+        dfdt_.resize(n, false);
+        dxdtnew_.resize(n, false);
+        xtmp_.resize(n, false);
+        g1_.resize(n, false);
+        g2_.resize(n, false);
+        g3_.resize(n, false);
+        g4_.resize(n, false);
+        g5_.resize(n, false);
+    }
+
+protected:
+
+    state_type dxdt_, dfdt_, dxdtnew_, xtmp_;
+    state_type g1_, g2_, g3_, g4_, g5_;
+    rosenbrock_coefficients coef_;
+};
+
+} // ode
+
+} // ecell4
+
+#endif /* ECELL4_ODE_SPARSE_ROSENBROCK4_HPP */
@@ -0,0 +1,144 @@
+#define BOOST_TEST_MODULE "ODEEnsembleSimulator_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <ecell4/core/Species.hpp>
+#include <ecell4/core/ReactionRule.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include "../ODESimulator.hpp"
+#include "../ODEEnsembleSimulator.hpp"
+
+using namespace ecell4;
+using namespace ecell4::ode;
+
+
+static void check_ensemble(const ODESolverType solver_type, const Integer num_threads)
+{
+    const Real L(1.5);
+    const Real3 edge_lengths(L, L, L);
+
+    Species sp1("A"), sp2("B"), sp3("C");
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 0.3));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 1.2));
+
+    std::shared_ptr<ODEWorld> world(new ODEWorld(edge_lengths));
+    world->add_molecules(sp1, 10.0);
+    world->add_molecules(sp2, 5.0);
+    world->add_molecules(sp3, 0.0);
+    const std::vector<Species> species(world->list_species());
+
+    const std::size_t num_members(7);
+    std::vector<std::vector<Real> > values(num_members);
+    std::vector<std::vector<Real> > k(num_members);
+    for (std::size_t j(0); j < num_members; ++j)
+    {
+        for (std::size_t i(0); i < species.size(); ++i)
+        {
+            values[j].push_back(world->get_value_exact(species[i]) + j);
+        }
+        k[j].push_back(0.3 * (1 + j));
+        k[j].push_back(1.2 / (1 + j));
+    }
+
+    ODEEnsembleSimulator target(world, model, values, k, solver_type, num_threads);
+    target.set_absolute_tolerance(1e-10);
+    target.set_relative_tolerance(1e-10);
+    BOOST_CHECK_EQUAL(target.num_members(), num_members);
+
+    std::vector<Real> times;
+    times.push_back(0.5);
+    times.push_back(1.0);
+    times.push_back(3.0);
+    const ODEEnsembleResult result(target.run(times));
+    BOOST_CHECK_EQUAL(result.times().size(), times.size());
+    BOOST_CHECK_EQUAL(result.species().size(), species.size());
+    BOOST_CHECK_EQUAL(result.data().size(), times.size() * species.size() * num_members);
+
+    for (std::size_t j(0); j < num_members; ++j)
+    {
+        std::shared_ptr<NetworkModel> m(new NetworkModel());
+        m->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, k[j][0]));
+        m->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, k[j][1]));
+        std::shared_ptr<ODEWorld> w(new ODEWorld(edge_lengths));
+        for (std::size_t i(0); i < species.size(); ++i)
+        {
+            w->set_value(species[i], values[j][i]);
+        }
+
+        ODESimulator sim(w, m, RUNGE_KUTTA_CASH_KARP54);
+        sim.set_absolute_tolerance(1e-10);
+        sim.set_relative_tolerance(1e-10);
+        for (std::size_t t(0); t < times.size(); ++t)
+        {
+            while (sim.step(times[t]));
+            const std::vector<Real> vals(result.values(t, j));
+            for (std::size_t i(0); i < species.size(); ++i)
+            {
+                BOOST_CHECK_CLOSE(vals[i], w->get_value_exact(species[i]), 1e-5);
+                BOOST_CHECK_EQUAL(vals[i], result.value(t, i, j));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ODEEnsembleSimulator_test_runge_kutta)
+{
+    check_ensemble(RUNGE_KUTTA_CASH_KARP54, 1);
+}
+
+BOOST_AUTO_TEST_CASE(ODEEnsembleSimulator_test_rosenbrock4)
+{
+    check_ensemble(ROSENBROCK4_CONTROLLER, 1);
+}
+
+BOOST_AUTO_TEST_CASE(ODEEnsembleSimulator_test_multiple_threads)
+{
+    check_ensemble(RUNGE_KUTTA_CASH_KARP54, 3);
+    check_ensemble(SPARSE_ROSENBROCK4_CONTROLLER, 3);
+}
+
+BOOST_AUTO_TEST_CASE(ODEEnsembleSimulator_test_default_values)
+{
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    Species sp1("A"), sp2("B");
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+
+    std::shared_ptr<ODEWorld> world(new ODEWorld(edge_lengths));
+    world->set_value(sp1, 100.0);
+
+    // Members differ only in the rate constant, starting from the world.
+    std::vector<std::vector<Real> > k(3);
+    k[0].push_back(0.5);
+    k[1].push_back(1.0);
+    k[2].push_back(2.0);
+    ODEEnsembleSimulator target(
+        world, model, std::vector<std::vector<Real> >(), k, RUNGE_KUTTA_CASH_KARP54);
+    BOOST_CHECK(!world->has_species(sp2));  // species are reserved at initialize()
+    target.set_absolute_tolerance(1e-12);
+    target.set_relative_tolerance(1e-12);
+
+    std::vector<Real> times;
+    times.push_back(0.0);
+    times.push_back(1.0);
+    const ODEEnsembleResult result(target.run(times));
+    BOOST_CHECK(world->has_species(sp2));
+
+    std::size_t idx(0);
+    while (result.species()[idx] != sp1)
+    {
+        ++idx;
+    }
+    for (std::size_t j(0); j < 3; ++j)
+    {
+        BOOST_CHECK_EQUAL(result.value(0, idx, j), 100.0);
+        BOOST_CHECK_CLOSE(result.value(1, idx, j), 100.0 * std::exp(-k[j][0]), 1e-6);
+    }
+    BOOST_CHECK_EQUAL(world->get_value_exact(sp1), 100.0);
+}
@@ -11,6 +11,7 @@
 #include <ecell4/core/ReactionRule.hpp>
 #include <ecell4/core/NetworkModel.hpp>
 #include "../ODESimulator.hpp"
+#include "../SparseMatrix.hpp"
 
 using namespace ecell4;
 using namespace ecell4::ode;
@@ -71,3 +72,368 @@ BOOST_AUTO_TEST_CASE(ODESimulator_test_step2)
 
     // BOOST_ASSERT(false);
 }
+
+static Real michaelis_menten(
+    const ReactionRuleDescriptor::state_container_type& r,
+    const ReactionRuleDescriptor::state_container_type& p,
+    Real volume, Real t, const ReactionRuleDescriptorCPPfunc& rd)
+{
+    return 2.0 * r[0] / (r[0] + 10.0);
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_derivatives)
+{
+    const Real L(2.0);
+    const Real3 edge_lengths(L, L, L);
+    const Real volume(L * L * L);
+
+    Species sp1("A"), sp2("B"), sp3("C");
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+
+    // A + A > B with the mass action
+    ReactionRule rr1;
+    rr1.set_k(0.5);
+    rr1.add_reactant(sp1);
+    rr1.add_reactant(sp1);
+    rr1.add_product(sp2);
+    model->add_reaction_rule(rr1);
+
+    // B > C with a user-defined rate law
+    ReactionRule rr2;
+    rr2.add_reactant(sp2);
+    rr2.add_product(sp3);
+    rr2.set_descriptor(std::shared_ptr<ReactionRuleDescriptor>(
+        new ReactionRuleDescriptorCPPfunc(
+            michaelis_menten,
+            ReactionRuleDescriptor::coefficient_container_type(1, 1.0),
+            ReactionRuleDescriptor::coefficient_container_type(1, 1.0))));
+    model->add_reaction_rule(rr2);
+
+    // 1.5 C > 3 A with non-integral coefficients
+    ReactionRule rr3;
+    rr3.add_reactant(sp3);
+    rr3.add_product(sp1);
+    rr3.set_descriptor(std::shared_ptr<ReactionRuleDescriptor>(
+        new ReactionRuleDescriptorMassAction(
+            3.0,
+            ReactionRuleDescriptor::coefficient_container_type(1, 1.5),
+            ReactionRuleDescriptor::coefficient_container_type(1, 3.0))));
+    model->add_reaction_rule(rr3);
+
+    std::shared_ptr<ODEWorld> world(new ODEWorld(edge_lengths));
+    world->set_value(sp1, 40.0);
+    world->set_value(sp2, 30.0);
+    world->set_value(sp3, 20.0);
+
+    ODESimulator target(world, model);
+
+    const Real flux1(0.5 * volume * (40.0 / volume) * (40.0 / volume));
+    const Real flux2(2.0 * 30.0 / (30.0 + 10.0));
+    const Real flux3(3.0 * volume * std::pow(20.0 / volume, 1.5));
+
+    const std::vector<Species> species(world->list_species());
+    const std::vector<Real> derivs(target.derivatives());
+    BOOST_CHECK_EQUAL(derivs.size(), species.size());
+    for (std::size_t i(0); i < species.size(); ++i)
+    {
+        if (species[i] == sp1)
+        {
+            BOOST_CHECK_CLOSE(derivs[i], -2.0 * flux1 + 3.0 * flux3, 1e-10);
+        }
+        else if (species[i] == sp2)
+        {
+            BOOST_CHECK_CLOSE(derivs[i], flux1 - flux2, 1e-10);
+        }
+        else if (species[i] == sp3)
+        {
+            BOOST_CHECK_CLOSE(derivs[i], flux2 - 1.5 * flux3, 1e-10);
+        }
+    }
+
+    // The total is conserved through the compiled system.
+    target.step(1.0);
+    BOOST_CHECK_CLOSE(
+        world->get_value_exact(sp1) + 2.0 * world->get_value_exact(sp2)
+            + 2.0 * world->get_value_exact(sp3),
+        40.0 + 60.0 + 40.0, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_jacobian)
+{
+    const Real L(2.0);
+    const Real3 edge_lengths(L, L, L);
+    const Real volume(L * L * L);
+
+    Species sp1("A"), sp2("B"), sp3("C");
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+
+    ReactionRule rr1;
+    rr1.set_k(0.5);
+    rr1.add_reactant(sp1);
+    rr1.add_reactant(sp1);
+    rr1.add_product(sp2);
+    model->add_reaction_rule(rr1);
+
+    ReactionRule rr2;
+    rr2.add_reactant(sp2);
+    rr2.add_product(sp3);
+    rr2.set_descriptor(std::shared_ptr<ReactionRuleDescriptor>(
+        new ReactionRuleDescriptorCPPfunc(
+            michaelis_menten,
+            ReactionRuleDescriptor::coefficient_container_type(1, 1.0),
+            ReactionRuleDescriptor::coefficient_container_type(1, 1.0))));
+    model->add_reaction_rule(rr2);
+
+    ReactionRule rr3;
+    rr3.add_reactant(sp3);
+    rr3.add_product(sp1);
+    rr3.set_descriptor(std::shared_ptr<ReactionRuleDescriptor>(
+        new ReactionRuleDescriptorMassAction(
+            3.0,
+            ReactionRuleDescriptor::coefficient_container_type(1, 1.5),
+            ReactionRuleDescriptor::coefficient_container_type(1, 3.0))));
+    model->add_reaction_rule(rr3);
+
+    std::shared_ptr<ODEWorld> world(new ODEWorld(edge_lengths));
+    world->set_value(sp1, 40.0);
+    world->set_value(sp2, 30.0);
+    world->set_value(sp3, 20.0);
+
+    ODESimulator target(world, model);
+
+    const Real dflux1(40.0 / volume);  // d/dA 0.5 A^2 / V
+    const Real dflux2(2.0 * 10.0 / ((30.0 + 10.0) * (30.0 + 10.0)));
+    const Real dflux3(4.5 * std::sqrt(20.0 / volume));  // d/dC 3 V^(-1/2) C^(3/2)
+
+    const std::vector<Species> species(world->list_species());
+    std::vector<std::size_t> idx(3);
+    for (std::size_t i(0); i < species.size(); ++i)
+    {
+        idx[species[i] == sp1 ? 0 : (species[i] == sp2 ? 1 : 2)] = i;
+    }
+
+    const std::vector<std::vector<Real> > jacobian(target.jacobian());
+    BOOST_CHECK_EQUAL(jacobian.size(), 3);
+    BOOST_CHECK_CLOSE(jacobian[idx[0]][idx[0]], -2.0 * dflux1, 1e-10);
+    BOOST_CHECK_CLOSE(jacobian[idx[1]][idx[0]], dflux1, 1e-10);
+    BOOST_CHECK_EQUAL(jacobian[idx[2]][idx[0]], 0.0);
+    BOOST_CHECK_CLOSE(jacobian[idx[1]][idx[1]], -dflux2, 1e-4);
+    BOOST_CHECK_CLOSE(jacobian[idx[2]][idx[1]], dflux2, 1e-4);
+    BOOST_CHECK_EQUAL(jacobian[idx[0]][idx[1]], 0.0);
+    BOOST_CHECK_CLOSE(jacobian[idx[0]][idx[2]], 3.0 * dflux3, 1e-10);
+    BOOST_CHECK_CLOSE(jacobian[idx[2]][idx[2]], -1.5 * dflux3, 1e-10);
+    BOOST_CHECK_EQUAL(jacobian[idx[1]][idx[2]], 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_SparseLU)
+{
+    // A tridiagonal matrix with a dense last row and column
+    const std::size_t n(50);
+    std::vector<SparseMatrix::entry_type> entries;
+    for (std::size_t i(0); i < n; ++i)
+    {
+        if (i > 0)
+        {
+            entries.push_back(SparseMatrix::entry_type(i, i - 1));
+        }
+        if (i + 1 < n)
+        {
+            entries.push_back(SparseMatrix::entry_type(i, i + 1));
+        }
+        entries.push_back(SparseMatrix::entry_type(i, n - 1));
+        entries.push_back(SparseMatrix::entry_type(n - 1, i));
+    }
+    SparseMatrix A(n, entries);
+    BOOST_CHECK_EQUAL(A.find(0, 2), SparseMatrix::npos);
+    BOOST_CHECK(A.find(3, 3) != SparseMatrix::npos);
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        for (std::size_t p(A.row_offsets()[i]); p < A.row_offsets()[i + 1]; ++p)
+        {
+            A.values()[p] = (A.columns()[p] == i ? -4.0 : std::sin(1.0 + i + 2.0 * A.columns()[p]));
+        }
+    }
+
+    SparseLU lu(A);
+    // The hub is ordered last, and no fill-in occurs.
+    BOOST_CHECK_EQUAL(lu.num_nonzeros(), A.num_nonzeros());
+
+    const Real alpha(2.5), beta(-1.0);
+    BOOST_CHECK(lu.factorize(A, alpha, beta));
+
+    std::vector<Real> x(n);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        x[i] = std::cos(0.3 * i);
+    }
+    std::vector<Real> b(n, 0.0);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        b[i] += alpha * x[i];
+        for (std::size_t p(A.row_offsets()[i]); p < A.row_offsets()[i + 1]; ++p)
+        {
+            b[i] += beta * A.values()[p] * x[A.columns()[p]];
+        }
+    }
+
+    lu.solve(b);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        BOOST_CHECK_CLOSE(b[i], x[i], 1e-8);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_sparse_rosenbrock4)
+{
+    // The Robertson problem, a stiff system
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    Species sp1("A"), sp2("B"), sp3("C");
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 0.04));
+
+    ReactionRule rr1;
+    rr1.set_k(3e+7);
+    rr1.add_reactant(sp2);
+    rr1.add_reactant(sp2);
+    rr1.add_product(sp2);
+    rr1.add_product(sp3);
+    model->add_reaction_rule(rr1);
+
+    ReactionRule rr2;
+    rr2.set_k(1e+4);
+    rr2.add_reactant(sp2);
+    rr2.add_reactant(sp3);
+    rr2.add_product(sp1);
+    rr2.add_product(sp3);
+    model->add_reaction_rule(rr2);
+
+    std::shared_ptr<ODEWorld> world1(new ODEWorld(edge_lengths));
+    world1->set_value(sp1, 1.0);
+    world1->set_value(sp2, 0.0);
+    world1->set_value(sp3, 0.0);
+    std::shared_ptr<ODEWorld> world2(new ODEWorld(edge_lengths));
+    world2->set_value(sp1, 1.0);
+    world2->set_value(sp2, 0.0);
+    world2->set_value(sp3, 0.0);
+
+    ODESimulator target1(world1, model, ROSENBROCK4_CONTROLLER);
+    ODESimulator target2(world2, model, SPARSE_ROSENBROCK4_CONTROLLER);
+    target1.set_absolute_tolerance(1e-10);
+    target1.set_relative_tolerance(1e-8);
+    target2.set_absolute_tolerance(1e-10);
+    target2.set_relative_tolerance(1e-8);
+
+    const Real upto(40.0);
+    while (target1.step(upto));
+    while (target2.step(upto));
+
+    BOOST_CHECK_CLOSE(world2->get_value_exact(sp1), world1->get_value_exact(sp1), 1e-4);
+    BOOST_CHECK_CLOSE(world2->get_value_exact(sp2), world1->get_value_exact(sp2), 1e-4);
+    BOOST_CHECK_CLOSE(world2->get_value_exact(sp3), world1->get_value_exact(sp3), 1e-4);
+    BOOST_CHECK_CLOSE(
+        world2->get_value_exact(sp1) + world2->get_value_exact(sp2) + world2->get_value_exact(sp3),
+        1.0, 1e-6);
+    BOOST_CHECK_CLOSE(world2->get_value_exact(sp1), 0.7158, 0.1);  // a reference value at t = 40
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_set_volume)
+{
+    // The system must be regenerated after the volume or the model is changed
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+    Species sp1("A"), sp2("B"), sp3("C");
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    ReactionRule rr1;
+    rr1.set_k(1.0);
+    rr1.add_reactant(sp1);
+    rr1.add_reactant(sp1);
+    rr1.add_product(sp2);
+    model->add_reaction_rule(rr1);
+
+    std::shared_ptr<ODEWorld> world1(new ODEWorld(edge_lengths));
+    world1->set_value(sp1, 1.0);
+    world1->reserve_species(sp2);
+    world1->reserve_species(sp3);
+    std::shared_ptr<ODEWorld> world2(new ODEWorld(edge_lengths));
+    world2->set_value(sp1, 1.0);
+    world2->reserve_species(sp2);
+    world2->reserve_species(sp3);
+
+    ODESimulator target1(world1, model);
+    ODESimulator target2(world2, model);
+    while (target1.step(1.0))
+    {
+        ; // do nothing
+    }
+    while (target2.step(1.0))
+    {
+        ; // do nothing
+    }
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp1), world2->get_value_exact(sp1), 1e-8);
+
+    world1->set_volume(0.5);
+    world2->set_volume(0.5);
+    while (target1.step(2.0))
+    {
+        ; // do nothing
+    }
+    {
+        ODESimulator target3(world2, model);
+        while (target3.step(2.0))
+        {
+            ; // do nothing
+        }
+    }
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp1), world2->get_value_exact(sp1), 1e-4);
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp2), world2->get_value_exact(sp2), 1e-4);
+
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp3, 2.0));
+    while (target1.step(3.0))
+    {
+        ; // do nothing
+    }
+    {
+        ODESimulator target3(world2, model);
+        while (target3.step(3.0))
+        {
+            ; // do nothing
+        }
+    }
+    BOOST_CHECK(world1->get_value_exact(sp3) > 0.0);
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp1), world2->get_value_exact(sp1), 1e-4);
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp3), world2->get_value_exact(sp3), 1e-4);
+
+    // The rate constant of a mass action descriptor is changed in place
+    ReactionRule rr2(create_unimolecular_reaction_rule(sp2, sp3, 0.5));
+    rr2.set_descriptor(std::shared_ptr<ReactionRuleDescriptor>(
+        new ReactionRuleDescriptorMassAction(
+            0.5, std::vector<Real>(1, 1.0), std::vector<Real>(1, 1.0))));
+    model->add_reaction_rule(rr2);
+    while (target1.step(4.0))
+    {
+        ; // do nothing
+    }
+    {
+        ODESimulator target3(world2, model);
+        while (target3.step(4.0))
+        {
+            ; // do nothing
+        }
+    }
+
+    std::dynamic_pointer_cast<ReactionRuleDescriptorMassAction>(
+        model->reaction_rules().back().get_descriptor())->set_k(5.0);
+    while (target1.step(5.0))
+    {
+        ; // do nothing
+    }
+    {
+        ODESimulator target3(world2, model);
+        while (target3.step(5.0))
+        {
+            ; // do nothing
+        }
+    }
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp2), world2->get_value_exact(sp2), 1e-4);
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp3), world2->get_value_exact(sp3), 1e-4);
+}
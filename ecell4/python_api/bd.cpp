@@ -6,6 +6,8 @@
 
 #include "simulator.hpp"
 #include "simulator_factory.hpp"
+#include "ensemble_runner.hpp"
+#include "particle_arrays.hpp"
 #include "world_interface.hpp"
 
 namespace py = pybind11;
@@ -22,10 +24,14 @@ void define_bd_factory(py::module& m)
 {
     py::class_<BDFactory> factory(m, "BDFactory");
     factory
-        .def(py::init<const Integer3&, Real>(),
+        .def(py::init<const Integer3&, Real, const Integer>(),
                 py::arg("matrix_sizes") = BDFactory::default_matrix_sizes(),
-                py::arg("bd_dt_factor") = BDFactory::default_bd_dt_factor())
-        .def("rng", &BDFactory::rng);
+                py::arg("bd_dt_factor") = BDFactory::default_bd_dt_factor(),
+                py::arg("num_threads") = BDFactory::default_num_threads())
+        .def("rng", &BDFactory::rng)
+        .def("space_type", &BDFactory::space_type,
+            py::arg("type"),
+            py::arg("verlet_skin") = ParticleSpaceSoAImpl::default_verlet_skin());
     define_factory_functions(factory);
 
     m.attr("Factory") = factory;
@@ -37,12 +43,17 @@ void define_bd_simulator(py::module& m)
     py::class_<BDSimulator, Simulator, PySimulator<BDSimulator>,
         std::shared_ptr<BDSimulator>> simulator(m, "BDSimulator");
     simulator
-        .def(py::init<std::shared_ptr<BDWorld>, Real>(),
-                py::arg("w"), py::arg("bd_dt_factor") = 1e-5)
-        .def(py::init<std::shared_ptr<BDWorld>, std::shared_ptr<Model>, Real>(),
-                py::arg("w"), py::arg("m"), py::arg("bd_dt_factor") = 1e-5)
+        .def(py::init<std::shared_ptr<BDWorld>, Real, const Integer>(),
+                py::arg("w"), py::arg("bd_dt_factor") = BDSimulator::default_bd_dt_factor(),
+                py::arg("num_threads") = BDSimulator::default_num_threads())
+        .def(py::init<std::shared_ptr<BDWorld>, std::shared_ptr<Model>, Real, const Integer>(),
+                py::arg("w"), py::arg("m"), py::arg("bd_dt_factor") = BDSimulator::default_bd_dt_factor(),
+                py::arg("num_threads") = BDSimulator::default_num_threads())
+        .def("num_threads", &BDSimulator::num_threads)
         .def("last_reactions", &BDSimulator::last_reactions)
-        .def("set_t", &BDSimulator::set_t);
+        .def("set_t", &BDSimulator::set_t)
+        .def("batched", &BDSimulator::batched)
+        .def("set_batched", &BDSimulator::set_batched, py::arg("batched"));
     define_simulator_functions(simulator);
 
     m.attr("Simulator") = simulator;
@@ -81,6 +92,9 @@ void define_bd_world(py::module& m)
             (std::vector<std::pair<std::pair<ParticleID, Particle>, Real>>
              (BDWorld::*)(const Real3&, const Real&, const ParticleID&, const ParticleID&) const)
             &BDWorld::list_particles_within_radius)
+        .def("has_overlap", &BDWorld::has_overlap,
+            py::arg("pos"), py::arg("radius"),
+            py::arg("ignore1") = ParticleID(), py::arg("ignore2") = ParticleID())
         .def("periodic_transpose", &BDWorld::periodic_transpose)
         .def("apply_boundary", &BDWorld::apply_boundary)
         .def("distance_sq", &BDWorld::distance_sq)
@@ -93,6 +107,8 @@ void define_bd_world(py::module& m)
         .def("bind_to", &BDWorld::bind_to)
         .def("rng", &BDWorld::rng);
 
+    define_new_particles(world);
+
     m.attr("World") = world;
 }
 
@@ -131,6 +147,7 @@ void setup_bd_module(py::module& m)
     define_bd_simulator(m);
     define_bd_world(m);
     define_reaction_info(m);
+    define_ensemble_runner<BDFactory>(m);
 }
 
 }
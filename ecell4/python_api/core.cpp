@@ -2,6 +2,7 @@
 
 #include <ecell4/core/BDMLWriter.hpp>
 #include <ecell4/core/Context.hpp>
+#include <ecell4/core/EnsembleStatistics.hpp>
 #include <ecell4/core/extras.hpp>
 #include <ecell4/core/functions.hpp>
 #include <ecell4/core/Integer3.hpp>
@@ -11,6 +12,7 @@
 
 #include "model.hpp"
 #include "observers.hpp"
+#include "particle_arrays.hpp"
 #include "random_number_generator.hpp"
 #include "reaction_rule_descriptor.hpp"
 #include "shape.hpp"
@@ -378,6 +380,7 @@ void define_rng(py::module& m)
         .def("gaussian", &RandomNumberGenerator::gaussian,
             py::arg("sigma"), py::arg("mean") = 0.0)
         .def("binomial", &RandomNumberGenerator::binomial)
+        .def("poisson", &RandomNumberGenerator::poisson)
         .def("seed", (void (RandomNumberGenerator::*)()) &RandomNumberGenerator::seed)
         .def("seed", (void (RandomNumberGenerator::*)(Integer)) &RandomNumberGenerator::seed)
         .def("save", (void (RandomNumberGenerator::*)(const std::string&) const) &RandomNumberGenerator::save)
@@ -389,6 +392,15 @@ void define_rng(py::module& m)
         .def(py::init<>())
         .def(py::init<const Integer>(), py::arg("seed"))
         .def(py::init<const std::string&>(), py::arg("filename"));
+
+    py::class_<PhiloxRandomNumberGenerator, RandomNumberGenerator,
+        PyRandomNumberGeneratorImpl<PhiloxRandomNumberGenerator>,
+        std::shared_ptr<PhiloxRandomNumberGenerator>>(m, "PhiloxRandomNumberGenerator")
+        .def(py::init<const Integer, const Integer>(),
+            py::arg("seed") = 0, py::arg("stream_id") = 0)
+        .def(py::init<const std::string&>(), py::arg("filename"))
+        .def("split", &PhiloxRandomNumberGenerator::split, py::arg("stream_id"))
+        .def("stream", &PhiloxRandomNumberGenerator::stream);
 }
 
 static inline
@@ -530,6 +542,14 @@ void define_model(py::module& m)
         .def(py::init<>())
         .def("set_effective", &NetfreeModel::set_effective)
         .def("effective", &NetfreeModel::effective)
+        .def("set_query_cache_capacity", &NetfreeModel::set_query_cache_capacity)
+        .def("query_cache_capacity", &NetfreeModel::query_cache_capacity)
+        .def("query_cache_hits", &NetfreeModel::query_cache_hits)
+        .def("query_cache_misses", &NetfreeModel::query_cache_misses)
+        .def("clear_query_cache", &NetfreeModel::clear_query_cache)
+        .def("expand", (std::shared_ptr<Model> (NetfreeModel::*)(
+                const std::vector<Species>&, const Integer, const std::map<Species, Integer>&,
+                const Integer) const) &NetfreeModel::expand)
         .def(py::pickle(
             [](const NetfreeModel& self)
             {
@@ -550,6 +570,26 @@ void define_model(py::module& m)
                 return model;
             }
         ));
+
+    py::class_<extras::network_generation_statistics>(m, "NetworkGenerationStatistics")
+        .def_readonly("iteration", &extras::network_generation_statistics::iteration)
+        .def_readonly("num_seeds", &extras::network_generation_statistics::num_seeds)
+        .def_readonly("num_trials", &extras::network_generation_statistics::num_trials)
+        .def_readonly("num_reactions", &extras::network_generation_statistics::num_reactions)
+        .def_readonly("num_new_species", &extras::network_generation_statistics::num_new_species)
+        .def_readonly("num_species", &extras::network_generation_statistics::num_species)
+        .def_readonly("elapsed_time", &extras::network_generation_statistics::elapsed_time);
+
+    m.def("generate_network_from_netfree_model",
+        (std::pair<std::shared_ptr<NetworkModel>, bool> (*)(
+            const NetfreeModel&, const std::vector<Species>&, const Integer,
+            const std::map<Species, Integer>&, const Integer,
+            const extras::network_generation_observer_type&))
+        &extras::generate_network_from_netfree_model,
+        py::arg("model"), py::arg("seeds"), py::arg("max_itr"),
+        py::arg("max_stoich") = std::map<Species, Integer>(),
+        py::arg("num_threads") = 1,
+        py::arg("observer") = extras::network_generation_observer_type());
 }
 
 static inline
@@ -582,6 +622,21 @@ void define_world_interface(py::module& m)
             (std::vector<std::pair<ParticleID, Particle>> (WorldInterface::*)(const Species&) const)
             &WorldInterface::list_particles)
         .def("list_particles_exact", &WorldInterface::list_particles_exact)
+        .def("list_particles_as_arrays",
+            [](const WorldInterface& self)
+            {
+                return particles_as_arrays(self.list_particles());
+            })
+        .def("list_particles_as_arrays",
+            [](const WorldInterface& self, const Species& sp)
+            {
+                return particles_as_arrays(self.list_particles(sp));
+            })
+        .def("list_particles_exact_as_arrays",
+            [](const WorldInterface& self, const Species& sp)
+            {
+                return particles_as_arrays(self.list_particles_exact(sp));
+            })
         ;
 }
 
@@ -1445,6 +1500,23 @@ void define_simulator(py::module& m)
         .def("next_time", &Simulator::next_time);
 }
 
+static inline
+void define_ensemble_statistics(py::module& m)
+{
+    py::class_<EnsembleStatistics>(m, "EnsembleStatistics")
+        .def(py::init<const std::vector<Species>&>(),
+            py::arg("targets") = std::vector<Species>())
+        .def("targets", &EnsembleStatistics::targets)
+        .def("times", &EnsembleStatistics::times)
+        .def("num_samples", &EnsembleStatistics::num_samples)
+        .def("add", &EnsembleStatistics::add, py::arg("data"))
+        .def("merge", &EnsembleStatistics::merge, py::arg("other"))
+        .def("histogram", &EnsembleStatistics::histogram, py::arg("i"), py::arg("j"))
+        .def("mean", &EnsembleStatistics::mean)
+        .def("variance", &EnsembleStatistics::variance)
+        .def("quantile", &EnsembleStatistics::quantile, py::arg("q"));
+}
+
 void setup_module(py::module& m)
 {
     define_real3(m);
@@ -1463,6 +1535,7 @@ void setup_module(py::module& m)
     define_observers(m);
     define_shape(m);
     define_simulator(m);
+    define_ensemble_statistics(m);
 
     m.def("load_version_information", (std::string (*)(const std::string&)) &extras::load_version_information);
     m.def("get_dimension_from_model", &extras::get_dimension_from_model);
@@ -2,6 +2,7 @@
 
 #include <ecell4/egfrd/egfrd.hpp>
 
+#include "particle_arrays.hpp"
 #include "simulator.hpp"
 #include "simulator_factory.hpp"
 #include "world_interface.hpp"
@@ -166,6 +167,8 @@ void define_egfrd_world(py::module& m)
         .def("bind_to", &EGFRDWorld::bind_to)
         .def("rng", &EGFRDWorld::rng);
 
+    define_new_particles(world);
+
     m.attr("World") = world;
 }
 
@@ -0,0 +1,71 @@
+#ifndef ECELL4_PYTHON_API_ENSEMBLE_RUNNER_HPP
+#define ECELL4_PYTHON_API_ENSEMBLE_RUNNER_HPP
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <ecell4/core/EnsembleRunner.hpp>
+
+namespace py = pybind11;
+
+namespace ecell4
+{
+
+namespace python_api
+{
+
+static inline
+bool has_descriptors(const std::shared_ptr<Model>& model)
+{
+    if (!model->is_static())
+    {
+        return false;
+    }
+
+    const Model::reaction_rule_container_type& reaction_rules(model->reaction_rules());
+    for (Model::reaction_rule_container_type::const_iterator i(reaction_rules.begin());
+        i != reaction_rules.end(); ++i)
+    {
+        if ((*i).has_descriptor())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class Factory>
+static inline
+void define_ensemble_runner(py::module& m)
+{
+    using world_type = typename Factory::world_type;
+    using runner_type = EnsembleRunner<Factory>;
+
+    py::class_<runner_type>(m, "EnsembleRunner")
+        .def(py::init<const Factory&, const std::shared_ptr<world_type>&,
+                const std::shared_ptr<Model>&, const Integer>(),
+            py::arg("factory"), py::arg("world"), py::arg("model"),
+            py::arg("num_threads") = 1)
+        .def("num_threads", &runner_type::num_threads)
+        .def("run",
+            [](const runner_type& self, const Integer num_replicates,
+               const Real duration, const Real dt,
+               const std::vector<std::string>& species, const Integer seed)
+            {
+                if (has_descriptors(self.model()))
+                {
+                    // A descriptor may call back into Python.
+                    return self.run(num_replicates, duration, dt, species, seed);
+                }
+                py::gil_scoped_release release;
+                return self.run(num_replicates, duration, dt, species, seed);
+            },
+            py::arg("num_replicates"), py::arg("duration"), py::arg("dt"),
+            py::arg("species") = std::vector<std::string>(), py::arg("seed") = 0);
+}
+
+}
+
+}
+
+#endif /* ECELL4_PYTHON_API_ENSEMBLE_RUNNER_HPP */
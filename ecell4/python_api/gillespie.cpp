@@ -3,9 +3,16 @@
 #include <ecell4/gillespie/GillespieFactory.hpp>
 #include <ecell4/gillespie/GillespieSimulator.hpp>
 #include <ecell4/gillespie/GillespieWorld.hpp>
+#include <ecell4/gillespie/NextReactionFactory.hpp>
+#include <ecell4/gillespie/NextReactionSimulator.hpp>
+#include <ecell4/gillespie/NetfreeFactory.hpp>
+#include <ecell4/gillespie/NetfreeSimulator.hpp>
+#include <ecell4/gillespie/TauLeapingFactory.hpp>
+#include <ecell4/gillespie/TauLeapingSimulator.hpp>
 
 #include "simulator.hpp"
 #include "simulator_factory.hpp"
+#include "ensemble_runner.hpp"
 #include "world_interface.hpp"
 
 namespace py = pybind11;
@@ -22,7 +29,8 @@ void define_gillespie_factory(py::module& m)
 {
     py::class_<GillespieFactory> factory(m, "GillespieFactory");
     factory
-        .def(py::init<>())
+        .def(py::init<const GillespieSolverType>(),
+            py::arg("solver_type") = GillespieFactory::default_solver_type())
         .def("rng", &GillespieFactory::rng);
     define_factory_functions(factory);
 
@@ -35,16 +43,103 @@ void define_gillespie_simulator(py::module& m)
     py::class_<GillespieSimulator, Simulator, PySimulator<GillespieSimulator>,
         std::shared_ptr<GillespieSimulator>> simulator(m, "GillespieSimulator");
     simulator
-        .def(py::init<std::shared_ptr<GillespieWorld>>(), py::arg("w"))
-        .def(py::init<std::shared_ptr<GillespieWorld>, std::shared_ptr<Model>>(),
-                py::arg("w"), py::arg("m"))
+        .def(py::init<std::shared_ptr<GillespieWorld>, const GillespieSolverType>(),
+                py::arg("w"),
+                py::arg("solver_type") = GillespieSolverType::DIRECT_METHOD)
+        .def(py::init<std::shared_ptr<GillespieWorld>, std::shared_ptr<Model>, const GillespieSolverType>(),
+                py::arg("w"), py::arg("m"),
+                py::arg("solver_type") = GillespieSolverType::DIRECT_METHOD)
         .def("last_reactions", &GillespieSimulator::last_reactions)
+        .def("solver_type", &GillespieSimulator::solver_type)
         .def("set_t", &GillespieSimulator::set_t);
     define_simulator_functions(simulator);
 
     m.attr("Simulator") = simulator;
 }
 
+static inline
+void define_next_reaction_factory(py::module& m)
+{
+    py::class_<NextReactionFactory> factory(m, "NextReactionFactory");
+    factory
+        .def(py::init<>())
+        .def("rng", &NextReactionFactory::rng);
+    define_factory_functions(factory);
+}
+
+static inline
+void define_next_reaction_simulator(py::module& m)
+{
+    py::class_<NextReactionSimulator, Simulator, PySimulator<NextReactionSimulator>,
+        std::shared_ptr<NextReactionSimulator>> simulator(m, "NextReactionSimulator");
+    simulator
+        .def(py::init<std::shared_ptr<GillespieWorld>>(), py::arg("w"))
+        .def(py::init<std::shared_ptr<GillespieWorld>, std::shared_ptr<Model>>(),
+                py::arg("w"), py::arg("m"))
+        .def("last_reactions", &NextReactionSimulator::last_reactions)
+        .def("set_t", &NextReactionSimulator::set_t);
+    define_simulator_functions(simulator);
+}
+
+static inline
+void define_netfree_factory(py::module& m)
+{
+    py::class_<NetfreeFactory> factory(m, "NetfreeFactory");
+    factory
+        .def(py::init<>())
+        .def("rng", &NetfreeFactory::rng);
+    define_factory_functions(factory);
+}
+
+static inline
+void define_netfree_simulator(py::module& m)
+{
+    py::class_<NetfreeSimulator, Simulator, PySimulator<NetfreeSimulator>,
+        std::shared_ptr<NetfreeSimulator>> simulator(m, "NetfreeSimulator");
+    simulator
+        .def(py::init<std::shared_ptr<GillespieWorld>>(), py::arg("w"))
+        .def(py::init<std::shared_ptr<GillespieWorld>, std::shared_ptr<Model>>(),
+                py::arg("w"), py::arg("m"))
+        .def("last_reactions", &NetfreeSimulator::last_reactions)
+        .def("num_complexes", &NetfreeSimulator::num_complexes)
+        .def("set_t", &NetfreeSimulator::set_t);
+    define_simulator_functions(simulator);
+}
+
+static inline
+void define_tau_leaping_factory(py::module& m)
+{
+    py::class_<TauLeapingFactory> factory(m, "TauLeapingFactory");
+    factory
+        .def(py::init<const Real, const Integer>(),
+            py::arg("epsilon") = TauLeapingFactory::default_epsilon(),
+            py::arg("critical_threshold") = TauLeapingFactory::default_critical_threshold())
+        .def("rng", &TauLeapingFactory::rng);
+    define_factory_functions(factory);
+}
+
+static inline
+void define_tau_leaping_simulator(py::module& m)
+{
+    py::class_<TauLeapingSimulator, Simulator, PySimulator<TauLeapingSimulator>,
+        std::shared_ptr<TauLeapingSimulator>> simulator(m, "TauLeapingSimulator");
+    simulator
+        .def(py::init<std::shared_ptr<GillespieWorld>, const Real, const Integer>(),
+                py::arg("w"),
+                py::arg("epsilon") = TauLeapingSimulator::default_epsilon(),
+                py::arg("critical_threshold") = TauLeapingSimulator::default_critical_threshold())
+        .def(py::init<std::shared_ptr<GillespieWorld>, std::shared_ptr<Model>, const Real, const Integer>(),
+                py::arg("w"), py::arg("m"),
+                py::arg("epsilon") = TauLeapingSimulator::default_epsilon(),
+                py::arg("critical_threshold") = TauLeapingSimulator::default_critical_threshold())
+        .def("last_reactions", &TauLeapingSimulator::last_reactions)
+        .def("is_leaping", &TauLeapingSimulator::is_leaping)
+        .def("epsilon", &TauLeapingSimulator::epsilon)
+        .def("critical_threshold", &TauLeapingSimulator::critical_threshold)
+        .def("set_t", &TauLeapingSimulator::set_t);
+    define_simulator_functions(simulator);
+}
+
 static inline
 void define_gillespie_world(py::module& m)
 {
@@ -106,10 +201,22 @@ void define_reaction_info(py::module& m)
 
 void setup_gillespie_module(py::module& m)
 {
+    py::enum_<GillespieSolverType>(m, "GillespieSolverType")
+        .value("DIRECT_METHOD", GillespieSolverType::DIRECT_METHOD)
+        .value("LOGARITHMIC_DIRECT_METHOD", GillespieSolverType::LOGARITHMIC_DIRECT_METHOD)
+        .export_values();
+
     define_gillespie_factory(m);
     define_gillespie_simulator(m);
     define_gillespie_world(m);
+    define_next_reaction_factory(m);
+    define_next_reaction_simulator(m);
+    define_netfree_factory(m);
+    define_netfree_simulator(m);
+    define_tau_leaping_factory(m);
+    define_tau_leaping_simulator(m);
     define_reaction_info(m);
+    define_ensemble_runner<GillespieFactory>(m);
 }
 
 }
@@ -6,6 +6,8 @@
 
 #include "simulator.hpp"
 #include "simulator_factory.hpp"
+#include "ensemble_runner.hpp"
+#include "particle_arrays.hpp"
 #include "world_interface.hpp"
 
 namespace py = pybind11;
@@ -22,9 +24,11 @@ void define_meso_factory(py::module& m)
 {
     py::class_<MesoscopicFactory> factory(m, "MesoscopicFactory");
     factory
-        .def(py::init<const Integer3&, const Real>(),
+        .def(py::init<const Integer3&, const Real, const Integer, const Real>(),
             py::arg("matrix_sizes") = MesoscopicFactory::default_matrix_sizes(),
-            py::arg("subvolume_length") = MesoscopicFactory::default_subvolume_length())
+            py::arg("subvolume_length") = MesoscopicFactory::default_subvolume_length(),
+            py::arg("num_threads") = MesoscopicFactory::default_num_threads(),
+            py::arg("sync_interval") = MesoscopicFactory::default_sync_interval())
         .def("rng", &MesoscopicFactory::rng);
     define_factory_functions(factory);
 
@@ -37,10 +41,18 @@ void define_meso_simulator(py::module& m)
     py::class_<MesoscopicSimulator, Simulator, PySimulator<MesoscopicSimulator>,
         std::shared_ptr<MesoscopicSimulator>> simulator(m, "MesoscopicSimulator");
     simulator
-        .def(py::init<std::shared_ptr<MesoscopicWorld>>(), py::arg("w"))
-        .def(py::init<std::shared_ptr<MesoscopicWorld>, std::shared_ptr<Model>>(),
-                py::arg("w"), py::arg("m"))
+        .def(py::init<std::shared_ptr<MesoscopicWorld>, const Integer, const Real>(),
+                py::arg("w"),
+                py::arg("num_threads") = MesoscopicSimulator::default_num_threads(),
+                py::arg("sync_interval") = MesoscopicSimulator::default_sync_interval())
+        .def(py::init<std::shared_ptr<MesoscopicWorld>, std::shared_ptr<Model>,
+                const Integer, const Real>(),
+                py::arg("w"), py::arg("m"),
+                py::arg("num_threads") = MesoscopicSimulator::default_num_threads(),
+                py::arg("sync_interval") = MesoscopicSimulator::default_sync_interval())
         .def("last_reactions", &MesoscopicSimulator::last_reactions)
+        .def("num_threads", &MesoscopicSimulator::num_threads)
+        .def("sync_interval", &MesoscopicSimulator::sync_interval)
         .def("set_t", &MesoscopicSimulator::set_t);
     define_simulator_functions(simulator);
 
@@ -124,6 +136,8 @@ void define_meso_world(py::module& m)
         .def("bind_to", &MesoscopicWorld::bind_to)
         .def("rng", &MesoscopicWorld::rng);
 
+    define_new_particles(world);
+
     m.attr("World") = world;
 }
 
@@ -165,6 +179,7 @@ void setup_meso_module(py::module& m)
     define_meso_simulator(m);
     define_meso_world(m);
     define_reaction_info(m);
+    define_ensemble_runner<MesoscopicFactory>(m);
 }
 
 }
@@ -3,6 +3,7 @@
 #include <ecell4/ode/ODEFactory.hpp>
 #include <ecell4/ode/ODESimulator.hpp>
 #include <ecell4/ode/ODEWorld.hpp>
+#include <ecell4/ode/ODEEnsembleSimulator.hpp>
 
 #include "simulator.hpp"
 #include "simulator_factory.hpp"
@@ -98,16 +99,68 @@ void define_ode_world(py::module& m)
     m.attr("World") = world;
 }
 
+static inline
+void define_ode_ensemble_simulator(py::module& m)
+{
+    py::class_<ODEEnsembleResult>(m, "ODEEnsembleResult")
+        .def("times", &ODEEnsembleResult::times)
+        .def("species", &ODEEnsembleResult::species)
+        .def("num_members", &ODEEnsembleResult::num_members)
+        .def("value", &ODEEnsembleResult::value)
+        .def("values", &ODEEnsembleResult::values)
+        .def("data", (const ODEEnsembleResult::data_container_type&
+            (ODEEnsembleResult::*)() const) &ODEEnsembleResult::data);
+
+    py::class_<ODEEnsembleSimulator>(m, "ODEEnsembleSimulator")
+        .def(py::init<const std::shared_ptr<ODEWorld>&, const std::shared_ptr<Model>&,
+                      const std::vector<std::vector<Real> >&,
+                      const std::vector<std::vector<Real> >&,
+                      const ODESolverType, const Integer>(),
+                py::arg("w"), py::arg("m"), py::arg("values"),
+                py::arg("k") = std::vector<std::vector<Real> >(),
+                py::arg("solver_type") = ODESolverType::ROSENBROCK4_CONTROLLER,
+                py::arg("num_threads") = 1)
+        .def("num_members", &ODEEnsembleSimulator::num_members)
+        .def("num_threads", &ODEEnsembleSimulator::num_threads)
+        .def("species", &ODEEnsembleSimulator::species)
+        .def("dt", &ODEEnsembleSimulator::dt)
+        .def("set_dt", &ODEEnsembleSimulator::set_dt)
+        .def("absolute_tolerance", &ODEEnsembleSimulator::absolute_tolerance)
+        .def("set_absolute_tolerance", &ODEEnsembleSimulator::set_absolute_tolerance)
+        .def("relative_tolerance", &ODEEnsembleSimulator::relative_tolerance)
+        .def("set_relative_tolerance", &ODEEnsembleSimulator::set_relative_tolerance)
+        .def("maximum_step_interval", &ODEEnsembleSimulator::maximum_step_interval)
+        .def("set_maximum_step_interval", &ODEEnsembleSimulator::set_maximum_step_interval)
+        .def("initialize", &ODEEnsembleSimulator::initialize)
+        .def("run",
+            [](ODEEnsembleSimulator& self, const std::vector<Real>& times)
+            {
+                if (!self.initialized())
+                {
+                    self.initialize();
+                }
+                if (self.has_ratelaws())
+                {
+                    // A rate law may call back into Python.
+                    return self.run(times);
+                }
+                py::gil_scoped_release release;
+                return self.run(times);
+            }, py::arg("times"));
+}
+
 void setup_ode_module(py::module& m)
 {
     py::enum_<ODESolverType>(m, "ODESolverType")
         .value("RUNGE_KUTTA_CASH_KARP54", ODESolverType::RUNGE_KUTTA_CASH_KARP54)
         .value("ROSENBROCK4_CONTROLLER", ODESolverType::ROSENBROCK4_CONTROLLER)
         .value("EULER", ODESolverType::EULER)
+        .value("SPARSE_ROSENBROCK4_CONTROLLER", ODESolverType::SPARSE_ROSENBROCK4_CONTROLLER)
         .export_values();
 
     define_ode_factory(m);
     define_ode_simulator(m);
+    define_ode_ensemble_simulator(m);
     define_ode_world(m);
 }
 
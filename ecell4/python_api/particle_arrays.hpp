@@ -0,0 +1,180 @@
+#ifndef ECELL4_PYTHON_API_PARTICLE_ARRAYS_HPP
+#define ECELL4_PYTHON_API_PARTICLE_ARRAYS_HPP
+
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <boost/optional.hpp>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <ecell4/core/Particle.hpp>
+#include <ecell4/core/Species.hpp>
+
+#include "type_caster.hpp"
+
+namespace py = pybind11;
+
+namespace ecell4
+{
+
+namespace python_api
+{
+
+    /**
+     * wrap a buffer with a NumPy array without copying it.
+     * the array takes the ownership of the buffer.
+     */
+    template<typename T>
+    static inline
+    py::array_t<T> as_array(std::unique_ptr<std::vector<T>> data, const std::vector<std::size_t>& shape)
+    {
+        const T* ptr(data->data());
+        const py::capsule owner(data.get(), [](void* p) { delete reinterpret_cast<std::vector<T>*>(p); });
+        data.release();
+        return py::array_t<T>(shape, ptr, owner);
+    }
+
+    /**
+     * pack particles into NumPy arrays, without a Python object for each particle.
+     * species_index refers to the list of distinct species.
+     */
+    static inline
+    py::dict particles_as_arrays(const std::vector<std::pair<ParticleID, Particle>>& particles)
+    {
+        const std::size_t num(particles.size());
+        std::unique_ptr<std::vector<Real>> positions(new std::vector<Real>(3 * num));
+        std::unique_ptr<std::vector<Real>> radii(new std::vector<Real>(num));
+        std::unique_ptr<std::vector<Real>> D(new std::vector<Real>(num));
+        std::unique_ptr<std::vector<Integer>> species_index(new std::vector<Integer>(num));
+        std::unique_ptr<std::vector<ParticleID::lot_type>> lot(
+            new std::vector<ParticleID::lot_type>(num));
+        std::unique_ptr<std::vector<ParticleID::serial_type>> serial(
+            new std::vector<ParticleID::serial_type>(num));
+
+        std::vector<Species> species;
+        std::unordered_map<Species, Integer> indices;
+        for (std::size_t i(0); i < num; ++i)
+        {
+            const ParticleID& pid(particles[i].first);
+            const Particle& p(particles[i].second);
+
+            for (std::size_t j(0); j < 3; ++j)
+            {
+                (*positions)[3 * i + j] = p.position()[j];
+            }
+            (*radii)[i] = p.radius();
+            (*D)[i] = p.D();
+            (*lot)[i] = pid.lot();
+            (*serial)[i] = pid.serial();
+
+            const std::unordered_map<Species, Integer>::const_iterator
+                it(indices.insert(std::make_pair(p.species(), species.size())).first);
+            if ((*it).second == static_cast<Integer>(species.size()))
+            {
+                species.push_back(p.species());
+            }
+            (*species_index)[i] = (*it).second;
+        }
+
+        py::dict retval;
+        retval["species"] = species;
+        retval["species_index"] = as_array(std::move(species_index), {num});
+        retval["positions"] = as_array(std::move(positions), {num, 3});
+        retval["radii"] = as_array(std::move(radii), {num});
+        retval["D"] = as_array(std::move(D), {num});
+        retval["lot"] = as_array(std::move(lot), {num});
+        retval["serial"] = as_array(std::move(serial), {num});
+        return retval;
+    }
+
+    static inline
+    boost::optional<ParticleID> new_particle_id(const std::pair<std::pair<ParticleID, Particle>, bool>& retval)
+    {
+        if (!retval.second)
+        {
+            return boost::none;
+        }
+        return retval.first.first;
+    }
+
+    static inline
+    boost::optional<ParticleID> new_particle_id(const boost::optional<ParticleID>& retval)
+    {
+        return retval;
+    }
+
+    /**
+     * define new_particles, the counterpart of list_particles_as_arrays.
+     * particles are given as the species list, species_index and positions,
+     * optionally with radii and D. Otherwise, they are taken from the species.
+     * lot and serial of new particles are returned. Those failed are zeros.
+     */
+    template<typename T>
+    void define_new_particles(T& world)
+    {
+        using world_type = typename T::type;
+        using real_array_type = py::array_t<Real, py::array::c_style | py::array::forcecast>;
+        using index_array_type = py::array_t<Integer, py::array::c_style | py::array::forcecast>;
+
+        const auto new_particles = [](
+            world_type& self, const std::vector<Species>& species,
+            const index_array_type& species_index, const real_array_type& positions,
+            const boost::optional<real_array_type>& radii,
+            const boost::optional<real_array_type>& D)
+        {
+            const std::size_t num(species_index.size());
+            if (species_index.ndim() != 1
+                || positions.ndim() != 2 || positions.shape(1) != 3
+                || static_cast<std::size_t>(positions.shape(0)) != num
+                || (radii && static_cast<std::size_t>(radii->size()) != num)
+                || (D && static_cast<std::size_t>(D->size()) != num)
+                || static_cast<bool>(radii) != static_cast<bool>(D))
+            {
+                throw std::invalid_argument("The shapes of arrays do not match.");
+            }
+
+            const auto index(species_index.template unchecked<1>());
+            const auto pos(positions.template unchecked<2>());
+            for (std::size_t i(0); i < num; ++i)
+            {
+                if (index(i) < 0 || index(i) >= static_cast<Integer>(species.size()))
+                {
+                    throw std::out_of_range("A species index is out of range.");
+                }
+            }
+
+            std::unique_ptr<std::vector<ParticleID::lot_type>> lot(
+                new std::vector<ParticleID::lot_type>(num));
+            std::unique_ptr<std::vector<ParticleID::serial_type>> serial(
+                new std::vector<ParticleID::serial_type>(num));
+            for (std::size_t i(0); i < num; ++i)
+            {
+                const Species& sp(species[index(i)]);
+                const Real3 position(pos(i, 0), pos(i, 1), pos(i, 2));
+                const boost::optional<ParticleID> pid(radii
+                    ? new_particle_id(self.new_particle(Particle(sp, position, radii->data()[i], D->data()[i])))
+                    : new_particle_id(self.new_particle(sp, position)));
+                if (pid)
+                {
+                    (*lot)[i] = pid->lot();
+                    (*serial)[i] = pid->serial();
+                }
+            }
+
+            py::dict retval;
+            retval["lot"] = as_array(std::move(lot), {num});
+            retval["serial"] = as_array(std::move(serial), {num});
+            return retval;
+        };
+
+        world.def("new_particles", new_particles,
+            py::arg("species"), py::arg("species_index"), py::arg("positions"),
+            py::arg("radii") = py::none(), py::arg("D") = py::none());
+    }
+
+}
+
+}
+#endif /* ECELL4_PYTHON_API_PARTICLE_ARRAYS_HPP */
@@ -10,6 +10,8 @@
 
 #include "simulator.hpp"
 #include "simulator_factory.hpp"
+#include "ensemble_runner.hpp"
+#include "particle_arrays.hpp"
 #include "world_interface.hpp"
 
 namespace py = pybind11;
@@ -54,10 +56,12 @@ static inline void define_spatiocyte_factory(py::module &m)
 {
     py::class_<SpatiocyteFactory> factory(m, "SpatiocyteFactory");
     factory
-        .def(py::init<const Real>(),
+        .def(py::init<const Real, const Integer>(),
              py::arg("voxel_radius") =
-                 SpatiocyteFactory::default_voxel_radius())
-        .def("rng", &SpatiocyteFactory::rng);
+                 SpatiocyteFactory::default_voxel_radius(),
+             py::arg("num_threads") = SpatiocyteFactory::default_num_threads())
+        .def("rng", &SpatiocyteFactory::rng)
+        .def("lattice_type", &SpatiocyteFactory::lattice_type, py::arg("type"));
     define_factory_functions(factory);
 
     m.attr("Factory") = factory;
@@ -68,10 +72,17 @@ static inline void define_spatiocyte_simulator(py::module &m)
     py::class_<SpatiocyteSimulator, Simulator, PySimulator<SpatiocyteSimulator>,
                std::shared_ptr<SpatiocyteSimulator>>
         simulator(m, "SpatiocyteSimulator");
-    simulator.def(py::init<std::shared_ptr<SpatiocyteWorld>>(), py::arg("w"))
-        .def(py::init<std::shared_ptr<SpatiocyteWorld>,
-                      std::shared_ptr<Model>>(),
-             py::arg("w"), py::arg("m"))
+    simulator
+        .def(py::init<std::shared_ptr<SpatiocyteWorld>, const Integer>(),
+             py::arg("w"),
+             py::arg("num_threads") =
+                 SpatiocyteSimulator::default_num_threads())
+        .def(py::init<std::shared_ptr<SpatiocyteWorld>, std::shared_ptr<Model>,
+                      const Integer>(),
+             py::arg("w"), py::arg("m"),
+             py::arg("num_threads") =
+                 SpatiocyteSimulator::default_num_threads())
+        .def("num_threads", &SpatiocyteSimulator::num_threads)
         .def("last_reactions", &SpatiocyteSimulator::last_reactions)
         .def("set_t", &SpatiocyteSimulator::set_t);
     define_simulator_functions(simulator);
@@ -180,9 +191,13 @@ static inline void define_spatiocyte_world(py::module &m)
           &create_spatiocyte_world_cell_list_impl);
     m.def("create_spatiocyte_world_vector_impl",
           &create_spatiocyte_world_vector_impl);
+    m.def("create_spatiocyte_world_compact_impl",
+          &create_spatiocyte_world_compact_impl);
     m.def("create_spatiocyte_world_square_offlattice_impl",
           &allocate_spatiocyte_world_square_offlattice_impl);
 
+    define_new_particles(world);
+
     m.attr("World") = world;
 }
 
@@ -214,6 +229,7 @@ void setup_spatiocyte_module(py::module &m)
     define_spatiocyte_simulator(m);
     define_spatiocyte_world(m);
     define_voxel(m);
+    define_ensemble_runner<SpatiocyteFactory>(m);
 }
 
 } // namespace python_api
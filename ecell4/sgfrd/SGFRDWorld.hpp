@@ -690,8 +690,6 @@ class SGFRDWorld
             const std::pair<Real3, FaceID>& pos, const Real& radius,
             const ParticleID& ignore1, const ParticleID& ignore2) const;
 
-    particle_container_type const& particles() const {return ps_->particles();}
-
     Real3 periodic_transpose(const Real3& pos1, const Real3& pos2) const
     {
         return this->polygon_->periodic_transpose(pos1, pos2);
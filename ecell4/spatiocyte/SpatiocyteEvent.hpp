@@ -7,6 +7,7 @@
 #include <ecell4/core/EventScheduler.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/ReactionRule.hpp>
+#include <ecell4/core/ThreadPool.hpp>
 
 namespace ecell4
 {
@@ -24,6 +25,16 @@ public:
 
     const std::vector<reaction_type> &reactions() const { return reactions_; }
 
+    /**
+     * Species whose numbers the next time of this event depends on.
+     * SpatiocyteSimulator interrupts the event only when the number of
+     * any of them has changed.
+     */
+    virtual std::vector<Species> dependencies() const
+    {
+        return std::vector<Species>();
+    }
+
     virtual void fire()
     {
         reactions_.clear();
@@ -49,8 +60,11 @@ struct StepEvent : SpatiocyteEvent
 {
     StepEvent(std::shared_ptr<Model> model,
               std::shared_ptr<SpatiocyteWorld> world, const Species &species,
-              const Real &t, const Real alpha = 1.0)
-        : SpatiocyteEvent(t), model_(model), world_(world), alpha_(alpha)
+              const Real &t, const Real alpha = 1.0,
+              const std::shared_ptr<ThreadPool> &pool =
+                  std::shared_ptr<ThreadPool>())
+        : SpatiocyteEvent(t), model_(model), world_(world), alpha_(alpha),
+          pool_(pool), num_slabs_(0)
     {
         if (const auto space_and_molecule_pool =
                 world_->find_space_and_molecule_pool(species))
@@ -73,12 +87,22 @@ struct StepEvent : SpatiocyteEvent
             dt_ = calc_dt<Dimension>(R, D) * alpha_;
 
         time_ = t + dt_;
+
+        if (pool_ && pool_->num_threads() > 1)
+        {
+            initialize_slabs();
+        }
     }
 
     Species const &species() const { return mpool_->species(); }
 
     Real const &alpha() const { return alpha_; }
 
+    /**
+     * the number of slabs walked in parallel. zero means the serial walk.
+     */
+    Integer num_slabs() const { return num_slabs_; }
+
     void fire_()
     {
         walk(alpha_);
@@ -92,27 +116,47 @@ struct StepEvent : SpatiocyteEvent
             return; // INVALID ALPHA VALUE
         }
 
+        if (num_slabs_ > 0)
+        {
+            walk_in_parallel(alpha);
+            return;
+        }
+
         MoleculePool::container_type voxels;
         copy(mpool_->begin(), mpool_->end(), back_inserter(voxels));
 
-        std::size_t idx(0);
+        // Hold the space and the rng here, and use raw pointers below.
+        const std::shared_ptr<VoxelSpaceBase> space(space_.lock());
+        const std::shared_ptr<RandomNumberGenerator> rng(world_->rng());
+
+        // Draw neighbors of all at once.
+        coords_.clear();
+        coords_.reserve(voxels.size());
         for (const auto &info : voxels)
         {
-            const Voxel voxel(space_, info.coordinate);
+            coords_.push_back(info.coordinate);
+        }
+        world_->get_neighbors_randomly<Dimension>(space.get(), coords_,
+                                                  neighbors_);
+
+        std::size_t idx(0);
+        for (std::size_t i(0); i < voxels.size(); ++i)
+        {
+            const auto &info(voxels[i]);
+            const Voxel voxel(space.get(), info.coordinate);
 
-            if (voxel.get_voxel_pool() != mpool_)
+            if (voxel.get_voxel_pool_ptr() != mpool_.get())
             {
                 // should skip if a voxel is not the target species.
                 // when reaction has occured before, a voxel can be changed.
                 continue;
             }
 
-            const Voxel neighbor =
-                world_->get_neighbor_randomly<Dimension>(voxel);
+            const Voxel &neighbor(neighbors_[i]);
 
             if (world_->can_move(voxel, neighbor))
             {
-                if (world_->rng()->uniform(0, 1) <= alpha)
+                if (rng->uniform(0, 1) <= alpha)
                     world_->move(voxel, neighbor, /*candidate=*/idx);
             }
             else
@@ -125,6 +169,28 @@ struct StepEvent : SpatiocyteEvent
     }
 
 protected:
+    /**
+     * split the lattice into slabs of layers for the parallel walk
+     * on the threads of the pool.
+     * the walk stays serial if the space does not allow concurrent moves,
+     * if the location is not a structure, or if slabs get too thin.
+     */
+    void initialize_slabs();
+
+    /**
+     * walk molecules slab by slab. slabs are coloured alternately, and
+     * those with the same colour are walked at once. each slab draws from
+     * its own stream of PhiloxRandomNumberGenerator with a seed taken from
+     * the world once a step, so that a run is reproduced with the same seed
+     * and number of threads. as a slab is at least two layers thick, molecules in
+     * slabs of the same colour never touch the same voxel.
+     * reactions cannot run concurrently because they add and remove
+     * molecules. they are attempted after all moves, in the order of
+     * slabs, only if both voxels still hold the same pools and the
+     * molecule has not been replaced by a product of the same species.
+     */
+    void walk_in_parallel(const Real &alpha);
+
     void attempt_reaction_(const SpatiocyteWorld::coordinate_id_pair_type &info,
                            const Voxel &dst, const Real &alpha)
     {
@@ -186,8 +252,25 @@ protected:
     std::shared_ptr<MoleculePool> mpool_;
 
     const Real alpha_;
+
+    // buffers for walk
+    std::vector<VoxelSpaceBase::coordinate_type> coords_;
+    std::vector<Voxel> neighbors_;
+
+    // for walk_in_parallel
+    std::shared_ptr<ThreadPool> pool_; // shared with the simulator
+    Integer num_slabs_;
 };
 
+template <>
+void StepEvent<3>::initialize_slabs();
+template <>
+void StepEvent<2>::initialize_slabs();
+template <>
+void StepEvent<3>::walk_in_parallel(const Real &alpha);
+template <>
+void StepEvent<2>::walk_in_parallel(const Real &alpha);
+
 struct ZerothOrderReactionEvent : SpatiocyteEvent
 {
     ZerothOrderReactionEvent(std::shared_ptr<SpatiocyteWorld> world,
@@ -215,6 +298,11 @@ struct FirstOrderReactionEvent : SpatiocyteEvent
     Real draw_dt();
     virtual void interrupt(Real const &t) { time_ = t + draw_dt(); }
 
+    virtual std::vector<Species> dependencies() const
+    {
+        return rule_.reactants();
+    }
+
 protected:
     ReactionInfo::Item choice()
     {
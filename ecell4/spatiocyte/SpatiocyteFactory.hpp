@@ -23,8 +23,10 @@ public:
     typedef SpatiocyteFactory this_type;
 
 public:
-    SpatiocyteFactory(const Real voxel_radius = default_voxel_radius())
-        : base_type(), rng_(), voxel_radius_(voxel_radius)
+    SpatiocyteFactory(const Real voxel_radius = default_voxel_radius(),
+                      const Integer num_threads = default_num_threads())
+        : base_type(), rng_(), voxel_radius_(voxel_radius),
+          num_threads_(num_threads), lattice_type_(default_lattice_type())
     {
         ; // do nothing
     }
@@ -36,6 +38,28 @@ public:
 
     static inline const Real default_voxel_radius() { return 0.0; }
 
+    static inline const Integer default_num_threads()
+    {
+        return simulator_type::default_num_threads();
+    }
+
+    static inline const std::string default_lattice_type() { return "vector"; }
+
+    /**
+     * select the implementation of the root lattice, either "vector"
+     * (LatticeSpaceVectorImpl) or "compact" (LatticeSpaceCompactImpl).
+     */
+    this_type &lattice_type(const std::string &type)
+    {
+        if (type != "vector" && type != "compact")
+        {
+            throw IllegalArgument("Unknown lattice type [" + type +
+                                  "] was given.");
+        }
+        lattice_type_ = type;
+        return (*this);
+    }
+
     this_type &rng(const std::shared_ptr<RandomNumberGenerator> &rng)
     {
         rng_ = rng;
@@ -51,7 +75,21 @@ public:
 protected:
     virtual world_type *create_world(const Real3 &edge_lengths) const
     {
-        if (rng_)
+        if (lattice_type_ == "compact")
+        {
+            std::shared_ptr<RandomNumberGenerator> rng(rng_);
+            if (!rng)
+            {
+                rng = std::shared_ptr<RandomNumberGenerator>(
+                    new GSLRandomNumberGenerator());
+                (*rng).seed();
+            }
+            return create_spatiocyte_world_compact_impl(
+                edge_lengths,
+                (voxel_radius_ > 0 ? voxel_radius_ : edge_lengths[0] / 100),
+                rng);
+        }
+        else if (rng_)
         {
             return new world_type(edge_lengths, voxel_radius_, rng_);
         }
@@ -65,9 +103,37 @@ protected:
         }
     }
 
+    /**
+     * keep the type of the lattice, which is not saved in the file.
+     */
+    virtual world_type *load_world(const std::string &filename) const
+    {
+        if (lattice_type_ != "compact")
+        {
+            return base_type::load_world(filename);
+        }
+
+        // a tiny lattice, which is reset by load
+        std::unique_ptr<world_type> w(create_spatiocyte_world_compact_impl(
+            ones(), 0.25,
+            std::shared_ptr<RandomNumberGenerator>(
+                new GSLRandomNumberGenerator())));
+        w->load(filename);
+        return w.release();
+    }
+
+    virtual simulator_type *
+    create_simulator(const std::shared_ptr<world_type> &w,
+                     const std::shared_ptr<Model> &m) const
+    {
+        return new simulator_type(w, m, num_threads_);
+    }
+
 protected:
     std::shared_ptr<RandomNumberGenerator> rng_;
     Real voxel_radius_;
+    Integer num_threads_;
+    std::string lattice_type_;
 };
 
 } // namespace spatiocyte
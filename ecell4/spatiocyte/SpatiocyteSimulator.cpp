@@ -17,6 +17,7 @@ void SpatiocyteSimulator::initialize()
     species_list_.clear(); // XXX:FIXME: Messy patch
 
     scheduler_.clear();
+    dependents_.clear();
     update_alpha_map();
     for (const auto &species : world_->list_species())
     {
@@ -31,7 +32,7 @@ void SpatiocyteSimulator::initialize()
         }
         const std::shared_ptr<SpatiocyteEvent> zeroth_order_reaction_event(
             create_zeroth_order_reaction_event(rule, world_->t()));
-        scheduler_.add(zeroth_order_reaction_event);
+        add_event(zeroth_order_reaction_event);
     }
 
     dt_ = scheduler_.next_time() - t();
@@ -74,14 +75,75 @@ void SpatiocyteSimulator::register_events(const Species &sp)
         const Real alpha(itr != alpha_map_.end() ? itr->second : 1.0);
         const std::shared_ptr<SpatiocyteEvent> step_event(
             create_step_event(sp, world_->t(), alpha));
-        scheduler_.add(step_event);
+        add_event(step_event);
     }
 
     for (const auto &rule : model_->query_reaction_rules(sp))
     {
         const std::shared_ptr<SpatiocyteEvent> first_order_reaction_event(
             create_first_order_reaction_event(rule, world_->t()));
-        scheduler_.add(first_order_reaction_event);
+        add_event(first_order_reaction_event);
+    }
+}
+
+void SpatiocyteSimulator::add_event(
+    const std::shared_ptr<SpatiocyteEvent> &event)
+{
+    const scheduler_type::identifier_type id(scheduler_.add(event));
+    for (const auto &species : event->dependencies())
+    {
+        std::vector<scheduler_type::identifier_type> &ids(dependents_[species]);
+        if (std::find(ids.begin(), ids.end(), id) == ids.end())
+            ids.push_back(id);
+    }
+}
+
+void SpatiocyteSimulator::interrupt_dependents(
+    const scheduler_type::identifier_type &fired, const Real &t)
+{
+    // Species whose numbers may have changed. These include pools now
+    // occupying the voxels involved and their locations, because placing
+    // or removing a molecule changes the number of vacant voxels.
+    std::vector<Species> changed;
+    const auto mark = [&changed](const Species &species) {
+        if (std::find(changed.begin(), changed.end(), species) ==
+            changed.end())
+            changed.push_back(species);
+    };
+    const auto mark_item = [&mark](const ReactionInfo::Item &item) {
+        mark(item.species);
+        if (const auto pool = item.voxel.get_voxel_pool())
+        {
+            mark(pool->species());
+            if (const auto location = pool->location())
+                mark(location->species());
+        }
+    };
+
+    for (const auto &reaction : last_reactions())
+    {
+        for (const auto &item : reaction.second.reactants())
+            mark_item(item);
+        for (const auto &item : reaction.second.products())
+            mark_item(item);
+    }
+
+    for (const auto &species : changed)
+    {
+        const dependency_map_type::const_iterator itr(
+            dependents_.find(species));
+        if (itr == dependents_.end())
+            continue;
+
+        for (const auto &id : (*itr).second)
+        {
+            if (id == fired)
+                continue; // it has already drawn its next time in fire()
+
+            const std::shared_ptr<SpatiocyteEvent> event(scheduler_.get(id));
+            event->interrupt(t);
+            scheduler_.update(std::make_pair(id, event));
+        }
     }
 }
 
@@ -95,12 +157,12 @@ SpatiocyteSimulator::create_step_event(const Species &species, const Real &t,
     if (dimension == Shape::THREE)
     {
         return std::shared_ptr<SpatiocyteEvent>(
-            new StepEvent<3>(model_, world_, species, t, alpha));
+            new StepEvent<3>(model_, world_, species, t, alpha, pool_));
     }
     else if (dimension == Shape::TWO)
     {
         return std::shared_ptr<SpatiocyteEvent>(
-            new StepEvent<2>(model_, world_, species, t, alpha));
+            new StepEvent<2>(model_, world_, species, t, alpha, pool_));
     }
     else
     {
@@ -181,7 +243,9 @@ bool SpatiocyteSimulator::step(const Real &upto)
 
 void SpatiocyteSimulator::step_()
 {
-    scheduler_type::value_type top(scheduler_.pop());
+    // The top event is kept in the scheduler so that its identifier,
+    // which dependents_ refers to, never changes.
+    const scheduler_type::value_type top(scheduler_.top());
     const Real time(top.second->time());
     world_->set_t(time);
     top.second->fire(); // top.second->time_ is updated in fire()
@@ -204,12 +268,8 @@ void SpatiocyteSimulator::step_()
         }
     }
 
-    for (const auto &event : scheduler_.events())
-    {
-        event.second->interrupt(time);
-        scheduler_.update(event);
-    }
-    scheduler_.add(top.second);
+    scheduler_.update(top);
+    interrupt_dependents(top.first, time);
 
     // update_alpha_map(); // may be performance cost
     for (const auto &species : new_species)
@@ -27,21 +27,35 @@ public:
     typedef SpatiocyteEvent::reaction_type reaction_type;
     typedef EventSchedulerBase<SpatiocyteEvent> scheduler_type;
     typedef std::unordered_map<Species, Real> alpha_map_type;
+    typedef std::unordered_map<Species,
+                               std::vector<scheduler_type::identifier_type>>
+        dependency_map_type;
 
 public:
     SpatiocyteSimulator(std::shared_ptr<SpatiocyteWorld> world,
-                        std::shared_ptr<Model> model)
-        : base_type(world, model)
+                        std::shared_ptr<Model> model,
+                        const Integer num_threads = default_num_threads())
+        : base_type(world, model), num_threads_(num_threads),
+          pool_(num_threads > 1 ? new ThreadPool(num_threads) : NULL)
     {
         initialize();
     }
 
-    SpatiocyteSimulator(std::shared_ptr<SpatiocyteWorld> world)
-        : base_type(world)
+    SpatiocyteSimulator(std::shared_ptr<SpatiocyteWorld> world,
+                        const Integer num_threads = default_num_threads())
+        : base_type(world), num_threads_(num_threads),
+          pool_(num_threads > 1 ? new ThreadPool(num_threads) : NULL)
     {
         initialize();
     }
 
+    static inline const Integer default_num_threads() { return 1; }
+
+    /**
+     * the number of threads to walk molecules in 3D. see StepEvent.
+     */
+    Integer num_threads() const { return num_threads_; }
+
     virtual Real dt() const { return dt_; }
 
     void initialize();
@@ -69,6 +83,9 @@ protected:
 
     void step_();
     void register_events(const Species &species);
+    void add_event(const std::shared_ptr<SpatiocyteEvent> &event);
+    void interrupt_dependents(const scheduler_type::identifier_type &fired,
+                              const Real &t);
     void update_alpha_map();
 
     void set_last_event_(std::shared_ptr<const SpatiocyteEvent> event)
@@ -80,12 +97,15 @@ protected:
     scheduler_type scheduler_;
     std::shared_ptr<const SpatiocyteEvent> last_event_;
     alpha_map_type alpha_map_;
+    dependency_map_type dependents_; // events to interrupt for each species
 
     std::vector<reaction_type> last_reactions_;
 
     std::vector<Species> species_list_;
 
     Real dt_;
+    Integer num_threads_;
+    std::shared_ptr<ThreadPool> pool_; // kept across steps if multithreaded
 };
 
 } // namespace spatiocyte
@@ -168,7 +168,7 @@ bool SpatiocyteWorld::add_molecules(const Species &sp, const Integer &num)
         auto count(0);
         while (count < num)
         {
-            const Voxel voxel(space, rng()->uniform_int(0, space->size() - 1));
+            const Voxel voxel(space, rng_->uniform_int(0, space->size() - 1));
 
             if (voxel.get_voxel_pool() != location)
                 continue;
@@ -377,18 +377,19 @@ boost::optional<Voxel> SpatiocyteWorld::check_neighbor(const Voxel &voxel,
         return boost::none;
     }
 
-    return tmp[rng()->uniform_int(0, tmp.size() - 1)];
+    return tmp[rng_->uniform_int(0, tmp.size() - 1)];
 }
 
 template <>
-const Voxel SpatiocyteWorld::get_neighbor_randomly<3>(const Voxel &voxel)
+const Voxel SpatiocyteWorld::get_neighbor_randomly<3>(const Voxel &voxel,
+                                                      RandomNumberGenerator &rng)
 {
-    const auto idx(rng()->uniform_int(0, num_neighbors(voxel) - 1));
+    const auto idx(rng.uniform_int(0, num_neighbors(voxel) - 1));
     const auto neighbor = get_neighbor(voxel, idx);
 
     if (const auto neighbors = interfaces_.find(neighbor))
     {
-        const auto idx(rng()->uniform_int(0, neighbors->size() - 1));
+        const auto idx(rng.uniform_int(0, neighbors->size() - 1));
         return neighbors->at(idx);
     }
 
@@ -396,31 +397,73 @@ const Voxel SpatiocyteWorld::get_neighbor_randomly<3>(const Voxel &voxel)
 }
 
 template <>
-const Voxel SpatiocyteWorld::get_neighbor_randomly<2>(const Voxel &voxel)
+const Voxel SpatiocyteWorld::get_neighbor_randomly<2>(const Voxel &voxel,
+                                                      RandomNumberGenerator &rng)
 {
     std::vector<Voxel> neighbors;
     for (Integer idx = 0; idx < num_neighbors(voxel); ++idx)
     {
         const Voxel neighbor = get_neighbor(voxel, idx);
-        if (get_dimension(neighbor.get_voxel_pool()->species()) > Shape::TWO)
+        if (get_dimension(neighbor.get_voxel_pool_ptr()->species()) >
+            Shape::TWO)
         {
             continue;
         }
         neighbors.push_back(neighbor);
     }
 
-    const Integer idx(rng()->uniform_int(0, neighbors.size() - 1));
+    const Integer idx(rng.uniform_int(0, neighbors.size() - 1));
     const auto neighbor = neighbors.at(idx);
 
     if (const auto neighbors = interfaces_.find(neighbor))
     {
-        const auto idx(rng()->uniform_int(0, neighbors->size() - 1));
+        const auto idx(rng.uniform_int(0, neighbors->size() - 1));
         return neighbors->at(idx);
     }
 
     return neighbor;
 }
 
+template <>
+void SpatiocyteWorld::get_neighbors_randomly<3>(
+    VoxelSpaceBase *space, const std::vector<coordinate_type> &coords,
+    std::vector<Voxel> &neighbors, RandomNumberGenerator &rng)
+{
+    std::vector<coordinate_type> dests;
+    space->get_neighbors_randomly(coords, rng, dests);
+
+    const bool has_interfaces(interfaces_.begin() != interfaces_.end());
+    neighbors.clear();
+    neighbors.reserve(dests.size());
+    for (const auto &dest : dests)
+    {
+        const Voxel neighbor(space, dest);
+        if (has_interfaces)
+        {
+            if (const auto candidates = interfaces_.find(neighbor))
+            {
+                const auto idx(rng.uniform_int(0, candidates->size() - 1));
+                neighbors.push_back(candidates->at(idx));
+                continue;
+            }
+        }
+        neighbors.push_back(neighbor);
+    }
+}
+
+template <>
+void SpatiocyteWorld::get_neighbors_randomly<2>(
+    VoxelSpaceBase *space, const std::vector<coordinate_type> &coords,
+    std::vector<Voxel> &neighbors, RandomNumberGenerator &rng)
+{
+    neighbors.clear();
+    neighbors.reserve(coords.size());
+    for (const auto &coord : coords)
+    {
+        neighbors.push_back(get_neighbor_randomly<2>(Voxel(space, coord), rng));
+    }
+}
+
 } // namespace spatiocyte
 
 } // namespace ecell4
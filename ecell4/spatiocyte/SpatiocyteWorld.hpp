@@ -7,6 +7,7 @@
 #include <stdexcept>
 
 #include <ecell4/core/LatticeSpaceCellListImpl.hpp>
+#include <ecell4/core/LatticeSpaceCompactImpl.hpp>
 #include <ecell4/core/LatticeSpaceVectorImpl.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/OffLatticeSpace.hpp>
@@ -40,6 +41,7 @@ class SpatiocyteWorld : public WorldInterface
 public:
     typedef LatticeSpaceVectorImpl default_root_type;
 
+    typedef VoxelSpaceBase::coordinate_type coordinate_type;
     typedef VoxelSpaceBase::coordinate_id_pair_type coordinate_id_pair_type;
 
     typedef std::shared_ptr<VoxelSpaceBase> space_type;
@@ -164,6 +166,7 @@ public:
 
         const H5::Group group(fin->openGroup("LatticeSpace"));
         get_root()->load_hdf5(group); // TODO
+        size_ = get_root()->size();
         sidgen_.load(*fin);
         rng_->load(*fin);
 #else
@@ -378,7 +381,7 @@ public:
 
     std::pair<ParticleID, Species> get_voxel_at(const Voxel &voxel) const
     {
-        const auto view(voxel.space.lock()->get_voxel_at(voxel.coordinate));
+        const auto view(voxel.space->get_voxel_at(voxel.coordinate));
         return std::make_pair(view.pid, view.species);
     }
 
@@ -482,12 +485,12 @@ public:
     {
         const MoleculeInfo minfo(get_molecule_info(species));
 
-        const auto target_space = voxel.space.lock();
+        VoxelSpaceBase *target_space(voxel.space);
         for (const auto &space : spaces_)
         {
             if (space->has_voxel(pid))
             {
-                if (space != target_space)
+                if (space.get() != target_space)
                 {
                     space->remove_voxel(pid);
                 }
@@ -516,12 +519,10 @@ public:
     // Deprecated
     bool can_move(const Voxel &src, const Voxel &dst) const
     {
-        // if they share the ownership (or both are empty), then we can move it.
-        // owner_before compares not only the number of owners, but also the
-        // address itself.
-        if (!src.space.owner_before(dst.space) && !dst.space.owner_before(src.space))
+        // if they are in the same space, then we can move it.
+        if (src.space == dst.space)
         {
-            return src.space.lock()->can_move(src.coordinate, dst.coordinate);
+            return src.space->can_move(src.coordinate, dst.coordinate);
         }
         return false;
     }
@@ -530,13 +531,10 @@ public:
     bool move(const Voxel &src, const Voxel &dst,
               const std::size_t candidate = 0)
     {
-        // if they share the ownership (or both are empty), then we can move it.
-        // owner_before compares not only the number of owners, but also the
-        // address itself.
-        if (!src.space.owner_before(dst.space) && !dst.space.owner_before(src.space))
+        // if they are in the same space, then we can move it.
+        if (src.space == dst.space)
         {
-            return src.space.lock()->move(src.coordinate, dst.coordinate,
-                                          candidate);
+            return src.space->move(src.coordinate, dst.coordinate, candidate);
         }
         return false;
     }
@@ -718,7 +716,7 @@ public:
     boost::optional<ParticleID> new_particle(const Species &sp,
                                              const Voxel &voxel)
     {
-        std::shared_ptr<VoxelSpaceBase> space(voxel.space.lock());
+        VoxelSpaceBase *space(voxel.space);
         if (!space->has_species(sp))
         {
             const MoleculeInfo minfo(get_molecule_info(sp));
@@ -736,7 +734,7 @@ public:
     boost::optional<ParticleID> new_voxel_structure(const Species &sp,
                                                     const Voxel &voxel)
     {
-        std::shared_ptr<VoxelSpaceBase> space(voxel.space.lock());
+        VoxelSpaceBase *space(voxel.space);
         if (!space->has_species(sp))
         {
             const MoleculeInfo minfo(get_molecule_info(sp));
@@ -765,17 +763,46 @@ public:
 
     const Integer num_neighbors(const Voxel &voxel) const
     {
-        return voxel.space.lock()->num_neighbors(voxel.coordinate);
+        return voxel.space->num_neighbors(voxel.coordinate);
     }
 
     const Voxel get_neighbor(const Voxel &voxel, Integer nrand) const
     {
         return Voxel(voxel.space,
-                     voxel.space.lock()->get_neighbor(voxel.coordinate, nrand));
+                     voxel.space->get_neighbor(voxel.coordinate, nrand));
     }
 
     template <int Dimension>
-    const Voxel get_neighbor_randomly(const Voxel &voxel);
+    const Voxel get_neighbor_randomly(const Voxel &voxel)
+    {
+        return get_neighbor_randomly<Dimension>(voxel, *rng_);
+    }
+
+    /**
+     * the same as above, but with the given random number generator.
+     * this can be called from multiple threads with their own generators.
+     */
+    template <int Dimension>
+    const Voxel get_neighbor_randomly(const Voxel &voxel,
+                                      RandomNumberGenerator &rng);
+
+    /**
+     * the same as get_neighbor_randomly for each voxel in a space,
+     * but draws neighbors at once.
+     */
+    template <int Dimension>
+    void get_neighbors_randomly(VoxelSpaceBase *space,
+                                const std::vector<coordinate_type> &coords,
+                                std::vector<Voxel> &neighbors)
+    {
+        get_neighbors_randomly<Dimension>(space, coords, neighbors, *rng_);
+    }
+
+    template <int Dimension>
+    void get_neighbors_randomly(VoxelSpaceBase *space,
+                                const std::vector<coordinate_type> &coords,
+                                std::vector<Voxel> &neighbors,
+                                RandomNumberGenerator &rng);
 
     const Species &draw_species(const Species &pttrn) const;
 
@@ -948,6 +975,14 @@ inline SpatiocyteWorld *create_spatiocyte_world_vector_impl(
         new LatticeSpaceVectorImpl(edge_lengths, voxel_radius), rng);
 }
 
+inline SpatiocyteWorld *create_spatiocyte_world_compact_impl(
+    const Real3 &edge_lengths, const Real &voxel_radius,
+    const std::shared_ptr<RandomNumberGenerator> &rng)
+{
+    return new SpatiocyteWorld(
+        new LatticeSpaceCompactImpl(edge_lengths, voxel_radius), rng);
+}
+
 inline SpatiocyteWorld *allocate_spatiocyte_world_square_offlattice_impl(
     const Real edge_length, const Species &species, const Real &voxel_radius,
     const std::shared_ptr<RandomNumberGenerator> &rng)
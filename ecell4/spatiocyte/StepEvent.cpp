@@ -1,4 +1,7 @@
 #include "SpatiocyteEvent.hpp"
+#include <ecell4/core/HCPLatticeSpace.hpp>
+
+#include <unordered_set>
 
 namespace ecell4
 {
@@ -18,6 +21,147 @@ const Real calc_dt<2>(const Real R, const Real D)
     return R * R / D;
 }
 
+template <>
+void StepEvent<3>::initialize_slabs()
+{
+    num_slabs_ = 0;
+
+    const std::shared_ptr<VoxelSpaceBase> space(space_.lock());
+    const HCPLatticeSpace *lattice(
+        dynamic_cast<const HCPLatticeSpace *>(space.get()));
+    if (lattice == NULL || !lattice->allows_concurrent_moves())
+        return;
+
+    const std::shared_ptr<VoxelPool> location(mpool_->location());
+    if (!location || location->voxel_type() == VoxelPool::DEFAULT)
+        return; // moves would modify the location pool too
+
+    // An even number of slabs, each of which is two layers at least.
+    Integer num_slabs(
+        std::min(2 * pool_->num_threads(), Integer(lattice->layer_size() / 2)));
+    num_slabs -= num_slabs % 2;
+    if (num_slabs < 4)
+        return; // no slabs of the same colour to walk at once
+
+    num_slabs_ = num_slabs;
+}
+
+template <>
+void StepEvent<2>::initialize_slabs()
+{
+    num_slabs_ = 0; // molecules on a structure are always walked serially
+}
+
+template <>
+void StepEvent<3>::walk_in_parallel(const Real &alpha)
+{
+    typedef VoxelSpaceBase::coordinate_type coordinate_type;
+
+    // The pool is neither resized nor reordered until reactions below,
+    // so voxels[i] is always at mpool_->begin() + i while walking.
+    const MoleculePool::container_type voxels(mpool_->begin(), mpool_->end());
+    const std::shared_ptr<VoxelSpaceBase> space(space_.lock());
+    const HCPLatticeSpace *lattice(
+        static_cast<const HCPLatticeSpace *>(space.get()));
+
+    const Integer num_layers(lattice->layer_size());
+    std::vector<std::vector<std::size_t>> members(num_slabs_);
+    for (std::size_t i(0); i < voxels.size(); ++i)
+    {
+        const Integer layer(
+            lattice->coordinate2global(voxels[i].coordinate).layer);
+        members[layer * num_slabs_ / num_layers].push_back(i);
+    }
+
+    // 62 bits of a seed for the streams of slabs, as BDParallelPropagator
+    const std::shared_ptr<RandomNumberGenerator> world_rng(world_->rng());
+    const Integer seed(world_rng->uniform_int(0, 0x7fffffff) * 0x80000000LL +
+                       world_rng->uniform_int(0, 0x7fffffff));
+
+    std::vector<std::vector<std::pair<std::size_t, Voxel>>> attempts(
+        num_slabs_);
+    const auto walk_slab = [&](const Integer slab) {
+        PhiloxRandomNumberGenerator rng(seed, slab);
+        std::vector<coordinate_type> coords;
+        coords.reserve(members[slab].size());
+        for (const auto &i : members[slab])
+        {
+            coords.push_back(voxels[i].coordinate);
+        }
+        std::vector<Voxel> neighbors;
+        world_->get_neighbors_randomly<3>(space.get(), coords, neighbors, rng);
+
+        for (std::size_t k(0); k < coords.size(); ++k)
+        {
+            const std::size_t &i(members[slab][k]);
+            const Voxel voxel(space.get(), coords[k]);
+            if (voxel.get_voxel_pool_ptr() != mpool_.get())
+                continue;
+
+            const Voxel &neighbor(neighbors[k]);
+            if (world_->can_move(voxel, neighbor))
+            {
+                if (rng.uniform(0, 1) <= alpha)
+                    world_->move(voxel, neighbor, /*candidate=*/i);
+            }
+            else
+            {
+                attempts[slab].push_back(std::make_pair(i, neighbor));
+            }
+        }
+    };
+
+    const Integer stride(2 * pool_->num_threads());
+    for (Integer colour(0); colour < 2; ++colour)
+    {
+        pool_->run([&](const std::size_t rank) {
+            for (Integer slab(colour + 2 * static_cast<Integer>(rank));
+                 slab < num_slabs_; slab += stride)
+            {
+                walk_slab(slab);
+            }
+        });
+    }
+
+    // Voxels where products of this species have been placed. A molecule
+    // in the list is no longer there if its voxel is in this set.
+    std::unordered_set<coordinate_type> replaced;
+    for (const auto &slab_attempts : attempts)
+    {
+        for (const auto &attempt : slab_attempts)
+        {
+            const auto &info(voxels[attempt.first]);
+            const Voxel voxel(space.get(), info.coordinate);
+            if (voxel.get_voxel_pool_ptr() != mpool_.get())
+                continue; // consumed by a reaction before
+
+            if (!replaced.empty() && replaced.count(info.coordinate) > 0)
+                continue; // replaced by a product
+
+            if (world_->can_move(voxel, attempt.second))
+                continue; // the partner has left
+
+            const std::size_t num_reactions(reactions_.size());
+            attempt_reaction_(info, attempt.second, alpha);
+            if (reactions_.size() == num_reactions)
+                continue;
+
+            for (const auto &product : reactions_.back().second.products())
+            {
+                if (product.voxel.space == space.get() &&
+                    product.voxel.get_voxel_pool_ptr() == mpool_.get())
+                    replaced.insert(product.voxel.coordinate);
+            }
+        }
+    }
+}
+
+template <>
+void StepEvent<2>::walk_in_parallel(const Real &alpha)
+{
+    throw NotSupported("Molecules on a structure cannot walk in parallel.");
+}
+
 } // namespace spatiocyte
 
 } // namespace ecell4
@@ -14,34 +14,60 @@ namespace spatiocyte
 
 class SpatiocyteWorld;
 
+/**
+ * A handle of a voxel in a space owned by SpatiocyteWorld.
+ * It holds a raw non-owning pointer to the space, so that copying and
+ * dereferencing it on hot paths never touches reference counts.
+ * A voxel must not outlive the world.
+ */
 struct Voxel
 {
     typedef VoxelSpaceBase::coordinate_type coordinate_type;
 
-    Voxel(std::weak_ptr<VoxelSpaceBase> space, coordinate_type coordinate)
+    Voxel(VoxelSpaceBase *space, coordinate_type coordinate)
         : space(space), coordinate(coordinate)
     {
     }
 
-    std::weak_ptr<VoxelSpaceBase> space;
+    Voxel(const std::shared_ptr<VoxelSpaceBase> &space,
+          coordinate_type coordinate)
+        : space(space.get()), coordinate(coordinate)
+    {
+    }
+
+    Voxel(const std::weak_ptr<VoxelSpaceBase> &space,
+          coordinate_type coordinate)
+        : space(space.lock().get()), coordinate(coordinate)
+    {
+    }
+
+    VoxelSpaceBase *space;
     coordinate_type coordinate;
 
 public:
     const Real3 position() const
     {
-        return space.lock()->coordinate2position(coordinate);
+        return space->coordinate2position(coordinate);
     }
 
-    bool clear() const { return space.lock()->remove_voxel(coordinate); }
+    bool clear() const { return space->remove_voxel(coordinate); }
 
     std::shared_ptr<VoxelPool> get_voxel_pool() const
     {
-        return space.lock()->get_voxel_pool_at(coordinate);
+        return space->get_voxel_pool_at(coordinate);
+    }
+
+    /**
+     * the same as get_voxel_pool, but without touching the reference count.
+     */
+    const VoxelPool *get_voxel_pool_ptr() const
+    {
+        return space->get_voxel_pool_ptr_at(coordinate);
     }
 
     bool operator==(const Voxel &rhs) const noexcept
     {
-        return space.lock() == rhs.space.lock() && coordinate == rhs.coordinate;
+        return space == rhs.space && coordinate == rhs.coordinate;
     }
 };
 
@@ -55,8 +81,7 @@ struct hash<ecell4::spatiocyte::Voxel>
 {
     std::size_t operator()(const ecell4::spatiocyte::Voxel &val) const
     {
-        auto ptr = val.space.lock().get();
-        return hash<decltype(ptr)>()(ptr) ^
+        return hash<ecell4::VoxelSpaceBase *>()(val.space) ^
                static_cast<std::size_t>(val.coordinate);
     }
 };
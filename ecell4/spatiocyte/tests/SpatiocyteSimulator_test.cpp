@@ -261,6 +261,191 @@ BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_binding_reaction)
     BOOST_CHECK_EQUAL(25 - world->num_molecules(sp2), num_sp3);
 }
 
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_interrupt_dependents)
+{
+    const Real L(2.5e-8);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const Real radius(1.25e-9);
+    const ecell4::Species sp1("A", radius, 1.0e-12), sp2("B", radius, 1.1e-12),
+        sp3("C", 2.5e-9, 1.2e-12), sp4("D", 2.5e-9, 1.2e-12);
+
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_species_attribute(sp4);
+
+    model->add_reaction_rule(
+        create_binding_reaction_rule(sp1, sp2, sp3, 1e-20));
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp3, sp4, 1e6));
+
+    std::shared_ptr<GSLRandomNumberGenerator> rng(
+        new GSLRandomNumberGenerator());
+    std::shared_ptr<SpatiocyteWorld> world(
+        new SpatiocyteWorld(edge_lengths, voxel_radius, rng));
+
+    SpatiocyteSimulator sim(world, model);
+
+    BOOST_CHECK(world->add_molecules(sp1, 25));
+    BOOST_CHECK(world->add_molecules(sp2, 25));
+    // The event of C -> D is scheduled at infinity with no C at first.
+    // It must be rescheduled when A + B -> C produces C.
+    BOOST_CHECK(world->add_molecules(sp3, 1));
+    world->remove_molecules(sp3, 1);
+    sim.initialize();
+
+    for (Integer i(0); i < 200; ++i)
+    {
+        sim.step();
+    }
+    const Integer num_sp4(world->num_molecules(sp4));
+    BOOST_CHECK(num_sp4 > 0);
+    BOOST_CHECK_EQUAL(25 - world->num_molecules(sp1),
+                      world->num_molecules(sp3) + num_sp4);
+}
+
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_compact_impl)
+{
+    const Real L(2.5e-8);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const Real radius(1.25e-9);
+    const ecell4::Species sp1("A", radius, 1.0e-12), sp2("B", radius, 1.1e-12),
+        sp3("C", 2.5e-9, 1.2e-12);
+
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+
+    model->add_reaction_rule(
+        create_binding_reaction_rule(sp1, sp2, sp3, 1e-20));
+
+    std::shared_ptr<GSLRandomNumberGenerator> rng(
+        new GSLRandomNumberGenerator());
+    std::shared_ptr<SpatiocyteWorld> world(
+        create_spatiocyte_world_compact_impl(edge_lengths, voxel_radius, rng));
+
+    SpatiocyteSimulator sim(world, model);
+
+    BOOST_CHECK(world->add_molecules(sp1, 25));
+    BOOST_CHECK(world->add_molecules(sp2, 25));
+    sim.initialize();
+
+    for (Integer i(0); i < 20; ++i)
+    {
+        sim.step();
+    }
+    const Integer num_sp3(world->num_molecules(sp3));
+    BOOST_ASSERT(num_sp3 > 0);
+    BOOST_CHECK_EQUAL(25 - world->num_molecules(sp1), num_sp3);
+    BOOST_CHECK_EQUAL(25 - world->num_molecules(sp2), num_sp3);
+    BOOST_CHECK_EQUAL(world->list_particles().size(), 50 - num_sp3);
+}
+
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_parallel_walk)
+{
+    const Real L(1e-7);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const Real radius(1.25e-9);
+    const ecell4::Species sp1("A", radius, 1.0e-12), sp2("B", radius, 1.1e-12),
+        sp3("C", 2.5e-9, 1.2e-12);
+
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+
+    model->add_reaction_rule(
+        create_binding_reaction_rule(sp1, sp2, sp3, 1e-20));
+
+    std::shared_ptr<GSLRandomNumberGenerator> rng(
+        new GSLRandomNumberGenerator());
+    std::shared_ptr<SpatiocyteWorld> world(
+        new SpatiocyteWorld(edge_lengths, voxel_radius, rng));
+
+    BOOST_CHECK(world->add_molecules(sp1, 1000));
+    BOOST_CHECK(world->add_molecules(sp2, 1000));
+
+    SpatiocyteSimulator sim(world, model, 2);
+    BOOST_CHECK_EQUAL(sim.num_threads(), 2);
+
+    StepEvent<3> event(model, world, sp1, world->t(), 1.0,
+                       std::shared_ptr<ThreadPool>(new ThreadPool(2)));
+    BOOST_CHECK_EQUAL(event.num_slabs(), 4);
+
+    const std::vector<std::pair<ParticleID, Particle>> initial(
+        world->list_particles_exact(sp1));
+    for (Integer i(0); i < 50; ++i)
+    {
+        sim.step();
+    }
+
+    const Integer num_sp3(world->num_molecules(sp3));
+    BOOST_ASSERT(num_sp3 > 0);
+    BOOST_CHECK_EQUAL(1000 - world->num_molecules(sp1), num_sp3);
+    BOOST_CHECK_EQUAL(1000 - world->num_molecules(sp2), num_sp3);
+
+    // Each molecule in a pool is on a voxel occupied by the pool.
+    for (const auto &sp : {sp1, sp2, sp3})
+    {
+        for (const auto &item : world->list_voxels_exact(sp))
+        {
+            const std::pair<ParticleID, Species> view(
+                world->get_voxel_at(item.voxel));
+            BOOST_CHECK_EQUAL(view.first, item.pid);
+            BOOST_CHECK_EQUAL(view.second, sp);
+        }
+    }
+
+    Integer num_moved(0);
+    for (const auto &item : initial)
+    {
+        if (world->has_particle(item.first) &&
+            world->get_particle(item.first).second.position() !=
+                item.second.position())
+            ++num_moved;
+    }
+    BOOST_CHECK(num_moved > 0);
+}
+
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_parallel_walk_reproducible)
+{
+    const Real L(1e-7);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const ecell4::Species sp1("A", 1.25e-9, 1.0e-12);
+
+    std::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+
+    std::vector<std::vector<Voxel::coordinate_type>> results;
+    for (Integer trial(0); trial < 2; ++trial)
+    {
+        std::shared_ptr<GSLRandomNumberGenerator> rng(
+            new GSLRandomNumberGenerator(1));
+        std::shared_ptr<SpatiocyteWorld> world(
+            new SpatiocyteWorld(edge_lengths, voxel_radius, rng));
+        BOOST_CHECK(world->add_molecules(sp1, 1000));
+
+        SpatiocyteSimulator sim(world, model, 2);
+        for (Integer i(0); i < 20; ++i)
+        {
+            sim.step();
+        }
+
+        std::vector<Voxel::coordinate_type> coordinates;
+        for (const auto &item : world->list_voxels_exact(sp1))
+        {
+            coordinates.push_back(item.voxel.coordinate);
+        }
+        results.push_back(coordinates);
+    }
+    BOOST_CHECK(results[0] == results[1]);
+}
+
 BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_unbinding_reaction)
 {
     const Real L(2.5e-8);
@@ -0,0 +1,106 @@
+import unittest
+import numpy
+from ecell4_base.core import *
+from ecell4_base.bd import BDWorld
+
+class ParticleArraysTest(unittest.TestCase):
+
+    def setUp(self):
+        self.species = [Species("A", 0.005, 1.0), Species("B", 0.01, 0.5)]
+
+        model = NetworkModel()
+        for sp in self.species:
+            model.add_species_attribute(sp)
+
+        self.world = BDWorld(ones(), Integer3(3, 3, 3))
+        self.world.bind_to(model)
+
+        # particles on a grid never overlap
+        self.positions = numpy.array(
+            [[0.1 + 0.2 * i, 0.1 + 0.2 * j, 0.5] for i in range(5) for j in range(5)])
+        self.species_index = numpy.array([i % 2 for i in range(25)])
+
+    def assertParticles(self, arrays, particles):
+        self.assertEqual(arrays["positions"].shape, (len(particles), 3))
+        for i, (pid, p) in enumerate(particles):
+            self.assertEqual(arrays["lot"][i], pid.lot())
+            self.assertEqual(arrays["serial"][i], pid.serial())
+            self.assertEqual(
+                arrays["species"][arrays["species_index"][i]].serial(), p.species().serial())
+            self.assertEqual(Real3(*arrays["positions"][i]), p.position())
+            self.assertEqual(arrays["radii"][i], p.radius())
+            self.assertEqual(arrays["D"][i], p.D())
+
+    def test_new_particles(self):
+        pids = self.world.new_particles(self.species, self.species_index, self.positions)
+        self.assertEqual(pids["lot"].shape, (25, ))
+        self.assertEqual(pids["serial"].shape, (25, ))
+        self.assertEqual(self.world.num_particles(), 25)
+
+        for i in range(25):
+            pid = ParticleID((int(pids["lot"][i]), int(pids["serial"][i])))
+            self.assertTrue(self.world.has_particle(pid))
+            p = self.world.get_particle(pid)[1]
+            sp = self.species[self.species_index[i]]
+            self.assertEqual(p.species().serial(), sp.serial())
+            self.assertEqual(p.position(), Real3(*self.positions[i]))
+            self.assertEqual(p.radius(), 0.005 if i % 2 == 0 else 0.01)
+
+    def test_new_particles_with_radii_and_D(self):
+        radii = numpy.full(25, 0.02)
+        D = numpy.arange(25, dtype=float)
+        pids = self.world.new_particles(
+            self.species, self.species_index, self.positions, radii, D)
+        for i in range(25):
+            p = self.world.get_particle(ParticleID((int(pids["lot"][i]), int(pids["serial"][i]))))[1]
+            self.assertEqual(p.radius(), 0.02)
+            self.assertEqual(p.D(), D[i])
+
+    def test_list_particles_as_arrays(self):
+        self.world.new_particles(self.species, self.species_index, self.positions)
+
+        self.assertParticles(
+            self.world.list_particles_as_arrays(), self.world.list_particles())
+        for sp in self.species:
+            self.assertParticles(
+                self.world.list_particles_as_arrays(sp), self.world.list_particles(sp))
+            self.assertParticles(
+                self.world.list_particles_exact_as_arrays(sp),
+                self.world.list_particles_exact(sp))
+
+        arrays = self.world.list_particles_as_arrays()
+        self.assertEqual(len(arrays["species"]), 2)
+        self.assertEqual(len(arrays["species_index"]), 25)
+
+    def test_empty(self):
+        arrays = self.world.list_particles_as_arrays()
+        self.assertEqual(len(arrays["species"]), 0)
+        self.assertEqual(arrays["positions"].shape, (0, 3))
+        self.assertEqual(arrays["radii"].shape, (0, ))
+
+    def test_shape_mismatch(self):
+        with self.assertRaises(ValueError):
+            self.world.new_particles(self.species, self.species_index[: 24], self.positions)
+        with self.assertRaises(ValueError):
+            self.world.new_particles(self.species, self.species_index, self.positions[:, : 2])
+        with self.assertRaises(ValueError):
+            self.world.new_particles(
+                self.species, self.species_index, self.positions, numpy.ones(24), numpy.ones(24))
+        with self.assertRaises(ValueError):
+            self.world.new_particles(
+                self.species, self.species_index, self.positions, radii=numpy.ones(25))
+        self.assertEqual(self.world.num_particles(), 0)
+
+    def test_out_of_range(self):
+        species_index = self.species_index.copy()
+        species_index[3] = 2
+        with self.assertRaises(IndexError):
+            self.world.new_particles(self.species, species_index, self.positions)
+        species_index[3] = -1
+        with self.assertRaises(IndexError):
+            self.world.new_particles(self.species, species_index, self.positions)
+        self.assertEqual(self.world.num_particles(), 0)
+
+
+if __name__ == '__main__':
+    unittest.main()